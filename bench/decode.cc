@@ -0,0 +1,193 @@
+#include <dballe/file.h>
+#include <dballe/importer.h>
+#include <dballe/core/benchmark.h>
+#include <dballe/msg/msg.h>
+#include <wreport/var.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+// Count all allocations made by the program
+static std::atomic<size_t> allocations(0);
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if (void* res = malloc(size ? size : 1))
+        return res;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+/// Number of allocations done by a task, per decoded message
+struct AllocationCount
+{
+    std::string name;
+    size_t allocations = 0;
+    size_t messages = 0;
+
+    void print() const
+    {
+        fprintf(stdout, "%s: %zu messages, %.1f allocations per message\n",
+                name.c_str(), messages, messages ? (double)allocations / messages : 0.0);
+    }
+};
+
+struct AllocationTask : public dballe::benchmark::Task
+{
+    AllocationCount count;
+    std::string m_name;
+
+    AllocationTask(const std::string& name) : m_name(name) { count.name = name; }
+
+    const char* name() const override { return m_name.c_str(); }
+
+    /// Run the task once, returning the number of messages it produced
+    virtual size_t run_counted() = 0;
+
+    void run_once() override
+    {
+        size_t start = allocations;
+        size_t messages = run_counted();
+        count.allocations += allocations - start;
+        count.messages += messages;
+    }
+};
+
+/**
+ * Decode all the messages of a file, either into new messages, or reusing the
+ * messages decoded previously
+ */
+struct BenchmarkDecode : public AllocationTask
+{
+    const char* pathname;
+    bool reuse;
+    std::vector<dballe::BinaryMessage> encoded;
+    std::unique_ptr<dballe::Importer> importer;
+
+    BenchmarkDecode(const std::string& name, const char* pathname, bool reuse)
+        : AllocationTask((reuse ? "reuse-" : "decode-") + name), pathname(pathname), reuse(reuse) {}
+
+    void setup() override
+    {
+        auto in = dballe::File::create(dballe::Encoding::BUFR, pathname, "rb");
+        in->foreach([&](const dballe::BinaryMessage& msg) {
+            encoded.push_back(msg);
+            return true;
+        });
+        importer = dballe::Importer::create(dballe::Encoding::BUFR);
+    }
+
+    size_t run_counted() override
+    {
+        size_t res = 0;
+        std::vector<std::shared_ptr<dballe::Message>> msgs;
+        for (const auto& msg: encoded)
+        {
+            if (reuse)
+                importer->from_binary(msg, msgs);
+            else
+                msgs = importer->from_binary(msg);
+            res += msgs.size();
+        }
+        return res;
+    }
+
+    void teardown() override
+    {
+        encoded.clear();
+        importer.reset();
+    }
+};
+
+/**
+ * Copy all the decoded messages of a file into a message, either creating a
+ * new message each time, or recycling the same one
+ */
+struct BenchmarkFill : public AllocationTask
+{
+    const char* pathname;
+    bool recycle;
+    dballe::benchmark::Messages messages;
+
+    BenchmarkFill(const std::string& name, const char* pathname, bool recycle)
+        : AllocationTask((recycle ? "recycle-" : "fill-") + name), pathname(pathname), recycle(recycle) {}
+
+    void setup() override
+    {
+        messages.load(pathname);
+    }
+
+    void fill(const dballe::Message& src, dballe::impl::Message& dest)
+    {
+        src.foreach_var([&](const dballe::Level& level, const dballe::Trange& trange, const wreport::Var& var) {
+            dest.set(level, trange, var);
+            return true;
+        });
+    }
+
+    size_t run_counted() override
+    {
+        size_t res = 0;
+        dballe::impl::Message recycled;
+        for (const auto& msgs: messages)
+            for (const auto& msg: msgs)
+            {
+                if (recycle)
+                {
+                    recycled.recycle();
+                    fill(*msg, recycled);
+                } else {
+                    dballe::impl::Message dest;
+                    fill(*msg, dest);
+                }
+                ++res;
+            }
+        return res;
+    }
+
+    void teardown() override
+    {
+        messages.clear();
+    }
+};
+
+int main(int argc, const char* argv[])
+{
+    using namespace dballe::benchmark;
+
+    struct { const char* name; const char* pathname; } files[] = {
+        { "synop", "extra/bufr/synop-rad1.bufr" },
+        { "temp", "extra/bufr/temp-huge.bufr" },
+        { "acars", "extra/bufr/gts-acars2.bufr" },
+    };
+
+    std::vector<std::unique_ptr<AllocationTask>> tasks;
+    for (const auto& f: files)
+    {
+        tasks.emplace_back(new BenchmarkDecode(f.name, f.pathname, false));
+        tasks.emplace_back(new BenchmarkDecode(f.name, f.pathname, true));
+        tasks.emplace_back(new BenchmarkFill(f.name, f.pathname, false));
+        tasks.emplace_back(new BenchmarkFill(f.name, f.pathname, true));
+    }
+
+    Benchmark benchmark;
+    dballe::benchmark::Whitelist whitelist(argc, argv);
+
+    for (auto& task: tasks)
+        if (whitelist.has(task->name()))
+            benchmark.timeit(*task, 5);
+
+    benchmark.print_timings();
+
+    for (const auto& task: tasks)
+        if (task->count.messages)
+            task->count.print();
+    return 0;
+}
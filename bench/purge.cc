@@ -0,0 +1,80 @@
+#include <dballe/db/db.h>
+#include <dballe/core/benchmark.h>
+#include <dballe/core/query.h>
+#include <dballe/msg/msg.h>
+#include <vector>
+
+/// Purge old data from an in-memory database, rolling back after each run
+struct BenchmarkPurge : public dballe::benchmark::Task
+{
+    dballe::benchmark::Messages messages;
+    std::shared_ptr<dballe::db::DB> db;
+    const char* m_name;
+    const char* m_pathname;
+
+    BenchmarkPurge(const char* name, const char* pathname)
+        : m_name(name), m_pathname(pathname)
+    {
+        db = dballe::db::DB::connect_memory();
+    }
+
+    const char* name() const override { return m_name; }
+
+    void setup() override
+    {
+        db->reset();
+        messages.load(m_pathname);
+
+        // Multiply messages by changing their datetime
+        size_t size = messages.size();
+        for (unsigned year = 2016; year < 2018; ++year)
+            for (unsigned month = 1; month <= 12; ++month)
+                for (unsigned hour = 0; hour < 24; ++hour)
+                    messages.duplicate(size, dballe::Datetime(year, month, 1, hour));
+
+        auto tr = db->transaction();
+        for (const auto& msgs: messages)
+            tr->import_messages(msgs);
+        tr->commit();
+    }
+
+    void run_once() override
+    {
+        auto tr = std::dynamic_pointer_cast<dballe::db::Transaction>(db->transaction());
+        // Remove every other month
+        for (unsigned year = 2016; year < 2018; ++year)
+            for (unsigned month = 1; month <= 12; month += 2)
+            {
+                dballe::core::Query query;
+                query.dtrange.min = dballe::Datetime(year, month, 1);
+                query.dtrange.max = dballe::Datetime(year, month, 1, 23, 59, 59);
+                tr->remove_data(query);
+            }
+        tr->purge_before(dballe::Datetime(2017, 1, 1));
+        tr->rollback();
+    }
+
+    void teardown() override
+    {
+        db->remove_all();
+    }
+};
+
+int main(int argc, const char* argv[])
+{
+    using namespace dballe::benchmark;
+    dballe::benchmark::Task* tasks[] = {
+        new BenchmarkPurge("synop", "extra/bufr/synop-rad1.bufr"),
+        new BenchmarkPurge("acars", "extra/bufr/gts-acars2.bufr"),
+    };
+
+    Benchmark benchmark;
+    dballe::benchmark::Whitelist whitelist(argc, argv);
+
+    for (auto task: tasks)
+        if (whitelist.has(task->name()))
+            benchmark.timeit(*task, 5);
+
+    benchmark.print_timings();
+    return 0;
+}
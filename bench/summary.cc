@@ -0,0 +1,131 @@
+#include <dballe/db/summary_memory.h>
+#include <dballe/core/benchmark.h>
+#include <dballe/core/query.h>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+/// Regional summaries to merge into a global one
+struct Regions
+{
+    std::vector<std::shared_ptr<dballe::db::SummaryMemory>> summaries;
+
+    Regions(unsigned count=40, unsigned stations=2000)
+    {
+        const wreport::Varcode varcodes[] = {
+            WR_VAR(0, 12, 101), WR_VAR(0, 12, 103), WR_VAR(0, 13, 3), WR_VAR(0, 13, 11),
+            WR_VAR(0, 11, 1), WR_VAR(0, 11, 2), WR_VAR(0, 10, 4), WR_VAR(0, 20, 1),
+        };
+        for (unsigned region = 0; region < count; ++region)
+        {
+            auto summary = std::make_shared<dballe::db::SummaryMemory>();
+            for (unsigned i = 0; i < stations; ++i)
+            {
+                dballe::Station station;
+                station.report = i % 2 ? "synop" : "locali";
+                // Neighbouring regions overlap by half their stations
+                station.coords = dballe::Coords((int)(region * stations / 2 + i) % 9000000, (int)i * 100);
+                for (auto code: varcodes)
+                    for (unsigned month = 1; month <= 12; month += 4)
+                    {
+                        dballe::db::summary::VarDesc vd(dballe::Level(1), dballe::Trange(254, 0, 0), code);
+                        dballe::DatetimeRange dtrange(dballe::Datetime(2020, month, 1), dballe::Datetime(2020, month + 3, 1));
+                        summary->add(station, vd, dtrange, 100);
+                        vd.level = dballe::Level(103, 2000);
+                        summary->add(station, vd, dtrange, 100);
+                    }
+            }
+            summaries.push_back(summary);
+        }
+    }
+};
+
+/// Merge all regional summaries using the given number of threads
+struct BenchmarkMerge : public dballe::benchmark::Task
+{
+    const Regions& regions;
+    std::string m_name;
+    unsigned threads;
+
+    BenchmarkMerge(const Regions& regions, unsigned threads)
+        : regions(regions), m_name("merge-" + std::to_string(threads)), threads(threads)
+    {
+    }
+
+    const char* name() const override { return m_name.c_str(); }
+
+    void setup() override
+    {
+        setenv("DBA_THREADS", std::to_string(threads).c_str(), 1);
+    }
+
+    void run_once() override
+    {
+        dballe::db::SummaryMemory global;
+        for (const auto& summary: regions.summaries)
+            global.add_summary(*summary);
+        global.data_count();
+    }
+};
+
+/// Filter a global summary using the given number of threads
+struct BenchmarkFilter : public dballe::benchmark::Task
+{
+    std::shared_ptr<dballe::db::SummaryMemory> global;
+    std::string m_name;
+    unsigned threads;
+
+    BenchmarkFilter(const Regions& regions, unsigned threads)
+        : global(std::make_shared<dballe::db::SummaryMemory>()), m_name("filter-" + std::to_string(threads)), threads(threads)
+    {
+        for (const auto& summary: regions.summaries)
+            global->add_summary(*summary);
+    }
+
+    const char* name() const override { return m_name.c_str(); }
+
+    void setup() override
+    {
+        setenv("DBA_THREADS", std::to_string(threads).c_str(), 1);
+    }
+
+    void run_once() override
+    {
+        dballe::core::Query query;
+        query.report = "synop";
+        query.dtrange.min = dballe::Datetime(2020, 6, 1);
+        query.dtrange.max = dballe::Datetime(2020, 7, 1);
+        dballe::db::BaseSummaryMemoryView<dballe::Station> view(global, query);
+        view.data_count();
+    }
+};
+
+int main(int argc, const char* argv[])
+{
+    using namespace dballe::benchmark;
+
+    Regions regions;
+
+    std::vector<unsigned> thread_counts;
+    unsigned max_threads = std::thread::hardware_concurrency();
+    for (unsigned threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads ? max_threads : 1);
+
+    std::vector<std::unique_ptr<Task>> tasks;
+    for (auto threads: thread_counts)
+        tasks.emplace_back(new BenchmarkMerge(regions, threads));
+    for (auto threads: thread_counts)
+        tasks.emplace_back(new BenchmarkFilter(regions, threads));
+
+    Benchmark benchmark;
+    dballe::benchmark::Whitelist whitelist(argc, argv);
+
+    for (auto& task: tasks)
+        if (whitelist.has(task->name()))
+            benchmark.timeit(*task, 5);
+
+    benchmark.print_timings();
+    return 0;
+}
@@ -3,8 +3,11 @@
 #include "dballe/db/v7/transaction.h"
 #include "dballe/cmdline/dbadb.h"
 #include "dballe/core/arrayfile.h"
+#include "dballe/core/csv.h"
 #include "dballe/msg/msg.h"
 #include "config.h"
+#include <map>
+#include <sstream>
 
 using namespace dballe;
 using namespace dballe::cmdline;
@@ -90,6 +93,164 @@ this->add_method("issue62", [](Fixture& f) {
     wassert(actual(msg->get_datetime()) == Datetime(2016, 3, 14, 23, 0, 4));
 });
 
+this->add_method("export_subsets", [](Fixture& f) {
+    Dbadb dbadb(*f.db);
+
+    cmdline::ReaderOptions opts;
+    cmdline::Reader reader(opts);
+    wassert(actual(dbadb.do_import(dballe::tests::datafile("bufr/synop3new.bufr"), reader, DBImportOptions::defaults)) == 0);
+
+    core::Query query;
+    core::ArrayFile single(Encoding::BUFR);
+    wassert(actual(dbadb.do_export(query, single, "", nullptr)) == 0);
+    wassert(actual(single.msgs.size()) > 1u);
+
+    impl::ExporterOptions export_opts;
+    export_opts.max_subsets = 100;
+    export_opts.compress = true;
+    core::ArrayFile batched(Encoding::BUFR);
+    wassert(actual(dbadb.do_export(query, batched, export_opts, nullptr, 2)) == 0);
+    wassert(actual(batched.msgs.size()) < single.msgs.size());
+
+    // The same messages are exported, in the same order
+    auto importer = Importer::create(Encoding::BUFR);
+    impl::Messages expected;
+    for (const auto& msg: single.msgs)
+        for (const auto& m: importer->from_binary(msg))
+            expected.push_back(m);
+    impl::Messages decoded;
+    for (const auto& msg: batched.msgs)
+        for (const auto& m: importer->from_binary(msg))
+            decoded.push_back(m);
+    wassert(actual(decoded.size()) == expected.size());
+    for (unsigned i = 0; i < decoded.size(); ++i)
+        wassert(actual(decoded[i]->diff(*expected[i])) == 0u);
+});
+
+this->add_method("export_csv", [](Fixture& f) {
+    Dbadb dbadb(*f.db);
+
+    cmdline::ReaderOptions opts;
+    cmdline::Reader reader(opts);
+    wassert(actual(dbadb.do_import(dballe::tests::datafile("bufr/obs0-1.22.bufr"), reader, DBImportOptions::defaults)) == 0);
+    wassert(actual(dbadb.do_import(dballe::tests::datafile("bufr/obs1-11.16.bufr"), reader, DBImportOptions::defaults)) == 0);
+
+    // Add a mobile station with station data and values at several datetimes
+    {
+        auto tr = f.db->transaction();
+        core::Data vals;
+        vals.station.report = "ship";
+        vals.station.coords = Coords(44.10, 11.50);
+        vals.station.ident = "MOBILE1";
+        vals.level = Level(103, 2000);
+        vals.trange = Trange::instant();
+        for (int hour = 0; hour < 3; ++hour)
+        {
+            vals.clear_ids();
+            vals.datetime = Datetime(2015, 4, 25, hour);
+            vals.values.set("B12101", 280.0 + hour);
+            tr->insert_data(vals);
+        }
+        core::Data svals;
+        svals.station.report = "ship";
+        svals.station.coords = Coords(44.10, 11.50);
+        svals.station.ident = "MOBILE1";
+        svals.values.set("B01019", "Test ship");
+        tr->insert_station_data(svals);
+
+        // And a station with only station values
+        core::Data only;
+        only.station.report = "synop";
+        only.station.coords = Coords(45.0, 12.0);
+        only.values.set("B01019", "Station only");
+        tr->insert_station_data(only);
+        tr->commit();
+    }
+
+    auto export_csv = [&](const core::Query& query) {
+        FILE* out = tmpfile();
+        wassert(actual(dbadb.do_export_csv(query, out)) == 0);
+        rewind(out);
+        std::string data;
+        char buf[4096];
+        size_t len;
+        while ((len = fread(buf, 1, 4096, out)) > 0)
+            data.append(buf, len);
+        fclose(out);
+        return data;
+    };
+
+    core::Query query;
+    std::string data = export_csv(query);
+
+    // The CSV can be read back as messages, with the same data as exported
+    // by query_messages
+    std::stringstream in(data);
+    CSVReader csv(in);
+    auto cursor = f.db->query_messages(query);
+    // Station values of each station, which are written only before its
+    // first datetime
+    std::map<std::string, Values> station_data;
+    unsigned count = 0;
+    unsigned mobile_count = 0;
+    while (cursor->next())
+    {
+        auto expected = impl::Message::downcast(cursor->get_message());
+        impl::Message msg;
+        wassert_true(msg.from_csv(csv));
+        wassert(actual(msg.get_report()) == expected->get_report());
+        wassert(actual(msg.get_coords()) == expected->get_coords());
+        wassert(actual(msg.get_datetime()) == expected->get_datetime());
+
+        Coords coords = expected->get_coords();
+        Values& sdata = station_data[expected->get_report() + " " + std::to_string(coords.lat) + " " + std::to_string(coords.lon)];
+        sdata.merge(msg.station_data);
+        for (const auto& val: expected->station_data)
+        {
+            const Var* var = sdata.maybe_var(val->code());
+            wassert_true(var);
+            wassert(actual(var->format()) == val->format());
+        }
+        if (!expected->get_ident().is_missing())
+            ++mobile_count;
+
+        wassert(actual(msg.data.size()) == expected->data.size());
+        for (const auto& ctx: expected->data)
+            for (const auto& val: ctx.values)
+            {
+                const Var* var = msg.get(ctx.level, ctx.trange, val->code());
+                wassert_true(var);
+                wassert(actual(var->format()) == val->format());
+            }
+        ++count;
+    }
+    wassert(actual(count) > 3u);
+    wassert(actual(mobile_count) == 3u);
+
+    // Stations with no measured values come last
+    impl::Message only;
+    wassert_true(only.from_csv(csv));
+    wassert(actual(only.get_coords()) == Coords(45.0, 12.0));
+    wassert(actual(only.data.size()) == 0u);
+    wassert(actual(only.station_data.maybe_var(WR_VAR(0, 1, 19))->format()) == "Station only");
+
+    impl::Message msg;
+    wassert_false(msg.from_csv(csv));
+
+    // Unsorted exports also write station information only once per station
+    query.query = "nosort";
+    data = export_csv(query);
+    auto occurrences = [&](const std::string& s) {
+        unsigned res = 0;
+        for (size_t pos = data.find(s); pos != std::string::npos; pos = data.find(s, pos + 1))
+            ++res;
+        return res;
+    };
+    wassert(actual(occurrences("Test ship")) == 1u);
+    wassert(actual(occurrences("MOBILE1")) == 1u);
+    wassert(actual(occurrences("Station only")) == 1u);
+});
+
 }
 
 }
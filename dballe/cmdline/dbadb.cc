@@ -1,10 +1,17 @@
 #include "dbadb.h"
 #include "dballe/message.h"
 #include "dballe/msg/msg.h"
+#include "dballe/msg/parallel_encoder.h"
 #include "dballe/values.h"
+#include "dballe/var.h"
+#include "dballe/core/csv.h"
+#include "dballe/core/query.h"
 #include "dballe/db/db.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/memory/archive.h"
 
 #include <cstdlib>
+#include <set>
 
 using namespace wreport;
 using namespace std;
@@ -99,6 +106,123 @@ int Dbadb::do_export_dump(const Query& query, FILE* out)
     return 0;
 }
 
+int Dbadb::do_export_csv(const Query& query, FILE* out)
+{
+    CSVFileWriter writer(out);
+    impl::Message::csv_header(writer);
+
+    auto tr = db.transaction();
+    auto cursor = tr->query_data(query);
+    DBStation station;
+    string lat, lon;
+    char buf[32];
+    bool first = true;
+    // Stations whose station information has already been written
+    std::set<int> written;
+
+    // Write a station value, leaving date, level and time range empty as
+    // Message::to_csv does
+    auto write_station_value = [&](const std::string& code, const Var& var) {
+        writer.add_value_raw(lon);
+        writer.add_value_raw(lat);
+        writer.add_value(station.report);
+        for (int i = 0; i < 8; ++i)
+            writer.add_value_empty();
+        writer.add_value(code);
+        writer.add_var_value_formatted(var);
+        writer.flush_row();
+    };
+
+    // Select the station of the following rows, and write its station
+    // information the first time it is seen
+    auto set_station = [&](const DBStation& cur_station) {
+        station = cur_station;
+        snprintf(buf, 32, "%.5f", station.coords.dlon());
+        lon = buf;
+        snprintf(buf, 32, "%.5f", station.coords.dlat());
+        lat = buf;
+
+        if (!written.insert(station.id).second)
+            return;
+
+        if (!station.ident.is_missing())
+            write_station_value(varcode_format(WR_VAR(0, 1, 11)), *newvar(WR_VAR(0, 1, 11), (const char*)station.ident));
+
+        core::Query station_query;
+        station_query.ana_id = station.id;
+        station_query.query = core::Query::downcast(query).query;
+        auto station_cursor = tr->query_station_data(station_query);
+        while (station_cursor->next())
+        {
+            Var var = station_cursor->get_var();
+            write_station_value(varcode_format(var.code()), var);
+            for (const Var* a = var.next_attr(); a != NULL; a = a->next_attr())
+                write_station_value(varcode_format(var.code()) + "." + varcode_format(a->code()), *a);
+        }
+    };
+
+    while (cursor->next())
+    {
+        DBStation cur_station = cursor->get_station();
+        if (first || cur_station != station)
+        {
+            set_station(cur_station);
+            first = false;
+        }
+
+        Datetime datetime = cursor->get_datetime();
+        Level level = cursor->get_level();
+        Trange trange = cursor->get_trange();
+        Var var = cursor->get_var();
+
+        writer.add_value_raw(lon);
+        writer.add_value_raw(lat);
+        writer.add_value(station.report);
+        datetime.to_csv_iso8601(writer, ' ');
+        level.to_csv(writer);
+        trange.to_csv(writer);
+        writer.add_value(var.code());
+        writer.add_var_value_formatted(var);
+        writer.flush_row();
+
+        for (const Var* a = var.next_attr(); a != NULL; a = a->next_attr())
+        {
+            writer.add_value_raw(lon);
+            writer.add_value_raw(lat);
+            writer.add_value(station.report);
+            datetime.to_csv_iso8601(writer, ' ');
+            level.to_csv(writer);
+            trange.to_csv(writer);
+            writer.add_value(varcode_format(var.code()) + "." + varcode_format(a->code()));
+            writer.add_var_value_formatted(*a);
+            writer.flush_row();
+        }
+    }
+
+    // Stations that have no measured values
+    auto station_cursor = tr->query_stations(query);
+    while (station_cursor->next())
+    {
+        DBStation cur_station = station_cursor->get_station();
+        if (written.find(cur_station.id) == written.end())
+            set_station(cur_station);
+    }
+
+    tr->rollback();
+    writer.flush();
+    return 0;
+}
+
+int Dbadb::do_archive(const Query& query, const std::string& pathname)
+{
+    auto tr = dynamic_pointer_cast<db::v7::Transaction>(db.transaction(true));
+    if (!tr)
+        throw error_unimplemented("archives can only be created from V7 databases");
+    db::v7::memory::write_archive(*tr, core::Query::downcast(query), pathname);
+    tr->rollback();
+    return 0;
+}
+
 int Dbadb::do_import(const list<string>& fnames, Reader& reader, const DBImportOptions& opts)
 {
     Importer importer(db, opts);
@@ -131,10 +255,12 @@ int Dbadb::do_export(const Query& query, File& file, const char* output_template
     impl::ExporterOptions opts;
     if (output_template && output_template[0] != 0)
         opts.template_name = output_template;
+    return do_export(query, file, opts, forced_repmemo);
+}
 
-    if (forced_repmemo)
-        forced_repmemo = forced_repmemo;
-    auto exporter = Exporter::create(file.encoding(), opts);
+int Dbadb::do_export(const Query& query, File& file, const ExporterOptions& opts, const char* forced_repmemo, unsigned threads)
+{
+    impl::ParallelEncoder encoder(file.encoding(), opts, [&](const std::string& data) { file.write(data); }, threads);
 
     auto cursor = db.query_messages(query);
     while (cursor->next())
@@ -147,10 +273,9 @@ int Dbadb::do_export(const Query& query, File& file, const char* output_template
             m.type = impl::Message::type_from_repmemo(forced_repmemo);
             m.set_rep_memo(forced_repmemo);
         }
-        std::vector<std::shared_ptr<Message>> msgs;
-        msgs.emplace_back(move(msg));
-        file.write(exporter->to_binary(msgs));
+        encoder.add(msg);
     }
+    encoder.flush();
     return 0;
 }
 
@@ -28,6 +28,14 @@ public:
     /// Export messages and dump their contents to the given file descriptor
     int do_export_dump(const Query& query, FILE* out);
 
+    /**
+     * Export data as CSV, in the format read by impl::Message::from_csv.
+     *
+     * Rows are written straight from the data cursor, one per value (plus
+     * one per attribute), without building intermediate messages.
+     */
+    int do_export_csv(const Query& query, FILE* out);
+
     /// Import the given files
     int do_import(const std::list<std::string>& fnames, Reader& reader, const DBImportOptions& opts);
 
@@ -36,6 +44,19 @@ public:
 
     /// Export messages writing them to the givne file
     int do_export(const Query& query, File& file, const char* output_template=NULL, const char* forced_repmemo=NULL);
+
+    /**
+     * Export messages writing them to the given file.
+     *
+     * Messages are encoded on \a threads worker threads (0 means
+     * core::default_concurrency()), and written in order. opts.max_subsets
+     * and opts.compress control how consecutive messages are grouped in
+     * bulletins.
+     */
+    int do_export(const Query& query, File& file, const ExporterOptions& opts, const char* forced_repmemo=NULL, unsigned threads=0);
+
+    /// Write a read-only archive with the data selected by the query
+    int do_archive(const Query& query, const std::string& pathname);
 };
 
 
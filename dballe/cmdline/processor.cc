@@ -56,7 +56,7 @@ void Item::set_msgs(std::vector<std::shared_ptr<dballe::Message>>* new_msgs)
     msgs = new_msgs;
 }
 
-void Item::decode(Importer& imp, bool print_errors)
+void Item::decode(Importer& imp, bool print_errors, std::vector<std::shared_ptr<dballe::Message>>* reuse)
 {
     if (!rmsg) return;
 
@@ -106,7 +106,13 @@ void Item::decode(Importer& imp, bool print_errors)
             {
                 msgs = new std::vector<std::shared_ptr<dballe::Message>>;
                 try {
-                    *msgs = dynamic_cast<const BulletinImporter*>(&imp)->from_bulletin(*bulletin);
+                    const BulletinImporter& bimp = dynamic_cast<const BulletinImporter&>(imp);
+                    if (reuse)
+                    {
+                        msgs->swap(*reuse);
+                        bimp.from_bulletin(*bulletin, *msgs);
+                    } else
+                        *msgs = bimp.from_bulletin(*bulletin);
                 } catch (error& e) {
                     if (print_errors) print_parse_error(*rmsg, e);
                     delete msgs;
@@ -205,6 +211,28 @@ bool Filter::match_index(int idx) const
     return imatcher.match(idx);
 }
 
+bool Filter::is_selective() const
+{
+    return category != -1 || subcategory != -1 || !imatcher.ranges.empty() || matcher != nullptr;
+}
+
+bool Filter::match_index_entry(const impl::FileIndexEntry& entry) const
+{
+    if (!match_index(entry.index))
+        return false;
+
+    if (category != -1 && entry.category != -1 && category != entry.category)
+        return false;
+
+    if (subcategory != -1 && entry.subcategory != -1 && subcategory != entry.subcategory)
+        return false;
+
+    if (matcher && matcher->match(impl::MatchedFileIndexEntry(entry)) == matcher::MATCH_NO)
+        return false;
+
+    return true;
+}
+
 bool Filter::match_common(const BinaryMessage&, const std::vector<std::shared_ptr<dballe::Message>>* msgs) const
 {
     if (msgs == NULL && parsable)
@@ -377,6 +405,11 @@ void Reader::read_file(const std::list<std::string>& fnames, Action& action)
     do
     {
         unique_ptr<File> file;
+        // Sidecar index of the file, used to skip messages that cannot match
+        unique_ptr<impl::FileIndex> index;
+
+        if (name != fnames.end() && filter.is_selective())
+            index = impl::FileIndex::load_sidecar(*name);
 
         if (input_type == "auto")
         {
@@ -398,24 +431,38 @@ void Reader::read_file(const std::list<std::string>& fnames, Action& action)
             }
         }
 
+        // Ignore indices made reading the file with a different encoding
+        if (index && !index->entries.empty() && index->entries[0].encoding != file->encoding())
+            index.reset();
 
         std::unique_ptr<Importer> imp = Importer::create(file->encoding(), import_opts);
-        while (BinaryMessage bm = file->read())
-        {
+        // Messages of the previous item, reused for decoding the next one
+        std::vector<std::shared_ptr<dballe::Message>> reuse;
+        auto process = [&](const BinaryMessage& bm) -> bool {
             Item item;
             item.rmsg = new BinaryMessage(bm);
             item.idx = bm.index;
             bool processed = false;
 
+            // Give the decoded messages back for reuse when done with the
+            // item. Actions that keep messages hold references to them, which
+            // prevents their reuse
+            struct GiveBack
+            {
+                Item& item;
+                std::vector<std::shared_ptr<dballe::Message>>& reuse;
+                ~GiveBack() { if (item.msgs) reuse.swap(*item.msgs); }
+            } give_back{item, reuse};
+
             try {
     //          if (op_verbose)
     //              fprintf(stderr, "Reading message #%d...\n", item.index);
 
                 if (!filter.match_index(item.idx))
-                    continue;
+                    return true;
 
                 try {
-                    item.decode(*imp, print_errors);
+                    item.decode(*imp, print_errors, &reuse);
                 } catch (std::exception& e) {
                     // Convert decode errors into ProcessingException, to skip
                     // this item if it fails to decode. We can safely skip,
@@ -427,7 +474,7 @@ void Reader::read_file(const std::list<std::string>& fnames, Action& action)
                 //process_input(*file, rmsg, grepdata, action);
 
                 if (!filter.match_item(item))
-                    continue;
+                    return true;
 
                 processed = action(item);
             } catch (ProcessingException& pe) {
@@ -453,7 +500,13 @@ void Reader::read_file(const std::list<std::string>& fnames, Action& action)
                 ++count_successes;
             else
                 ++count_failures;
-        }
+            return true;
+        };
+
+        if (index)
+            index->foreach(*file, [&](const impl::FileIndexEntry& e) { return filter.match_index_entry(e); }, process);
+        else
+            file->foreach(process);
     } while (name != fnames.end());
 }
 
@@ -4,6 +4,7 @@
 #include <dballe/importer.h>
 #include <dballe/exporter.h>
 #include <dballe/msg/msg.h>
+#include <dballe/msg/fileindex.h>
 #include <stdexcept>
 #include <list>
 #include <string>
@@ -105,8 +106,13 @@ struct Item
     Item();
     ~Item();
 
-    /// Decode all that can be decoded
-    void decode(Importer& imp, bool print_errors=false);
+    /**
+     * Decode all that can be decoded.
+     *
+     * If \a reuse is not nullptr, decoding reuses the messages in it that
+     * are not referenced anywhere else (see Importer::foreach_decoded_reusing)
+     */
+    void decode(Importer& imp, bool print_errors=false, std::vector<std::shared_ptr<Message>>* reuse=nullptr);
 
     /// Set the value of msgs, possibly replacing the previous one
     void set_msgs(std::vector<std::shared_ptr<Message>>* new_msgs);
@@ -166,6 +172,10 @@ struct Filter
     void matcher_from_record(const Query& query);
 
     bool match_index(int idx) const;
+    /// Check if the filter uses anything besides parsable/unparsable
+    bool is_selective() const;
+    /// Check if a message summarised by a file index entry can match
+    bool match_index_entry(const impl::FileIndexEntry& entry) const;
     bool match_common(const BinaryMessage& rmsg, const std::vector<std::shared_ptr<dballe::Message>>* msgs) const;
     bool match_msgs(const std::vector<std::shared_ptr<dballe::Message>>& msgs) const;
     bool match_bufrex(const BinaryMessage& rmsg, const wreport::Bulletin* rm, const std::vector<std::shared_ptr<dballe::Message>>* msgs) const;
@@ -201,6 +201,71 @@ class Tests : public TestCase
             wassert(actual(in.cols[4]) == "\n");
             wassert(actual(in.next()).isfalse());
         });
+
+        // Test reading rows that span input chunks
+        add_method("chunks", []() {
+            string data;
+            // Make the quoted column straddle the first chunk boundary
+            data.append(CSVReader::chunk_size - 3, 'a');
+            data += ",\"b\"\"c\"\r\n";
+            for (unsigned i = 0; i < 10000; ++i)
+                data += "1,\"2,3\",,4\n";
+            data += "x,y";
+
+            stringstream in(data);
+            CSVReader reader(in);
+            wassert(actual(reader.next()).istrue());
+            wassert(actual(reader.cols.size()) == 2u);
+            wassert(actual(reader.cols[0].size()) == CSVReader::chunk_size - 3);
+            wassert(actual(reader.cols[1]) == "b\"c");
+            for (unsigned i = 0; i < 10000; ++i)
+            {
+                wassert(actual(reader.next()).istrue());
+                wassert(actual(reader.cols.size()) == 4u);
+                wassert(actual(reader.cols[0]) == "1");
+                wassert(actual(reader.cols[1]) == "2,3");
+                wassert(actual(reader.cols[2]) == "");
+                wassert(actual(reader.cols[3]) == "4");
+            }
+            wassert(actual(reader.next()).istrue());
+            wassert(actual(reader.cols.size()) == 2u);
+            wassert(actual(reader.cols[0]) == "x");
+            wassert(actual(reader.cols[1]) == "y");
+            wassert(actual(reader.next()).isfalse());
+        });
+
+        // Test buffered writing to a FILE
+        add_method("file_writer", []() {
+            FILE* out = tmpfile();
+            {
+                CSVFileWriter writer(out);
+                for (unsigned i = 0; i < 20000; ++i)
+                {
+                    writer.add_value(i);
+                    writer.add_value("a,b");
+                    writer.flush_row();
+                }
+                writer.flush();
+            }
+            wassert(actual(ftell(out)) == 20000 * 7 + 10 * 1 + 90 * 2 + 900 * 3 + 9000 * 4 + 10000 * 5);
+            rewind(out);
+            string data;
+            char buf[4096];
+            size_t len;
+            while ((len = fread(buf, 1, 4096, out)) > 0)
+                data.append(buf, len);
+            fclose(out);
+
+            stringstream in(data);
+            CSVReader reader(in);
+            for (unsigned i = 0; i < 20000; ++i)
+            {
+                wassert(actual(reader.next()).istrue());
+                wassert(actual(reader.as_int(0)) == (int)i);
+                wassert(actual(reader.cols[1]) == "a,b");
+            }
+            wassert(actual(reader.next()).isfalse());
+        });
     }
 } test("core_csv");
 
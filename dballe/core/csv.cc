@@ -73,6 +73,8 @@ void CSVReader::open(const std::string& pathname)
 {
     close();
     close_on_exit = true;
+    buf.clear();
+    buf_pos = 0;
     in = new ifstream(pathname.c_str());
     if (in->fail())
         error_system::throwf("cannot open file %s", pathname.c_str());
@@ -140,131 +142,136 @@ bool CSVReader::move_to_data(unsigned number_col)
     return true;
 }
 
-int CSVReader::next_char()
+const size_t CSVReader::chunk_size;
+
+bool CSVReader::fill_buffer()
 {
-    int res = in->get();
-    if (res == EOF && !in->eof())
-        throw error_system("reading a character from CSV input");
-    return res;
+    buf_pos = 0;
+    buf.resize(chunk_size);
+    in->read(&buf[0], chunk_size);
+    if (in->bad())
+        throw error_system("reading a chunk of CSV input");
+    buf.resize(in->gcount());
+    return !buf.empty();
+}
+
+std::string& CSVReader::start_col(unsigned idx)
+{
+    if (idx < cols.size())
+        cols[idx].clear();
+    else
+        cols.emplace_back();
+    return cols[idx];
 }
 
 bool CSVReader::next()
 {
     if (!in) return false;
 
-    cols.clear();
-
     // Tokenize the input line
     enum State { BEG, COL, QCOL, EQCOL, HALFEOL } state = BEG;
-    string col;
-    int c;
-    while ((c = next_char()) != EOF)
+    unsigned ncols = 0;
+    string* col = &start_col(0);
+    while (buf_pos < buf.size() || fill_buffer())
     {
+        const char* s = buf.data() + buf_pos;
+        const char* e = buf.data() + buf.size();
         switch (state)
         {
             // Look for the beginning of a column value
             case BEG:
-                switch (c)
+                if (*s == '"')
                 {
-                    case '"':
-                        state = QCOL;
-                        break;
-                    case ',':
-                        state = BEG;
-                        cols.push_back(col);
-                        col.clear();
-                        break;
-                    case '\r':
-                        state = HALFEOL;
-                        break;
-                    case '\n':
-                        cols.push_back(col);
-                        return true;
-                    default:
-                        state = COL;
-                        col += c;
-                        break;
+                    state = QCOL;
+                    ++buf_pos;
+                    break;
                 }
-                break;
+                state = COL;
+                // Fallthrough
             // Inside a column value
             case COL:
-                switch (c)
+            {
+                // Copy the run of plain characters in one go
+                const char* p = s;
+                while (p != e && *p != ',' && *p != '\n' && *p != '\r')
+                    ++p;
+                col->append(s, p - s);
+                buf_pos += p - s;
+                if (p == e) break;
+                ++buf_pos;
+                switch (*p)
                 {
                     case ',':
                         state = BEG;
-                        cols.push_back(col);
-                        col.clear();
+                        col = &start_col(++ncols);
                         break;
                     case '\r':
                         state = HALFEOL;
                         break;
                     case '\n':
-                        cols.push_back(col);
+                        cols.resize(ncols + 1);
                         return true;
-                    default:
-                        col += c;
-                        break;
                 }
                 break;
+            }
             // Inside a quoted column value
             case QCOL:
-                switch (c)
-                {
-                    case '\"':
-                        state = EQCOL;
-                        break;
-                    default:
-                        col += c;
-                        break;
-                }
+            {
+                const char* p = (const char*)memchr(s, '"', e - s);
+                if (!p) p = e;
+                col->append(s, p - s);
+                buf_pos += p - s;
+                if (p == e) break;
+                ++buf_pos;
+                state = EQCOL;
                 break;
+            }
             // After a quote character found inside a quoted column value
             case EQCOL:
-                switch (c)
+                ++buf_pos;
+                switch (*s)
                 {
                     // The quote marked the end of the value
                     case ',':
                         state = BEG;
-                        cols.push_back(col);
-                        col.clear();
+                        col = &start_col(++ncols);
                         break;
                     case '\r':
                         state = HALFEOL;
                         break;
                     case '\n':
-                        cols.push_back(col);
+                        cols.resize(ncols + 1);
                         return true;
                     // The quote was an escape
                     default:
                         state = QCOL;
-                        col += c;
+                        *col += *s;
                         break;
                 }
                 break;
             // After \r was found
             case HALFEOL:
-                switch (c)
+                ++buf_pos;
+                switch (*s)
                 {
                     case '\n':
-                        cols.push_back(col);
+                        cols.resize(ncols + 1);
                         return true;
                     default:
                         state = COL;
-                        col += '\r';
-                        col += c;
+                        *col += '\r';
+                        *col += *s;
                         break;
                 }
                 break;
         }
     }
 
-    if (state == BEG)
-        return false;
-
-    if (!col.empty())
-        cols.push_back(col);
+    if (!col->empty())
+        ++ncols;
+    cols.resize(ncols);
 
-    return true;
+    return state != BEG;
 }
 
 bool csv_read_next(FILE* in, std::vector<std::string>& cols)
@@ -534,4 +541,34 @@ void CSVWriter::add_value(const std::string& val)
     row += '"';
 }
 
+CSVFileWriter::CSVFileWriter(FILE* out) : out(out) {}
+
+CSVFileWriter::~CSVFileWriter()
+{
+    try {
+        flush();
+    } catch (std::exception&) {
+        // Destructors cannot throw: use flush() explicitly to see errors
+    }
+}
+
+const size_t CSVFileWriter::flush_size;
+
+void CSVFileWriter::flush_row()
+{
+    buf.append(row);
+    buf += '\n';
+    row.clear();
+    if (buf.size() >= flush_size)
+        flush();
+}
+
+void CSVFileWriter::flush()
+{
+    if (buf.empty()) return;
+    if (fwrite(buf.data(), buf.size(), 1, out) != 1)
+        throw error_system("cannot write CSV data");
+    buf.clear();
+}
+
 }
@@ -52,8 +52,20 @@ class CSVReader
 {
 protected:
     std::istream* in;
+    /// Data read from in and not yet parsed
+    std::string buf;
+    /// Position in buf of the next character to parse
+    size_t buf_pos = 0;
 
-    int next_char();
+    /**
+     * Read the next chunk of input into buf.
+     *
+     * @returns false if the input has no more data
+     */
+    bool fill_buffer();
+
+    /// Return cols[idx], cleared, adding it if needed
+    std::string& start_col(unsigned idx);
 
 public:
     /**
@@ -64,9 +76,17 @@ public:
     /// Last line read
     std::string line;
 
-    /// Parsed CSV columns for the last line read
+    /**
+     * Parsed CSV columns for the last line read.
+     *
+     * The strings are reused across lines, to avoid reallocating them for
+     * every row.
+     */
     std::vector<std::string> cols;
 
+    /// Size of the chunks read from the input stream
+    static const size_t chunk_size = 65536;
+
     CSVReader();
     CSVReader(std::istream& in);
     CSVReader(const std::string& pathname);
@@ -115,7 +135,12 @@ public:
      */
     bool move_to_data(unsigned number_col=0);
 
-    /// Read the next CSV line, returning false if EOF is reached
+    /**
+     * Read the next CSV line, returning false if EOF is reached.
+     *
+     * Input is read in chunks of chunk_size bytes, and runs of characters
+     * without CSV syntax are copied into the columns in one go.
+     */
     bool next();
 
     static std::string unescape(const std::string& csvstr);
@@ -185,6 +210,33 @@ public:
     virtual void flush_row() = 0;
 };
 
+/**
+ * CSVWriter that accumulates rows in memory and writes them to a FILE in
+ * large blocks
+ */
+class CSVFileWriter : public CSVWriter
+{
+protected:
+    FILE* out;
+    /// Rows not yet written to out
+    std::string buf;
+
+public:
+    /// Size of buffered data after which flush_row() writes it out
+    static const size_t flush_size = 65536;
+
+    CSVFileWriter(FILE* out);
+    CSVFileWriter(const CSVFileWriter&) = delete;
+    /// Write out any pending rows, ignoring errors
+    ~CSVFileWriter();
+    CSVFileWriter& operator=(const CSVFileWriter&) = delete;
+
+    void flush_row() override;
+
+    /// Write all buffered rows to the output file
+    void flush();
+};
+
 
 }
 #endif
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <cstring>
 
 using namespace wreport;
 using namespace std;
@@ -44,6 +45,15 @@ bool File::foreach(std::function<bool(const BinaryMessage&)> dest)
     return true;
 }
 
+void File::seek(off_t offset, int index)
+{
+    if (fd == nullptr)
+        throw error_consistency("cannot seek in a closed file");
+    if (fseeko(fd, offset, SEEK_SET) == -1)
+        error_system::throwf("cannot seek to offset %jd in %s", (intmax_t)offset, m_name.c_str());
+    idx = index;
+}
+
 std::string File::resolve_test_data_file(const std::string& name)
 {
     // Skip appending the test data path for pathnames starting with ./
@@ -135,5 +145,132 @@ void JsonFile::write(const std::string& msg)
     //     error_system::throwf("cannot write JSON line terminator to %s", m_name.c_str());
 }
 
+
+MappedMessageFile::MappedMessageFile(const std::string& name, std::unique_ptr<core::MappedFile> mapping)
+    : m_name(name), mapping(std::move(mapping))
+{
+}
+
+void MappedMessageFile::close()
+{
+    mapping.reset();
+}
+
+BinaryMessage MappedMessageFile::read()
+{
+    if (!mapping)
+        throw error_consistency("cannot read from a closed file");
+    BinaryMessage res(encoding());
+    size_t begin, size;
+    if (!scan(begin, size))
+        return res;
+    res.data.assign((const char*)mapping->begin() + begin, size);
+    res.pathname = m_name;
+    res.offset = begin;
+    res.index = idx++;
+    return res;
+}
+
+bool MappedMessageFile::foreach(std::function<bool(const BinaryMessage&)> dest)
+{
+    if (!mapping)
+        throw error_consistency("cannot read from a closed file");
+    BinaryMessage msg(encoding());
+    msg.pathname = m_name;
+    size_t begin, size;
+    while (scan(begin, size))
+    {
+        msg.data.assign((const char*)mapping->begin() + begin, size);
+        msg.offset = begin;
+        msg.index = idx++;
+        if (!dest(msg))
+            return false;
+    }
+    return true;
+}
+
+void MappedMessageFile::seek(off_t offset, int index)
+{
+    if (!mapping)
+        throw error_consistency("cannot seek in a closed file");
+    if (offset < 0 || (size_t)offset > mapping->size())
+        error_consistency::throwf("cannot seek to offset %jd in %s, which is %zu bytes long", (intmax_t)offset, m_name.c_str(), mapping->size());
+    pos = offset;
+    idx = index;
+}
+
+void MappedMessageFile::write(const std::string& msg)
+{
+    error_unimplemented::throwf("%s is open read-only", m_name.c_str());
+}
+
+bool MappedBufrFile::scan(size_t& begin, size_t& size)
+{
+    const uint8_t* buf = mapping->begin();
+    size_t len = mapping->size();
+    while (pos + 4 <= len)
+    {
+        const uint8_t* found = (const uint8_t*)memmem(buf + pos, len - pos, "BUFR", 4);
+        if (!found)
+            break;
+        begin = found - buf;
+        if (begin + 8 > len)
+            error_consistency::throwf("%s: BUFR message at offset %zu is truncated in section 0", m_name.c_str(), begin);
+        // Total message length, as encoded in section 0
+        size = (buf[begin + 4] << 16) | (buf[begin + 5] << 8) | buf[begin + 6];
+        if (size < 12)
+            error_consistency::throwf("%s: BUFR message at offset %zu declares a length of %zu bytes, which is too short", m_name.c_str(), begin, size);
+        if (begin + size > len)
+            error_consistency::throwf("%s: BUFR message at offset %zu declares a length of %zu bytes, but only %zu are left in the file", m_name.c_str(), begin, size, len - begin);
+        pos = begin + size;
+        return true;
+    }
+    pos = len;
+    return false;
+}
+
+bool MappedCrexFile::scan(size_t& begin, size_t& size)
+{
+    const uint8_t* buf = mapping->begin();
+    size_t len = mapping->size();
+    if (pos + 6 > len)
+    {
+        pos = len;
+        return false;
+    }
+    const uint8_t* found = (const uint8_t*)memmem(buf + pos, len - pos, "CREX++", 6);
+    if (!found)
+    {
+        pos = len;
+        return false;
+    }
+    begin = found - buf;
+    const uint8_t* end = (const uint8_t*)memmem(found + 6, len - begin - 6, "7777", 4);
+    if (!end)
+        error_consistency::throwf("%s: CREX message at offset %zu has no end of message marker", m_name.c_str(), begin);
+    size = end + 4 - found;
+    pos = begin + size;
+    return true;
+}
+
+bool MappedJsonFile::scan(size_t& begin, size_t& size)
+{
+    const uint8_t* buf = mapping->begin();
+    size_t len = mapping->size();
+    if (pos >= len)
+        return false;
+    begin = pos;
+    const uint8_t* nl = (const uint8_t*)memchr(buf + pos, '\n', len - pos);
+    size = nl ? nl - (buf + pos) : len - pos;
+    pos += nl ? size + 1 : size;
+    // Like JsonFile, an empty line ends the file
+    if (size == 0)
+    {
+        pos = len;
+        return false;
+    }
+    return true;
+}
+
 }
 }
@@ -3,6 +3,7 @@
 
 #include <dballe/file.h>
 #include <dballe/core/defs.h>
+#include <dballe/core/mmap.h>
 #include <memory>
 #include <string>
 #include <cstdio>
@@ -31,6 +32,7 @@ public:
     std::string pathname() const override { return m_name; }
     void close() override;
     bool foreach(std::function<bool(const BinaryMessage&)> dest) override;
+    void seek(off_t offset, int index) override;
 
     /**
      * Resolve the location of a test data file
@@ -80,6 +82,78 @@ public:
     void write(const std::string& msg) override;
 };
 
+/**
+ * Base for read-only dballe::File implementations working on a memory mapping
+ * of the whole file.
+ *
+ * Message boundaries are found by searching the mapping with memchr/memmem,
+ * and message data is copied straight from the mapping into the
+ * BinaryMessage. foreach() reuses the same BinaryMessage for all messages, to
+ * avoid an allocation for each message.
+ */
+class MappedMessageFile : public dballe::File
+{
+protected:
+    /// Name of the file
+    std::string m_name;
+    /// Memory mapping of the file contents
+    std::unique_ptr<core::MappedFile> mapping;
+    /// Offset in the mapping where the search for the next message starts
+    size_t pos = 0;
+    /// Index of the next message that will be read
+    int idx = 0;
+
+    /**
+     * Find the next message starting from pos, and move pos past its end.
+     *
+     * Returns false when there are no more messages in the file.
+     */
+    virtual bool scan(size_t& begin, size_t& size) = 0;
+
+public:
+    MappedMessageFile(const std::string& name, std::unique_ptr<core::MappedFile> mapping);
+
+    std::string pathname() const override { return m_name; }
+    void close() override;
+    BinaryMessage read() override;
+    bool foreach(std::function<bool(const BinaryMessage&)> dest) override;
+    void seek(off_t offset, int index) override;
+    void write(const std::string& msg) override;
+};
+
+class MappedBufrFile : public MappedMessageFile
+{
+protected:
+    bool scan(size_t& begin, size_t& size) override;
+
+public:
+    using MappedMessageFile::MappedMessageFile;
+
+    Encoding encoding() const override { return Encoding::BUFR; }
+};
+
+class MappedCrexFile : public MappedMessageFile
+{
+protected:
+    bool scan(size_t& begin, size_t& size) override;
+
+public:
+    using MappedMessageFile::MappedMessageFile;
+
+    Encoding encoding() const override { return Encoding::CREX; }
+};
+
+class MappedJsonFile : public MappedMessageFile
+{
+protected:
+    bool scan(size_t& begin, size_t& size) override;
+
+public:
+    using MappedMessageFile::MappedMessageFile;
+
+    Encoding encoding() const override { return Encoding::JSON; }
+};
+
 }
 }
 #endif
@@ -3,6 +3,8 @@
 
 namespace dballe {
 
+struct Varmatch;
+
 namespace core {
 class Data;
 class Query;
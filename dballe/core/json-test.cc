@@ -1,6 +1,9 @@
 #include "tests.h"
 #include "json.h"
 #include <sstream>
+#include <limits>
+#include <cmath>
+#include <cstdio>
 
 using namespace std;
 using namespace dballe;
@@ -100,6 +103,122 @@ class Tests : public TestCase
             writer.end_mapping();
             wassert(actual(out.str()) == "{\"\":1,\"antani\":1.0}");
         });
+        add_method("numbers", []() {
+            // Numbers are formatted as std::to_string does
+            std::string out;
+            core::JSONWriter writer(out);
+            const int ints[] = { 0, 7, -7, 1234567890, std::numeric_limits<int>::min(), std::numeric_limits<int>::max() };
+            const double doubles[] = { 0.0, -3.0, 0.5, -1.25, 1e-9, 123456.789 };
+            std::string expected = "[";
+            writer.start_list();
+            for (int val: ints)
+            {
+                writer.add(val);
+                expected += std::to_string(val) + ",";
+            }
+            for (double val: doubles)
+            {
+                writer.add(val);
+                double vint;
+                if (modf(val, &vint) == 0.0)
+                    expected += std::to_string((int)vint) + ".0,";
+                else
+                    expected += std::to_string(val) + ",";
+            }
+            writer.add((size_t)18446744073709551615ull);
+            expected += "18446744073709551615]";
+            writer.end_list();
+            wassert(actual(out) == expected);
+        });
+        add_method("sinks", []() {
+            auto write = [](core::JSONWriter& writer) {
+                writer.start_mapping();
+                writer.add("a", 1);
+                writer.add("b\t", "c\"d");
+                writer.end_mapping();
+                writer.add_break();
+            };
+            const char* expected = "{\"a\":1,\"b\\t\":\"c\\\"d\"}\n";
+
+            // Appending to a string
+            std::string str("prefix ");
+            {
+                core::JSONWriter writer(str);
+                write(writer);
+            }
+            wassert(actual(str) == std::string("prefix ") + expected);
+
+            // Writing to a stream flushes complete values
+            std::stringstream sstr;
+            core::JSONWriter swriter(sstr);
+            swriter.start_list();
+            swriter.add(1);
+            wassert(actual(sstr.str()) == "");
+            swriter.end_list();
+            wassert(actual(sstr.str()) == "[1]");
+
+            // Writing to a FILE
+            FILE* out = tmpfile();
+            {
+                core::JSONWriter writer(out);
+                write(writer);
+                write(writer);
+            }
+            rewind(out);
+            char buf[128];
+            size_t len = fread(buf, 1, sizeof(buf), out);
+            fclose(out);
+            wassert(actual(std::string(buf, len)) == std::string(expected) + expected);
+        });
+        add_method("parse_string", []() {
+            std::string buf = R"("" "antani" "a\"b\\c\n" "\\")";
+            core::json::Stream in(buf);
+            wassert(actual(in.parse_string()) == "");
+            wassert(actual(in.parse_string()) == "antani");
+            wassert(actual(in.parse_string()) == "a\"b\\c\n");
+            wassert(actual(in.parse_string()) == "\\");
+            wassert_true(in.eof());
+
+            std::string truncated = R"("antani\")";
+            core::json::Stream in1(truncated);
+            wassert_throws(core::JSONParseException, in1.parse_string());
+        });
+        add_method("parse_buffer", []() {
+            // Parse only part of a buffer
+            std::string buf = R"({"a":[1,-2,3.5],"b":null} [1,2])";
+            core::json::Stream in(buf.data(), buf.data() + buf.find(' '));
+            std::vector<std::string> keys;
+            std::vector<int> ints;
+            double dval = 0;
+            in.parse_object([&](const std::string& key) {
+                keys.push_back(key);
+                if (key == "a")
+                    in.parse_array([&]{
+                        std::string num;
+                        bool is_double;
+                        std::tie(num, is_double) = in.parse_number();
+                        if (is_double)
+                            dval = std::stod(num);
+                        else
+                            ints.push_back(std::stoi(num));
+                    });
+                else
+                    in.expect_token("null");
+            });
+            wassert_true(in.eof());
+            wassert(actual(keys.size()) == 2u);
+            wassert(actual(keys[1]) == "b");
+            wassert(actual(ints.size()) == 2u);
+            wassert(actual(ints[1]) == -2);
+            wassert(actual(dval) == 3.5);
+
+            // Reading from a std::istream parses the rest of the stream
+            std::stringstream sin(buf);
+            sin.get();
+            core::json::Stream in1(sin);
+            wassert(actual(in1.peek()) == '"');
+            wassert(actual(in1.parse_string()) == "a");
+        });
     };
 } test("core_json");
 
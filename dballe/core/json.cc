@@ -1,21 +1,70 @@
 #include "json.h"
 #include "dballe/values.h"
+#include <wreport/error.h>
 #include <cctype>
 #include <cmath>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <iterator>
+#include <unistd.h>
 
 using namespace std;
 
 namespace dballe {
 namespace core {
 
-JSONWriter::JSONWriter(std::ostream& out) : out(out) {}
-JSONWriter::~JSONWriter() {}
+JSONWriter::JSONWriter(std::ostream& out) : buf(own_buf), out(&out) {}
+JSONWriter::JSONWriter(std::string& out) : buf(out) {}
+JSONWriter::JSONWriter(FILE* out) : buf(own_buf), outfile(out) {}
+JSONWriter::JSONWriter(int outfd) : buf(own_buf), outfd(outfd) {}
+
+JSONWriter::~JSONWriter()
+{
+    // Errors cannot be reported here: call flush() explicitly to see them
+    try {
+        flush();
+    } catch (...) {
+    }
+}
 
 void JSONWriter::reset()
 {
     stack.clear();
 }
 
+void JSONWriter::flush()
+{
+    if (buf.empty()) return;
+    if (out)
+        out->write(buf.data(), buf.size());
+    else if (outfile)
+    {
+        if (fwrite(buf.data(), buf.size(), 1, outfile) != 1)
+            throw wreport::error_system("cannot write JSON output");
+    }
+    else if (outfd != -1)
+    {
+        const char* pos = buf.data();
+        size_t left = buf.size();
+        while (left)
+        {
+            ssize_t res = write(outfd, pos, left);
+            if (res < 0)
+            {
+                if (errno == EINTR) continue;
+                throw wreport::error_system("cannot write JSON output");
+            }
+            pos += res;
+            left -= res;
+        }
+    }
+    else
+        // Output goes straight to the caller's string
+        return;
+    buf.clear();
+}
+
 void JSONWriter::val_head()
 {
     if (!stack.empty())
@@ -23,30 +72,63 @@ void JSONWriter::val_head()
         switch (stack.back())
         {
             case LIST_FIRST: stack.back() = LIST; break;
-            case LIST: out << ','; break;
+            case LIST: buf += ','; break;
             case MAPPING_KEY_FIRST: stack.back() = MAPPING_VAL; break;
-            case MAPPING_KEY: out << ','; stack.back() = MAPPING_VAL; break;
-            case MAPPING_VAL: out << ':'; stack.back() = MAPPING_KEY; break;
+            case MAPPING_KEY: buf += ','; stack.back() = MAPPING_VAL; break;
+            case MAPPING_VAL: buf += ':'; stack.back() = MAPPING_KEY; break;
         }
     }
 }
 
+void JSONWriter::append_unsigned(unsigned long long val)
+{
+    char tmp[24];
+    char* end = tmp + sizeof(tmp);
+    char* pos = end;
+    do {
+        *--pos = '0' + val % 10;
+        val /= 10;
+    } while (val);
+    buf.append(pos, end);
+}
+
+void JSONWriter::append_int(int val)
+{
+    if (val < 0)
+    {
+        buf += '-';
+        // Negate as unsigned, to also handle the most negative int
+        append_unsigned(0ull - (unsigned long long)(long long)val);
+    } else
+        append_unsigned(val);
+}
+
 void JSONWriter::add_null()
 {
     val_head();
-    out << "null";
+    buf += "null";
+    val_tail();
 }
 
 void JSONWriter::add_bool(bool val)
 {
     val_head();
-    out << (val ? "true" : "false" );
+    buf += (val ? "true" : "false" );
+    val_tail();
 }
 
 void JSONWriter::add_int(int val)
 {
     val_head();
-    out << to_string(val);
+    append_int(val);
+    val_tail();
+}
+
+void JSONWriter::add_unsigned(unsigned long long val)
+{
+    val_head();
+    append_unsigned(val);
+    val_tail();
 }
 
 void JSONWriter::add_double(double val)
@@ -57,30 +139,44 @@ void JSONWriter::add_double(double val)
     vfrac = modf(val, &vint);
     if (vfrac == 0.0)
     {
-        out << to_string((int)vint);
-        out << ".0";
+        append_int((int)vint);
+        buf += ".0";
     }
     else
-        out << to_string(val);
+    {
+        // Same formatting as std::to_string
+        char tmp[512];
+        int len = snprintf(tmp, sizeof(tmp), "%f", val);
+        buf.append(tmp, len);
+    }
+    val_tail();
 }
 
 void JSONWriter::add_cstring(const char* val)
 {
     val_head();
-    out << '"';
-    for ( ; *val; ++val)
+    buf += '"';
+    while (true)
+    {
+        // Copy characters that need no escaping in one go
+        size_t len = strcspn(val, "\"\\\b\f\n\r\t");
+        buf.append(val, len);
+        val += len;
+        if (!*val) break;
         switch (*val)
         {
-            case '"': out << "\\\""; break;
-            case '\\': out << "\\\\"; break;
-            case '\b': out << "\\b"; break;
-            case '\f': out << "\\f"; break;
-            case '\n': out << "\\n"; break;
-            case '\r': out << "\\r"; break;
-            case '\t': out << "\\t"; break;
-            default: out << *val; break;
+            case '"': buf += "\\\""; break;
+            case '\\': buf += "\\\\"; break;
+            case '\b': buf += "\\b"; break;
+            case '\f': buf += "\\f"; break;
+            case '\n': buf += "\\n"; break;
+            case '\r': buf += "\\r"; break;
+            case '\t': buf += "\\t"; break;
         }
-    out << '"';
+        ++val;
+    }
+    buf += '"';
+    val_tail();
 }
 
 void JSONWriter::add_string(const std::string& val)
@@ -187,7 +283,8 @@ void JSONWriter::add_datetimerange(const DatetimeRange& val)
 
 void JSONWriter::add_number(const std::string& val) {
     val_head();
-    out << val;
+    buf += val;
+    val_tail();
 }
 
 void JSONWriter::add_var(const wreport::Var& val) {
@@ -212,33 +309,36 @@ void JSONWriter::add_ident(const Ident& val)
 }
 
 void JSONWriter::add_break() {
-    out << "\n";
+    buf += '\n';
+    val_tail();
 }
 
 void JSONWriter::start_list()
 {
     val_head();
-    out << '[';
+    buf += '[';
     stack.push_back(LIST_FIRST);
 }
 
 void JSONWriter::end_list()
 {
-    out << ']';
+    buf += ']';
     stack.pop_back();
+    val_tail();
 }
 
 void JSONWriter::start_mapping()
 {
     val_head();
-    out << '{';
+    buf += '{';
     stack.push_back(MAPPING_KEY_FIRST);
 }
 
 void JSONWriter::end_mapping()
 {
-    out << '}';
+    buf += '}';
     stack.pop_back();
+    val_tail();
 }
 
 
@@ -248,7 +348,7 @@ void Stream::expect_token(const char* token)
 {
     for (const char* s = token; *s; ++s)
     {
-        int c = in.get();
+        int c = get();
         if (c != *s)
         {
             if (c == EOF)
@@ -261,10 +361,10 @@ void Stream::expect_token(const char* token)
     }
 }
 
-void Stream::skip_spaces()
+Stream::Stream(std::istream& in)
+    : buffer(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()),
+      cur(buffer.data()), end(buffer.data() + buffer.size())
 {
-    while (isspace(in.peek()))
-        in.get();
 }
 
 double Stream::parse_double()
@@ -276,13 +376,11 @@ double Stream::parse_double()
 
 std::tuple<std::string, bool> Stream::parse_number()
 {
-    string num;
-    bool done = false;
+    const char* start = cur;
     bool is_double = false;
-    while (!done)
+    for ( ; cur < end; ++cur)
     {
-        int c = in.peek();
-        switch (c)
+        switch (*cur)
         {
             case '-':
             case '0':
@@ -295,19 +393,17 @@ std::tuple<std::string, bool> Stream::parse_number()
             case '7':
             case '8':
             case '9':
-                num.append(1, in.get());
-                break;
+                continue;
             case '.':
             case 'e':
             case 'E':
             case '+':
                 is_double = true;
-                num.append(1, in.get());
-                break;
-            default:
-                done = true;
+                continue;
         }
+        break;
     }
+    std::string num(start, cur);
 
     skip_spaces();
 
@@ -317,37 +413,34 @@ std::tuple<std::string, bool> Stream::parse_number()
 std::string Stream::parse_string()
 {
     string res;
-    int c = in.get(); // Eat the leading '"'
-    if (c != '"')
+    if (get() != '"') // Eat the leading '"'
         throw JSONParseException("expected string does not begin with '\"'");
-    bool done = false;
-    while (!done)
+    while (true)
     {
-        int c = in.get();
+        // Copy everything up to the closing quote at once, unless there are
+        // escape sequences before it
+        const char* quote = (const char*)memchr(cur, '"', end - cur);
+        if (!quote)
+            throw JSONParseException("unterminated string");
+        const char* escape = (const char*)memchr(cur, '\\', quote - cur);
+        if (!escape)
+        {
+            res.append(cur, quote);
+            cur = quote + 1;
+            break;
+        }
+        res.append(cur, escape);
+        cur = escape + 1;
+        int c = get();
         switch (c)
         {
-            case '\\':
-                c = in.get();
-                if (c == EOF)
-                    throw JSONParseException("unterminated string");
-                switch (c)
-                {
-                    case 'b': res.append(1, '\b'); break;
-                    case 'f': res.append(1, '\f'); break;
-                    case 'n': res.append(1, '\n'); break;
-                    case 'r': res.append(1, '\r'); break;
-                    case 't': res.append(1, '\t'); break;
-                    default: res.append(1, c); break;
-                }
-                break;
-            case '"':
-                done = true;
-                break;
-            case EOF:
-                throw JSONParseException("unterminated string");
-            default:
-                res.append(1, c);
-                break;
+            case 'b': res.append(1, '\b'); break;
+            case 'f': res.append(1, '\f'); break;
+            case 'n': res.append(1, '\n'); break;
+            case 'r': res.append(1, '\r'); break;
+            case 't': res.append(1, '\t'); break;
+            case EOF: throw JSONParseException("unterminated string");
+            default: res.append(1, c); break;
         }
     }
     skip_spaces();
@@ -529,43 +622,43 @@ DatetimeRange Stream::parse_datetimerange()
 
 void Stream::parse_array(std::function<void()> on_element)
 {
-    if (in.get() != '[')
+    if (get() != '[')
         throw JSONParseException("expected array does not begin with '['");
     skip_spaces();
-    while (in.peek() != ']')
+    while (peek() != ']')
     {
         on_element();
-        if (in.peek() == ',')
-            in.get();
+        if (peek() == ',')
+            get();
         skip_spaces();
     }
-    if (in.get() != ']')
+    if (get() != ']')
         throw JSONParseException("array does not end with '['");
     skip_spaces();
 }
 
 void Stream::parse_object(std::function<void(const std::string& key)> on_value)
 {
-    if (in.get() != '{')
+    if (get() != '{')
         throw JSONParseException("expected object does not begin with '{'");
     skip_spaces();
-    while (in.peek() != '}')
+    while (peek() != '}')
     {
-        if (in.peek() != '"')
+        if (peek() != '"')
             throw JSONParseException("expected a string as object key");
         std::string key = parse_string();
         skip_spaces();
-        if (in.peek() == ':')
-            in.get();
+        if (peek() == ':')
+            get();
         else
             throw JSONParseException("':' expected after object key");
         skip_spaces();
         on_value(key);
-        if (in.peek() == ',')
-            in.get();
+        if (peek() == ',')
+            get();
         skip_spaces();
     }
-    if (in.get() != '}')
+    if (get() != '}')
         throw JSONParseException("expected object does not end with '}'");
     skip_spaces();
 }
@@ -573,7 +666,7 @@ void Stream::parse_object(std::function<void(const std::string& key)> on_value)
 Element Stream::identify_next()
 {
     skip_spaces();
-    switch (in.peek())
+    switch (peek())
     {
         case EOF:
             throw JSONParseException("JSON string is truncated");
@@ -662,5 +755,10 @@ void JSONReader::parse(std::istream& in) {
     parse_value(jstream, *this);
 }
 
+void JSONReader::parse(json::Stream& in)
+{
+    parse_value(in, *this);
+}
+
 }
 }
@@ -8,6 +8,10 @@
 #include <vector>
 #include <ostream>
 #include <istream>
+#include <sstream>
+#include <string>
+#include <cctype>
+#include <cstdio>
 
 namespace dballe {
 namespace core {
@@ -25,6 +29,12 @@ struct JSONParseException : public std::runtime_error {
  *
  * The JSON output is all in one line, so that end of line can be used as
  * separator between distinct JSON records.
+ *
+ * Output is formatted into a memory buffer. When writing to a std::ostream,
+ * the buffer is flushed every time a top-level value is complete; when
+ * writing to a FILE or a file descriptor, it is flushed when a top-level value
+ * is complete and the buffer is larger than flush_size, and on flush() and
+ * destruction.
  */
 class JSONWriter
 {
@@ -36,17 +46,38 @@ protected:
         MAPPING_KEY,
         MAPPING_VAL,
     };
-    std::ostream& out;
+    std::string own_buf;
+    /// Buffer with the formatted output
+    std::string& buf;
+    std::ostream* out = nullptr;
+    FILE* outfile = nullptr;
+    int outfd = -1;
     std::vector<State> stack;
 
     /// Append whatever separator is needed (if any) before a new value
     void val_head();
 
-    void jputc(char c);
-    void jputs(const char* s);
+    /// Flush the buffer if a top-level value has been completed
+    void val_tail()
+    {
+        if (stack.empty() && (out || buf.size() >= flush_size))
+            flush();
+    }
+
+    void append_int(int val);
+    void append_unsigned(unsigned long long val);
 
 public:
+    /// Buffer size after which FILE and file descriptor output is flushed
+    static const size_t flush_size = 65536;
+
     JSONWriter(std::ostream& out);
+    /// Append the output to \a out
+    explicit JSONWriter(std::string& out);
+    explicit JSONWriter(FILE* out);
+    explicit JSONWriter(int outfd);
+    JSONWriter(const JSONWriter&) = delete;
+    JSONWriter& operator=(const JSONWriter&) = delete;
     ~JSONWriter();
 
     /**
@@ -55,6 +86,9 @@ public:
      */
     void reset();
 
+    /// Write the buffered output to the output stream, FILE or file descriptor
+    void flush();
+
     void start_list();
     void end_list();
 
@@ -67,11 +101,15 @@ public:
     void add_double(double val);
     void add_cstring(const char* val);
     void add_string(const std::string& val);
+    void add_unsigned(unsigned long long val);
     template<typename T>
     void add_ostream(const T& val)
     {
         val_head();
-        out << val;
+        std::ostringstream s;
+        s << val;
+        buf += s.str();
+        val_tail();
     }
 
     void add_number(const std::string& val);
@@ -93,7 +131,7 @@ public:
     void add(double val) { add_double(val); }
     void add(int val) { add_int(val); }
     void add(bool val) { add_bool(val); }
-    void add(size_t val) { add_ostream(val); }
+    void add(size_t val) { add_unsigned(val); }
     void add(wreport::Varcode val) { add_int(val); }
     void add(const Level& val) { add_level(val); }
     void add(const Trange& val) { add_trange(val); }
@@ -124,6 +162,10 @@ public:
     }
 };
 
+namespace json {
+struct Stream;
+}
+
 /**
  * JSON sax-like parser.
  */
@@ -146,6 +188,9 @@ public:
 
     // Parse a stream
     void parse(std::istream& in);
+
+    /// Parse the next value from \a in
+    void parse(json::Stream& in);
 };
 
 
@@ -162,31 +207,61 @@ enum Element
     JSON_NULL,
 };
 
+/**
+ * JSON parser working on a buffer in memory.
+ *
+ * The buffer is not copied, and needs to remain valid while the Stream is in
+ * use.
+ */
 struct Stream
 {
-    std::istream& in;
+protected:
+    /// Contents read when parsing a std::istream
+    std::string buffer;
+
+public:
+    /// Current parsing position
+    const char* cur;
+    /// End of the buffer
+    const char* end;
+
+    Stream(const char* begin, const char* end) : cur(begin), end(end) {}
+    explicit Stream(const std::string& buf) : cur(buf.data()), end(buf.data() + buf.size()) {}
+    /**
+     * Parse the contents of a std::istream.
+     *
+     * All the rest of \a in is read in memory before parsing.
+     */
+    explicit Stream(std::istream& in);
+    Stream(const Stream&) = delete;
+    Stream& operator=(const Stream&) = delete;
+
+    /// Return the next character without consuming it, or EOF
+    int peek() const { return cur < end ? (unsigned char)*cur : EOF; }
+
+    /// Consume and return the next character, or EOF
+    int get() { return cur < end ? (unsigned char)*cur++ : EOF; }
 
-    Stream(std::istream& in) : in(in) {}
+    /// Check if all the buffer has been parsed
+    bool eof() const { return cur >= end; }
 
     /// Raise a parse error if the stream does not yield this exact token
     void expect_token(const char* token);
 
     /// Consume and discard all spaces at the start of the stream
-    void skip_spaces();
+    void skip_spaces()
+    {
+        while (cur < end && isspace((unsigned char)*cur))
+            ++cur;
+    }
 
     /// Parse an unsigned integer
     template<typename T>
     T parse_unsigned()
     {
         T res = 0;
-        while (true)
-        {
-            int c = in.peek();
-            if (c >= '0' and c <= '9')
-                res = res * 10 + in.get() - '0';
-            else
-                break;
-        }
+        for ( ; cur < end && *cur >= '0' && *cur <= '9'; ++cur)
+            res = res * 10 + *cur - '0';
         skip_spaces();
         return res;
     }
@@ -195,9 +270,9 @@ struct Stream
     template<typename T>
     T parse_signed()
     {
-        if (in.peek() == '-')
+        if (peek() == '-')
         {
-            in.get();
+            ++cur;
             return -parse_unsigned<T>();
         } else
             return parse_unsigned<T>();
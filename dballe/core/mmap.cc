@@ -0,0 +1,40 @@
+#include "mmap.h"
+#include <wreport/error.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace wreport;
+
+namespace dballe {
+namespace core {
+
+MappedFile::MappedFile(const std::string& pathname, const char* what)
+    : addr(MAP_FAILED)
+{
+    int fd = open(pathname.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+        error_system::throwf("cannot open %s %s", what, pathname.c_str());
+    struct stat st;
+    if (fstat(fd, &st) == -1)
+    {
+        ::close(fd);
+        error_system::throwf("cannot stat %s %s", what, pathname.c_str());
+    }
+    m_size = st.st_size;
+    if (m_size)
+        addr = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m_size && addr == MAP_FAILED)
+        error_system::throwf("cannot memory map %s %s", what, pathname.c_str());
+}
+
+MappedFile::~MappedFile()
+{
+    if (addr != MAP_FAILED)
+        munmap(addr, m_size);
+}
+
+}
+}
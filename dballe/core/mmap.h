@@ -0,0 +1,37 @@
+#ifndef DBALLE_CORE_MMAP_H
+#define DBALLE_CORE_MMAP_H
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace dballe {
+namespace core {
+
+/**
+ * Read-only memory mapping of a whole file.
+ *
+ * Errors are reported as "cannot open <what> <pathname>", to allow callers
+ * to say what kind of file they were trying to read.
+ */
+class MappedFile
+{
+protected:
+    void* addr;
+    size_t m_size = 0;
+
+public:
+    MappedFile(const std::string& pathname, const char* what="file");
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    size_t size() const { return m_size; }
+    const uint8_t* begin() const { return (const uint8_t*)addr; }
+    const uint8_t* end() const { return (const uint8_t*)addr + m_size; }
+};
+
+}
+}
+
+#endif
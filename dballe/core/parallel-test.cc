@@ -0,0 +1,63 @@
+#include "dballe/core/tests.h"
+#include "parallel.h"
+#include <atomic>
+#include <vector>
+
+using namespace dballe;
+using namespace dballe::core;
+using namespace wreport::tests;
+using namespace std;
+
+namespace {
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override;
+} test("core_parallel");
+
+void Tests::register_tests() {
+
+add_method("concurrency", []() {
+    wassert(actual(default_concurrency()) > 0u);
+});
+
+add_method("parallel_for", []() {
+    // Every item is visited exactly once
+    vector<unsigned> visited(10007, 0);
+    parallel_for(visited.size(), 100, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            ++visited[i];
+    }, 4);
+    for (size_t i = 0; i < visited.size(); ++i)
+        wassert(actual(visited[i]) == 1u);
+
+    // Empty ranges do not call fn
+    unsigned calls = 0;
+    parallel_for(0, 100, [&](size_t, size_t) { ++calls; }, 4);
+    wassert(actual(calls) == 0u);
+
+    // Ranges smaller than min_chunk run in a single call
+    parallel_for(50, 100, [&](size_t begin, size_t end) {
+        ++calls;
+        wassert(actual(begin) == 0u);
+        wassert(actual(end) == 50u);
+    }, 4);
+    wassert(actual(calls) == 1u);
+});
+
+add_method("parallel_for_exceptions", []() {
+    std::atomic<unsigned> calls(0);
+    auto e = wassert_throws(std::runtime_error, parallel_for(1000, 10, [&](size_t begin, size_t) {
+        ++calls;
+        if (begin > 0) throw std::runtime_error("test error");
+    }, 4));
+    wassert(actual(e.what()) == "test error");
+    // All chunks ran to completion before the exception was rethrown
+    wassert(actual((unsigned)calls) == 4u);
+});
+
+}
+
+}
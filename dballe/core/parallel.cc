@@ -0,0 +1,75 @@
+#include "parallel.h"
+#include <thread>
+#include <exception>
+#include <vector>
+#include <cstdlib>
+
+using namespace std;
+
+namespace dballe {
+namespace core {
+
+unsigned default_concurrency()
+{
+    if (const char* env = getenv("DBA_THREADS"))
+    {
+        int val = atoi(env);
+        if (val > 0) return val;
+    }
+    unsigned res = std::thread::hardware_concurrency();
+    return res ? res : 1;
+}
+
+void parallel_for(size_t size, size_t min_chunk, std::function<void(size_t begin, size_t end)> fn, unsigned max_threads)
+{
+    if (!size) return;
+    if (!min_chunk) min_chunk = 1;
+    if (!max_threads) max_threads = default_concurrency();
+
+    size_t chunks = (size + min_chunk - 1) / min_chunk;
+    if (chunks > max_threads) chunks = max_threads;
+    if (chunks <= 1)
+    {
+        fn(0, size);
+        return;
+    }
+
+    size_t chunk_size = (size + chunks - 1) / chunks;
+    vector<exception_ptr> errors(chunks);
+    vector<thread> workers;
+    workers.reserve(chunks - 1);
+    try {
+        for (size_t i = 1; i < chunks; ++i)
+        {
+            size_t begin = i * chunk_size;
+            if (begin >= size) break;
+            size_t end = begin + chunk_size < size ? begin + chunk_size : size;
+            workers.emplace_back([&fn, &errors, i, begin, end] {
+                try {
+                    fn(begin, end);
+                } catch (...) {
+                    errors[i] = current_exception();
+                }
+            });
+        }
+    } catch (...) {
+        // Thread creation failed: wait for what we started, then propagate
+        for (auto& w: workers) w.join();
+        throw;
+    }
+
+    // The calling thread takes care of the first chunk
+    try {
+        fn(0, chunk_size < size ? chunk_size : size);
+    } catch (...) {
+        errors[0] = current_exception();
+    }
+
+    for (auto& w: workers) w.join();
+
+    for (const auto& e: errors)
+        if (e) rethrow_exception(e);
+}
+
+}
+}
@@ -0,0 +1,38 @@
+#ifndef DBALLE_CORE_PARALLEL_H
+#define DBALLE_CORE_PARALLEL_H
+
+#include <functional>
+#include <cstddef>
+
+namespace dballe {
+namespace core {
+
+/**
+ * Number of worker threads to use for parallelisable work.
+ *
+ * It defaults to the hardware concurrency, and can be overridden with the
+ * DBA_THREADS environment variable. It is always at least 1.
+ */
+unsigned default_concurrency();
+
+/**
+ * Split the range [0, size) in contiguous chunks and call fn(begin, end) on
+ * each chunk, using up to max_threads threads (0 means default_concurrency()).
+ *
+ * Chunks are never smaller than min_chunk items, so small ranges are
+ * processed in the calling thread without starting any thread.
+ *
+ * If fn throws in any thread, the first exception is rethrown in the calling
+ * thread after all threads have finished.
+ *
+ * fn must not touch state shared with other chunks, unless it is read only.
+ * Note that wreport::Varinfo lookups through dballe::varinfo() lazily load
+ * the B table on first use: do one lookup in the calling thread before
+ * starting parallel work that needs them.
+ */
+void parallel_for(size_t size, size_t min_chunk, std::function<void(size_t begin, size_t end)> fn, unsigned max_threads=0);
+
+}
+}
+
+#endif
@@ -475,6 +475,12 @@ unsigned Query::parse_modifiers(const char* s)
                 else
                     got = 0;
                 break;
+            case 8:
+                if (strncmp(s, "parallel", 8) == 0)
+                    modifiers |= DBA_DB_MODIFIER_PARALLEL;
+                else
+                    got = 0;
+                break;
             default:
                 got = 0;
                 break;
@@ -24,6 +24,9 @@
 /** When values from different reports exist on the same point, only report the
  * one with the highest datetime. See issue #80 for details */
 #define DBA_DB_MODIFIER_LAST        (1 << 10)
+/** Split the query in parts run concurrently on the connections of a
+ * connection pool */
+#define DBA_DB_MODIFIER_PARALLEL    (1 << 11)
 
 namespace dballe {
 namespace core {
@@ -147,6 +147,15 @@ struct SmallSet
         return items.back();
     }
 
+    /// Remove the item at the given position
+    void erase(iterator it)
+    {
+        // Items not yet sorted are all at the end of the vector
+        if ((size_t)(it - items.begin()) >= items.size() - dirty)
+            --dirty;
+        items.erase(it);
+    }
+
     // static const Value& _smallset_get_value(const Item&);
 
     void rearrange_dirty() const
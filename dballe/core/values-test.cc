@@ -1,5 +1,7 @@
 #include "tests.h"
 #include "values.h"
+#include "varmatch.h"
+#include "var.h"
 #include <cstring>
 
 using namespace std;
@@ -21,6 +23,75 @@ void Tests::register_tests()
 add_method("empty", []() {
 });
 
+add_method("match_attrs", []() {
+    wreport::Var var(varinfo(WR_VAR(0, 12, 101)), 280.0);
+    var.seta(newvar(WR_VAR(0, 33, 7), 50));
+    var.seta(newvar(WR_VAR(0, 1, 212), "test"));
+    var.seta(newvar(WR_VAR(0, 33, 196), 1));
+
+    core::value::Encoder enc;
+    enc.append_attributes(var);
+
+    using core::value::Decoder;
+    wassert_true(Decoder::match_attrs(enc.buf, *Varmatch::parse("B33007>40")));
+    wassert_false(Decoder::match_attrs(enc.buf, *Varmatch::parse("B33007<40")));
+    wassert_true(Decoder::match_attrs(enc.buf, *Varmatch::parse("B33196=1")));
+    wassert_false(Decoder::match_attrs(enc.buf, *Varmatch::parse("B33196=0")));
+    wassert_false(Decoder::match_attrs(enc.buf, *Varmatch::parse("B33192>0")));
+    wassert_false(Decoder::match_attrs(std::vector<uint8_t>(), *Varmatch::parse("B33007>40")));
+});
+
+add_method("compact", []() {
+    wreport::Var var(varinfo(WR_VAR(0, 12, 101)), 280.0);
+    var.seta(newvar(WR_VAR(0, 33, 7), 50));
+    var.seta(newvar(WR_VAR(0, 33, 196), 1));
+    var.seta(newvar(WR_VAR(0, 1, 212), "test"));
+
+    core::value::Encoder enc;
+    enc.append_attributes(var);
+    // Header, 2 common attributes in 2 bytes each, B01212 in 2 bytes and the
+    // string with its length
+    wassert(actual(enc.buf.size()) == 2u + 2 + 2 + 2 + 5);
+    wassert_false(core::value::Decoder::is_outdated(enc.buf));
+
+    wreport::Var decoded(varinfo(WR_VAR(0, 12, 101)), 280.0);
+    core::value::Decoder::decode_attrs(enc.buf, decoded);
+    wassert(actual(decoded.enqa(WR_VAR(0, 33, 7))->enqi()) == 50);
+    wassert(actual(decoded.enqa(WR_VAR(0, 33, 196))->enqi()) == 1);
+    wassert(actual(decoded.enqa(WR_VAR(0, 1, 212))->enqs()) == "test");
+});
+
+add_method("legacy", []() {
+    // Attributes encoded with version 1 of the encoding
+    core::value::Encoder enc;
+    enc.append_uint16(WR_VAR(0, 33, 7));
+    enc.append_uint32(50);
+    enc.append_uint16(WR_VAR(0, 1, 212));
+    enc.append_cstring("test");
+    std::vector<uint8_t> buf = enc.buf;
+
+    using core::value::Decoder;
+    wassert_true(Decoder::is_outdated(buf));
+    wassert_true(Decoder::match_attrs(buf, *Varmatch::parse("B33007>40")));
+    wassert_false(Decoder::match_attrs(buf, *Varmatch::parse("B33007<40")));
+
+    wreport::Var var(varinfo(WR_VAR(0, 12, 101)), 280.0);
+    Decoder::decode_attrs(buf, var);
+    wassert(actual(var.enqa(WR_VAR(0, 33, 7))->enqi()) == 50);
+    wassert(actual(var.enqa(WR_VAR(0, 1, 212))->enqs()) == "test");
+
+    // Upgrade to the current encoding
+    wassert_true(Decoder::upgrade(buf));
+    wassert_false(Decoder::is_outdated(buf));
+    wassert(actual(buf.size()) == 2u + 2 + 2 + 5);
+    wassert_false(Decoder::upgrade(buf));
+
+    wreport::Var var1(varinfo(WR_VAR(0, 12, 101)), 280.0);
+    Decoder::decode_attrs(buf, var1);
+    wassert(actual(var1.enqa(WR_VAR(0, 33, 7))->enqi()) == 50);
+    wassert(actual(var1.enqa(WR_VAR(0, 1, 212))->enqs()) == "test");
+});
+
 }
 
 }
@@ -1,6 +1,8 @@
 #include "values.h"
 #include "dballe/core/var.h"
+#include "dballe/core/varmatch.h"
 #include <arpa/inet.h>
+#include <cstring>
 #include <ostream>
 
 using namespace std;
@@ -10,6 +12,26 @@ namespace dballe {
 namespace core {
 namespace value {
 
+namespace {
+
+/**
+ * Varcodes of common attributes, encoded in one byte in version 2 of the
+ * encoding.
+ *
+ * This is part of the encoding: entries can only be appended together with a
+ * new format version.
+ */
+const Varcode common_codes[] = {
+    WR_VAR(0, 33,   7), WR_VAR(0, 33, 192), WR_VAR(0, 33, 193), WR_VAR(0, 33, 194),
+    WR_VAR(0, 33, 195), WR_VAR(0, 33, 196), WR_VAR(0, 33, 197), WR_VAR(0, 33, 198),
+    WR_VAR(0, 33, 199), WR_VAR(0, 33, 200), WR_VAR(0, 33, 201), WR_VAR(0, 33,   2),
+    WR_VAR(0, 33,   3), WR_VAR(0, 33,   5), WR_VAR(0, 33,   6), WR_VAR(0, 33,  15),
+    WR_VAR(0, 33,  36), WR_VAR(0, 33,  40), WR_VAR(0, 33,  41), WR_VAR(0, 33,  50),
+};
+const unsigned common_codes_size = sizeof(common_codes) / sizeof(common_codes[0]);
+
+}
+
 Encoder::Encoder()
 {
     buf.reserve(64);
@@ -34,22 +56,55 @@ void Encoder::append_cstring(const char* val)
     buf.push_back(0);
 }
 
+void Encoder::append_varint(uint32_t val)
+{
+    while (val >= 0x80)
+    {
+        buf.push_back((val & 0x7f) | 0x80);
+        val >>= 7;
+    }
+    buf.push_back(val);
+}
+
+void Encoder::append_varcode(wreport::Varcode code)
+{
+    for (unsigned i = 0; i < common_codes_size; ++i)
+        if (common_codes[i] == code)
+        {
+            append_varint(i);
+            return;
+        }
+    append_varint(code + common_codes_size);
+}
+
 void Encoder::append(const wreport::Var& var)
 {
-    // Encode code
-    append_uint16(var.code());
+    if (buf.empty())
+    {
+        buf.push_back(FORMAT_MARKER);
+        buf.push_back(FORMAT_VERSION);
+    }
+
+    append_varcode(var.code());
     switch (var.info()->type)
     {
         case Vartype::Binary:
         case Vartype::String:
-            // Encode value, including terminating zero
-            append_cstring(var.enqc());
+        {
+            const char* val = var.enqc();
+            size_t len = strlen(val);
+            append_varint(len);
+            buf.insert(buf.end(), (const uint8_t*)val, (const uint8_t*)val + len);
             break;
+        }
         case Vartype::Integer:
         case Vartype::Decimal:
-            // Just encode the integer value
-            append_uint32(var.enqi());
+        {
+            // Zigzag encoding, to keep small negative numbers small
+            int32_t val = var.enqi();
+            append_varint(((uint32_t)val << 1) ^ (uint32_t)(val >> 31));
             break;
+        }
     }
 }
 
@@ -59,7 +114,19 @@ void Encoder::append_attributes(const wreport::Var& var)
         append(*a);
 }
 
-Decoder::Decoder(const std::vector<uint8_t>& buf) : buf(buf.data()), size(buf.size()) {}
+Decoder::Decoder(const std::vector<uint8_t>& buf) : buf(buf.data()), size(buf.size())
+{
+    if (size && *this->buf == FORMAT_MARKER)
+    {
+        if (size < 2)
+            error_toolong::throwf("cannot decode the encoding version: only %u bytes are left to read", size);
+        version = this->buf[1];
+        if (version != 2)
+            error_consistency::throwf("cannot decode version %u of encoded variables", version);
+        this->buf += 2;
+        size -= 2;
+    }
+}
 
 uint16_t Decoder::decode_uint16()
 {
@@ -95,19 +162,87 @@ const char* Decoder::decode_cstring()
     return res;
 }
 
+uint32_t Decoder::decode_varint()
+{
+    uint32_t res = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7)
+    {
+        if (!size) error_toolong::throwf("cannot decode a varint: reached the end of buffer before the end of the number");
+        uint8_t c = *buf++;
+        --size;
+        res |= (uint32_t)(c & 0x7f) << shift;
+        if (!(c & 0x80)) return res;
+    }
+    error_consistency::throwf("cannot decode a varint: the number is longer than 32 bits");
+}
+
+wreport::Varcode Decoder::decode_varcode()
+{
+    if (version == 1)
+        return decode_uint16();
+    uint32_t val = decode_varint();
+    if (val < common_codes_size)
+        return common_codes[val];
+    return val - common_codes_size;
+}
+
+void Decoder::decode_value(wreport::Var& var)
+{
+    switch (var.info()->type)
+    {
+        case Vartype::Binary:
+        case Vartype::String:
+            if (version == 1)
+                var.setc(decode_cstring());
+            else {
+                uint32_t len = decode_varint();
+                if (size < len) error_toolong::throwf("cannot decode a %u bytes string: only %u bytes are left to read", len, size);
+                var.setc(std::string((const char*)buf, len).c_str());
+                buf += len;
+                size -= len;
+            }
+            break;
+        case Vartype::Integer:
+        case Vartype::Decimal:
+            if (version == 1)
+                var.seti((int)decode_uint32());
+            else {
+                uint32_t val = decode_varint();
+                var.seti((int32_t)(val >> 1) ^ -(int32_t)(val & 1));
+            }
+            break;
+    }
+}
+
 unique_ptr<wreport::Var> Decoder::decode_var()
 {
-    wreport::Varinfo info = varinfo(decode_uint16());
+    unique_ptr<wreport::Var> res(new wreport::Var(varinfo(decode_varcode())));
+    decode_value(*res);
+    return res;
+}
+
+void Decoder::skip_value(wreport::Varinfo info)
+{
     switch (info->type)
     {
         case Vartype::Binary:
         case Vartype::String:
-            return unique_ptr<wreport::Var>(new wreport::Var(info, decode_cstring()));
+            if (version == 1)
+                decode_cstring();
+            else {
+                uint32_t len = decode_varint();
+                if (size < len) error_toolong::throwf("cannot skip a %u bytes string: only %u bytes are left to read", len, size);
+                buf += len;
+                size -= len;
+            }
+            break;
         case Vartype::Integer:
         case Vartype::Decimal:
-            return unique_ptr<wreport::Var>(new wreport::Var(info, (int)decode_uint32()));
-        default:
-            error_consistency::throwf("unsupported variable type %d", (int)info->type);
+            if (version == 1)
+                decode_uint32();
+            else
+                decode_varint();
+            break;
     }
 }
 
@@ -118,6 +253,42 @@ void Decoder::decode_attrs(const std::vector<uint8_t>& buf, wreport::Var& var)
         var.seta(move(dec.decode_var()));
 }
 
+bool Decoder::is_outdated(const std::vector<uint8_t>& buf)
+{
+    if (buf.empty()) return false;
+    return buf[0] != FORMAT_MARKER || buf.size() < 2 || buf[1] < FORMAT_VERSION;
+}
+
+bool Decoder::upgrade(std::vector<uint8_t>& buf)
+{
+    if (!is_outdated(buf)) return false;
+    Encoder enc;
+    Decoder dec(buf);
+    while (dec.size)
+        enc.append(*dec.decode_var());
+    buf = move(enc.buf);
+    return true;
+}
+
+bool Decoder::match_attrs(const std::vector<uint8_t>& buf, const Varmatch& match)
+{
+    Decoder dec(buf);
+    while (dec.size)
+    {
+        wreport::Varinfo info = varinfo(dec.decode_varcode());
+        if (info->code != match.code)
+        {
+            dec.skip_value(info);
+            continue;
+        }
+        wreport::Var var(info);
+        dec.decode_value(var);
+        if (match(var))
+            return true;
+    }
+    return false;
+}
+
 }
 }
 }
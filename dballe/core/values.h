@@ -2,6 +2,7 @@
 #define DBALLE_CORE_VALUES_H
 
 #include <dballe/fwd.h>
+#include <dballe/core/fwd.h>
 #include <wreport/var.h>
 #include <vector>
 
@@ -9,6 +10,30 @@ namespace dballe {
 namespace core {
 namespace value {
 
+/**
+ * Binary encoding of lists of variables, used to store attributes.
+ *
+ * Version 1 of the encoding is a sequence of big endian 16 bit varcodes, each
+ * followed by a NUL-terminated string for string and binary values, or by a
+ * big endian 32 bit integer with the scaled value for numeric variables.
+ *
+ * Version 2 starts with the two bytes FORMAT_MARKER and 2, followed by a
+ * sequence of:
+ *
+ * * a varint with the index of the varcode in the table of common attribute
+ *   varcodes, or with the varcode plus the size of the table;
+ * * a zigzag encoded varint with the scaled value for numeric variables, or
+ *   a varint length followed by the string for string and binary values.
+ *
+ * A version 1 buffer cannot start with FORMAT_MARKER, since the first byte of
+ * a B table varcode is at most 0x3f. An empty buffer means no variables in
+ * all versions.
+ */
+static const uint8_t FORMAT_MARKER = 0xff;
+
+/// Version of the encoding written by Encoder
+static const uint8_t FORMAT_VERSION = 2;
+
 struct Encoder
 {
     std::vector<uint8_t> buf;
@@ -17,6 +42,8 @@ struct Encoder
     void append_uint16(uint16_t val);
     void append_uint32(uint32_t val);
     void append_cstring(const char* val);
+    void append_varint(uint32_t val);
+    void append_varcode(wreport::Varcode code);
     void append(const wreport::Var& var);
     void append_attributes(const wreport::Var& var);
 };
@@ -25,17 +52,45 @@ struct Decoder
 {
     const uint8_t* buf;
     unsigned size;
+    /// Version of the encoding of buf
+    unsigned version = 1;
 
     Decoder(const std::vector<uint8_t>& buf);
     uint16_t decode_uint16();
     uint32_t decode_uint32();
     const char* decode_cstring();
+    uint32_t decode_varint();
+    wreport::Varcode decode_varcode();
     std::unique_ptr<wreport::Var> decode_var();
 
+    /// Decode the value of an encoded variable, after its varcode
+    void decode_value(wreport::Var& var);
+
+    /// Skip an encoded value of the given variable
+    void skip_value(wreport::Varinfo info);
+
+    /// Check if buf is encoded with a version older than FORMAT_VERSION
+    static bool is_outdated(const std::vector<uint8_t>& buf);
+
+    /**
+     * Reencode buf with the current version of the encoding.
+     *
+     * @return true if buf has been changed
+     */
+    static bool upgrade(std::vector<uint8_t>& buf);
+
     /**
      * Decode the attributes of var from a buffer
      */
     static void decode_attrs(const std::vector<uint8_t>& buf, wreport::Var& var);
+
+    /**
+     * Check if any of the attributes encoded in buf matches match.
+     *
+     * Only attributes with the varcode of the matcher are decoded: all the
+     * others are skipped without allocating a Var.
+     */
+    static bool match_attrs(const std::vector<uint8_t>& buf, const Varmatch& match);
 };
 
 }
@@ -97,6 +97,24 @@ add_method("parse_wipe", []{
     wassert_false(opts->wipe);
 });
 
+add_method("parse_reconnect_after_fork", []{
+    auto opts = DBConnectOptions::create("sqlite://test.sqlite");
+    wassert_false(opts->reconnect_after_fork);
+
+    opts = DBConnectOptions::create("sqlite://test.sqlite?reconnect_after_fork=yes&wipe");
+    wassert(actual(opts->url) == "sqlite://test.sqlite");
+    wassert_true(opts->reconnect_after_fork);
+    wassert_true(opts->wipe);
+    opts->reset_actions();
+    wassert_true(opts->reconnect_after_fork);
+
+    opts = DBConnectOptions::create("postgresql:///testuser@testhost/testdb?port=5433&reconnect_after_fork=no");
+    wassert(actual(opts->url) == "postgresql:///testuser@testhost/testdb?port=5433");
+    wassert_false(opts->reconnect_after_fork);
+
+    wassert(actual_function([] { DBConnectOptions::create("sqlite://test.sqlite?reconnect_after_fork=maybe"); }).throws("unsupported value for reconnect_after_fork: maybe"));
+});
+
 }
 
 }
@@ -1,5 +1,6 @@
 #include "db.h"
 #include "db/db.h"
+#include "db/v7/db.h"
 #include "sql/sql.h"
 #include "core/string.h"
 #include "wreport/utils/string.h"
@@ -10,7 +11,7 @@ using namespace wreport;
 
 namespace dballe {
 
-static bool parse_wipe(const std::string& strval)
+static bool parse_bool(const char* name, const std::string& strval)
 {
     std::string val = str::lower(strval);
     if (val.empty()) return true;
@@ -20,7 +21,34 @@ static bool parse_wipe(const std::string& strval)
     if (val == "0") return false;
     if (val == "no") return false;
     if (val == "false") return false;
-    wreport::error_consistency::throwf("unsupported value for wipe: %s (supported: 1/0, true/false, yes/no)", strval.c_str());
+    wreport::error_consistency::throwf("unsupported value for %s: %s (supported: 1/0, true/false, yes/no)", name, strval.c_str());
+}
+
+static unsigned parse_pool_size(const std::string& strval)
+{
+    char* end;
+    unsigned long val = strtoul(strval.c_str(), &end, 10);
+    if (strval.empty() || *end || val > 1024)
+        wreport::error_consistency::throwf("unsupported value for pool: %s (supported: a number of connections between 0 and 1024)", strval.c_str());
+    return val;
+}
+
+static size_t parse_memory_size(const char* name, const std::string& strval)
+{
+    char* end;
+    unsigned long long val = strtoull(strval.c_str(), &end, 10);
+    if (!strval.empty() && end != strval.c_str())
+    {
+        switch (*end)
+        {
+            case 'k': case 'K': val *= 1024; ++end; break;
+            case 'm': case 'M': val *= 1024 * 1024; ++end; break;
+            case 'g': case 'G': val *= 1024 * 1024 * 1024; ++end; break;
+        }
+        if (!*end)
+            return val;
+    }
+    wreport::error_consistency::throwf("unsupported value for %s: %s (supported: a number of bytes, optionally followed by k, M or G)", name, strval.c_str());
 }
 
 void DBConnectOptions::reset_actions()
@@ -35,10 +63,22 @@ std::unique_ptr<DBConnectOptions> DBConnectOptions::create(const std::string& ur
 
     std::string wipe;
     if (url_pop_query_string(res->url, "wipe", wipe))
-        res->wipe = parse_wipe(wipe);
+        res->wipe = parse_bool("wipe", wipe);
     else
         res->wipe = false;
 
+    std::string pool;
+    if (url_pop_query_string(res->url, "pool", pool))
+        res->pool_size = parse_pool_size(pool);
+
+    std::string reconnect;
+    if (url_pop_query_string(res->url, "reconnect_after_fork", reconnect))
+        res->reconnect_after_fork = parse_bool("reconnect_after_fork", reconnect);
+
+    std::string query_cache;
+    if (url_pop_query_string(res->url, "query_cache", query_cache))
+        res->query_cache_size = parse_memory_size("query_cache", query_cache);
+
     if (strncmp(url.c_str(), "test:", 5) == 0)
     {
         const char* envurl = getenv("DBA_DB");
@@ -113,16 +153,26 @@ DB::~DB()
 
 std::shared_ptr<DB> DB::connect(const DBConnectOptions& opts)
 {
+    std::shared_ptr<db::DB> res;
     if (opts.url == "mem:")
     {
-        return db::DB::connect_memory();
+        res = db::DB::connect_memory();
+    } else if (opts.url.compare(0, 4, "arc:") == 0) {
+        if (opts.wipe)
+            throw error_consistency("cannot wipe an archive database: archives are read-only");
+        res = db::DB::connect_archive(opts.url.c_str() + 4);
     } else {
         auto conn(sql::Connection::create(opts));
-        auto res = db::DB::create(conn);
+        conn->reconnect_after_fork = opts.reconnect_after_fork;
+        res = db::DB::create(conn);
         if (opts.wipe)
             res->reset();
-        return res;
     }
+    if (opts.pool_size)
+        std::dynamic_pointer_cast<db::v7::DB>(res)->open_pool(opts.pool_size);
+    if (opts.query_cache_size)
+        std::dynamic_pointer_cast<db::v7::DB>(res)->enable_query_cache(opts.query_cache_size);
+    return res;
 }
 
 std::shared_ptr<CursorStation> DB::query_stations(const Query& query)
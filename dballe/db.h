@@ -27,6 +27,25 @@ public:
     /// Wipe database on connection
     bool wipe = false;
 
+    /**
+     * Number of read-only connections to open, to run read-only transactions
+     * concurrently from multiple threads. 0 (the default) disables pooling.
+     */
+    unsigned pool_size = 0;
+
+    /**
+     * Reopen the database connections when they are used in a child process
+     * after fork(), instead of raising an error. Data cached by the DB object
+     * before forking is kept.
+     */
+    bool reconnect_after_fork = false;
+
+    /**
+     * Maximum memory, in bytes, used to cache the results of data queries. 0
+     * (the default) disables the cache.
+     */
+    size_t query_cache_size = 0;
+
     /**
      * Disable all the one-off actions set to perform on connection.
      *
@@ -2,11 +2,19 @@
 #include "dballe/db/tests.h"
 #include "dballe/core/error.h"
 #include "dballe/db.h"
+#include "dballe/core/json.h"
+#include "dballe/core/values.h"
+#include "dballe/sql/sql.h"
+#include "explorer.h"
 #include "v7/repinfo.h"
 #include "v7/db.h"
+#include "v7/pool.h"
 #include "v7/transaction.h"
 #include "config.h"
+#include <algorithm>
 #include <cstring>
+#include <sstream>
+#include <thread>
 #include <unistd.h>
 #include <wreport/utils/subprocess.h>
 
@@ -37,6 +45,7 @@ class CommitTests : public FixtureTestCase<DBFixture<DB>>
 };
 
 Tests<V7DB> tg2("db_basic_tr_v7_sqlite", "SQLITE");
+Tests<V7DB> tg2_mem("db_basic_tr_v7_mem", "MEM");
 #ifdef HAVE_LIBPQ
 Tests<V7DB> tg4("db_basic_tr_v7_postgresql", "POSTGRESQL");
 #endif
@@ -45,6 +54,7 @@ Tests<V7DB> tg6("db_basic_tr_v7_mysql", "MYSQL");
 #endif
 
 CommitTests<V7DB> ct2("db_basic_db_v7_sqlite", "SQLITE");
+CommitTests<V7DB> ct2_mem("db_basic_db_v7_mem", "MEM");
 #ifdef HAVE_LIBPQ
 CommitTests<V7DB> ct4("db_basic_db_v7_postgresql", "POSTGRESQL");
 #endif
@@ -545,6 +555,639 @@ this->add_method("vacuum", [](Fixture& f) {
     }
 });
 
+this->add_method("purge_before", [](Fixture& f) {
+    TestDataSet data;
+    data.stations["s1"].station.report = "synop";
+    data.stations["s1"].station.coords = Coords(12.34560, 76.54320);
+    data.stations["s1"].values.set("B01019", "Station 1");
+
+    data.stations["s2"].station.report = "metar";
+    data.stations["s2"].station.coords = Coords(23.45670, 65.43210);
+    data.stations["s2"].values.set("B01019", "Station 2");
+
+    data.data["s1"].station = data.stations["s1"].station;
+    data.data["s1"].level = Level(10, 11, 15, 22);
+    data.data["s1"].trange = Trange(20, 111, 122);
+    data.data["s1"].datetime = Datetime(1945, 4, 25, 8);
+    data.data["s1"].values.set("B01011", "Data 1");
+
+    data.data["s2old"].station = data.stations["s2"].station;
+    data.data["s2old"].level = Level(1);
+    data.data["s2old"].trange = Trange::instant();
+    data.data["s2old"].datetime = Datetime(1945, 4, 25, 8);
+    data.data["s2old"].values.set("B01011", "Data 2");
+
+    data.data["s2"].station = data.stations["s2"].station;
+    data.data["s2"].level = Level(10, 11, 15, 22);
+    data.data["s2"].trange = Trange(20, 111, 122);
+    data.data["s2"].datetime = Datetime(2015, 4, 25, 8);
+    data.data["s2"].values.set("B01011", "Data 3");
+
+    wassert(f.populate_database(data));
+
+    auto& db = *f.db;
+
+    // Batches are made of the rows to delete, whatever gaps there are in ids
+    {
+        auto t = db.conn->transaction();
+        int id_min, id_max, batch_last;
+        wassert_true(db.driver().data_id_range_v7(id_min, id_max));
+        wassert_true(db.driver().data_next_batch_v7(Datetime(2000, 1, 1), id_min - 1, 1, batch_last));
+        wassert(actual(batch_last) >= id_min);
+        int first = batch_last;
+        wassert_true(db.driver().data_next_batch_v7(Datetime(2000, 1, 1), first, 1000, batch_last));
+        wassert(actual(batch_last) > first);
+        wassert_false(db.driver().data_next_batch_v7(Datetime(2000, 1, 1), batch_last, 1000, batch_last));
+        t->rollback();
+    }
+
+    // Use a tiny batch size to exercise batching
+    wassert(actual(db.purge_before(Datetime(2000, 1, 1), 1)) == 2u);
+
+    // Only the recent value is left
+    {
+        auto c = db.query_data(core::Query());
+        wassert(actual(c->remaining()) == 1);
+        c->next();
+        wassert(actual(c->get_datetime()) == Datetime(2015, 4, 25, 8));
+    }
+
+    // Station 1 is gone, station 2 is still there with its station data
+    {
+        auto c = db.query_stations(core::Query());
+        wassert(actual(c->remaining()) == 1);
+        c->next();
+        wassert(actual(c->get_station().id) == data.stations["s2"].station.id);
+
+        core::Query q;
+        q.ana_id = data.stations["s2"].station.id;
+        wassert(actual(db.query_station_data(q)->remaining()) == 1);
+    }
+
+    // Purging again removes nothing
+    wassert(actual(db.purge_before(Datetime(2000, 1, 1))) == 0u);
+
+    // Purge from inside a transaction
+    {
+        auto tr = dynamic_pointer_cast<db::Transaction>(db.transaction());
+        wassert(actual(tr->purge_before(Datetime(2020, 1, 1))) == 1u);
+        tr->commit();
+    }
+    wassert(actual(db.query_data(core::Query())->remaining()) == 0);
+    wassert(actual(db.query_stations(core::Query())->remaining()) == 0);
+});
+
+this->add_method("upgrade_attrs", [](Fixture& f) {
+    OldDballeTestDataSet data;
+    wassert(f.populate_database(data));
+
+    auto& db = *f.db;
+    {
+        auto tr = dynamic_pointer_cast<db::Transaction>(db.transaction());
+        auto cur = tr->query_data(core::Query());
+        wassert_true(cur->next());
+        Values attrs;
+        attrs.set("B33007", 50);
+        attrs.set("B01212", "test");
+        tr->attr_insert_data(dynamic_pointer_cast<db::CursorData>(cur)->attr_reference_id(), attrs);
+        cur->discard();
+        tr->commit();
+    }
+
+    // Newly written attributes are already in the current encoding
+    wassert(actual(db.upgrade_attrs(1)) == 0u);
+
+    core::Query query;
+    query.query = "attrs";
+    auto cur = db.query_data(query);
+    unsigned found = 0;
+    while (cur->next())
+        if (cur->get_var().enqa(WR_VAR(0, 33, 7)))
+            ++found;
+    wassert(actual(found) == 1u);
+
+    // Attributes are kept decoded in memory, and there is nothing to upgrade
+    if (f.backend == "MEM") return;
+
+    // Store attributes encoded with version 1 of the encoding in all the
+    // rows of data and station_data
+    core::value::Encoder enc;
+    enc.append_uint16(WR_VAR(0, 33, 7));
+    enc.append_uint32(50);
+    enc.append_uint16(WR_VAR(0, 1, 212));
+    enc.append_cstring("test");
+    std::string hex;
+    char buf[3];
+    for (uint8_t c: enc.buf)
+    {
+        snprintf(buf, 3, "%02x", (unsigned)c);
+        hex += buf;
+    }
+    std::string blob = db.conn->server_type == sql::ServerType::POSTGRES ? "'\\x" + hex + "'::bytea" : "X'" + hex + "'";
+    {
+        auto t = db.conn->transaction();
+        db.conn->execute("UPDATE data SET attrs=" + blob);
+        db.conn->execute("UPDATE station_data SET attrs=" + blob);
+        t->commit();
+    }
+
+    // Format all values with their attributes
+    auto dump = [&]() {
+        std::string res;
+        auto tr = db.transaction();
+        auto scur = tr->query_station_data(query);
+        while (scur->next())
+        {
+            Var var = scur->get_var();
+            std::string row = var.format();
+            for (const Var* a = var.next_attr(); a; a = a->next_attr())
+                row += " " + varcode_format(a->code()) + "=" + a->format();
+            res += row + "\n";
+        }
+        auto dcur = tr->query_data(query);
+        while (dcur->next())
+        {
+            Var var = dcur->get_var();
+            std::string row = var.format();
+            for (const Var* a = var.next_attr(); a; a = a->next_attr())
+                row += " " + varcode_format(a->code()) + "=" + a->format();
+            res += row + "\n";
+        }
+        tr->rollback();
+        return res;
+    };
+
+    std::string legacy = dump();
+    auto occurrences = [&](const std::string& s) {
+        unsigned res = 0;
+        for (size_t pos = legacy.find(s); pos != std::string::npos; pos = legacy.find(s, pos + 1))
+            ++res;
+        return res;
+    };
+    wassert(actual(occurrences("\n")) == 14u);
+    wassert(actual(occurrences(" B33007=50")) == 14u);
+    wassert(actual(occurrences(" B01212=test")) == 14u);
+
+    wassert(actual(db.upgrade_attrs(3)) == 14u);
+    wassert(actual(db.upgrade_attrs(3)) == 0u);
+    wassert(actual(dump()) == legacy);
+});
+
+this->add_method("summary_table", [](Fixture& f) {
+    auto& db = *f.db;
+    if (f.backend == "MEM")
+    {
+        wassert(actual_function([&] { db.set_summary_table(true); }).throws("in-memory databases do not support a summary table"));
+        return;
+    }
+
+    OldDballeTestDataSet data;
+    wassert(f.populate_database(data));
+
+    // Format the results of a detailed summary query
+    auto summary = [&]() {
+        core::Query query;
+        query.query = "details";
+        auto tr = db.transaction();
+        auto cur = tr->query_summary(query);
+        std::vector<std::string> rows;
+        while (cur->next())
+        {
+            DatetimeRange dt = cur->get_datetimerange();
+            rows.push_back(cur->get_station().to_string() + " " + cur->get_level().to_string() + " "
+                    + cur->get_trange().to_string() + " " + varcode_format(cur->get_varcode()) + " "
+                    + std::to_string(cur->get_count()) + " " + dt.min.to_string() + " " + dt.max.to_string());
+        }
+        tr->rollback();
+        std::sort(rows.begin(), rows.end());
+        std::string res;
+        for (const auto& row: rows)
+            res += row + "\n";
+        return res;
+    };
+
+    // Compare the incrementally maintained summary table with one rebuilt
+    // from scratch
+    auto check = [&]() {
+        std::string incremental = summary();
+        db.set_summary_table(false);
+        std::string full = summary();
+        db.set_summary_table(true);
+        wassert(actual(incremental) == full);
+    };
+
+    std::string before = summary();
+    db.set_summary_table(true);
+    wassert(actual(summary()) == before);
+
+    // Insert new values, in a new and in an existing time series
+    {
+        auto tr = db.transaction();
+        core::Data d;
+        d.station = data.stations["synop"].station;
+        d.level = Level(10, 11, 15, 22);
+        d.trange = Trange(20, 111, 122);
+        d.datetime = Datetime(1945, 4, 26, 8);
+        d.values.set("B01011", "new value");
+        d.values.set("B12101", 273.15);
+        wassert(tr->insert_data(d, DBInsertOptions::defaults));
+        tr->commit();
+    }
+    wassert(check());
+
+    // Delete by query
+    {
+        auto tr = db.transaction();
+        core::Query query;
+        query.dtrange = DatetimeRange(Datetime(1945, 4, 25, 8), Datetime(1945, 4, 25, 8));
+        tr->remove_data(query);
+        tr->commit();
+    }
+    wassert(check());
+
+    // Delete by id
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(db.transaction());
+        core::Query query;
+        query.varcodes.insert(WR_VAR(0, 12, 101));
+        auto cur = tr->query_data(query);
+        wassert_true(cur->next());
+        int id = dynamic_pointer_cast<db::CursorData>(cur)->attr_reference_id();
+        cur->discard();
+        tr->remove_data_by_id(id);
+        tr->commit();
+    }
+    wassert(check());
+
+    // Purge
+    wassert(actual(db.purge_before(Datetime(1945, 4, 26), 1)) == 2u);
+    wassert(check());
+
+    // Transactions notice when the summary table is dropped or created
+    // outside of this DB
+    db.conn->execute("DROP TABLE summary");
+    {
+        auto tr = db.transaction();
+        core::Data d;
+        d.station = data.stations["synop"].station;
+        d.level = Level(10, 11, 15, 22);
+        d.trange = Trange(20, 111, 122);
+        d.datetime = Datetime(1945, 4, 27, 8);
+        d.values.set("B12101", 274.15);
+        wassert(tr->insert_data(d, DBInsertOptions::defaults));
+        tr->commit();
+    }
+    db.set_summary_table(true);
+    wassert(check());
+
+    db.set_summary_table(false);
+});
+
+this->add_method("change_feed", [](Fixture& f) {
+    auto& db = *f.db;
+    OldDballeTestDataSet data;
+    wassert(f.populate_database(data));
+
+    auto to_json = [](const DBExplorer& explorer) {
+        std::stringstream json;
+        core::JSONWriter writer(json);
+        explorer.to_json(writer);
+        return json.str();
+    };
+
+    // Serialize an explorer rebuilt from the whole database
+    auto rebuilt = [&]() {
+        DBExplorer explorer;
+        auto tr = db.transaction();
+        {
+            auto update = explorer.rebuild();
+            update.add_db(*tr);
+        }
+        tr->rollback();
+        return to_json(explorer);
+    };
+
+    DBExplorer explorer;
+    {
+        auto tr = db.transaction();
+        auto update = explorer.rebuild();
+        wassert(update.add_db(*tr));
+        tr->rollback();
+    }
+
+    // Apply the changes recorded by a transaction to the explorer
+    auto apply = [&](db::v7::Transaction& tr) {
+        auto update = explorer.update();
+        update.add_changes(tr.changes());
+    };
+
+    // Insert new values, in a new and in an existing time series
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(db.transaction());
+        tr->record_changes();
+        core::Data d;
+        d.station = data.stations["synop"].station;
+        d.level = Level(10, 11, 15, 22);
+        d.trange = Trange(20, 111, 122);
+        d.datetime = Datetime(1945, 4, 26, 8);
+        d.values.set("B01011", "new value");
+        d.values.set("B12101", 273.15);
+        wassert(tr->insert_data(d, DBInsertOptions::defaults));
+        tr->commit();
+        wassert(actual(tr->changes().added.size()) == 2u);
+        wassert(actual(tr->changes().replaced.size()) == 0u);
+        wassert(apply(*tr));
+    }
+    wassert(actual(to_json(explorer)) == rebuilt());
+
+    // Delete by query
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(db.transaction());
+        tr->record_changes();
+        core::Query query;
+        query.dtrange = DatetimeRange(Datetime(1945, 4, 25, 8), Datetime(1945, 4, 25, 8));
+        tr->remove_data(query);
+        tr->commit();
+        wassert(actual(tr->changes().added.size()) == 0u);
+        wassert_false(tr->changes().replaced.empty());
+        wassert(apply(*tr));
+    }
+    wassert(actual(to_json(explorer)) == rebuilt());
+
+    // Delete by id
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(db.transaction());
+        tr->record_changes();
+        core::Query query;
+        query.varcodes.insert(WR_VAR(0, 12, 101));
+        auto cur = tr->query_data(query);
+        wassert_true(cur->next());
+        int id = dynamic_pointer_cast<db::CursorData>(cur)->attr_reference_id();
+        cur->discard();
+        tr->remove_data_by_id(id);
+        tr->commit();
+        wassert(actual(tr->changes().replaced.size()) == 1u);
+        wassert(apply(*tr));
+        wassert(actual(to_json(explorer)) == rebuilt());
+    }
+
+    // Purge the metar values, leaving its station without data
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(db.transaction());
+        tr->record_changes();
+        wassert(actual(tr->purge_before(Datetime(1945, 4, 26))) == 2u);
+        tr->commit();
+        wassert(actual(tr->changes().added.size()) == 0u);
+        wassert(actual(tr->changes().replaced.size()) == 2u);
+        for (const auto& change: tr->changes().replaced)
+        {
+            wassert(actual(change.station.report) == "metar");
+            wassert(actual(change.count) == 0u);
+        }
+        wassert(apply(*tr));
+    }
+    wassert(actual(to_json(explorer)) == rebuilt());
+
+    // Changes are not recorded unless requested
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(db.transaction());
+        tr->remove_data(core::Query());
+        tr->rollback();
+        wassert_true(tr->changes().empty());
+    }
+
+    // Remove everything
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(db.transaction());
+        tr->record_changes();
+        tr->remove_all();
+        tr->commit();
+        wassert_true(tr->changes().cleared);
+        wassert(apply(*tr));
+    }
+    wassert(actual(explorer.global_summary().data_count()) == 0u);
+    wassert(actual(to_json(explorer)) == rebuilt());
+});
+
+this->add_method("connection_pool", [](Fixture& f) {
+    auto& db = *f.db;
+    if (f.backend == "MEM")
+    {
+        wassert(actual_function([&] { db.open_pool(2); }).throws("connection pools are not supported on in-memory databases"));
+        return;
+    }
+
+    OldDballeTestDataSet data;
+    wassert(f.populate_database(data));
+    wassert(db.open_pool(2));
+
+    // Count data and collect levels with a read-only transaction
+    auto read = [&]() {
+        std::string res;
+        auto tr = db.transaction(true);
+        auto cur = tr->query_data(core::Query());
+        res = std::to_string(cur->remaining());
+        while (cur->next())
+            res += " " + cur->get_level().to_string();
+        tr->rollback();
+        return res;
+    };
+    std::string expected = read();
+
+    // Run more readers than there are pooled connections
+    std::vector<std::string> results(4);
+    std::vector<std::string> errors(4);
+    std::vector<std::thread> threads;
+    for (unsigned i = 0; i < 4; ++i)
+        threads.emplace_back([&, i] {
+            try {
+                results[i] = read();
+            } catch (std::exception& e) {
+                errors[i] = e.what();
+            }
+        });
+    for (auto& t: threads)
+        t.join();
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        wassert(actual(errors[i]) == "");
+        wassert(actual(results[i]) == expected);
+    }
+
+    // Committed changes, including new levels, are seen by pooled readers
+    {
+        auto tr = db.transaction();
+        core::Data d;
+        d.station = data.stations["synop"].station;
+        d.level = Level(1, 2, 3, 4);
+        d.trange = Trange(20, 111, 122);
+        d.datetime = Datetime(1945, 4, 26, 8);
+        d.values.set("B12101", 273.15);
+        wassert(tr->insert_data(d, DBInsertOptions::defaults));
+        tr->commit();
+    }
+    std::string updated = read();
+    wassert(actual(updated) != expected);
+    wassert(actual(updated).contains(Level(1, 2, 3, 4).to_string()));
+
+    db.pool.reset();
+    db.shared_cache.reset();
+});
+
+this->add_method("parallel_query", [](Fixture& f) {
+    auto& db = *f.db;
+
+    // Queries are only split on backends whose transactions can share a
+    // snapshot of the database
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(db.transaction(true));
+        std::string snapshot = tr->connection().export_snapshot();
+        tr->rollback();
+        if (snapshot.empty())
+            throw TestSkipped();
+    }
+
+    OldDballeTestDataSet data;
+    wassert(f.populate_database(data));
+    wassert(db.open_pool(3));
+
+    // Format the results of a data query, one value per line
+    auto read = [&](const core::Query& query) {
+        std::string res;
+        auto tr = db.transaction(true);
+        auto cur = tr->query_data(query);
+        while (cur->next())
+            res += cur->get_station().to_string() + " " + cur->get_level().to_string() + " "
+                + cur->get_trange().to_string() + " " + cur->get_datetime().to_string() + " "
+                + cur->get_var().format() + "\n";
+        tr->rollback();
+        return res;
+    };
+
+    // Compare the results of a query run with and without the parallel modifier
+    auto check = [&](core::Query query) {
+        std::string expected = read(query);
+        wassert_true(!expected.empty());
+        query.query += query.query.empty() ? "parallel" : ",parallel";
+        wassert(actual(read(query)) == expected);
+    };
+
+    // Split by station
+    wassert(check(core::Query()));
+    core::Query query;
+    query.query = "last";
+    wassert(check(query));
+
+    // Split by datetime on a single station
+    query = core::Query();
+    query.ana_id = data.stations["synop"].station.id;
+    query.dtrange = DatetimeRange(Datetime(1945, 4, 25), Datetime(1945, 4, 26));
+    wassert(check(query));
+
+    // Unsorted results contain the same values
+    query = core::Query();
+    query.query = "nosort,parallel";
+    auto tr = db.transaction(true);
+    auto cur = tr->query_data(query);
+    wassert(actual(cur->remaining()) == tr->query_data(core::Query())->remaining());
+    tr->rollback();
+    cur.reset();
+    tr.reset();
+
+    // Parts only run on free connections: with a single pooled connection,
+    // held by the transaction running the query, it runs as usual
+    db.pool.reset();
+    db.shared_cache.reset();
+    wassert(db.open_pool(1));
+    {
+        auto tr1 = db.transaction(true);
+        wassert_true(db.pool->try_acquire() == nullptr);
+        tr1->rollback();
+    }
+    wassert_true(db.pool->try_acquire() != nullptr);
+    wassert(check(core::Query()));
+
+    db.pool.reset();
+    db.shared_cache.reset();
+});
+
+this->add_method("query_cache", [](Fixture& f) {
+    auto& db = *f.db;
+    OldDballeTestDataSet data;
+    wassert(f.populate_database(data));
+    db.enable_query_cache(1024 * 1024);
+
+    // Format the results of a data query, one value per line
+    auto read = [](dballe::Transaction& tr, const core::Query& query) {
+        std::string res;
+        auto cur = tr.query_data(query);
+        while (cur->next())
+            res += cur->get_station().to_string() + " " + cur->get_level().to_string() + " "
+                + cur->get_datetime().to_string() + " " + cur->get_var().format() + "\n";
+        return res;
+    };
+
+    core::Query query;
+    query.dtrange = DatetimeRange(Datetime(1945, 1, 1), Datetime(1945, 12, 31, 23, 59, 59));
+    query.query = "attrs,last";
+    std::string expected;
+    {
+        auto tr = db.transaction();
+        expected = read(*tr, query);
+        tr->rollback();
+    }
+    wassert(actual(db.query_cache->size()) == 1u);
+    wassert(actual(db.query_cache->misses()) == 1u);
+
+    // The same query, written in a different way, is answered from the cache
+    core::Query query1(query);
+    query1.query = "last,attrs";
+    {
+        auto tr = db.transaction();
+        wassert(actual(read(*tr, query1)) == expected);
+        tr->rollback();
+    }
+    wassert(actual(db.query_cache->hits()) == 1u);
+
+    // Transactions that wrote see their own changes, and committing them
+    // invalidates the cache
+    std::string updated;
+    {
+        auto tr = db.transaction();
+        core::Data d;
+        d.station = data.stations["synop"].station;
+        d.level = Level(1, 2, 3, 4);
+        d.trange = Trange(20, 111, 122);
+        d.datetime = Datetime(1945, 4, 26, 8);
+        d.values.set("B12101", 273.15);
+        wassert(tr->insert_data(d, DBInsertOptions::defaults));
+        updated = read(*tr, query);
+        wassert(actual(updated) != expected);
+        tr->commit();
+    }
+    {
+        auto tr = db.transaction();
+        wassert(actual(read(*tr, query)) == updated);
+        tr->rollback();
+    }
+    wassert(actual(db.query_cache->hits()) == 1u);
+    wassert(actual(db.query_cache->misses()) == 2u);
+    wassert(actual(db.query_cache->size()) == 1u);
+
+    // Entries that do not fit in the memory budget are evicted
+    db.enable_query_cache(db.query_cache->memory());
+    for (const auto& q: { query, core::Query() })
+    {
+        auto tr = db.transaction();
+        read(*tr, q);
+        tr->rollback();
+    }
+    wassert(actual(db.query_cache->size()) <= 1u);
+    wassert(actual(db.query_cache->memory()) <= db.query_cache->max_memory);
+
+    db.query_cache.reset();
+});
+
 // Test simple queries
 this->add_method("wipe", [](Fixture& f) {
     // We are connected to an empty database
@@ -587,14 +1230,14 @@ this->add_method("transaction_create_error", [](Fixture& f) {
         auto t = f.db->transaction();
         throw TestFailed("db->transaction() should throw");
     } catch (dballe::error_db& e) {
-        wassert(actual(e.what()).matches("^cannot compile query|relation \"repinfo\" does not exist|Table 'test\\.repinfo' doesn't exist"));
+        wassert(actual(e.what()).matches("^cannot compile query|^cannot access table repinfo|relation \"repinfo\" does not exist|Table 'test\\.repinfo' doesn't exist"));
     }
 
     try {
         auto t = f.db->transaction();
         throw TestFailed("db->transaction() should throw");
     } catch (dballe::error_db& e) {
-        wassert(actual(e.what()).matches("^cannot compile query|relation \"repinfo\" does not exist|Table 'test\\.repinfo' doesn't exist"));
+        wassert(actual(e.what()).matches("^cannot compile query|^cannot access table repinfo|relation \"repinfo\" does not exist|Table 'test\\.repinfo' doesn't exist"));
     }
 });
 
@@ -639,6 +1282,68 @@ this->add_method("transactions_after_fork", [](Fixture& f) {
     f.db->transaction();
 });
 
+this->add_method("reconnect_after_fork", [](Fixture& f) {
+    if (f.backend == "MEM") return;
+
+    class TestChild: public subprocess::Child
+    {
+    protected:
+        std::shared_ptr<dballe::DB> db;
+
+        int main() noexcept override
+        {
+            try {
+                auto t = db->transaction();
+                unsigned count = t->query_stations(core::Query())->remaining();
+                t->rollback();
+                if (count != 2)
+                {
+                    fprintf(stderr, "Forked process found %u stations instead of 2\n", count);
+                    return 1;
+                }
+                return 0;
+            } catch (std::exception& e) {
+                fprintf(stderr, "Unexpected error starting a transaction in test child: %s", e.what());
+                return 2;
+            }
+        }
+
+    public:
+        TestChild(std::shared_ptr<dballe::DB> db)
+            : db(db)
+        {
+        }
+    };
+
+    OldDballeTestDataSet data;
+    wassert(f.populate_database(data));
+    f.db->conn->reconnect_after_fork = true;
+    // Pooled connections are also closed in the children, and on SQLite the
+    // pool switches the database to WAL journaling
+    wassert(f.db->open_pool(2));
+
+    TestChild child1(f.db);
+    TestChild child2(f.db);
+
+    child1.fork();
+    child2.fork();
+
+    wassert(actual(child1.wait()) == 0);
+    wassert(actual(child2.wait()) == 0);
+
+    // The connections of the parent are still usable
+    auto t = f.db->transaction();
+    wassert(actual(t->query_stations(core::Query())->remaining()) == 2);
+    t->rollback();
+    t = f.db->transaction(true);
+    wassert(actual(t->query_stations(core::Query())->remaining()) == 2);
+    t->rollback();
+    t.reset();
+    f.db->pool.reset();
+    f.db->shared_cache.reset();
+    f.db->conn->reconnect_after_fork = false;
+});
+
 }
 
 }
@@ -319,6 +319,7 @@ class Tests : public FixtureTestCase<EmptyTransactionFixture<DB>>
 };
 
 Tests<V7DB> tg2("db_import_v7_sqlite", "SQLITE");
+Tests<V7DB> tg2_mem("db_import_v7_mem", "MEM");
 #ifdef HAVE_LIBPQ
 Tests<V7DB> tg4("db_import_v7_postgresql", "POSTGRESQL");
 #endif
@@ -50,6 +50,7 @@ class CommitTests : public FixtureTestCase<DBFixture<DB>>
 };
 
 Tests<V7DB> tg2("db_misc_tr_v7_sqlite", "SQLITE");
+Tests<V7DB> tg2_mem("db_misc_tr_v7_mem", "MEM");
 #ifdef HAVE_LIBPQ
 Tests<V7DB> tg4("db_misc_tr_v7_postgresql", "POSTGRESQL");
 #endif
@@ -58,6 +59,7 @@ Tests<V7DB> tg6("db_misc_tr_v7_mysql", "MYSQL");
 #endif
 
 CommitTests<V7DB> ct2("db_misc_db_v7_sqlite", "SQLITE");
+CommitTests<V7DB> ct2_mem("db_misc_db_v7_mem", "MEM");
 #ifdef HAVE_LIBPQ
 CommitTests<V7DB> ct4("db_misc_db_v7_postgresql", "POSTGRESQL");
 #endif
@@ -409,6 +411,39 @@ this->add_method("delete_notfound", [](Fixture& f) {
     wassert(actual(cur->remaining()) == 4);
     cur->discard();
 });
+this->add_method("delete_attr_filter", [](Fixture& f) {
+    // Remove data selecting it by attributes
+    core::Data base;
+    base.station.coords = Coords(12.0, 48.0);
+    base.station.report = "synop";
+    base.level = Level(1, 0, 1, 0);
+    base.trange = Trange(1, 0, 0);
+
+    // The first value has no attributes, then values alternate between
+    // matching and not matching the filter
+    for (int i = 0; i < 31; ++i)
+    {
+        core::Data d = base;
+        d.datetime = Datetime(2020, 1, 1, 0, i);
+        d.values.set("B12101", 280.0 + i);
+        f.tr->insert_data(d);
+        if (i == 0) continue;
+        Values attrs;
+        attrs.set("B33007", i % 2 ? 10 : 90);
+        f.tr->attr_insert_data(d.values.value("B12101").data_id, attrs);
+    }
+
+    core::Query query;
+    query.attr_filter = "B33007<50";
+    f.tr->remove_data(query);
+
+    // Only the values without attributes or with B33007=90 are left
+    query.clear();
+    auto cur = f.tr->query_data(query);
+    wassert(actual(cur->remaining()) == 16);
+    while (cur->next())
+        wassert(actual(cur->get_datetime().minute % 2) == 0);
+});
 this->add_method("query_datetime", [](Fixture& f) {
     // Test datetime queries
     /* Prepare test data */
@@ -94,7 +94,9 @@ class EmptyFixtureTests : public FixtureTestCase<EmptyTransactionFixture<DB>>
 
 
 OldFixtureTests<V7DB> tg2("db_query_data1_v7_sqlite", "SQLITE");
+OldFixtureTests<V7DB> tg2_mem("db_query_data1_v7_mem", "MEM");
 EmptyFixtureTests<V7DB> tg4("db_query_data2_v7_sqlite", "SQLITE");
+EmptyFixtureTests<V7DB> tg4_mem("db_query_data2_v7_mem", "MEM");
 #ifdef HAVE_LIBPQ
 OldFixtureTests<V7DB> tg6("db_query_data1_v7_postgresql", "POSTGRESQL");
 EmptyFixtureTests<V7DB> tg8("db_query_data2_v7_postgresql", "POSTGRESQL");
@@ -181,6 +181,7 @@ class Tests : public FixtureTestCase<TransactionFixture<DB, DBData>>
 };
 
 Tests<V7DB> tg2("db_query_station_v7_sqlite", "SQLITE");
+Tests<V7DB> tg2_mem("db_query_station_v7_mem", "MEM");
 #ifdef HAVE_LIBPQ
 Tests<V7DB> tg4("db_query_station_v7_postgresql", "POSTGRESQL");
 #endif
@@ -273,6 +273,7 @@ class Tests : public FixtureTestCase<DBDataFixture<DB>>
 };
 
 Tests<V7DB> tg2("db_query_summary_v7_sqlite", "SQLITE");
+Tests<V7DB> tg2_mem("db_query_summary_v7_mem", "MEM");
 #ifdef HAVE_LIBPQ
 Tests<V7DB> tg4("db_query_summary_v7_postgresql", "POSTGRESQL");
 #endif
@@ -1,6 +1,7 @@
 #include "config.h"
 #include "db.h"
 #include "v7/db.h"
+#include "v7/memory/connection.h"
 #include "dballe/sql/sql.h"
 #include "dballe/sql/sqlite.h"
 #include "dballe/message.h"
@@ -68,6 +69,7 @@ void DB::set_default_format(Format format) { default_format = format; }
 bool DB::is_url(const char* str)
 {
     if (strncmp(str, "mem:", 4) == 0) return true;
+    if (strncmp(str, "arc:", 4) == 0) return true;
     if (strncmp(str, "sqlite:", 7) == 0) return true;
     if (strncmp(str, "postgresql:", 11) == 0) return true;
     if (strncmp(str, "mysql:", 6) == 0) return true;
@@ -126,13 +128,18 @@ shared_ptr<DB> DB::connect_from_file(const char* pathname)
 
 shared_ptr<DB> DB::connect_memory()
 {
-    auto conn = sql::SQLiteConnection::create();
-    conn->open_memory();
+    auto conn = v7::memory::MemoryConnection::create();
     auto res = static_pointer_cast<DB>(make_shared<v7::DB>(conn));
     res->reset();
     return res;
 }
 
+shared_ptr<DB> DB::connect_archive(const char* pathname)
+{
+    auto conn = v7::memory::MemoryConnection::open_archive(pathname);
+    return static_pointer_cast<DB>(make_shared<v7::DB>(conn));
+}
+
 const char* DB::default_repinfo_file()
 {
     const char* repinfo_file = getenv("DBA_REPINFO");
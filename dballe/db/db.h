@@ -243,6 +243,20 @@ public:
      */
     virtual void update_repinfo(const char* repinfo_file, int* added, int* deleted, int* updated) = 0;
 
+    /**
+     * Remove all measured data with a datetime earlier than dt, then remove
+     * the station and level/timerange entries that are left without data.
+     *
+     * Unlike remove_data(), this does not go through the query machinery and
+     * uses range deletes on the data table.
+     *
+     * @param dt
+     *   Data with datetime strictly earlier than this are removed
+     * @return
+     *   The number of measured values removed
+     */
+    virtual unsigned purge_before(const Datetime& dt) = 0;
+
     /**
      * Dump the entire contents of the database to an output stream
      */
@@ -268,6 +282,14 @@ public:
      */
     static std::shared_ptr<DB> connect_memory();
 
+    /**
+     * Open a read-only archive created with `dbadb archive`
+     *
+     * @param pathname
+     *   The pathname to the archive file
+     */
+    static std::shared_ptr<DB> connect_archive(const char* pathname);
+
     /**
      * Create a database from an open Connection
      */
@@ -324,6 +346,49 @@ public:
      */
     virtual void vacuum() = 0;
 
+    /**
+     * Remove all measured data with a datetime earlier than dt.
+     *
+     * Data are removed in batches of at most batch_size rows, each in its own
+     * transaction, so that the database never has to hold a huge transaction.
+     * Afterwards, orphan station and level/timerange entries are removed in
+     * bulk, and freed space is returned to the filesystem where the backend
+     * supports it.
+     *
+     * @param dt
+     *   Data with datetime strictly earlier than this are removed
+     * @param batch_size
+     *   Maximum number of rows removed in a single transaction
+     * @return
+     *   The number of measured values removed
+     */
+    virtual unsigned purge_before(const Datetime& dt, unsigned batch_size=10000) = 0;
+
+    /**
+     * Reencode with the current attribute encoding all the attributes stored
+     * with an older encoding.
+     *
+     * Rows are processed in batches of at most batch_size rows, each in its
+     * own transaction.
+     *
+     * @return
+     *   The number of values whose attributes have been reencoded
+     */
+    virtual unsigned upgrade_attrs(unsigned batch_size=10000) = 0;
+
+    /**
+     * Create or drop the summary table.
+     *
+     * The summary table keeps, for each (station, level/timerange, varcode)
+     * combination, the number of values and their datetime range. It is kept
+     * up to date when data are inserted or removed, and summary queries are
+     * answered from it when they do not filter on datetime or on values.
+     *
+     * Creating it scans the whole data table. It should be done when no other
+     * process is writing to the database.
+     */
+    virtual void set_summary_table(bool enabled) = 0;
+
     /**
      * Query attributes on a station value
      *
@@ -4,6 +4,7 @@
 #include "dballe/db/v7/transaction.h"
 #include "wreport/utils/sys.h"
 #include "explorer.h"
+#include "summary_memory.h"
 #include "config.h"
 
 using namespace dballe;
@@ -215,6 +216,108 @@ this->add_method("issue232", [](Fixture& f) {
         cur->get_datetimerange();
 });
 
+this->add_method("filter_view", [](Fixture& f) {
+    std::string json_sample = R"({"e":[
+        {"s":{"r":"synop","c":[4450000,1150000]},"v":[
+            {"l":[1,null,null,null],"t":[254,0,0],"v":3173,"d":[[2020,1,1,0,0,0],[2020,1,31,0,0,0]],"c":1},
+            {"l":[1,null,null,null],"t":[254,0,0],"v":344,"d":[[2020,1,1,0,0,0],[2020,1,31,0,0,0]],"c":2}
+        ]},
+        {"s":{"r":"synop","c":[-3350000,17950000]},"v":[
+            {"l":[1,null,null,null],"t":[254,0,0],"v":3173,"d":[[2020,2,1,0,0,0],[2020,2,28,0,0,0]],"c":4}
+        ]},
+        {"s":{"r":"temp","c":[1000000,-17950000]},"v":[
+            {"l":[1,null,null,null],"t":[254,0,0],"v":3173,"d":[[2021,1,1,0,0,0],[2021,1,31,0,0,0]],"c":8}
+        ]}]})";
+
+    EXPLORER explorer;
+    {
+        std::stringstream json(json_sample);
+        core::json::Stream in(json);
+        auto update = explorer.update();
+        wassert(update.add_json(in));
+    }
+    wassert(actual(explorer.global_summary().data_count()) == 15u);
+
+    core::Query query;
+    query.lonrange.set(170.0, -170.0);
+    explorer.set_filter(query);
+    wassert(actual(explorer.active_summary().data_count()) == 12u);
+
+    query = core::Query();
+    query.latrange.set(-40.0, 0.0);
+    explorer.set_filter(query);
+    wassert(actual(explorer.active_summary().data_count()) == 4u);
+
+    query = core::Query();
+    query.report = "synop";
+    query.varcodes.insert(WR_VAR(0, 12, 101));
+    explorer.set_filter(query);
+    wassert(actual(explorer.active_summary().data_count()) == 5u);
+    wassert(actual(explorer.active_summary().datetime_min()) == Datetime(2020, 1, 1));
+    wassert(actual(explorer.active_summary().datetime_max()) == Datetime(2020, 2, 28));
+
+    // Queries on the active summary only see the filtered entries
+    core::Query query1;
+    query1.dtrange.min = Datetime(2020, 2, 1);
+    auto cur = explorer.active_summary().query_summary(query1);
+    wassert(actual(cur->remaining()) == 1);
+
+    // The active summary serializes only the filtered entries
+    std::stringstream json;
+    core::JSONWriter writer(json);
+    explorer.active_summary().to_json(writer);
+    json.seekg(0);
+    core::json::Stream in(json);
+    SummaryMemory summary;
+    wassert(summary.load_json(in));
+    wassert(actual(summary.data_count()) == 5u);
+});
+
+this->add_method("binary_format", [](Fixture& f) {
+    OldDballeTestDataSet test_data;
+    wassert(f.populate(test_data));
+
+    sys::unlink_ifexists("test-explorer.summary");
+    std::string expected;
+    {
+        EXPLORER explorer("test-explorer.summary");
+        {
+            auto update = explorer.rebuild();
+            wassert(update.add_db(*f.tr));
+        }
+        std::stringstream json;
+        core::JSONWriter writer(json);
+        explorer.to_json(writer);
+        expected = json.str();
+    }
+
+    wassert_true(SummaryMemory::is_binary("test-explorer.summary"));
+
+    EXPLORER explorer("test-explorer.summary");
+    std::stringstream json;
+    core::JSONWriter writer(json);
+    explorer.to_json(writer);
+    wassert(actual(json.str()) == expected);
+    wassert(actual(explorer.global_summary().data_count()) == 4u);
+
+    core::Query query;
+    query.set_from_test_string("rep_memo=metar");
+    explorer.set_filter(query);
+    wassert(test_explorer_contents(explorer));
+
+    // Corrupted table sizes are rejected before reading the tables
+    std::string buf = sys::read_file("test-explorer.summary");
+    std::string corrupted = buf;
+    uint32_t entry_count = 0xffffffff;
+    corrupted.replace(28, sizeof(entry_count), (const char*)&entry_count, sizeof(entry_count));
+    sys::write_file("test-explorer-corrupted.summary", corrupted);
+    wassert(actual_function([] { SummaryMemory summary("test-explorer-corrupted.summary"); }).throws("truncated or corrupted"));
+
+    sys::write_file("test-explorer-corrupted.summary", buf.substr(0, buf.size() / 2));
+    wassert(actual_function([] { SummaryMemory summary("test-explorer-corrupted.summary"); }).throws("truncated or corrupted"));
+    sys::unlink_ifexists("test-explorer-corrupted.summary");
+});
+
 this->add_method("issue262", [](Fixture& f) {
     EXPLORER explorer1("test.xapian");
     EXPLORER explorer2("test.xapian");
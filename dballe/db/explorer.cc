@@ -37,7 +37,8 @@ template<typename Station>
 BaseExplorer<Station>::BaseExplorer(const std::string& pathname)
 {
     using namespace wreport;
-    if (str::endswith(pathname, ".json"))
+    if (str::endswith(pathname, ".json") || str::endswith(pathname, ".summary")
+            || db::BaseSummaryMemory<Station>::is_binary(pathname))
         _global_summary = make_shared<db::BaseSummaryMemory<Station>>(pathname);
     else
     {
@@ -117,6 +118,8 @@ void BaseExplorer<Station>::update_active_summary()
 {
     if (filter.empty())
         _active_summary = _global_summary;
+    else if (auto global = dynamic_pointer_cast<const db::BaseSummaryMemory<Station>>(_global_summary))
+        _active_summary = make_shared<db::BaseSummaryMemoryView<Station>>(global, filter);
     else
     {
         auto new_active_summary = make_shared<db::BaseSummaryMemory<Station>>();
@@ -187,6 +190,12 @@ void BaseExplorer<Station>::Update::add_cursor(dballe::CursorSummary& cur)
         explorer->_global_summary->add_cursor(cur);
 }
 
+template<typename Station>
+void BaseExplorer<Station>::Update::add_changes(const dballe::db::summary::Changes& changes)
+{
+    explorer->_global_summary->apply_changes(changes);
+}
+
 template<typename Station>
 void BaseExplorer<Station>::Update::add_json(core::json::Stream& in)
 {
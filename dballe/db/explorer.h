@@ -53,6 +53,15 @@ public:
         /// Merge summary data from a database
         void add_cursor(dballe::CursorSummary& cur);
 
+        /**
+         * Apply the changes committed by a database transaction.
+         *
+         * The cost is proportional to the number of time series changed, and
+         * the result is the same as rebuilding the explorer from the whole
+         * database.
+         */
+        void add_changes(const dballe::db::summary::Changes& changes);
+
         /// Load the explorer contents from JSON
         void add_json(core::json::Stream& in);
 
@@ -72,6 +81,15 @@ public:
     };
 
     BaseExplorer();
+
+    /**
+     * Create an explorer persisted to the given file.
+     *
+     * Files ending in `.json` are stored as JSON, files ending in `.summary`
+     * or already containing a binary summary use the binary summary format,
+     * and other files use Xapian if available, or the binary summary format
+     * otherwise.
+     */
     BaseExplorer(const std::string& pathname);
     BaseExplorer(const BaseExplorer&) = delete;
     BaseExplorer(BaseExplorer&&) = delete;
@@ -9,6 +9,8 @@
 #include "dballe/db/summary_xapian.h"
 #endif
 #include <wreport/utils/sys.h>
+#include <cstdlib>
+#include <type_traits>
 
 using namespace dballe;
 using namespace dballe::db;
@@ -239,6 +241,34 @@ this->add_method("merge_entries", [](Fixture& f) {
     wassert(actual(summary.data_count()) == 36u + 24u);
 });
 
+this->add_method("remove_entries", [](Fixture& f) {
+    typename BACKEND::station_type station;
+    station.report = "test";
+    station.coords = Coords(44.5, 11.5);
+    summary::VarDesc vd1(Level(1), Trange::instant(), WR_VAR(0, 1, 112));
+    summary::VarDesc vd2(Level(1), Trange::instant(), WR_VAR(0, 12, 101));
+    DatetimeRange dtrange(Datetime(2018, 1, 1), Datetime(2018, 7, 1));
+
+    BACKEND summary;
+    summary.add(station, vd1, dtrange, 12u);
+    summary.add(station, vd2, dtrange, 3u);
+    wassert(actual(summary.data_count()) == 15u);
+
+    summary.remove(station, vd1);
+    wassert(actual(summary.data_count()) == 3u);
+    wassert(actual(get_stations(summary).size()) == 1);
+    wassert(actual(get_varcodes(summary).size()) == 1u);
+
+    // Removing a missing entry does nothing
+    summary.remove(station, vd1);
+    wassert(actual(summary.data_count()) == 3u);
+
+    // Removing the last entry of a station removes the station
+    summary.remove(station, vd2);
+    wassert(actual(summary.data_count()) == 0u);
+    wassert(actual(get_stations(summary).size()) == 0);
+});
+
 this->add_method("merge_summaries", [](Fixture& f) {
     BACKEND summary;
 
@@ -388,6 +418,93 @@ this->add_method("datetime_intersect", [](Fixture& f) {
     }
 });
 
+this->add_method("parallel_merge", [](Fixture& f) {
+    // Only in-memory summaries split merges across threads
+    if (!std::is_same<BACKEND, SummaryMemory>::value && !std::is_same<BACKEND, DBSummaryMemory>::value)
+        throw TestSkipped();
+
+    BACKEND a;
+    BACKEND b;
+    summary::VarDesc vd(Level(1), Trange::instant(), WR_VAR(0, 12, 101));
+    for (int i = 0; i < 3000; ++i)
+    {
+        typename BACKEND::station_type station;
+        station.report = i % 2 ? "synop" : "temp";
+        station.coords = Coords(i * 10, i * 20);
+        if (i < 2000)
+            a.add(station, vd, DatetimeRange(Datetime(2020, 1, 1), Datetime(2020, 1, 31)), 1);
+        if (i >= 1000)
+            b.add(station, vd, DatetimeRange(Datetime(2020, 2, 1), Datetime(2020, 2, 28)), 2);
+    }
+
+    auto merge = [&](const char* threads) {
+        setenv("DBA_THREADS", threads, 1);
+        std::unique_ptr<BACKEND> res(new BACKEND);
+        res->add_summary(a);
+        res->add_summary(b);
+        core::Query query;
+        query.report = "synop";
+        query.dtrange.min = Datetime(2020, 2, 1);
+        std::unique_ptr<BACKEND> filtered(new BACKEND);
+        filtered->add_filtered(*res, query);
+        unsetenv("DBA_THREADS");
+        return std::make_pair(std::move(res), std::move(filtered));
+    };
+
+    auto sequential = merge("1");
+    auto parallel = merge("4");
+
+    wassert(actual(get_stations(*parallel.first).size()) == 3000u);
+    wassert(actual(parallel.first->data_count()) == 6000u);
+    wassert(actual(parallel.second->data_count()) == 2000u);
+
+    std::stringstream json_sequential;
+    core::JSONWriter writer_sequential(json_sequential);
+    sequential.first->to_json(writer_sequential);
+    std::stringstream json_parallel;
+    core::JSONWriter writer_parallel(json_parallel);
+    parallel.first->to_json(writer_parallel);
+    wassert(actual(json_parallel.str()) == json_sequential.str());
+});
+
+this->add_method("memory_view", [](Fixture& f) {
+    // Only in-memory summaries have filtered views
+    if (!std::is_same<BACKEND, SummaryMemory>::value && !std::is_same<BACKEND, DBSummaryMemory>::value)
+        throw TestSkipped();
+    typedef BaseSummaryMemory<typename BACKEND::station_type> Memory;
+
+    auto summary = std::make_shared<Memory>();
+    DatetimeRange dtrange(Datetime(2020, 1, 1), Datetime(2020, 1, 31));
+    for (int i = 0; i < 20; ++i)
+    {
+        typename BACKEND::station_type station;
+        station.report = "synop";
+        station.coords = Coords(i * 100000, i * 100000);
+        for (int code = 0; code < 5; ++code)
+            summary->add(station, summary::VarDesc(Level(1), Trange::instant(), WR_VAR(0, 12, 101 + code)), dtrange, 1);
+    }
+
+    // Select with several varcodes and several grid cells
+    core::Query query;
+    query.varcodes.insert(WR_VAR(0, 12, 101));
+    query.varcodes.insert(WR_VAR(0, 12, 103));
+    query.varcodes.insert(WR_VAR(0, 12, 199));
+    query.latrange.set(2.0, 6.5);
+    BaseSummaryMemoryView<typename BACKEND::station_type> view(summary, query);
+    wassert(actual(view.data_count()) == 10u);
+    wassert(actual(get_varcodes(view).size()) == 2u);
+
+    // Any access to the view fails after the summary is modified, including
+    // the values it had already computed
+    typename BACKEND::station_type station;
+    station.report = "temp";
+    station.coords = Coords(4.0, 4.0);
+    summary->add(station, summary::VarDesc(Level(1), Trange::instant(), WR_VAR(0, 12, 101)), dtrange, 1);
+    wassert(actual_function([&] { view.data_count(); }).throws("modified"));
+    wassert(actual_function([&] { get_varcodes(view); }).throws("modified"));
+    wassert(actual_function([&] { get_reports(view); }).throws("modified"));
+});
+
 this->add_method("issue218", [](Fixture& f) {
     BACKEND summary;
 
@@ -8,6 +8,7 @@
 #include "dballe/msg/context.h"
 #include <algorithm>
 #include <unordered_set>
+#include <set>
 #include <cstring>
 
 using namespace std;
@@ -127,6 +128,31 @@ void BaseSummary<Station>::add_summary(const BaseSummary<dballe::DBStation>& sum
     });
 }
 
+template<typename Station>
+void BaseSummary<Station>::apply_changes(const summary::Changes& changes)
+{
+    if (changes.cleared)
+        clear();
+
+    // Replaced series already account for the values added to them
+    std::set<std::pair<DBStation, summary::VarDesc>> replaced;
+    for (const auto& change: changes.replaced)
+    {
+        Station station = summary::convert_station<Station, DBStation>(change.station);
+        remove(station, change.var);
+        if (change.count > 0)
+            add(station, change.var, change.dtrange, change.count);
+        replaced.emplace(change.station, change.var);
+    }
+
+    for (const auto& change: changes.added)
+    {
+        if (replaced.find(std::make_pair(change.station, change.var)) != replaced.end())
+            continue;
+        add(summary::convert_station<Station, DBStation>(change.station), change.var, change.dtrange, change.count);
+    }
+}
+
 namespace {
 
 // This class is used to disentangle code a bit to try and workaround an
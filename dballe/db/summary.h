@@ -35,6 +35,52 @@ struct VarDesc
     bool operator>=(const VarDesc& o) const { return std::tie(level, trange, varcode) >= std::tie(o.level, o.trange, o.varcode); }
 };
 
+/**
+ * Statistics of a time series changed by a database transaction
+ */
+struct SeriesChange
+{
+    dballe::DBStation station;
+    VarDesc var;
+    dballe::DatetimeRange dtrange;
+    size_t count = 0;
+
+    SeriesChange(const dballe::DBStation& station, const VarDesc& var, const dballe::DatetimeRange& dtrange, size_t count)
+        : station(station), var(var), dtrange(dtrange), count(count) {}
+};
+
+/**
+ * Time series changed by a database transaction, in a form that can be
+ * applied to a summary without rescanning the database
+ */
+struct Changes
+{
+    /**
+     * Values added to time series: dtrange and count only refer to the new
+     * values, and are merged with what the summary already contains
+     */
+    std::vector<SeriesChange> added;
+
+    /**
+     * Time series that had values removed: dtrange and count describe the
+     * whole series after the change, and replace what the summary contains.
+     * A count of 0 means that the series does not exist anymore.
+     */
+    std::vector<SeriesChange> replaced;
+
+    /// True if all the data was removed before the other changes
+    bool cleared = false;
+
+    bool empty() const { return !cleared && added.empty() && replaced.empty(); }
+
+    void clear()
+    {
+        added.clear();
+        replaced.clear();
+        cleared = false;
+    }
+};
+
 }
 
 /**
@@ -89,6 +135,17 @@ public:
     /// Add an entry to the summary
     virtual void add(const Station& station, const summary::VarDesc& vd, const dballe::DatetimeRange& dtrange, size_t count) = 0;
 
+    /// Remove the entry for a time series, if present
+    virtual void remove(const Station& station, const summary::VarDesc& vd) = 0;
+
+    /**
+     * Apply the changes done by a database transaction.
+     *
+     * This costs proportionally to the number of time series changed, instead
+     * of the size of the database.
+     */
+    virtual void apply_changes(const summary::Changes& changes);
+
     /// Add an entry to the summary taken from the current status of \a cur
     virtual void add_cursor(const dballe::CursorSummary& cur);
 
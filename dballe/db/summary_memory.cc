@@ -3,12 +3,19 @@
 #include "dballe/core/var.h"
 #include "dballe/core/query.h"
 #include "dballe/core/json.h"
+#include "dballe/core/mmap.h"
+#include "dballe/core/parallel.h"
 #include "dballe/msg/msg.h"
 #include "dballe/msg/context.h"
 #include <wreport/utils/sys.h>
+#include <wreport/utils/string.h>
 #include <algorithm>
+#include <iterator>
 #include <unordered_set>
 #include <cstring>
+#include <cstdio>
+#include <limits>
+#include <mutex>
 #include <sstream>
 
 using namespace std;
@@ -17,6 +24,357 @@ using namespace dballe;
 namespace dballe {
 namespace db {
 
+namespace summary {
+
+namespace {
+
+/// Size of the side of a grid cell, in 1/100000 of a degree
+static const int CELL_SIZE = 100000;
+
+/// Minimum number of stations or candidate entries to check in each thread
+const size_t parallel_filter_min_stations = 4096;
+const size_t parallel_filter_min_entries = 16384;
+
+inline int grid_cell(int coord)
+{
+    if (coord >= 0)
+        return coord / CELL_SIZE;
+    return -((-coord + CELL_SIZE - 1) / CELL_SIZE);
+}
+
+/// Check if a grid cell can contain stations in the query area
+bool cell_matches(const core::Query& q, const std::pair<int, int>& cell)
+{
+    int lat_min = cell.first * CELL_SIZE;
+    int lat_max = lat_min + CELL_SIZE - 1;
+    if (lat_max < q.latrange.imin || lat_min > q.latrange.imax)
+        return false;
+
+    if (q.lonrange.is_missing())
+        return true;
+    int lon_min = cell.second * CELL_SIZE;
+    int lon_max = lon_min + CELL_SIZE - 1;
+    if (q.lonrange.imin <= q.lonrange.imax)
+        return lon_max >= q.lonrange.imin && lon_min <= q.lonrange.imax;
+    // The range wraps around the antimeridian
+    return lon_max >= q.lonrange.imin || lon_min <= q.lonrange.imax;
+}
+
+/// Restrict \a res to the positions also in \a postings
+void intersect(Postings& res, bool& restricted, const Postings& postings)
+{
+    if (!restricted)
+    {
+        res = postings;
+        restricted = true;
+        return;
+    }
+    Postings out;
+    std::set_intersection(res.begin(), res.end(), postings.begin(), postings.end(), back_inserter(out));
+    res = std::move(out);
+}
+
+/// Merge posting lists into a single sorted list without duplicates
+Postings merge(const std::vector<const Postings*>& lists)
+{
+    if (lists.size() == 1)
+        return *lists[0];
+    size_t size = 0;
+    for (const auto& l: lists)
+        size += l->size();
+    Postings res;
+    res.reserve(size);
+    for (const auto& l: lists)
+        res.insert(res.end(), l->begin(), l->end());
+    std::sort(res.begin(), res.end());
+    res.erase(std::unique(res.begin(), res.end()), res.end());
+    return res;
+}
+
+/// Intersect \a res with the postings of \a key, returning false if there are none
+template<typename Key>
+bool intersect_key(Postings& res, bool& restricted, const std::map<Key, Postings>& postings, const Key& key)
+{
+    auto i = postings.find(key);
+    if (i == postings.end())
+        return false;
+    intersect(res, restricted, i->second);
+    return true;
+}
+
+}
+
+template<typename Station>
+Index<Station>::Index(const StationEntries<Station>& entries)
+{
+    uint32_t pos = 0;
+    for (const auto& station_entry: entries.sorted())
+    {
+        stations.push_back(&station_entry.sorted());
+        station_start.push_back(pos);
+        Postings& report = by_report[station_entry.station.report];
+        Postings& cell = by_cell[std::make_pair(grid_cell(station_entry.station.coords.lat), grid_cell(station_entry.station.coords.lon))];
+        for (const auto& var_entry: station_entry)
+        {
+            report.push_back(pos);
+            cell.push_back(pos);
+            by_level[var_entry.var.level].push_back(pos);
+            by_trange[var_entry.var.trange].push_back(pos);
+            by_varcode[var_entry.var.varcode].push_back(pos);
+            ++pos;
+        }
+    }
+    station_start.push_back(pos);
+}
+
+template<typename Station>
+Postings Index<Station>::select(const dballe::Query& query) const
+{
+    const core::Query& q = core::Query::downcast(query);
+    Postings res;
+    bool restricted = false;
+
+    if (!q.report.empty() && !intersect_key(res, restricted, by_report, q.report))
+        return Postings();
+    if (!q.level.is_missing() && !intersect_key(res, restricted, by_level, q.level))
+        return Postings();
+    if (!q.trange.is_missing() && !intersect_key(res, restricted, by_trange, q.trange))
+        return Postings();
+
+    if (!q.varcodes.empty())
+    {
+        std::vector<const Postings*> lists;
+        for (const auto& code: q.varcodes)
+        {
+            auto i = by_varcode.find(code);
+            if (i != by_varcode.end())
+                lists.push_back(&i->second);
+        }
+        if (lists.empty())
+            return Postings();
+        intersect(res, restricted, merge(lists));
+    }
+
+    if (!q.latrange.is_missing() || !q.lonrange.is_missing())
+    {
+        std::vector<const Postings*> lists;
+        for (const auto& i: by_cell)
+            if (cell_matches(q, i.first))
+                lists.push_back(&i.second);
+        if (lists.empty())
+            return Postings();
+        intersect(res, restricted, merge(lists));
+    }
+
+    // Check the remaining constraints on the candidate entries, splitting
+    // large summaries in chunks checked on multiple threads
+    DatetimeRange wanted_dtrange = q.get_datetimerange();
+    bool has_flt_dtrange = !wanted_dtrange.is_missing();
+    std::mutex mutex;
+    std::vector<std::pair<size_t, Postings>> chunks;
+
+    if (!restricted)
+    {
+        core::parallel_for(stations.size(), parallel_filter_min_stations, [&](size_t begin, size_t end) {
+            StationFilter<Station> filter(query);
+            Postings out;
+            for (size_t s = begin; s < end; ++s)
+            {
+                if (filter.has_flt_station && !filter.matches_station(stations[s]->station))
+                    continue;
+                for (uint32_t pos = station_start[s]; pos < station_start[s + 1]; ++pos)
+                    if (!has_flt_dtrange || !wanted_dtrange.is_disjoint(var(s, pos).dtrange))
+                        out.push_back(pos);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            chunks.emplace_back(begin, std::move(out));
+        });
+    } else {
+        if (!StationFilter<Station>(query).has_flt_station && !has_flt_dtrange)
+            return res;
+
+        core::parallel_for(res.size(), parallel_filter_min_entries, [&](size_t begin, size_t end) {
+            StationFilter<Station> filter(query);
+            Postings out;
+            size_t s = std::upper_bound(station_start.begin(), station_start.end(), res[begin]) - station_start.begin() - 1;
+            size_t checked = stations.size();
+            bool station_matches = true;
+            for (size_t i = begin; i < end; ++i)
+            {
+                uint32_t pos = res[i];
+                while (station_start[s + 1] <= pos)
+                    ++s;
+                if (filter.has_flt_station && s != checked)
+                {
+                    station_matches = filter.matches_station(stations[s]->station);
+                    checked = s;
+                }
+                if (!station_matches)
+                    continue;
+                if (has_flt_dtrange && wanted_dtrange.is_disjoint(var(s, pos).dtrange))
+                    continue;
+                out.push_back(pos);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            chunks.emplace_back(begin, std::move(out));
+        });
+    }
+
+    // Chunks are contiguous: concatenating them in order keeps the result
+    // sorted
+    std::sort(chunks.begin(), chunks.end(), [](const std::pair<size_t, Postings>& a, const std::pair<size_t, Postings>& b) {
+        return a.first < b.first;
+    });
+    Postings out;
+    for (const auto& chunk: chunks)
+        out.insert(out.end(), chunk.second.begin(), chunk.second.end());
+    return out;
+}
+
+template<typename Station>
+bool Index<Station>::iter(const Postings& positions, std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange&, size_t)> dest) const
+{
+    size_t s = 0;
+    for (auto pos: positions)
+    {
+        while (station_start[s + 1] <= pos)
+            ++s;
+        const VarEntry& entry = var(s, pos);
+        if (!dest(stations[s]->station, entry.var, entry.dtrange, entry.count))
+            return false;
+    }
+    return true;
+}
+
+template struct Index<dballe::Station>;
+template struct Index<dballe::DBStation>;
+
+}
+
+namespace {
+
+/// Signature at the start of binary summary files, including the format version
+const char binary_magic[8] = { 'D', 'B', 'A', 'S', 'U', 'M', 0, 1 };
+
+/// Marker used to reject files written with a different byte order
+const uint32_t binary_byte_order = 0x01020304;
+
+/// Value used for missing idents and datetimes
+const uint32_t binary_missing_ident = std::numeric_limits<uint32_t>::max();
+const int64_t binary_missing_datetime = std::numeric_limits<int64_t>::min();
+
+/**
+ * Header of a binary summary file.
+ *
+ * It is followed by the tables of stations, levels, time ranges, varcodes and
+ * entries, each padded to a multiple of 8 bytes, and by the string table with
+ * the NUL-terminated reports and idents of the stations.
+ *
+ * All records have a fixed size and are stored in native byte order, so that
+ * a mapped file can be used without decoding.
+ */
+struct BinaryHeader
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t station_count;
+    uint32_t level_count;
+    uint32_t trange_count;
+    uint32_t varcode_count;
+    uint32_t entry_count;
+    uint32_t strings_size;
+    uint32_t padding;
+};
+
+struct BinaryStation
+{
+    int32_t id;
+    int32_t lat;
+    int32_t lon;
+    /// Offset of the report in the string table
+    uint32_t report;
+    /// Offset of the ident in the string table, or binary_missing_ident
+    uint32_t ident;
+    uint32_t padding;
+};
+
+struct BinaryLevel
+{
+    int32_t ltype1;
+    int32_t l1;
+    int32_t ltype2;
+    int32_t l2;
+};
+
+struct BinaryTrange
+{
+    int32_t pind;
+    int32_t p1;
+    int32_t p2;
+    int32_t padding;
+};
+
+struct BinaryEntry
+{
+    uint32_t station;
+    uint32_t level;
+    uint32_t trange;
+    uint32_t varcode;
+    int64_t dtmin;
+    int64_t dtmax;
+    uint64_t count;
+};
+
+static_assert(sizeof(BinaryHeader) % 8 == 0, "binary summary header is not 8-byte aligned");
+static_assert(sizeof(BinaryStation) % 8 == 0, "binary summary station record is not 8-byte aligned");
+static_assert(sizeof(BinaryEntry) % 8 == 0, "binary summary entry record is not 8-byte aligned");
+
+/// Size of a table of count records of the given size, padded to 8 bytes
+inline size_t binary_table_size(size_t count, size_t size)
+{
+    return (count * size + 7) & ~(size_t)7;
+}
+
+int64_t encode_datetime(const Datetime& dt)
+{
+    if (dt.is_missing())
+        return binary_missing_datetime;
+    return (int64_t)dt.to_julian() * 100000 + dt.hour * 3600 + dt.minute * 60 + dt.second;
+}
+
+Datetime decode_datetime(int64_t val)
+{
+    if (val == binary_missing_datetime)
+        return Datetime();
+    int sod = val % 100000;
+    return Datetime::from_julian(val / 100000, sod / 3600, (sod / 60) % 60, sod % 60);
+}
+
+inline int station_id(const dballe::Station&) { return MISSING_INT; }
+inline int station_id(const dballe::DBStation& station) { return station.id; }
+inline void set_station_id(dballe::Station&, int) {}
+inline void set_station_id(dballe::DBStation& station, int id) { station.id = id; }
+
+/// Append the binary representation of a table to buf, padded to 8 bytes
+template<typename T>
+void append_table(std::string& buf, const std::vector<T>& table)
+{
+    buf.append((const char*)table.data(), table.size() * sizeof(T));
+    buf.append(binary_table_size(table.size(), sizeof(T)) - table.size() * sizeof(T), 0);
+}
+
+/// Return the id of val in an interning table, adding it if missing
+template<typename T>
+uint32_t intern(std::map<T, uint32_t>& ids, std::vector<T>& values, const T& val)
+{
+    auto res = ids.emplace(val, values.size());
+    if (res.second)
+        values.push_back(val);
+    return res.first->second;
+}
+
+}
+
 template<typename Station>
 BaseSummaryMemory<Station>::BaseSummaryMemory()
 {
@@ -27,12 +385,31 @@ BaseSummaryMemory<Station>::BaseSummaryMemory(const std::string& pathname)
     : pathname(pathname)
 {
     using namespace wreport;
-    if (sys::exists(pathname))
+    if (is_binary(pathname))
     {
-        std::stringstream in(sys::read_file(pathname));
-        core::json::Stream json(in);
+        binary = true;
+        load_binary(pathname);
+    }
+    else if (sys::exists(pathname))
+    {
+        std::string buf = sys::read_file(pathname);
+        core::json::Stream json(buf);
         load_json(json);
     }
+    else
+        binary = !str::endswith(pathname, ".json");
+}
+
+template<typename Station>
+bool BaseSummaryMemory<Station>::is_binary(const std::string& pathname)
+{
+    FILE* in = fopen(pathname.c_str(), "rb");
+    if (!in)
+        return false;
+    char magic[sizeof(binary_magic)];
+    bool res = fread(magic, sizeof(magic), 1, in) == 1 && memcmp(magic, binary_magic, sizeof(magic)) == 0;
+    fclose(in);
+    return res;
 }
 
 template<typename Station>
@@ -86,12 +463,6 @@ bool BaseSummaryMemory<Station>::varcodes(std::function<bool(const wreport::Varc
     return true;
 }
 
-template<typename Station>
-std::shared_ptr<dballe::CursorSummary> BaseSummaryMemory<Station>::query_summary(const Query& query) const
-{
-    return std::make_shared<summary::Cursor<Station>>(entries, query);
-}
-
 template<typename Station>
 bool BaseSummaryMemory<Station>::iter(std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange& dtrange, size_t count)> dest) const
 {
@@ -105,7 +476,23 @@ bool BaseSummaryMemory<Station>::iter(std::function<bool(const Station&, const s
 template<typename Station>
 bool BaseSummaryMemory<Station>::iter_filtered(const dballe::Query& query, std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange& dtrange, size_t count)> dest) const
 {
-    return entries.iter_filtered(query, dest);
+    auto idx = _index();
+    return idx->iter(idx->select(query), dest);
+}
+
+template<typename Station>
+std::shared_ptr<const summary::Index<Station>> BaseSummaryMemory<Station>::_index() const
+{
+    if (!index)
+        index = std::make_shared<summary::Index<Station>>(entries);
+    return index;
+}
+
+template<typename Station>
+void BaseSummaryMemory<Station>::invalidate_index()
+{
+    index.reset();
+    ++generation;
 }
 
 template<typename Station>
@@ -150,6 +537,7 @@ void BaseSummaryMemory<Station>::clear()
     dtrange = dballe::DatetimeRange();
     count = 0;
     dirty = false;
+    invalidate_index();
 }
 
 template<typename Station>
@@ -157,6 +545,22 @@ void BaseSummaryMemory<Station>::add(const Station& station, const summary::VarD
 {
     entries.add(station, vd, dtrange, count);
     dirty = true;
+    invalidate_index();
+}
+
+template<typename Station>
+void BaseSummaryMemory<Station>::remove(const Station& station, const summary::VarDesc& vd)
+{
+    if (!entries.remove(station, vd))
+        return;
+    // Removing entries can shrink the sets of reports, levels, tranges and
+    // varcodes, so they need recomputing from scratch
+    m_reports.clear();
+    m_levels.clear();
+    m_tranges.clear();
+    m_varcodes.clear();
+    dirty = true;
+    invalidate_index();
 }
 
 template<typename Station>
@@ -164,8 +568,13 @@ void BaseSummaryMemory<Station>::add_filtered(const BaseSummary<Station>& summar
 {
     if (const BaseSummaryMemory<Station>* s = dynamic_cast<const BaseSummaryMemory<Station>*>(&summary))
     {
-        entries.add_filtered(s->entries, query);
+        auto s_index = s->_index();
+        s_index->iter(s_index->select(query), [&](const Station& station, const summary::VarDesc& vd, const DatetimeRange& dtrange, size_t count) {
+            entries.add(station, vd, dtrange, count);
+            return true;
+        });
         dirty = true;
+        invalidate_index();
     } else {
         BaseSummary<Station>::add_filtered(summary, query);
     }
@@ -178,6 +587,7 @@ void BaseSummaryMemory<Station>::add_summary(const BaseSummary<dballe::Station>&
     {
         entries.add(s->_entries());
         dirty = true;
+        invalidate_index();
     } else {
         BaseSummary<Station>::add_summary(summary);
     }
@@ -190,6 +600,7 @@ void BaseSummaryMemory<Station>::add_summary(const BaseSummary<dballe::DBStation
     {
         entries.add(s->_entries());
         dirty = true;
+        invalidate_index();
     } else {
         BaseSummary<Station>::add_summary(summary);
     }
@@ -202,10 +613,159 @@ void BaseSummaryMemory<Station>::commit()
     if (pathname.empty())
         return;
 
-    std::stringstream out;
+    if (binary)
+    {
+        write_binary(pathname);
+        return;
+    }
+
+    std::string out;
     core::JSONWriter writer(out);
     to_json(writer);
-    sys::write_file(pathname, out.str());
+    sys::write_file(pathname, out);
+}
+
+template<typename Station>
+void BaseSummaryMemory<Station>::write_binary(const std::string& pathname) const
+{
+    using namespace wreport;
+    std::string strings;
+    std::map<std::string, uint32_t> string_ids;
+    auto intern_string = [&](const std::string& val) {
+        auto res = string_ids.emplace(val, strings.size());
+        if (res.second)
+        {
+            strings += val;
+            strings += '\0';
+        }
+        return res.first->second;
+    };
+
+    std::vector<BinaryStation> stations;
+    std::map<Level, uint32_t> level_ids;
+    std::vector<Level> levels;
+    std::map<Trange, uint32_t> trange_ids;
+    std::vector<Trange> tranges;
+    std::map<wreport::Varcode, uint32_t> varcode_ids;
+    std::vector<wreport::Varcode> varcodes;
+    std::vector<BinaryEntry> binary_entries;
+
+    for (const auto& station_entry: entries.sorted())
+    {
+        BinaryStation bs;
+        bs.id = station_id(station_entry.station);
+        bs.lat = station_entry.station.coords.lat;
+        bs.lon = station_entry.station.coords.lon;
+        bs.report = intern_string(station_entry.station.report);
+        bs.ident = station_entry.station.ident.is_missing() ? binary_missing_ident : intern_string(station_entry.station.ident.get());
+        bs.padding = 0;
+
+        for (const auto& var_entry: station_entry.sorted())
+        {
+            BinaryEntry be;
+            be.station = stations.size();
+            be.level = intern(level_ids, levels, var_entry.var.level);
+            be.trange = intern(trange_ids, tranges, var_entry.var.trange);
+            be.varcode = intern(varcode_ids, varcodes, var_entry.var.varcode);
+            be.dtmin = encode_datetime(var_entry.dtrange.min);
+            be.dtmax = encode_datetime(var_entry.dtrange.max);
+            be.count = var_entry.count;
+            binary_entries.push_back(be);
+        }
+
+        stations.push_back(bs);
+    }
+
+    std::vector<BinaryLevel> binary_levels;
+    for (const auto& level: levels)
+        binary_levels.push_back(BinaryLevel{level.ltype1, level.l1, level.ltype2, level.l2});
+    std::vector<BinaryTrange> binary_tranges;
+    for (const auto& trange: tranges)
+        binary_tranges.push_back(BinaryTrange{trange.pind, trange.p1, trange.p2, 0});
+    std::vector<uint32_t> binary_varcodes(varcodes.begin(), varcodes.end());
+
+    BinaryHeader header;
+    memcpy(header.magic, binary_magic, sizeof(binary_magic));
+    header.byte_order = binary_byte_order;
+    header.station_count = stations.size();
+    header.level_count = binary_levels.size();
+    header.trange_count = binary_tranges.size();
+    header.varcode_count = binary_varcodes.size();
+    header.entry_count = binary_entries.size();
+    header.strings_size = strings.size();
+    header.padding = 0;
+
+    std::string buf;
+    buf.append((const char*)&header, sizeof(header));
+    append_table(buf, stations);
+    append_table(buf, binary_levels);
+    append_table(buf, binary_tranges);
+    append_table(buf, binary_varcodes);
+    append_table(buf, binary_entries);
+    buf += strings;
+    sys::write_file(pathname, buf);
+}
+
+template<typename Station>
+void BaseSummaryMemory<Station>::load_binary(const std::string& pathname)
+{
+    using namespace wreport;
+    core::MappedFile file(pathname, "summary");
+    if (file.size() < sizeof(BinaryHeader) || memcmp(file.begin(), binary_magic, sizeof(binary_magic)) != 0)
+        error_consistency::throwf("%s is not a binary DB-All.e summary, or was created with an unsupported version", pathname.c_str());
+    const BinaryHeader& header = *reinterpret_cast<const BinaryHeader*>(file.begin());
+    if (header.byte_order != binary_byte_order)
+        error_consistency::throwf("%s was written on a machine with a different byte order", pathname.c_str());
+
+    const uint8_t* cur = file.begin() + sizeof(BinaryHeader);
+    // Return the start of the next table, checking that it fits in the file
+    auto table = [&](uint32_t count, size_t size) {
+        if (count > (size_t)(file.end() - cur) / size)
+            error_consistency::throwf("%s: binary summary file is truncated or corrupted", pathname.c_str());
+        const uint8_t* res = cur;
+        cur += std::min(binary_table_size(count, size), (size_t)(file.end() - cur));
+        return res;
+    };
+    const BinaryStation* stations = reinterpret_cast<const BinaryStation*>(table(header.station_count, sizeof(BinaryStation)));
+    const BinaryLevel* levels = reinterpret_cast<const BinaryLevel*>(table(header.level_count, sizeof(BinaryLevel)));
+    const BinaryTrange* tranges = reinterpret_cast<const BinaryTrange*>(table(header.trange_count, sizeof(BinaryTrange)));
+    const uint32_t* varcodes = reinterpret_cast<const uint32_t*>(table(header.varcode_count, sizeof(uint32_t)));
+    const BinaryEntry* binary_entries = reinterpret_cast<const BinaryEntry*>(table(header.entry_count, sizeof(BinaryEntry)));
+    const char* strings = reinterpret_cast<const char*>(cur);
+    if ((size_t)(file.end() - cur) != header.strings_size || (header.strings_size && strings[header.strings_size - 1]))
+        error_consistency::throwf("%s: binary summary file is truncated or corrupted", pathname.c_str());
+
+    std::vector<Station> decoded_stations;
+    decoded_stations.reserve(header.station_count);
+    for (uint32_t i = 0; i < header.station_count; ++i)
+    {
+        const BinaryStation& bs = stations[i];
+        if (bs.report >= header.strings_size || (bs.ident != binary_missing_ident && bs.ident >= header.strings_size))
+            error_consistency::throwf("%s: binary summary file is truncated or corrupted", pathname.c_str());
+        Station station;
+        set_station_id(station, bs.id);
+        station.report = strings + bs.report;
+        station.coords.lat = bs.lat;
+        station.coords.lon = bs.lon;
+        if (bs.ident != binary_missing_ident)
+            station.ident = strings + bs.ident;
+        decoded_stations.emplace_back(std::move(station));
+    }
+
+    for (uint32_t i = 0; i < header.entry_count; ++i)
+    {
+        const BinaryEntry& be = binary_entries[i];
+        if (be.station >= header.station_count || be.level >= header.level_count
+                || be.trange >= header.trange_count || be.varcode >= header.varcode_count)
+            error_consistency::throwf("%s: binary summary file is truncated or corrupted", pathname.c_str());
+        const BinaryLevel& bl = levels[be.level];
+        const BinaryTrange& bt = tranges[be.trange];
+        entries.add(decoded_stations[be.station],
+                summary::VarDesc(Level(bl.ltype1, bl.l1, bl.ltype2, bl.l2), Trange(bt.pind, bt.p1, bt.p2), varcodes[be.varcode]),
+                DatetimeRange(decode_datetime(be.dtmin), decode_datetime(be.dtmax)), be.count);
+    }
+    dirty = true;
+    invalidate_index();
 }
 
 template<typename Station>
@@ -214,7 +774,7 @@ void BaseSummaryMemory<Station>::to_json(core::JSONWriter& writer) const
     writer.start_mapping();
     writer.add("e");
     writer.start_list();
-    for (const auto& e: entries)
+    for (const auto& e: entries.sorted())
         e.to_json(writer);
     writer.end_list();
     writer.end_mapping();
@@ -232,6 +792,7 @@ void BaseSummaryMemory<Station>::load_json(core::json::Stream& in)
             throw core::JSONParseException("unsupported key \"" + key + "\" for summary::Entry");
     });
     dirty = true;
+    invalidate_index();
 }
 
 template<typename Station>
@@ -270,8 +831,198 @@ void BaseSummaryMemory<Station>::dump(FILE* out) const
     fprintf(out, "Dirty: %s\n", dirty ? "true" : "false");
 }
 
+
+
+template<typename Station>
+BaseSummaryMemoryView<Station>::BaseSummaryMemoryView(std::shared_ptr<const BaseSummaryMemory<Station>> source, const dballe::Query& query)
+    : source(source), generation(source->_generation()), index(source->_index()), positions(index->select(query))
+{
+}
+
+template<typename Station>
+void BaseSummaryMemoryView<Station>::check_index() const
+{
+    if (source->_generation() != generation)
+        throw wreport::error_consistency("the summary has been modified after creating a filtered view of it");
+}
+
+template<typename Station>
+void BaseSummaryMemoryView<Station>::recompute_summaries() const
+{
+    check_index();
+    m_reports.clear();
+    m_levels.clear();
+    m_tranges.clear();
+    m_varcodes.clear();
+    dtrange = DatetimeRange();
+    count = 0;
+    bool first = true;
+    index->iter(positions, [&](const Station& station, const summary::VarDesc& vd, const DatetimeRange& var_dtrange, size_t var_count) {
+        m_reports.add(station.report);
+        m_levels.add(vd.level);
+        m_tranges.add(vd.trange);
+        m_varcodes.add(vd.varcode);
+        if (first)
+        {
+            first = false;
+            dtrange = var_dtrange;
+        } else
+            dtrange.merge(var_dtrange);
+        count += var_count;
+        return true;
+    });
+    dirty = false;
+}
+
+template<typename Station>
+bool BaseSummaryMemoryView<Station>::stations(std::function<bool(const Station&)> dest) const
+{
+    check_index();
+    const Station* last = nullptr;
+    return index->iter(positions, [&](const Station& station, const summary::VarDesc&, const DatetimeRange&, size_t) {
+        if (&station == last)
+            return true;
+        last = &station;
+        return dest(station);
+    });
+}
+
+template<typename Station>
+bool BaseSummaryMemoryView<Station>::reports(std::function<bool(const std::string&)> dest) const
+{
+    check_index();
+    if (dirty) recompute_summaries();
+    for (const auto& v: m_reports)
+        if (!dest(v))
+            return false;
+    return true;
+}
+
+template<typename Station>
+bool BaseSummaryMemoryView<Station>::levels(std::function<bool(const Level&)> dest) const
+{
+    check_index();
+    if (dirty) recompute_summaries();
+    for (const auto& v: m_levels)
+        if (!dest(v))
+            return false;
+    return true;
+}
+
+template<typename Station>
+bool BaseSummaryMemoryView<Station>::tranges(std::function<bool(const Trange&)> dest) const
+{
+    check_index();
+    if (dirty) recompute_summaries();
+    for (const auto& v: m_tranges)
+        if (!dest(v))
+            return false;
+    return true;
+}
+
+template<typename Station>
+bool BaseSummaryMemoryView<Station>::varcodes(std::function<bool(const wreport::Varcode&)> dest) const
+{
+    check_index();
+    if (dirty) recompute_summaries();
+    for (const auto& v: m_varcodes)
+        if (!dest(v))
+            return false;
+    return true;
+}
+
+template<typename Station>
+bool BaseSummaryMemoryView<Station>::iter(std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange& dtrange, size_t count)> dest) const
+{
+    check_index();
+    return index->iter(positions, dest);
+}
+
+template<typename Station>
+bool BaseSummaryMemoryView<Station>::iter_filtered(const dballe::Query& query, std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange& dtrange, size_t count)> dest) const
+{
+    check_index();
+    summary::Postings selected = index->select(query);
+    summary::Postings res;
+    std::set_intersection(positions.begin(), positions.end(), selected.begin(), selected.end(), back_inserter(res));
+    return index->iter(res, dest);
+}
+
+template<typename Station>
+void BaseSummaryMemoryView<Station>::clear()
+{
+    throw wreport::error_consistency("cannot clear a filtered view of a summary");
+}
+
+template<typename Station>
+void BaseSummaryMemoryView<Station>::add(const Station& station, const summary::VarDesc& vd, const dballe::DatetimeRange& dtrange, size_t count)
+{
+    throw wreport::error_consistency("cannot add entries to a filtered view of a summary");
+}
+
+template<typename Station>
+void BaseSummaryMemoryView<Station>::remove(const Station& station, const summary::VarDesc& vd)
+{
+    throw wreport::error_consistency("cannot remove entries from a filtered view of a summary");
+}
+
+template<typename Station>
+void BaseSummaryMemoryView<Station>::to_json(core::JSONWriter& writer) const
+{
+    check_index();
+    const Station* last = nullptr;
+    writer.start_mapping();
+    writer.add("e");
+    writer.start_list();
+    index->iter(positions, [&](const Station& station, const summary::VarDesc& vd, const DatetimeRange& dtrange, size_t count) {
+        if (&station != last)
+        {
+            if (last)
+            {
+                writer.end_list();
+                writer.end_mapping();
+            }
+            writer.start_mapping();
+            writer.add("s");
+            writer.add(station);
+            writer.add("v");
+            writer.start_list();
+            last = &station;
+        }
+        summary::VarEntry(vd, dtrange, count).to_json(writer);
+        return true;
+    });
+    if (last)
+    {
+        writer.end_list();
+        writer.end_mapping();
+    }
+    writer.end_list();
+    writer.end_mapping();
+}
+
+template<typename Station>
+void BaseSummaryMemoryView<Station>::dump(FILE* out) const
+{
+    check_index();
+    if (dirty) recompute_summaries();
+    fprintf(out, "Summary view:\n");
+    fprintf(out, "Entries:\n");
+    index->iter(positions, [&](const Station& station, const summary::VarDesc& vd, const DatetimeRange& dtrange, size_t count) {
+        fprintf(out, "   Station: "); station.print(out);
+        summary::VarEntry(vd, dtrange, count).dump(out);
+        return true;
+    });
+    fprintf(out, "Datetime range: ");
+    dtrange.min.print_iso8601(out, 'T', " to ");
+    dtrange.max.print_iso8601(out);
+    fprintf(out, "Count: %zd\n", count);
+}
+
 template class BaseSummaryMemory<dballe::Station>;
 template class BaseSummaryMemory<dballe::DBStation>;
+template class BaseSummaryMemoryView<dballe::Station>;
+template class BaseSummaryMemoryView<dballe::DBStation>;
 
 }
 }
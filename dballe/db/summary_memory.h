@@ -4,10 +4,67 @@
 #include <dballe/core/fwd.h>
 #include <dballe/db/summary.h>
 #include <dballe/db/summary_utils.h>
+#include <map>
+#include <memory>
+#include <cstdint>
 
 namespace dballe {
 namespace db {
 
+namespace summary {
+
+/// Sorted list of positions of entries in an Index
+typedef std::vector<uint32_t> Postings;
+
+/**
+ * Inverted index of the entries of a summary.
+ *
+ * Variable entries are numbered station by station, and for each report,
+ * level, time range, varcode and 1x1 degree grid cell, the index stores the
+ * sorted positions of the entries that have it. Filtering becomes an
+ * intersection of position lists, followed by an exact check of the remaining
+ * station and datetime constraints.
+ *
+ * The index points into the StationEntries it was built from, and is invalid
+ * as soon as they are modified.
+ */
+template<typename Station>
+struct Index
+{
+    /// Station entries, in position order
+    std::vector<const StationEntry<Station>*> stations;
+    /// Position of the first entry of each station, plus the total count at the end
+    std::vector<uint32_t> station_start;
+
+    std::map<std::string, Postings> by_report;
+    std::map<Level, Postings> by_level;
+    std::map<Trange, Postings> by_trange;
+    std::map<wreport::Varcode, Postings> by_varcode;
+    std::map<std::pair<int, int>, Postings> by_cell;
+
+    explicit Index(const StationEntries<Station>& entries);
+
+    /// Number of indexed entries
+    uint32_t size() const { return station_start.back(); }
+
+    /// Return the entry at position \a pos of the station with index \a station
+    const VarEntry& var(size_t station, uint32_t pos) const
+    {
+        return *(stations[station]->begin() + (pos - station_start[station]));
+    }
+
+    /// Return the positions of the entries matching a query
+    Postings select(const dballe::Query& query) const;
+
+    /// Send the entries at the given positions to \a dest
+    bool iter(const Postings& positions, std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange&, size_t)> dest) const;
+};
+
+extern template struct Index<dballe::Station>;
+extern template struct Index<dballe::DBStation>;
+
+}
+
 /**
  * High level objects for working with DB-All.e DB summaries
  */
@@ -20,6 +77,9 @@ protected:
 
     std::string pathname;
 
+    /// Save to pathname using the binary format instead of JSON
+    bool binary = false;
+
     mutable core::SortedSmallUniqueValueSet<std::string> m_reports;
     mutable core::SortedSmallUniqueValueSet<dballe::Level> m_levels;
     mutable core::SortedSmallUniqueValueSet<dballe::Trange> m_tranges;
@@ -29,14 +89,37 @@ protected:
 
     mutable bool dirty = false;
 
+    /// Inverted index of entries, built on demand
+    mutable std::shared_ptr<const summary::Index<Station>> index;
+
+    /// Incremented every time the entries are modified
+    uint64_t generation = 0;
+
     void recompute_summaries() const;
 
+    /// Drop the index after the entries have been modified
+    void invalidate_index();
+
 public:
     BaseSummaryMemory();
+
+    /**
+     * Create a summary persisted to the given file.
+     *
+     * If the file exists, it is loaded using the format it was written in.
+     * New files are written in binary format, unless their name ends in
+     * `.json`.
+     */
     BaseSummaryMemory(const std::string& pathname);
 
     const summary::StationEntries<Station>& _entries() const { if (dirty) recompute_summaries(); return entries.sorted(); }
 
+    /// Return the inverted index of the summary entries, building it if needed
+    std::shared_ptr<const summary::Index<Station>> _index() const;
+
+    /// Return a counter that changes every time the entries are modified
+    uint64_t _generation() const { return generation; }
+
     bool stations(std::function<bool(const Station&)>) const override;
     bool reports(std::function<bool(const std::string&)>) const override;
     bool levels(std::function<bool(const Level&)>) const override;
@@ -47,18 +130,6 @@ public:
     Datetime datetime_max() const override { if (dirty) recompute_summaries(); return dtrange.max; }
     unsigned data_count() const override { if (dirty) recompute_summaries(); return count; }
 
-    /**
-     * Query the contents of the summary
-     *
-     * @param query
-     *   The record with the query data (see technical specifications, par. 1.6.4
-     *   "parameter output/input")
-     * @return
-     *   The cursor to use to iterate over the results. The results are the
-     *   same as DB::query_summary.
-     */
-    std::shared_ptr<dballe::CursorSummary> query_summary(const Query& query) const override;
-
     bool iter(std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange&, size_t)>) const override;
     bool iter_filtered(const dballe::Query& query, std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange&, size_t)>) const override;
 
@@ -67,6 +138,8 @@ public:
     /// Add an entry to the summary
     void add(const Station& station, const summary::VarDesc& vd, const dballe::DatetimeRange& dtrange, size_t count) override;
 
+    void remove(const Station& station, const summary::VarDesc& vd) override;
+
     /// Merge the copy of another summary into this one
     void add_summary(const BaseSummary<dballe::Station>& summary) override;
 
@@ -84,6 +157,73 @@ public:
     /// Load contents from JSON, merging with the current contents
     void load_json(core::json::Stream& in) override;
 
+    /// Write the contents to a file in binary format
+    void write_binary(const std::string& pathname) const;
+
+    /// Load contents from a file in binary format, merging with the current contents
+    void load_binary(const std::string& pathname);
+
+    /// Check if a file exists and contains a summary in binary format
+    static bool is_binary(const std::string& pathname);
+
+    DBALLE_TEST_ONLY void dump(FILE* out) const override;
+};
+
+/**
+ * Read-only view of the entries of a BaseSummaryMemory that match a query.
+ *
+ * The view shares the entries of the summary it filters, and only stores the
+ * positions of the matching ones. The summary cannot be modified while the
+ * view is in use.
+ */
+template<typename Station>
+class BaseSummaryMemoryView : public BaseSummary<Station>
+{
+protected:
+    std::shared_ptr<const BaseSummaryMemory<Station>> source;
+    /// Generation of source when the view was created
+    uint64_t generation;
+    std::shared_ptr<const summary::Index<Station>> index;
+    summary::Postings positions;
+
+    mutable core::SortedSmallUniqueValueSet<std::string> m_reports;
+    mutable core::SortedSmallUniqueValueSet<dballe::Level> m_levels;
+    mutable core::SortedSmallUniqueValueSet<dballe::Trange> m_tranges;
+    mutable core::SortedSmallUniqueValueSet<wreport::Varcode> m_varcodes;
+    mutable dballe::DatetimeRange dtrange;
+    mutable size_t count = 0;
+
+    mutable bool dirty = true;
+
+    void recompute_summaries() const;
+
+    /// Throw if the summary has changed since the view was created
+    void check_index() const;
+
+public:
+    BaseSummaryMemoryView(std::shared_ptr<const BaseSummaryMemory<Station>> source, const dballe::Query& query);
+
+    bool stations(std::function<bool(const Station&)>) const override;
+    bool reports(std::function<bool(const std::string&)>) const override;
+    bool levels(std::function<bool(const Level&)>) const override;
+    bool tranges(std::function<bool(const Trange&)>) const override;
+    bool varcodes(std::function<bool(const wreport::Varcode&)>) const override;
+
+    Datetime datetime_min() const override { check_index(); if (dirty) recompute_summaries(); return dtrange.min; }
+    Datetime datetime_max() const override { check_index(); if (dirty) recompute_summaries(); return dtrange.max; }
+    unsigned data_count() const override { check_index(); if (dirty) recompute_summaries(); return count; }
+
+    bool iter(std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange&, size_t)>) const override;
+    bool iter_filtered(const dballe::Query& query, std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange&, size_t)>) const override;
+
+    void clear() override;
+    void add(const Station& station, const summary::VarDesc& vd, const dballe::DatetimeRange& dtrange, size_t count) override;
+    void remove(const Station& station, const summary::VarDesc& vd) override;
+    void commit() override {}
+
+    /// Serialize to JSON
+    void to_json(core::JSONWriter& writer) const override;
+
     DBALLE_TEST_ONLY void dump(FILE* out) const override;
 };
 
@@ -99,6 +239,8 @@ typedef BaseSummaryMemory<dballe::DBStation> DBSummaryMemory;
 
 extern template class BaseSummaryMemory<dballe::Station>;
 extern template class BaseSummaryMemory<dballe::DBStation>;
+extern template class BaseSummaryMemoryView<dballe::Station>;
+extern template class BaseSummaryMemoryView<dballe::DBStation>;
 
 }
 }
@@ -1,11 +1,31 @@
 #define _DBALLE_LIBRARY_CODE
 #include "summary_utils.h"
 #include "dballe/core/json.h"
+#include "dballe/core/parallel.h"
+#include <algorithm>
+#include <functional>
 
 namespace dballe {
 namespace db {
 namespace summary {
 
+namespace {
+
+/// Minimum number of stations to merge for splitting the work across threads
+const size_t parallel_merge_min_stations = 1024;
+
+size_t station_hash(const dballe::Station& station)
+{
+    size_t res = std::hash<std::string>()(station.report);
+    res = res * 31 + std::hash<int>()(station.coords.lat);
+    res = res * 31 + std::hash<int>()(station.coords.lon);
+    if (!station.ident.is_missing())
+        res = res * 31 + std::hash<std::string>()(station.ident.get());
+    return res;
+}
+
+}
+
 void VarEntry::to_json(core::JSONWriter& writer) const
 {
     writer.start_mapping();
@@ -68,6 +88,16 @@ void StationEntry<Station>::add(const StationEntry<OStation>& entries)
         add(entry.var, entry.dtrange, entry.count);
 }
 
+template<typename Station>
+bool StationEntry<Station>::remove(const VarDesc& vd)
+{
+    iterator i = find(vd);
+    if (i == end())
+        return false;
+    SmallSet::erase(i);
+    return true;
+}
+
 template<typename Station>
 void StationEntry<Station>::add_filtered(const StationEntry& entries, const dballe::Query& query)
 {
@@ -128,7 +158,7 @@ void StationEntry<Station>::to_json(core::JSONWriter& writer) const
     writer.add(station);
     writer.add("v");
     writer.start_list();
-    for (const auto& entry: *this)
+    for (const auto& entry: sorted())
         entry.to_json(writer);
     writer.end_list();
     writer.end_mapping();
@@ -172,9 +202,30 @@ void StationEntries<Station>::add(const Station& station, const VarDesc& vd, con
         Parent::add(StationEntry<Station>(station, vd, dtrange, count));
 }
 
+template<typename Station>
+bool StationEntries<Station>::remove(const Station& station, const VarDesc& vd)
+{
+    iterator cur = this->find(station);
+    if (cur == end())
+        return false;
+    if (!cur->remove(vd))
+        return false;
+    if (cur->empty())
+        Parent::erase(cur);
+    return true;
+}
+
 template<typename Station>
 void StationEntries<Station>::add(const StationEntries<Station>& entries)
 {
+    if (entries.size() >= parallel_merge_min_stations && core::default_concurrency() > 1)
+    {
+        add_partitioned<Station>(entries, [](StationEntries<Station>& partition, const Station& station, const StationEntry<Station>& entry) {
+            partition.add(station, entry);
+        });
+        return;
+    }
+
     for (const auto& entry: entries)
         add(entry);
 }
@@ -192,35 +243,102 @@ void StationEntries<Station>::add(const StationEntry<Station>& entry)
 template<typename Station> template<typename OStation>
 void StationEntries<Station>::add(const StationEntries<OStation>& entries)
 {
+    if (entries.size() >= parallel_merge_min_stations && core::default_concurrency() > 1)
+    {
+        add_partitioned<OStation>(entries, [](StationEntries<Station>& partition, const Station& station, const StationEntry<OStation>& entry) {
+            partition.add(station, entry);
+        });
+        return;
+    }
+
+    for (const auto& entry: entries)
+        add(convert_station<Station, OStation>(entry.station), entry);
+}
+
+template<typename Station> template<typename OStation>
+void StationEntries<Station>::add(const Station& station, const StationEntry<OStation>& entry)
+{
+    iterator cur = this->find(station);
+    if (cur != end())
+        cur->add(entry);
+    else
+        Parent::add(StationEntry<Station>(station, entry));
+}
+
+template<typename Station>
+void StationEntries<Station>::add_filtered(const StationEntry<Station>& entry, const dballe::Query& query)
+{
+    iterator cur = this->find(entry.station);
+    if (cur != end())
+        cur->add_filtered(entry, query);
+    else {
+        StationEntry<Station> se(entry, query);
+        if (!se.empty())
+            Parent::add(std::move(se));
+    }
+}
+
+template<typename Station> template<typename OStation>
+void StationEntries<Station>::add_partitioned(const StationEntries<OStation>& entries, std::function<void(StationEntries<Station>&, const Station&, const StationEntry<OStation>&)> merge)
+{
+    // Split existing and new stations by hash, so that the same station
+    // always ends up in the same partition, and partitions can be merged
+    // independently
+    unsigned partition_count = core::default_concurrency();
+    std::vector<StationEntries<Station>> partitions(partition_count);
+    std::vector<std::vector<std::pair<Station, const StationEntry<OStation>*>>> sources(partition_count);
+
+    for (auto& entry: this->items)
+    {
+        auto& partition = partitions[station_hash(entry.station) % partition_count];
+        partition.items.emplace_back(std::move(entry));
+        ++partition.dirty;
+    }
+    this->items.clear();
+    this->dirty = 0;
+
     for (const auto& entry: entries)
     {
         Station station = convert_station<Station, OStation>(entry.station);
-        iterator cur = this->find(station);
-        if (cur != end())
-            cur->add(entry);
-        else
-            Parent::add(StationEntry<Station>(station, entry));
+        size_t hash = station_hash(station);
+        sources[hash % partition_count].emplace_back(std::move(station), &entry);
     }
+
+    core::parallel_for(partition_count, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            for (const auto& source: sources[i])
+                merge(partitions[i], source.first, *source.second);
+    }, partition_count);
+
+    // Partitions contain distinct stations: concatenate and sort them
+    for (auto& partition: partitions)
+        for (auto& entry: partition.items)
+            this->items.emplace_back(std::move(entry));
+    std::sort(this->items.begin(), this->items.end(), [](const StationEntry<Station>& a, const StationEntry<Station>& b) {
+        return a.station < b.station;
+    });
 }
 
 template<typename Station>
 void StationEntries<Station>::add_filtered(const StationEntries& entries, const dballe::Query& query)
 {
+    if (entries.size() >= parallel_merge_min_stations && core::default_concurrency() > 1)
+    {
+        add_partitioned<Station>(entries, [&](StationEntries<Station>& partition, const Station& station, const StationEntry<Station>& entry) {
+            StationFilter<Station> filter(query);
+            if (filter.matches_station(station))
+                partition.add_filtered(entry, query);
+        });
+        return;
+    }
+
     StationFilter<Station> filter(query);
 
-    for (auto entry: entries)
+    for (const auto& entry: entries)
     {
         if (!filter.matches_station(entry.station))
             continue;
-
-        iterator cur = this->find(entry.station);
-        if (cur != end())
-            cur->add_filtered(entry, query);
-        else {
-            StationEntry<Station> se(entry, query);
-            if (!se.empty())
-                Parent::add(std::move(se));
-        }
+        add_filtered(entry, query);
     }
 }
 
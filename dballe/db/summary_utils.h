@@ -100,9 +100,13 @@ struct StationEntry : protected core::SmallSet<VarEntry, VarDesc, station_entry_
     void add(const VarDesc& vd, const dballe::DatetimeRange& dtrange, size_t count);
     template<typename OStation>
     void add(const StationEntry<OStation>& entries);
+    /// Remove the entry for \a vd, returning false if it was not present
+    bool remove(const VarDesc& vd);
     void add_filtered(const StationEntry& entries, const dballe::Query& query);
     bool iter_filtered(const dballe::Query& query, std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange& dtrange, size_t count)> dest) const;
 
+    const StationEntry& sorted() const { if (this->dirty) this->rearrange_dirty(); return *this; }
+
     void to_json(core::JSONWriter& writer) const;
     static StationEntry from_json(core::json::Stream& in);
 
@@ -148,13 +152,44 @@ struct StationEntries : protected core::SmallSet<StationEntry<Station>, Station,
     /// Merge the given entry
     void add(const StationEntry<Station>& entry);
 
+    /// Merge the given entry, using \a station as its station
+    template<typename OStation>
+    void add(const Station& station, const StationEntry<OStation>& entry);
+
+    /**
+     * Merge the entries matching the query.
+     *
+     * Merging and filtering large sets of entries is split across threads,
+     * partitioning stations by hash.
+     */
     void add_filtered(const StationEntries& entry, const dballe::Query& query);
 
+    /// Merge the variables of \a entry matching the query
+    void add_filtered(const StationEntry<Station>& entry, const dballe::Query& query);
+
+    /**
+     * Remove the entry for a variable of a station, and the station itself if
+     * it is left without variables.
+     *
+     * Returns false if the entry was not present.
+     */
+    bool remove(const Station& station, const VarDesc& vd);
+
     bool has(const Station& station) const { return this->find(station) != this->end(); }
 
     const StationEntries& sorted() const { if (this->dirty) this->rearrange_dirty(); return *this; }
 
     bool iter_filtered(const dballe::Query& query, std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange& dtrange, size_t count)> dest) const;
+
+protected:
+    /**
+     * Merge entries on multiple threads.
+     *
+     * Existing and new stations are split in partitions by hash, and each
+     * partition is merged in its own thread using \a merge.
+     */
+    template<typename OStation>
+    void add_partitioned(const StationEntries<OStation>& entries, std::function<void(StationEntries<Station>&, const Station&, const StationEntry<OStation>&)> merge);
 };
 
 
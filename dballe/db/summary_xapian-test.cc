@@ -5,7 +5,9 @@
 
 #ifdef HAVE_XAPIAN
 #include "dballe/db/summary_xapian.h"
+#include "dballe/core/json.h"
 #include <wreport/utils/sys.h>
+#include <sstream>
 
 using namespace dballe;
 using namespace dballe::db;
@@ -37,6 +39,17 @@ std::vector<std::string> get_reports(const BACKEND& summary)
     return res;
 }
 
+/// Build a term with the JSON encoding used by older versions
+template<typename T>
+std::string legacy_term(char prefix, const T& val)
+{
+    std::stringstream res;
+    res << prefix;
+    core::JSONWriter writer(res);
+    writer.add(val);
+    return res.str();
+}
+
 template<typename BACKEND>
 void Tests<BACKEND>::register_tests()
 {
@@ -79,6 +92,75 @@ this->add_method("xapian_concurrency", [] {
 #endif
 });
 
+this->add_method("upgrade_terms", [] {
+    typename BACKEND::station_type station;
+    set_station_id(station, 1);
+    station.report = "synop";
+    station.coords = Coords(44.0, 11.0);
+    station.ident = "test";
+    summary::VarDesc vd(Level(1), Trange::instant(), WR_VAR(0, 12, 101));
+
+    // Create a database with the old JSON term encoding
+    sys::rmtree_ifexists("testfile");
+    {
+        Xapian::WritableDatabase db("testfile", Xapian::DB_CREATE_OR_OVERWRITE);
+        Xapian::Document doc;
+        doc.add_term(legacy_term('S', station));
+        doc.add_term(legacy_term('L', vd.level));
+        doc.add_term(legacy_term('T', vd.trange));
+        doc.add_term(varcode_format(vd.varcode));
+        doc.add_value(0, Datetime(2020, 1, 1).to_string());
+        doc.add_value(1, Datetime(2020, 2, 1).to_string());
+        doc.add_value(2, Xapian::sortable_serialise(10));
+        db.add_document(doc);
+        db.commit();
+    }
+
+    BACKEND summary("testfile");
+
+    core::Query query;
+    query.level = vd.level;
+    query.trange = vd.trange;
+    query.varcodes.insert(vd.varcode);
+    std::vector<typename BACKEND::station_type> stations;
+    summary.iter_filtered(query, [&](const typename BACKEND::station_type& s, const summary::VarDesc&, const DatetimeRange&, size_t) {
+        stations.push_back(s);
+        return true;
+    });
+    wassert(actual(stations.size()) == 1u);
+    wassert_true(stations[0] == station);
+    wassert(actual(summary.data_count()) == 10u);
+
+    // New entries are merged with the upgraded ones
+    summary.add(station, vd, DatetimeRange(Datetime(2020, 2, 1), Datetime(2020, 3, 1)), 5);
+    summary.commit();
+    stations.clear();
+    summary.stations([&](const typename BACKEND::station_type& s) { stations.push_back(s); return true; });
+    wassert(actual(stations.size()) == 1u);
+    wassert(actual(summary.data_count()) == 15u);
+    wassert(actual(summary.datetime_max()) == Datetime(2020, 3, 1));
+});
+
+this->add_method("flush_on_destruction", [] {
+    typename BACKEND::station_type station;
+    set_station_id(station, 1);
+    station.report = "synop";
+    station.coords = Coords(44.0, 11.0);
+    summary::VarDesc vd(Level(1), Trange::instant(), WR_VAR(0, 12, 101));
+
+    // Entries added and never queried are not lost when the summary is
+    // destroyed
+    sys::rmtree_ifexists("testfile");
+    {
+        BACKEND summary("testfile");
+        summary.add(station, vd, DatetimeRange(Datetime(2020, 1, 1), Datetime(2020, 2, 1)), 10);
+    }
+
+    BACKEND summary("testfile");
+    wassert(actual(get_reports(summary).size()) == 1u);
+    wassert(actual(summary.data_count()) == 10u);
+});
+
 }
 
 }
@@ -6,9 +6,11 @@
 #include "dballe/core/json.h"
 #include "dballe/msg/msg.h"
 #include "dballe/msg/context.h"
+#include <wreport/utils/sys.h>
 #include <algorithm>
 #include <unordered_set>
 #include <cstring>
+#include <cstdio>
 #include <sstream>
 
 using namespace std;
@@ -19,40 +21,112 @@ namespace db {
 
 namespace {
 
+/**
+ * Metadata key storing the version of the term encoding.
+ *
+ * Databases without it use the original encoding, with stations, levels and
+ * time ranges serialized as JSON.
+ */
+const char* term_format_key = "dballe.term_format";
+const char* term_format_version = "2";
+
+/// Number of added entries to keep in memory before writing them to Xapian
+const size_t add_batch_size = 10000;
+
+/*
+ * Terms encode integers as fixed-width big endian fields, with the sign bit
+ * flipped, so that the lexicographical order of terms follows the numeric
+ * order of their values.
+ */
+
+inline void append_int(std::string& term, int val)
+{
+    uint32_t v = (uint32_t)val ^ 0x80000000u;
+    char buf[4] = { (char)(v >> 24), (char)(v >> 16), (char)(v >> 8), (char)v };
+    term.append(buf, 4);
+}
+
+inline int read_int(const std::string& term, size_t& pos)
+{
+    if (pos + 4 > term.size())
+        wreport::error_consistency::throwf("Xapian term is too short: %zu bytes needed at position %zu, but the term is %zu bytes long", pos + 4, pos, term.size());
+    const unsigned char* p = (const unsigned char*)term.data() + pos;
+    pos += 4;
+    return (int)((((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3]) ^ 0x80000000u);
+}
+
+/// Read a NUL-terminated string
+inline std::string read_string(const std::string& term, size_t& pos)
+{
+    size_t end = term.find('\0', pos);
+    if (end == std::string::npos)
+        wreport::error_consistency::throwf("Xapian term has an unterminated string at position %zu", pos);
+    std::string res(term, pos, end - pos);
+    pos = end + 1;
+    return res;
+}
+
+void append_station(std::string& term, const dballe::Station& station)
+{
+    term += station.report;
+    term += '\0';
+    append_int(term, station.coords.lat);
+    append_int(term, station.coords.lon);
+    if (station.ident.is_missing())
+        term += '\0';
+    else
+    {
+        term += '\1';
+        term += station.ident.get();
+        term += '\0';
+    }
+}
+
+void read_station(const std::string& term, size_t& pos, dballe::Station& station)
+{
+    station.report = read_string(term, pos);
+    station.coords.lat = read_int(term, pos);
+    station.coords.lon = read_int(term, pos);
+    if (pos >= term.size())
+        wreport::error_consistency::throwf("Xapian station term is truncated");
+    if (term[pos++])
+        station.ident = read_string(term, pos);
+}
+
 std::string to_term(const dballe::Station& station)
 {
-    std::stringstream res;
-    res << "S";
-    core::JSONWriter writer(res);
-    writer.add(station);
-    return res.str();
+    std::string res("S");
+    append_station(res, station);
+    return res;
 }
 
 std::string to_term(const dballe::DBStation& station)
 {
-    std::stringstream res;
-    res << "S";
-    core::JSONWriter writer(res);
-    writer.add(station);
-    return res.str();
+    std::string res("S");
+    append_station(res, station);
+    append_int(res, station.id);
+    return res;
 }
 
 std::string to_term(const dballe::Level& level)
 {
-    std::stringstream res;
-    res << "L";
-    core::JSONWriter writer(res);
-    writer.add(level);
-    return res.str();
+    std::string res("L");
+    res.reserve(17);
+    append_int(res, level.ltype1);
+    append_int(res, level.l1);
+    append_int(res, level.ltype2);
+    append_int(res, level.l2);
+    return res;
 }
 
 std::string to_term(const dballe::Trange& trange)
 {
-    std::stringstream res;
-    res << "T";
-    core::JSONWriter writer(res);
-    writer.add(trange);
-    return res.str();
+    std::string res("T");
+    res.reserve(13);
+    append_int(res, trange.pind);
+    append_int(res, trange.p1);
+    append_int(res, trange.p2);
+    return res;
 }
 
 std::string to_term(const wreport::Varcode& varcode)
@@ -61,28 +135,46 @@ std::string to_term(const wreport::Varcode& varcode)
 }
 
 template<typename Station>
-Station station_from_term(const std::string& term)
+Station station_from_term(const std::string& term);
+
+template<>
+dballe::Station station_from_term<dballe::Station>(const std::string& term)
+{
+    dballe::Station res;
+    size_t pos = 1;
+    read_station(term, pos, res);
+    return res;
+}
+
+template<>
+dballe::DBStation station_from_term<dballe::DBStation>(const std::string& term)
 {
-    std::stringstream in(term);
-    in.get();
-    core::json::Stream json(in);
-    return json.parse<Station>();
+    dballe::DBStation res;
+    size_t pos = 1;
+    read_station(term, pos, res);
+    res.id = read_int(term, pos);
+    return res;
 }
 
 Level level_from_term(const std::string& term)
 {
-    std::stringstream in(term);
-    in.get();
-    core::json::Stream json(in);
-    return json.parse<Level>();
+    size_t pos = 1;
+    Level res;
+    res.ltype1 = read_int(term, pos);
+    res.l1 = read_int(term, pos);
+    res.ltype2 = read_int(term, pos);
+    res.l2 = read_int(term, pos);
+    return res;
 }
 
 Trange trange_from_term(const std::string& term)
 {
-    std::stringstream in(term);
-    in.get();
-    core::json::Stream json(in);
-    return json.parse<Trange>();
+    size_t pos = 1;
+    Trange res;
+    res.pind = read_int(term, pos);
+    res.p1 = read_int(term, pos);
+    res.p2 = read_int(term, pos);
+    return res;
 }
 
 wreport::Varcode varcode_from_term(const std::string& term)
@@ -90,6 +182,31 @@ wreport::Varcode varcode_from_term(const std::string& term)
     return WR_STRING_TO_VAR(term.c_str() + 1);
 }
 
+/// Decode a term written with the original JSON encoding
+template<typename T>
+T legacy_from_term(const std::string& term)
+{
+    core::json::Stream json(term.data() + 1, term.data() + term.size());
+    return json.parse<T>();
+}
+
+/// Reencode a term from the original JSON encoding
+template<typename Station>
+std::string upgrade_term(const std::string& term)
+{
+    // Skip terms that have already been reencoded
+    if (term.size() < 2 || term[1] != (term[0] == 'S' ? '{' : '['))
+        return term;
+
+    switch (term[0])
+    {
+        case 'S': return to_term(legacy_from_term<Station>(term));
+        case 'L': return to_term(legacy_from_term<Level>(term));
+        case 'T': return to_term(legacy_from_term<Trange>(term));
+        default: return term;
+    }
+}
+
 }
 
 #define CATCH_XAPIAN_RETHROW_WREPORT \
@@ -173,17 +290,66 @@ template<typename Station>
 BaseSummaryXapian<Station>::BaseSummaryXapian(const std::string& pathname)
 {
     db.reset(new XapianDBOndisk(pathname));
+    if (wreport::sys::exists(pathname))
+        upgrade_terms();
+}
+
+template<typename Station>
+void BaseSummaryXapian<Station>::upgrade_terms()
+{
+    try {
+        std::vector<Xapian::docid> ids;
+        {
+            auto& reader = db->reader();
+            if (reader.get_metadata(term_format_key) == term_format_version)
+                return;
+            for (auto i = reader.postlist_begin(""); i != reader.postlist_end(""); ++i)
+                ids.push_back(*i);
+        }
+        if (ids.empty())
+            return;
+
+        // Commit in batches, so that the reader never sees too many changes
+        // at once
+        for (size_t start = 0; start < ids.size(); start += add_batch_size)
+        {
+            auto& reader = db->reader();
+            auto& writer = db->writer();
+            size_t end = std::min(ids.size(), start + add_batch_size);
+            for (size_t i = start; i < end; ++i)
+            {
+                Xapian::Document doc = reader.get_document(ids[i]);
+                Xapian::Document upgraded;
+                for (auto ti = doc.termlist_begin(); ti != doc.termlist_end(); ++ti)
+                    upgraded.add_term(upgrade_term<Station>(*ti));
+                for (auto vi = doc.values_begin(); vi != doc.values_end(); ++vi)
+                    upgraded.add_value(vi.get_valueno(), *vi);
+                writer.replace_document(ids[i], upgraded);
+            }
+            db->commit();
+        }
+
+        db->writer().set_metadata(term_format_key, term_format_version);
+        db->commit();
+    CATCH_XAPIAN_RETHROW_WREPORT
+    }
 }
 
 template<typename Station>
 BaseSummaryXapian<Station>::~BaseSummaryXapian()
 {
+    try {
+        flush();
+    } catch (std::exception& e) {
+        fprintf(stderr, "cannot write pending summary entries: %s\n", e.what());
+    }
 }
 
 template<typename Station>
 bool BaseSummaryXapian<Station>::stations(std::function<bool(const Station&)> dest) const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         auto end = db.allterms_end("S");
         for (auto ti = db.allterms_begin("S"); ti != end; ++ti)
@@ -198,6 +364,7 @@ template<typename Station>
 bool BaseSummaryXapian<Station>::reports(std::function<bool(const std::string&)> dest) const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         core::SmallUniqueValueSet<std::string> res;
         auto end = db.allterms_end("S");
@@ -216,6 +383,7 @@ template<typename Station>
 bool BaseSummaryXapian<Station>::levels(std::function<bool(const Level&)> dest) const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         auto end = db.allterms_end("L");
         for (auto ti = db.allterms_begin("L"); ti != end; ++ti)
@@ -230,6 +398,7 @@ template<typename Station>
 bool BaseSummaryXapian<Station>::tranges(std::function<bool(const Trange&)> dest) const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         auto end = db.allterms_end("T");
         for (auto ti = db.allterms_begin("T"); ti != end; ++ti)
@@ -245,6 +414,7 @@ template<typename Station>
 bool BaseSummaryXapian<Station>::varcodes(std::function<bool(const wreport::Varcode&)> dest) const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         auto end = db.allterms_end("B");
         for (auto ti = db.allterms_begin("B"); ti != end; ++ti)
@@ -259,6 +429,7 @@ template<typename Station>
 Datetime BaseSummaryXapian<Station>::datetime_min() const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         std::string lb = db.get_value_lower_bound(0);
         if (lb.empty())
@@ -272,6 +443,7 @@ template<typename Station>
 Datetime BaseSummaryXapian<Station>::datetime_max() const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         std::string lb = db.get_value_upper_bound(1);
         if (lb.empty())
@@ -285,6 +457,7 @@ template<typename Station>
 unsigned BaseSummaryXapian<Station>::data_count() const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         unsigned res = 0;
         for (auto ival = db.valuestream_begin(2); ival != db.valuestream_end(2); ++ival)
@@ -298,6 +471,7 @@ template<typename Station>
 void BaseSummaryXapian<Station>::clear()
 {
     try {
+        pending.clear();
         db->clear();
     CATCH_XAPIAN_RETHROW_WREPORT
     }
@@ -306,50 +480,92 @@ void BaseSummaryXapian<Station>::clear()
 template<typename Station>
 void BaseSummaryXapian<Station>::add(const Station& station, const summary::VarDesc& vd, const dballe::DatetimeRange& dtrange, size_t count)
 {
+    std::array<std::string, 4> terms;
+    terms[0] = to_term(station);
+    terms[1] = to_term(vd.level);
+    terms[2] = to_term(vd.trange);
+    terms[3] = to_term(vd.varcode);
+
+    auto res = pending.emplace(std::move(terms), std::make_pair(dtrange, count));
+    if (!res.second)
+    {
+        res.first->second.first.merge(dtrange);
+        res.first->second.second += count;
+    }
+
+    if (pending.size() >= add_batch_size)
+        flush();
+}
+
+template<typename Station>
+void BaseSummaryXapian<Station>::remove(const Station& station, const summary::VarDesc& vd)
+{
+    std::array<std::string, 4> terms;
+    terms[0] = to_term(station);
+    terms[1] = to_term(vd.level);
+    terms[2] = to_term(vd.trange);
+    terms[3] = to_term(vd.varcode);
+
     try {
+        flush();
         auto writer = this->db->writer();
-        std::array<std::string, 4> terms;
-        terms[0] = to_term(station);
-        terms[1] = to_term(vd.level);
-        terms[2] = to_term(vd.trange);
-        terms[3] = to_term(vd.varcode);
+        Xapian::Enquire enq(writer);
+        enq.set_query(Xapian::Query(Xapian::Query::OP_AND, terms.begin(), terms.end()));
+        Xapian::MSet mset = enq.get_mset(0, 1);
+        if (!mset.empty())
+            writer.delete_document(*mset.begin());
+    CATCH_XAPIAN_RETHROW_WREPORT
+    }
+}
 
-        Xapian::Query query(Xapian::Query::OP_AND, terms.begin(), terms.end());
+template<typename Station>
+void BaseSummaryXapian<Station>::flush() const
+{
+    if (pending.empty())
+        return;
 
+    try {
+        auto writer = this->db->writer();
         Xapian::Enquire enq(writer);
-        enq.set_query(query);
-
-        Xapian::MSet mset = enq.get_mset(0, 1);
-        if (mset.empty())
+        for (const auto& entry: pending)
         {
-            // Insert
-            Xapian::Document doc;
-            for (const auto& term: terms)
-                doc.add_term(term);
-
-            doc.add_value(0, dtrange.min.to_string());
-            doc.add_value(1, dtrange.max.to_string());
-            doc.add_value(2, Xapian::sortable_serialise(count));
-
-            writer.add_document(doc);
-        } else {
-            // Update
-            Xapian::Document doc = mset[0].get_document();
-            // TODO: merge dtrange, count
-
-            DatetimeRange range(
-                    Datetime::from_iso8601(doc.get_value(0).c_str()),
-                    Datetime::from_iso8601(doc.get_value(1).c_str()));
-            range.merge(dtrange);
+            const auto& terms = entry.first;
+            const DatetimeRange& dtrange = entry.second.first;
+            size_t count = entry.second.second;
+
+            enq.set_query(Xapian::Query(Xapian::Query::OP_AND, terms.begin(), terms.end()));
+            Xapian::MSet mset = enq.get_mset(0, 1);
+            if (mset.empty())
+            {
+                // Insert
+                Xapian::Document doc;
+                for (const auto& term: terms)
+                    doc.add_term(term);
 
-            doc.add_value(0, range.min.to_string());
-            doc.add_value(1, range.max.to_string());
+                doc.add_value(0, dtrange.min.to_string());
+                doc.add_value(1, dtrange.max.to_string());
+                doc.add_value(2, Xapian::sortable_serialise(count));
 
-            int old_count = Xapian::sortable_unserialise(doc.get_value(2));
-            doc.add_value(2, Xapian::sortable_serialise(old_count + count));
+                writer.add_document(doc);
+            } else {
+                // Update
+                Xapian::Document doc = mset[0].get_document();
 
-            writer.replace_document(doc.get_docid(), doc);
+                DatetimeRange range(
+                        Datetime::from_iso8601(doc.get_value(0).c_str()),
+                        Datetime::from_iso8601(doc.get_value(1).c_str()));
+                range.merge(dtrange);
+
+                doc.add_value(0, range.min.to_string());
+                doc.add_value(1, range.max.to_string());
+
+                int old_count = Xapian::sortable_unserialise(doc.get_value(2));
+                doc.add_value(2, Xapian::sortable_serialise(old_count + count));
+
+                writer.replace_document(doc.get_docid(), doc);
+            }
         }
+        pending.clear();
     CATCH_XAPIAN_RETHROW_WREPORT
     }
 }
@@ -358,6 +574,8 @@ template<typename Station>
 void BaseSummaryXapian<Station>::commit()
 {
     try {
+        flush();
+        db->writer().set_metadata(term_format_key, term_format_version);
         db->commit();
     CATCH_XAPIAN_RETHROW_WREPORT
     }
@@ -367,15 +585,13 @@ template<typename Station>
 bool BaseSummaryXapian<Station>::iter(std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange& dtrange, size_t count)> dest) const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         // Iterate stations
         auto send = db.allterms_end("S");
         for (auto si = db.allterms_begin("S"); si != send; ++si)
         {
-            std::stringstream in(*si);
-            in.get();
-            core::json::Stream json(in);
-            Station station = json.parse<Station>();
+            Station station = station_from_term<Station>(*si);
 
             // Iterate all documents for this station
             auto end = db.postlist_end(*si);
@@ -414,6 +630,7 @@ template<typename Station>
 bool BaseSummaryXapian<Station>::iter_filtered(const dballe::Query& query, std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange& dtrange, size_t count)> dest) const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         summary::StationFilter<Station> filter(query);
         const core::Query& q = core::Query::downcast(query);
@@ -530,6 +747,7 @@ template<typename Station>
 void BaseSummaryXapian<Station>::to_json(core::JSONWriter& writer) const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         writer.start_mapping();
         writer.add("e");
@@ -539,10 +757,7 @@ void BaseSummaryXapian<Station>::to_json(core::JSONWriter& writer) const
         auto send = db.allterms_end("S");
         for (auto si = db.allterms_begin("S"); si != send; ++si)
         {
-            std::stringstream in(*si);
-            in.get();
-            core::json::Stream json(in);
-            Station station = json.parse<Station>();
+            Station station = station_from_term<Station>(*si);
 
             writer.start_mapping();
             writer.add("s");
@@ -597,6 +812,7 @@ template<typename Station>
 void BaseSummaryXapian<Station>::dump(FILE* out) const
 {
     try {
+        flush();
         auto& db = this->db->reader();
         for (auto i = db.postlist_begin(""); i != db.postlist_end(""); ++i)
         {
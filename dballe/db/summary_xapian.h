@@ -4,6 +4,9 @@
 #include <dballe/core/fwd.h>
 #include <dballe/db/summary.h>
 #include <xapian.h>
+#include <array>
+#include <map>
+#include <string>
 
 namespace dballe {
 namespace db {
@@ -30,11 +33,32 @@ class BaseSummaryXapian: public BaseSummary<Station>
 {
     std::unique_ptr<XapianDB> db;
 
+    /// Entries added and not yet written to Xapian, indexed by their terms
+    mutable std::map<std::array<std::string, 4>, std::pair<DatetimeRange, size_t>> pending;
+
+    /// Write pending entries to Xapian
+    void flush() const;
+
 public:
     BaseSummaryXapian();
+
+    /**
+     * Open a summary stored in a Xapian database on disk.
+     *
+     * Databases created by older versions of DB-All.e are upgraded to the
+     * current term encoding.
+     */
     BaseSummaryXapian(const std::string& pathname);
     ~BaseSummaryXapian();
 
+    /**
+     * Reencode all terms written with the JSON encoding used by older
+     * versions of DB-All.e.
+     *
+     * It does nothing if the database already uses the current encoding.
+     */
+    void upgrade_terms();
+
     bool stations(std::function<bool(const Station&)>) const override;
     bool reports(std::function<bool(const std::string&)>) const override;
     bool levels(std::function<bool(const Level&)>) const override;
@@ -47,6 +71,7 @@ public:
 
     void clear() override;
     void add(const Station& station, const summary::VarDesc& vd, const dballe::DatetimeRange& dtrange, size_t count) override;
+    void remove(const Station& station, const summary::VarDesc& vd) override;
     void commit() override;
 
     bool iter(std::function<bool(const Station&, const summary::VarDesc&, const DatetimeRange&, size_t)>) const override;
@@ -1,4 +1,6 @@
 #include "batch.h"
+#include "db.h"
+#include "driver.h"
 #include "transaction.h"
 #include "station.h"
 #include <algorithm>
@@ -111,6 +113,7 @@ void Batch::write_pending(Tracer<>& trc)
 {
     if (!last_station)
         return;
+    transaction.mark_data_written();
     last_station->write_pending(trc, write_attrs);
 }
 
@@ -135,6 +138,24 @@ void Batch::dump(FILE* out) const
 
 namespace batch {
 
+/// Account for a newly inserted value in the summary rows of a station
+static void add_to_summary(StationSummary& summary, int id_station, int id_levtr, wreport::Varcode code, const Datetime& datetime)
+{
+    auto i = summary.find(std::make_pair(id_levtr, code));
+    if (i == summary.end())
+    {
+        SummaryTableRow row(id_station, id_levtr, code);
+        row.count = 1;
+        row.datetime = DatetimeRange(datetime, datetime);
+        summary.insert(std::make_pair(std::make_pair(id_levtr, code), row));
+        return;
+    }
+    SummaryTableRow& row = i->second;
+    ++row.count;
+    if (datetime < row.datetime.min) row.datetime.min = datetime;
+    if (datetime > row.datetime.max) row.datetime.max = datetime;
+}
+
 void StationDatum::dump(FILE* out) const
 {
     fprintf(out, "%01d%02d%03d(%d): %s\n",
@@ -213,7 +234,7 @@ void MeasuredData::add(int id_levtr, const wreport::Var* var, UpdateMode on_conf
     }
 }
 
-void MeasuredData::write_pending(Tracer<>& trc, Transaction& tr, int station_id, bool with_attrs)
+void MeasuredData::write_pending(Tracer<>& trc, Transaction& tr, int station_id, bool with_attrs, StationSummary* summary)
 {
     if (!to_insert.empty())
     {
@@ -226,6 +247,10 @@ void MeasuredData::write_pending(Tracer<>& trc, Transaction& tr, int station_id,
                 ids_on_db.add(MeasuredDataID(IdVarcode(v.id_levtr, v.var->code()), v.id));
             else
                 cur->id = v.id;
+
+            // Duplicates skipped by insert are left without an id
+            if (summary && v.id != MISSING_INT)
+                add_to_summary(*summary, station_id, v.id_levtr, v.var->code(), datetime);
         }
     }
     if (!to_update.empty())
@@ -287,8 +312,26 @@ void Station::write_pending(Tracer<>& trc, bool with_attrs)
         id = batch.transaction.station().insert_new(trc, *this);
 
     station_data.write_pending(trc, batch.transaction, id, with_attrs);
-    for (auto md: measured_data)
-        md->write_pending(trc, batch.transaction, id, with_attrs);
+    if (batch.transaction.summary_table || batch.transaction.recording_changes())
+    {
+        StationSummary station_summary;
+        for (auto md: measured_data)
+            md->write_pending(trc, batch.transaction, id, with_attrs, &station_summary);
+        if (!station_summary.empty())
+        {
+            std::vector<SummaryTableRow> summary;
+            summary.reserve(station_summary.size());
+            for (const auto& i: station_summary)
+                summary.push_back(i.second);
+            if (batch.transaction.summary_table)
+                batch.transaction.driver().summary_add_v7(summary);
+            if (batch.transaction.recording_changes())
+                batch.transaction.record_added(summary);
+        }
+    } else {
+        for (auto md: measured_data)
+            md->write_pending(trc, batch.transaction, id, with_attrs);
+    }
 }
 
 void Station::dump(FILE* out) const
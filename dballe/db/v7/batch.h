@@ -7,6 +7,7 @@
 #include <dballe/db/v7/fwd.h>
 #include <dballe/db/v7/utils.h>
 #include <vector>
+#include <map>
 #include <tuple>
 #include <memory>
 
@@ -52,6 +53,9 @@ enum UpdateMode {
     ERROR,
 };
 
+/// Summary of the values inserted for a station, by level/time range and varcode
+typedef std::map<std::pair<int, wreport::Varcode>, SummaryTableRow> StationSummary;
+
 struct StationDatum
 {
     int id = MISSING_INT;
@@ -130,7 +134,14 @@ struct MeasuredData
     }
 
     void add(int id_levtr, const wreport::Var* var, UpdateMode on_conflict);
-    void write_pending(Tracer<>& trc, Transaction& tr, int station_id, bool with_attrs);
+
+    /**
+     * Write pending changes to the database.
+     *
+     * If summary is not null, the values that have been inserted are added to
+     * it.
+     */
+    void write_pending(Tracer<>& trc, Transaction& tr, int station_id, bool with_attrs, StationSummary* summary=nullptr);
 };
 
 inline const Datetime& measured_data_vector_get_value(MeasuredData* const& item) { return item->datetime; }
@@ -8,13 +8,17 @@
 #include "dballe/db/v7/station.h"
 #include "dballe/db/v7/levtr.h"
 #include "dballe/db/v7/data.h"
+#include "dballe/db/v7/pool.h"
+#include "dballe/db/v7/querycache.h"
 #include "dballe/types.h"
 #include "dballe/var.h"
 #include "dballe/core/var.h"
 #include "dballe/core/data.h"
 #include "dballe/core/query.h"
+#include "dballe/core/parallel.h"
 #include "wreport/var.h"
 #include <unordered_map>
+#include <algorithm>
 #include <cstring>
 #include <cassert>
 
@@ -158,6 +162,9 @@ void StationData::remove()
 Data::Data(DataQueryBuilder& qb, bool with_attributes)
     : LevTrBase(qb.tr), with_attributes(with_attributes) {}
 
+Data::Data(std::shared_ptr<v7::Transaction> tr, bool with_attributes)
+    : LevTrBase(tr), with_attributes(with_attributes) {}
+
 void Data::load(Tracer<>& trc, const DataQueryBuilder& qb)
 {
     results.clear();
@@ -209,7 +216,7 @@ void Data::load_best(Tracer<>& trc, const DataQueryBuilder& qb)
     tr->levtr().prefetch_ids(trc, ids);
 }
 
-bool Data::add_to_last_results(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)
+bool Data::add_to_last_results(std::deque<DataRow>& results, const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)
 {
     if (results.empty()) goto append;
     if (station.id != results.back().station.id) goto append;
@@ -237,7 +244,7 @@ void Data::load_last(Tracer<>& trc, const DataQueryBuilder& qb)
     results.clear();
     set<int> ids;
     tr->data().run_data_query(trc, qb, [&](const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var) {
-        if (add_to_last_results(station, id_levtr, datetime, id_data, move(var)))
+        if (add_to_last_results(results, station, id_levtr, datetime, id_data, move(var)))
             ids.insert(id_levtr);
     });
     at_start = true;
@@ -245,6 +252,177 @@ void Data::load_last(Tracer<>& trc, const DataQueryBuilder& qb)
     tr->levtr().prefetch_ids(trc, ids);
 }
 
+namespace {
+
+/// Part of a data query run by load_parallel
+struct QueryPart
+{
+    int id_station_min = MISSING_INT;
+    int id_station_max = MISSING_INT;
+    DatetimeRange dtrange;
+    std::deque<DataRow> results;
+    std::set<int> ids;
+};
+
+long long to_seconds(const Datetime& dt)
+{
+    return (long long)dt.to_julian() * 86400 + dt.hour * 3600 + dt.minute * 60 + dt.second;
+}
+
+Datetime from_seconds(long long s)
+{
+    return Datetime::from_julian(s / 86400, (s % 86400) / 3600, (s % 3600) / 60, s % 60);
+}
+
+}
+
+bool Data::load_parallel(Tracer<>& trc, const DataQueryBuilder& qb)
+{
+    const core::Query& query = qb.query;
+    if (!tr->readonly || !tr->db->pool) return false;
+    if (qb.modifiers & DBA_DB_MODIFIER_BEST) return false;
+    if (query.limit != MISSING_INT) return false;
+
+    // Parts run on other connections can only give the same results as
+    // running the query here if they see the same snapshot of the database
+    std::string snapshot = tr->connection().export_snapshot();
+    if (snapshot.empty()) return false;
+
+    std::vector<int> stations;
+    {
+        StationQueryBuilder sqb(tr, query, DBA_DB_MODIFIER_UNSORTED);
+        sqb.build();
+        tr->station().run_station_query(trc, sqb, [&](const dballe::DBStation& station) {
+            stations.push_back(station.id);
+        });
+    }
+    std::sort(stations.begin(), stations.end());
+
+    // Since results are sorted by station first, and then by datetime,
+    // concatenating the results of the parts in order gives the same ordering
+    // as running the whole query
+    unsigned count;
+    if (stations.size() > 1)
+        count = std::min((size_t)core::default_concurrency(), stations.size());
+    else if (stations.size() == 1 && !(qb.modifiers & DBA_DB_MODIFIER_LAST)
+            && !query.dtrange.min.is_missing() && !query.dtrange.max.is_missing())
+    {
+        long long span = to_seconds(query.dtrange.max) - to_seconds(query.dtrange.min) + 1;
+        count = std::min((long long)core::default_concurrency(), span);
+    } else
+        return false;
+
+    // This transaction runs the first part, and each other part runs on a
+    // pooled connection that is free right now: waiting for one could
+    // deadlock, since this transaction may be holding the last one
+    std::vector<std::shared_ptr<v7::Transaction>> transactions;
+    transactions.push_back(tr);
+    while (transactions.size() < count)
+    {
+        auto ptr = tr->db->try_snapshot_transaction(snapshot);
+        if (!ptr) break;
+        transactions.emplace_back(ptr);
+    }
+    count = transactions.size();
+    if (count < 2) return false;
+
+    std::vector<QueryPart> parts(count);
+    if (stations.size() > 1)
+    {
+        for (unsigned i = 0; i < count; ++i)
+        {
+            parts[i].id_station_min = stations[i * stations.size() / count];
+            parts[i].id_station_max = stations[(i + 1) * stations.size() / count - 1];
+        }
+    } else {
+        long long begin = to_seconds(query.dtrange.min);
+        long long span = to_seconds(query.dtrange.max) - begin + 1;
+        for (unsigned i = 0; i < count; ++i)
+            parts[i].dtrange = DatetimeRange(
+                    from_seconds(begin + i * span / count),
+                    from_seconds(begin + (i + 1) * span / count - 1));
+    }
+
+    bool last = qb.modifiers & DBA_DB_MODIFIER_LAST;
+    core::parallel_for(parts.size(), 1, [&](size_t begin, size_t end) {
+        Tracer<> ptrc(nullptr);
+        for (size_t i = begin; i < end; ++i)
+        {
+            std::shared_ptr<v7::Transaction> ptr = transactions[i];
+            QueryPart& part = parts[i];
+            core::Query pq(query);
+            if (!part.dtrange.is_missing())
+                pq.dtrange = part.dtrange;
+            DataQueryBuilder pqb(ptr, pq, qb.modifiers, false);
+            pqb.id_station_min = part.id_station_min;
+            pqb.id_station_max = part.id_station_max;
+            pqb.build();
+            ptr->data().run_data_query(ptrc, pqb, [&](const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var) {
+                if (last)
+                {
+                    if (!add_to_last_results(part.results, station, id_levtr, datetime, id_data, move(var)))
+                        return;
+                } else
+                    part.results.emplace_back(station, id_levtr, datetime, id_data, std::move(var));
+                part.ids.insert(id_levtr);
+            });
+        }
+    }, parts.size());
+
+    for (size_t i = 1; i < transactions.size(); ++i)
+        transactions[i]->rollback();
+
+    results.clear();
+    std::set<int> ids;
+    for (auto& part: parts)
+    {
+        std::move(part.results.begin(), part.results.end(), std::back_inserter(results));
+        ids.insert(part.ids.begin(), part.ids.end());
+    }
+    at_start = true;
+
+    tr->levtr().prefetch_ids(trc, ids);
+    return true;
+}
+
+void Data::load_cached(const CachedData& cached)
+{
+    results.clear();
+    for (size_t i = 0; i < cached.size(); ++i)
+        results.emplace_back(cached.stations[cached.station[i]], cached.id_levtr[i], cached.datetime[i], cached.id_data[i],
+                std::unique_ptr<wreport::Var>(new Var(cached.values[i])));
+    at_start = true;
+
+    tr->levtr().load_cache(cached.levtr);
+}
+
+std::shared_ptr<const CachedData> Data::to_cached() const
+{
+    auto res = std::make_shared<CachedData>();
+    std::unordered_map<int, unsigned> stations;
+    std::set<int> ids;
+    res->station.reserve(results.size());
+    res->id_levtr.reserve(results.size());
+    res->datetime.reserve(results.size());
+    res->id_data.reserve(results.size());
+    res->values.reserve(results.size());
+    for (const auto& row: results)
+    {
+        auto s = stations.emplace(row.station.id, res->stations.size());
+        if (s.second)
+            res->stations.push_back(row.station);
+        res->station.push_back(s.first->second);
+        res->id_levtr.push_back(row.id_levtr);
+        res->datetime.push_back(row.datetime);
+        res->id_data.push_back(row.value.data_id);
+        res->values.push_back(*row.value);
+        ids.insert(row.id_levtr);
+    }
+    for (auto id: ids)
+        res->levtr.push_back(tr->levtr().lookup_cache(id));
+    return res;
+}
+
 void Data::query_attrs(std::function<void(std::unique_ptr<wreport::Var>)> dest, bool force_read)
 {
     if (!force_read && with_attributes)
@@ -295,7 +473,7 @@ std::shared_ptr<dballe::CursorStation> run_station_query(Tracer<>& trc, std::sha
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->connection().explain(qb.sql_query, stderr);
     }
 
     auto res = std::make_shared<Stations>(tr);
@@ -312,7 +490,7 @@ std::shared_ptr<dballe::CursorStationData> run_station_data_query(Tracer<>& trc,
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->connection().explain(qb.sql_query, stderr);
     }
 
     if (modifiers & (DBA_DB_MODIFIER_BEST | DBA_DB_MODIFIER_LAST))
@@ -331,22 +509,44 @@ std::shared_ptr<dballe::CursorStationData> run_station_data_query(Tracer<>& trc,
 std::shared_ptr<dballe::CursorData> run_data_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr, const core::Query& q, bool explain)
 {
     unsigned int modifiers = q.get_modifiers();
+
+    // Cached results are only valid for transactions that did not change the
+    // database
+    std::string cache_key;
+    if (tr->db->query_cache && !tr->data_written())
+    {
+        cache_key = QueryCache::make_key(q, modifiers);
+        if (auto cached = tr->db->query_cache->get(cache_key, tr->data_generation))
+        {
+            auto res = std::make_shared<Data>(tr, modifiers & DBA_DB_MODIFIER_WITH_ATTRIBUTES);
+            res->load_cached(*cached);
+            return res;
+        }
+    }
+
     DataQueryBuilder qb(tr, q, modifiers, false);
     qb.build();
 
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->connection().explain(qb.sql_query, stderr);
     }
 
     auto res = std::make_shared<Data>(qb, modifiers & DBA_DB_MODIFIER_WITH_ATTRIBUTES);
-    if (modifiers & DBA_DB_MODIFIER_BEST)
+    if ((modifiers & DBA_DB_MODIFIER_PARALLEL) && res->load_parallel(trc, qb))
+        ;
+    else if (modifiers & DBA_DB_MODIFIER_BEST)
         res->load_best(trc, qb);
     else if (modifiers & DBA_DB_MODIFIER_LAST)
         res->load_last(trc, qb);
     else
         res->load(trc, qb);
+
+    // Only store results read at the current generation, as they may be stale
+    // if changes were committed after the transaction started
+    if (!cache_key.empty() && tr->data_generation == tr->db->data_generation)
+        tr->db->query_cache->put(cache_key, tr->data_generation, res->to_cached());
     return res;
 }
 
@@ -362,7 +562,7 @@ std::shared_ptr<dballe::CursorSummary> run_summary_query(Tracer<>& trc, std::sha
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->connection().explain(qb.sql_query, stderr);
     }
 
     auto res = std::make_shared<Summary>(tr);
@@ -382,12 +582,32 @@ void run_delete_query(Tracer<>& trc, std::shared_ptr<v7::Transaction> tr, const
     if (explain)
     {
         fprintf(stderr, "EXPLAIN "); q.print(stderr);
-        tr->db->conn->explain(qb.sql_query, stderr);
+        tr->connection().explain(qb.sql_query, stderr);
     }
 
     if (station_vars)
         tr->station_data().remove(trc, qb);
-    else
+    else if (tr->summary_table || tr->recording_changes())
+    {
+        // Collect the summary rows affected by the delete, so that they can be
+        // recomputed afterwards. Ignoring attr_filter selects a superset of the
+        // rows to delete, which is harmless
+        core::Query keys_query(q);
+        keys_query.attr_filter.clear();
+        keys_query.limit = MISSING_INT;
+        SummaryQueryBuilder keys_qb(tr, keys_query, DBA_DB_MODIFIER_UNSORTED, false);
+        keys_qb.build();
+        std::vector<SummaryTableRow> keys;
+        tr->data().run_summary_query(trc, keys_qb, [&](const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t count) {
+            keys.emplace_back(station.id, id_levtr, code);
+        });
+
+        tr->data().remove(trc, qb);
+        if (tr->summary_table)
+            tr->driver().summary_refresh_v7(keys);
+        if (tr->recording_changes())
+            tr->record_removed(keys);
+    } else
         tr->data().remove(trc, qb);
 }
 
@@ -262,17 +262,35 @@ protected:
 
     /// Append or replace the last result according to priority. Returns false if the value has been ignored.
     bool add_to_best_results(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var);
-    /// Append or replace the last result according to datetime. Returns false if the value has been ignored.
-    bool add_to_last_results(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var);
+    /// Append or replace the last result in dest according to datetime. Returns false if the value has been ignored.
+    static bool add_to_last_results(std::deque<DataRow>& dest, const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var);
 
     void load(Tracer<>& trc, const DataQueryBuilder& qb);
     void load_best(Tracer<>& trc, const DataQueryBuilder& qb);
     void load_last(Tracer<>& trc, const DataQueryBuilder& qb);
 
+    /**
+     * Split the query in parts by station or datetime, and run them
+     * concurrently on this transaction and on free pooled connections that
+     * share its snapshot of the database.
+     *
+     * Returns false without loading anything if the query cannot be split,
+     * if the database cannot share snapshots between connections, or if no
+     * pooled connection is free.
+     */
+    bool load_parallel(Tracer<>& trc, const DataQueryBuilder& qb);
+
+    /// Load results from the query cache
+    void load_cached(const CachedData& cached);
+
+    /// Copy the results to store them in the query cache
+    std::shared_ptr<const CachedData> to_cached() const;
+
 public:
     bool with_attributes;
 
     Data(DataQueryBuilder& qb, bool with_attributes);
+    Data(std::shared_ptr<v7::Transaction> tr, bool with_attributes);
 
     std::shared_ptr<dballe::db::Transaction> get_transaction() const override { return tr; }
 
@@ -1,6 +1,10 @@
 #include "data.h"
 #include "dballe/types.h"
 #include "dballe/values.h"
+#include "dballe/var.h"
+#include "dballe/core/values.h"
+#include "dballe/core/varmatch.h"
+#include "dballe/core/parallel.h"
 #include <algorithm>
 #include <cstring>
 
@@ -67,6 +71,63 @@ template class DataCommon<StationDataTraits>;
 template class DataCommon<DataTraits>;
 
 
+AttrFilterMatcher::AttrFilterMatcher(const Varmatch& match)
+    : match(match)
+{
+}
+
+void AttrFilterMatcher::add(int id, std::vector<uint8_t>&& attrs)
+{
+    pending_ids.push_back(id);
+    pending_attrs.emplace_back(move(attrs));
+    if (pending_ids.size() >= batch_size)
+        flush();
+}
+
+void AttrFilterMatcher::flush()
+{
+    if (pending_ids.empty()) return;
+
+    // Make sure the B table is loaded before looking up varinfos from
+    // multiple threads
+    varinfo(match.code);
+
+    std::vector<char> matched(pending_ids.size(), 0);
+    core::parallel_for(pending_attrs.size(), 512, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i)
+            matched[i] = core::value::Decoder::match_attrs(pending_attrs[i], match);
+    });
+
+    for (size_t i = 0; i < pending_ids.size(); ++i)
+        if (matched[i])
+            ids.push_back(pending_ids[i]);
+
+    pending_ids.clear();
+    pending_attrs.clear();
+}
+
+void AttrFilterMatcher::foreach_chunk(size_t chunk_size, std::function<void(const std::string& id_list, unsigned count)> dest) const
+{
+    std::string id_list;
+    unsigned count = 0;
+    char buf[16];
+    for (auto id: ids)
+    {
+        if (count) id_list += ',';
+        snprintf(buf, 16, "%d", id);
+        id_list += buf;
+        if (++count == chunk_size)
+        {
+            dest(id_list, count);
+            id_list.clear();
+            count = 0;
+        }
+    }
+    if (count)
+        dest(id_list, count);
+}
+
+
 StationDataDumper::StationDataDumper(FILE* out)
     : out(out)
 {
@@ -3,6 +3,7 @@
 
 #include <dballe/fwd.h>
 #include <dballe/values.h>
+#include <dballe/types.h>
 #include <dballe/core/fwd.h>
 #include <dballe/core/defs.h>
 #include <dballe/sql/fwd.h>
@@ -97,6 +98,40 @@ public:
 };
 
 
+/**
+ * Select the IDs of the rows whose encoded attributes match an attr_filter.
+ *
+ * Rows are buffered and matched in parallel, batch_size at a time. The IDs of
+ * the matching rows are collected in ids, so that they can be deleted in bulk
+ * once the query that produced them has been fully read.
+ */
+struct AttrFilterMatcher
+{
+    const Varmatch& match;
+    /// IDs of the rows that matched
+    std::vector<int> ids;
+    /// Number of rows to buffer before matching them
+    size_t batch_size = 8192;
+
+    AttrFilterMatcher(const Varmatch& match);
+
+    /// Add a row to match
+    void add(int id, std::vector<uint8_t>&& attrs);
+
+    /// Match all buffered rows
+    void flush();
+
+    /**
+     * Call dest on consecutive chunks of the matched IDs, formatted as comma
+     * separated lists of at most chunk_size elements
+     */
+    void foreach_chunk(size_t chunk_size, std::function<void(const std::string& id_list, unsigned count)> dest) const;
+
+protected:
+    std::vector<int> pending_ids;
+    std::vector<std::vector<uint8_t>> pending_attrs;
+};
+
 struct StationDataDumper
 {
     unsigned count = 0;
@@ -133,6 +168,22 @@ struct DataTraits
     static const char* table_name;
 };
 
+/**
+ * Row of the summary table: number of values and datetime range of the time
+ * series of a (station, level/time range, varcode) combination
+ */
+struct SummaryTableRow
+{
+    int id_station;
+    int id_levtr;
+    wreport::Varcode code;
+    size_t count = 0;
+    DatetimeRange datetime;
+
+    SummaryTableRow(int id_station, int id_levtr, wreport::Varcode code)
+        : id_station(id_station), id_levtr(id_levtr), code(code) {}
+};
+
 extern template class DataCommon<StationDataTraits>;
 extern template class DataCommon<DataTraits>;
 
@@ -1,12 +1,13 @@
 #include "db.h"
 #include "dballe/sql/sql.h"
-#include "dballe/sql/querybuf.h"
 #include "dballe/db/v7/transaction.h"
 #include "dballe/db/v7/driver.h"
 #include "dballe/db/v7/repinfo.h"
 #include "dballe/db/v7/station.h"
 #include "dballe/db/v7/levtr.h"
 #include "dballe/db/v7/data.h"
+#include "dballe/db/v7/pool.h"
+#include "dballe/db/v7/querycache.h"
 #include "cursor.h"
 #include "dballe/core/query.h"
 #include "dballe/types.h"
@@ -19,7 +20,6 @@
 using namespace std;
 using namespace wreport;
 using dballe::sql::Connection;
-using dballe::sql::Querybuf;
 
 namespace dballe {
 namespace db {
@@ -27,7 +27,7 @@ namespace v7 {
 
 // First part of initialising a dba_db
 DB::DB(shared_ptr<Connection> conn)
-    : conn(conn), m_driver(v7::Driver::create(*this->conn).release())
+    : conn(conn), data_generation(0), m_driver(v7::Driver::create(*this->conn).release())
 {
     if (getenv("DBA_EXPLAIN") != NULL)
         explain_queries = true;
@@ -41,6 +41,7 @@ DB::DB(shared_ptr<Connection> conn)
 
     auto trc = trace->trace_connect(this->conn->get_url());
 
+
     /* Set the connection timeout */
     /* SQLSetConnectAttr(pc.od_conn, SQL_LOGIN_TIMEOUT, (SQLPOINTER *)5, 0); */
 }
@@ -59,19 +60,51 @@ v7::Driver& DB::driver()
 
 std::shared_ptr<dballe::Transaction> DB::transaction(bool readonly)
 {
+    if (readonly && pool)
+    {
+        auto pooled = pool->acquire();
+        auto res = pooled->conn->transaction(true);
+        std::lock_guard<std::mutex> lock(transaction_mutex);
+        return make_shared<v7::Transaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res), true, pooled);
+    }
+    std::lock_guard<std::mutex> lock(transaction_mutex);
     auto res = conn->transaction(readonly);
-    return make_shared<v7::Transaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res));
+    return make_shared<v7::Transaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res), readonly);
+}
+
+std::shared_ptr<v7::Transaction> DB::try_snapshot_transaction(const std::string& snapshot)
+{
+    if (!pool) return nullptr;
+    auto pooled = pool->try_acquire();
+    if (!pooled) return nullptr;
+    auto res = pooled->conn->transaction(true);
+    pooled->conn->import_snapshot(snapshot);
+    std::lock_guard<std::mutex> lock(transaction_mutex);
+    return make_shared<v7::Transaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res), true, pooled);
+}
+
+void DB::open_pool(unsigned size)
+{
+    pool = make_shared<v7::ConnectionPool>(*conn, size);
+    shared_cache.reset(new v7::SharedCache);
+}
+
+void DB::enable_query_cache(size_t max_memory)
+{
+    query_cache.reset(new v7::QueryCache(max_memory));
 }
 
 std::shared_ptr<dballe::db::Transaction> DB::test_transaction(bool readonly)
 {
     auto res = conn->transaction(readonly);
-    return make_shared<v7::TestTransaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res));
+    return make_shared<v7::TestTransaction>(dynamic_pointer_cast<v7::DB>(shared_from_this()), move(res), readonly);
 }
 
 void DB::delete_tables()
 {
     m_driver->delete_tables_v7();
+    if (shared_cache) shared_cache->invalidate();
+    ++data_generation;
 }
 
 void DB::disappear()
@@ -79,6 +112,8 @@ void DB::disappear()
     // TODO: track open trasnsactions with weak pointers and roll them all
     // back, or raise errors if some of them have not been fired yet?
     m_driver->delete_tables_v7();
+    if (shared_cache) shared_cache->invalidate();
+    ++data_generation;
 }
 
 void DB::reset(const char* repinfo_file)
@@ -100,6 +135,88 @@ void DB::vacuum()
     auto t = conn->transaction();
     driver().vacuum_v7();
     t->commit();
+    if (shared_cache) shared_cache->invalidate();
+}
+
+unsigned DB::purge_before(const Datetime& dt, unsigned batch_size)
+{
+    auto trc = trace->trace_purge(dt);
+
+    // Walk the data table by primary key, so that each batch is an index
+    // range scan and each transaction touches at most batch_size rows. Batch
+    // bounds come from the rows to delete, so gaps in the ids do not cost
+    // empty batches.
+    if (batch_size == 0) batch_size = 1;
+    unsigned count = 0;
+    int last_id = 0;
+    while (true)
+    {
+        auto t = conn->transaction();
+        int batch_last;
+        if (!driver().data_next_batch_v7(dt, last_id, batch_size, batch_last))
+        {
+            t->commit();
+            break;
+        }
+        count += purge_data(dt, last_id + 1, batch_last);
+        t->commit();
+        last_id = batch_last;
+    }
+
+    // Remove stations and levtr entries left without data
+    {
+        auto t = conn->transaction();
+        driver().vacuum_v7();
+        t->commit();
+    }
+    if (shared_cache) shared_cache->invalidate();
+    ++data_generation;
+
+    driver().compact_v7();
+    return count;
+}
+
+unsigned DB::purge_data(const Datetime& until, int id_first, int id_last)
+{
+    if (!conn->has_table("summary"))
+        return driver().purge_data_v7(until, id_first, id_last);
+
+    std::vector<SummaryTableRow> keys;
+    driver().data_keys_v7(id_first, id_last, until, keys);
+    unsigned count = driver().purge_data_v7(until, id_first, id_last);
+    driver().summary_refresh_v7(keys);
+    return count;
+}
+
+unsigned DB::upgrade_attrs(unsigned batch_size)
+{
+    if (batch_size == 0) batch_size = 1;
+    unsigned count = 0;
+    for (const char* table: { "station_data", "data" })
+    {
+        int last_id = 0;
+        while (true)
+        {
+            auto t = conn->transaction();
+            bool found = driver().upgrade_attrs_v7(table, batch_size, last_id, count);
+            t->commit();
+            if (!found) break;
+        }
+    }
+    return count;
+}
+
+void DB::set_summary_table(bool enabled)
+{
+    auto t = conn->transaction();
+    if (enabled != conn->has_table("summary"))
+    {
+        if (enabled)
+            driver().create_summary_v7();
+        else
+            driver().drop_summary_v7();
+    }
+    t->commit();
 }
 
 }
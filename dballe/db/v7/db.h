@@ -9,6 +9,8 @@
 #include <wreport/varinfo.h>
 #include <string>
 #include <memory>
+#include <mutex>
+#include <atomic>
 
 namespace dballe {
 namespace db {
@@ -26,13 +28,33 @@ public:
     Trace* trace = nullptr;
     /// True if we print an EXPLAIN trace of all queries to stderr
     bool explain_queries = false;
+    /// Read-only connections used by concurrent read-only transactions
+    std::shared_ptr<v7::ConnectionPool> pool;
+    /// Caches shared between transactions, used when a pool is open
+    std::unique_ptr<v7::SharedCache> shared_cache;
+    /// Cache of data query results, if enabled
+    std::unique_ptr<v7::QueryCache> query_cache;
+    /**
+     * Incremented every time committed changes may have modified the data in
+     * the database
+     */
+    std::atomic<unsigned> data_generation;
 
 protected:
     /// SQL driver backend
     v7::Driver* m_driver;
 
+    /// Serialize the creation of transactions from multiple threads
+    std::mutex transaction_mutex;
+
     void init_after_connect();
 
+    /**
+     * Delete the data with datetime earlier than until and id between id_first
+     * and id_last, keeping the summary table up to date
+     */
+    unsigned purge_data(const Datetime& until, int id_first, int id_last);
+
 public:
     DB(std::shared_ptr<dballe::sql::Connection> conn);
     virtual ~DB();
@@ -42,9 +64,51 @@ public:
     /// Access the backend DB driver
     v7::Driver& driver();
 
+    /**
+     * Start a transaction.
+     *
+     * If a connection pool is open, read-only transactions run on a pooled
+     * connection, and can be used concurrently from different threads. If
+     * all pooled connections are in use, this waits until one is released.
+     * Transactions that write use the main connection, and only one of them
+     * can be active at a time.
+     */
     std::shared_ptr<dballe::Transaction> transaction(bool readonly=false) override;
     std::shared_ptr<dballe::db::Transaction> test_transaction(bool readonly=false) override;
 
+    /**
+     * Start a read-only transaction on a free pooled connection, seeing the
+     * snapshot exported by another transaction with
+     * sql::Connection::export_snapshot().
+     *
+     * Returns nullptr without waiting if there is no pool, or if all its
+     * connections are in use.
+     */
+    std::shared_ptr<v7::Transaction> try_snapshot_transaction(const std::string& snapshot);
+
+    /**
+     * Open \a size read-only connections to the database, and use them for
+     * read-only transactions.
+     *
+     * Level/time range and repinfo information is then loaded once and shared
+     * between transactions, and reloaded only after a transaction commits
+     * changes: this assumes that the database is not modified by other
+     * processes while the pool is open.
+     *
+     * For SQLite databases, this switches the database to WAL journaling.
+     * Pools are not supported on in-memory databases.
+     */
+    void open_pool(unsigned size);
+
+    /**
+     * Cache the results of data queries, using up to \a max_memory bytes.
+     *
+     * Cached results are dropped when a transaction commits changes to the
+     * data: this assumes that the database is not modified by other processes
+     * while the cache is enabled.
+     */
+    void enable_query_cache(size_t max_memory);
+
     void disappear();
 
     /**
@@ -76,6 +140,10 @@ public:
      */
     void vacuum();
 
+    unsigned purge_before(const Datetime& dt, unsigned batch_size=10000) override;
+    unsigned upgrade_attrs(unsigned batch_size=10000) override;
+    void set_summary_table(bool enabled) override;
+
     friend class dballe::DB;
     friend class dballe::db::v7::Transaction;
 };
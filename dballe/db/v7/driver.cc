@@ -1,7 +1,10 @@
 #include "driver.h"
 #include "config.h"
 #include "dballe/db/v7/sqlite/driver.h"
+#include "dballe/db/v7/memory/driver.h"
+#include "dballe/db/v7/memory/connection.h"
 #include "dballe/sql/sqlite.h"
+#include "dballe/sql/querybuf.h"
 #ifdef HAVE_LIBPQ
 #include "dballe/db/v7/postgresql/driver.h"
 #include "dballe/sql/postgresql.h"
@@ -58,18 +61,53 @@ void Driver::remove_all(db::Format format)
 
 void Driver::remove_all_v7()
 {
+    if (connection.has_table("summary"))
+        connection.execute("DELETE FROM summary");
     connection.execute("DELETE FROM station_data");
     connection.execute("DELETE FROM data");
     connection.execute("DELETE FROM levtr");
     connection.execute("DELETE FROM station");
 }
 
+void Driver::compact_v7()
+{
+}
+
+void Driver::drop_summary_v7()
+{
+    connection.execute("DROP TABLE IF EXISTS summary");
+}
+
+void Driver::data_keys_v7(int id_first, int id_last, const Datetime& until, std::vector<SummaryTableRow>& keys)
+{
+    sql::Querybuf where;
+    where.appendf("id BETWEEN %d AND %d", id_first, id_last);
+    if (!until.is_missing())
+    {
+        where.append(" AND datetime < ");
+        connection.add_datetime(where, until);
+    }
+    summary_keys_v7(where, keys);
+}
+
+void Driver::fill_summary_v7()
+{
+    connection.execute(R"(
+        INSERT INTO summary (id_station, id_levtr, code, count, dtmin, dtmax)
+             SELECT id_station, id_levtr, code, COUNT(1), MIN(datetime), MAX(datetime)
+               FROM data
+           GROUP BY id_station, id_levtr, code
+    )");
+}
+
 std::unique_ptr<Driver> Driver::create(dballe::sql::Connection& conn)
 {
     using namespace dballe::sql;
 
     if (SQLiteConnection* c = dynamic_cast<SQLiteConnection*>(&conn))
         return unique_ptr<Driver>(new sqlite::Driver(*c));
+    else if (memory::MemoryConnection* c = dynamic_cast<memory::MemoryConnection*>(&conn))
+        return unique_ptr<Driver>(new memory::Driver(*c));
 #ifdef HAVE_LIBPQ
     else if (PostgreSQLConnection* c = dynamic_cast<PostgreSQLConnection*>(&conn))
         return unique_ptr<Driver>(new postgresql::Driver(*c));
@@ -86,7 +124,7 @@ std::unique_ptr<Driver> Driver::create(dballe::sql::Connection& conn)
 #ifdef HAVE_MYSQL
                 "MySQL, "
 #endif
-                "SQLite connectors");
+                "SQLite and in-memory connectors");
 }
 
 }
@@ -60,8 +60,101 @@ public:
     /// Perform database cleanup/maintenance on v7 databases
     virtual void vacuum_v7() = 0;
 
+    /**
+     * Read the lowest and highest id in the data table.
+     *
+     * @return false if the data table is empty
+     */
+    virtual bool data_id_range_v7(int& id_min, int& id_max) = 0;
+
+    /**
+     * Find the next batch of rows of the data table with datetime earlier
+     * than until.
+     *
+     * The batch is made of the first batch_size such rows, in id order,
+     * with id greater than last_id.
+     *
+     * @param batch_last
+     *   Set to the id of the last row in the batch
+     * @return false if there are no more rows to examine
+     */
+    virtual bool data_next_batch_v7(const Datetime& until, int last_id, unsigned batch_size, int& batch_last) = 0;
+
+    /**
+     * Delete the rows of the data table with id between id_first and id_last
+     * (inclusive) and datetime earlier than until.
+     *
+     * @return the number of rows deleted
+     */
+    virtual unsigned purge_data_v7(const Datetime& until, int id_first, int id_last) = 0;
+
+    /**
+     * Reencode with the current attribute encoding the attributes of up to
+     * batch_size rows of the given table ("station_data" or "data") with id
+     * greater than last_id.
+     *
+     * @param last_id
+     *   Set to the id of the last row examined
+     * @param rewritten
+     *   Incremented with the number of rows whose attributes have been
+     *   reencoded
+     * @return false if there were no more rows to examine
+     */
+    virtual bool upgrade_attrs_v7(const char* table, unsigned batch_size, int& last_id, unsigned& rewritten) = 0;
+
+    /**
+     * Create the summary table and fill it with the contents of the data
+     * table.
+     *
+     * The summary table has a row for each (station, level/time range,
+     * varcode) combination found in the data table, with the number of values
+     * and their minimum and maximum datetime.
+     */
+    virtual void create_summary_v7() = 0;
+
+    /// Drop the summary table, if it exists
+    virtual void drop_summary_v7();
+
+    /**
+     * Merge into the summary table the counts and datetime ranges of newly
+     * inserted values
+     */
+    virtual void summary_add_v7(const std::vector<SummaryTableRow>& rows) = 0;
+
+    /**
+     * Append to keys the (station, level/time range, varcode) combinations of
+     * the rows of the data table matching the SQL condition in where
+     */
+    virtual void summary_keys_v7(const std::string& where, std::vector<SummaryTableRow>& keys) = 0;
+
+    /**
+     * Append to keys the (station, level/time range, varcode) combinations of
+     * the rows of the data table with id between id_first and id_last
+     * (inclusive) and, if until is not missing, datetime earlier than until.
+     *
+     * The default implementation uses summary_keys_v7.
+     */
+    virtual void data_keys_v7(int id_first, int id_last, const Datetime& until, std::vector<SummaryTableRow>& keys);
+
+    /**
+     * Recompute from the data table the summary table rows for the given
+     * (station, level/time range, varcode) combinations
+     */
+    virtual void summary_refresh_v7(const std::vector<SummaryTableRow>& keys) = 0;
+
+    /**
+     * Return to the filesystem the space freed by deleting data, if the
+     * backend supports doing it cheaply. It is called outside of a
+     * transaction.
+     */
+    virtual void compact_v7();
+
     /// Create a Driver for this connection
     static std::unique_ptr<Driver> create(dballe::sql::Connection& conn);
+
+protected:
+    /// Fill an empty summary table with the contents of the data table
+    void fill_summary_v7();
 };
 
 }
@@ -126,7 +126,7 @@ std::shared_ptr<dballe::CursorMessage> Transaction::query_messages(const Query&
     if (db->explain_queries)
     {
         fprintf(stderr, "EXPLAIN "); query.print(stderr);
-        db->conn->explain(qb.sql_query, stderr);
+        connection().explain(qb.sql_query, stderr);
     }
 
     // Retrieve results, buffering them locally to avoid performing concurrent
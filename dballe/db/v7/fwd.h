@@ -18,6 +18,12 @@ struct LevTr;
 struct LevTrEntry;
 struct SQLTrace;
 struct Driver;
+struct SummaryTableRow;
+struct PooledConnection;
+class ConnectionPool;
+class SharedCache;
+struct CachedData;
+class QueryCache;
 
 namespace cursor {
 struct Stations;
@@ -1,5 +1,6 @@
 #include "levtr.h"
 #include "dballe/msg/msg.h"
+#include <algorithm>
 
 using namespace std;
 
@@ -16,6 +17,31 @@ void LevTr::clear_cache()
     cache.clear();
 }
 
+void LevTr::load_cache(const std::vector<LevTrEntry>& entries)
+{
+    for (const auto& e: entries)
+        cache.insert(e);
+}
+
+std::vector<LevTrEntry> LevTr::cached_entries() const
+{
+    std::vector<LevTrEntry> res;
+    res.reserve(cache.by_id.size());
+    for (const auto& i: cache.by_id)
+        res.push_back(*i.second);
+    std::sort(res.begin(), res.end(), [](const LevTrEntry& a, const LevTrEntry& b) { return a.id < b.id; });
+    return res;
+}
+
+std::set<int> LevTr::uncached_ids(const std::set<int>& ids) const
+{
+    std::set<int> res;
+    for (auto id: ids)
+        if (!cache.find_entry(id))
+            res.insert(id);
+    return res;
+}
+
 const LevTrEntry& LevTr::lookup_cache(int id)
 {
     const LevTrEntry* res = cache.find_entry(id);
@@ -7,6 +7,7 @@
 #include <dballe/msg/fwd.h>
 #include <memory>
 #include <set>
+#include <vector>
 #include <cstdio>
 #include <functional>
 
@@ -24,6 +25,9 @@ protected:
     LevTrCache cache;
     virtual void _dump(std::function<void(int, const Level&, const Trange&)> out) = 0;
 
+    /// Return the ids in \a ids that are not in the cache
+    std::set<int> uncached_ids(const std::set<int>& ids) const;
+
 public:
     LevTr(v7::Transaction& tr);
     virtual ~LevTr();
@@ -36,6 +40,12 @@ public:
      */
     void clear_cache();
 
+    /// Add the given entries to the cache
+    void load_cache(const std::vector<LevTrEntry>& entries);
+
+    /// Return a copy of the cached entries, sorted by id
+    std::vector<LevTrEntry> cached_entries() const;
+
     /**
      * Given a set of IDs, load LevTr information for them and add it to the cache.
      */
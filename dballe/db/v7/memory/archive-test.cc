@@ -0,0 +1,176 @@
+#include "dballe/db/tests.h"
+#include "dballe/db/v7/db.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/core/values.h"
+#include "archive.h"
+#include "connection.h"
+#include <unistd.h>
+
+using namespace dballe;
+using namespace dballe::db;
+using namespace dballe::tests;
+using namespace wreport;
+using namespace std;
+
+namespace {
+
+/// Format all data in a database as a string, one value per line
+std::string contents(dballe::DB& db)
+{
+    std::string res;
+    core::Query query;
+    query.query = "attrs";
+    auto tr = db.transaction();
+
+    auto sd = tr->query_station_data(query);
+    while (sd->next())
+    {
+        Var var = sd->get_var();
+        std::string line = sd->get_station().to_string() + " " + var.format();
+        for (const Var* a = var.next_attr(); a; a = a->next_attr())
+            line += " " + a->format();
+        res += line + "\n";
+    }
+
+    auto d = tr->query_data(query);
+    while (d->next())
+    {
+        Var var = d->get_var();
+        std::string line = d->get_station().to_string() + " " + d->get_level().to_string() + " "
+            + d->get_trange().to_string() + " " + d->get_datetime().to_string() + " " + var.format();
+        for (const Var* a = var.next_attr(); a; a = a->next_attr())
+            line += " " + a->format();
+        res += line + "\n";
+    }
+
+    tr->rollback();
+    return res;
+}
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override;
+} tests("db_v7_memory_archive");
+
+void Tests::register_tests() {
+
+add_method("roundtrip", [] {
+    auto mem = db::DB::connect_memory();
+    OldDballeTestDataSet data;
+    wassert(data.populate_db(*mem));
+
+    {
+        auto tr = dynamic_pointer_cast<db::Transaction>(mem->transaction());
+        core::Query query;
+        query.varcodes.insert(WR_VAR(0, 1, 12));
+        auto cur = tr->query_data(query);
+        wassert_true(cur->next());
+        Values attrs;
+        attrs.set("B33007", 50);
+        tr->attr_insert_data(dynamic_pointer_cast<db::CursorData>(cur)->attr_reference_id(), attrs);
+        cur->discard();
+        tr->commit();
+    }
+
+    const std::string pathname = "test-archive.arc";
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(mem->transaction());
+        wassert(db::v7::memory::write_archive(*tr, core::Query(), pathname));
+        tr->rollback();
+    }
+
+    auto arc = dballe::DB::connect(*DBConnectOptions::create("arc:" + pathname));
+    wassert(actual(contents(*arc)) == contents(*mem));
+
+    // Station queries and summaries work on the archive
+    auto tr = arc->transaction();
+    auto stations = tr->query_stations(core::Query());
+    wassert(actual(stations->remaining()) == 2);
+    core::Query query;
+    query.report = "synop";
+    auto summary = tr->query_summary(query);
+    wassert(actual(summary->remaining()) == 2);
+
+    // Archives are read-only
+    auto msgs = read_msgs("bufr/obs0-1.22.bufr", Encoding::BUFR);
+    wassert(actual_function([&] { tr->import_message(*msgs[0], DBImportOptions::defaults); }).throws("cannot modify an archive database: archives are read-only"));
+    tr->rollback();
+
+    ::unlink(pathname.c_str());
+});
+
+add_method("lazy", [] {
+    auto mem = db::DB::connect_memory();
+    TestDataSet data;
+    data.stations["s1"].station.report = "synop";
+    data.stations["s1"].station.coords = Coords(12.34560, 76.54320);
+    data.stations["s2"].station.report = "metar";
+    data.stations["s2"].station.coords = Coords(23.45670, 65.43210);
+    data.data["old"].station = data.stations["s1"].station;
+    data.data["old"].level = Level(1);
+    data.data["old"].trange = Trange::instant();
+    data.data["old"].datetime = Datetime(1945, 4, 25, 8);
+    data.data["old"].values.set("B12101", 270.15);
+    data.data["old"].values.set("B13011", 1.5);
+    data.data["new"].station = data.stations["s2"].station;
+    data.data["new"].level = Level(1);
+    data.data["new"].trange = Trange::instant();
+    data.data["new"].datetime = Datetime(2015, 4, 25, 8);
+    data.data["new"].values.set("B12101", 290.15);
+    wassert(data.populate_db(*mem));
+
+    const std::string pathname = "test-archive-lazy.arc";
+    {
+        auto tr = dynamic_pointer_cast<db::v7::Transaction>(mem->transaction());
+        wassert(db::v7::memory::write_archive(*tr, core::Query(), pathname));
+        tr->rollback();
+    }
+
+    auto arc = dballe::DB::connect(*DBConnectOptions::create("arc:" + pathname));
+    auto conn = dynamic_pointer_cast<db::v7::memory::MemoryConnection>(dynamic_pointer_cast<db::v7::DB>(arc)->conn);
+    const auto& table = conn->store.data;
+    wassert(actual(table.size()) == 0u);
+
+    auto tr = arc->transaction();
+
+    // Only the series in the queried datetime range are loaded
+    core::Query query;
+    query.dtrange.min = Datetime(2000, 1, 1);
+    auto cur = tr->query_data(query);
+    wassert(actual(cur->remaining()) == 1);
+    wassert_true(cur->next());
+    wassert(actual(cur->get_var().enqd()) == 290.15);
+    wassert(actual(table.size()) == 1u);
+
+    // Summaries load the series without decoding their values
+    query.clear();
+    query.varcodes.insert(WR_VAR(0, 13, 11));
+    auto summary = tr->query_summary(query);
+    wassert(actual(summary->remaining()) == 1);
+    wassert(actual(table.size()) == 2u);
+    int id = *table.by_code.at(WR_VAR(0, 13, 11)).begin();
+    wassert_true(table.value[table.find(id)] == nullptr);
+    tr->rollback();
+
+    // The rest is loaded on demand
+    wassert(actual(contents(*arc)) == contents(*mem));
+    wassert(actual(table.size()) == 3u);
+
+    ::unlink(pathname.c_str());
+});
+
+add_method("errors", [] {
+    wassert(actual_function([] { dballe::DB::connect(*DBConnectOptions::create("arc:does-not-exist.arc")); }).throws("cannot open archive does-not-exist.arc"));
+
+    FILE* out = fopen("test-archive-bad.arc", "wb");
+    fputs("this is not an archive", out);
+    fclose(out);
+    wassert(actual_function([] { dballe::DB::connect(*DBConnectOptions::create("arc:test-archive-bad.arc")); }).throws("is not a DB-All.e archive"));
+    ::unlink("test-archive-bad.arc");
+});
+
+}
+
+}
@@ -0,0 +1,512 @@
+#include "archive.h"
+#include "connection.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/repinfo.h"
+#include "dballe/db/db.h"
+#include "dballe/core/query.h"
+#include "dballe/core/values.h"
+#include "dballe/core/mmap.h"
+#include "dballe/values.h"
+#include "dballe/var.h"
+#include <wreport/error.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <unistd.h>
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+
+namespace {
+
+/// Signature at the start of archive files, including the format version
+const char archive_magic[8] = { 'D', 'B', 'A', 'A', 'R', 'C', 0, 1 };
+
+/// Encode a datetime as an integer that grows with time, and that is
+/// compact to delta-encode
+int64_t encode_datetime(const Datetime& dt)
+{
+    return (int64_t)dt.to_julian() * 100000 + dt.hour * 3600 + dt.minute * 60 + dt.second;
+}
+
+Datetime decode_datetime(int64_t val)
+{
+    int sod = val % 100000;
+    return Datetime::from_julian(val / 100000, sod / 3600, (sod / 60) % 60, sod % 60);
+}
+
+/// Buffer for encoding the archive contents
+struct Encoder
+{
+    std::string buf;
+
+    void add_uint(uint64_t val)
+    {
+        while (val >= 0x80)
+        {
+            buf += (char)((val & 0x7f) | 0x80);
+            val >>= 7;
+        }
+        buf += (char)val;
+    }
+
+    void add_int(int64_t val)
+    {
+        // Zigzag encoding, to keep small negative numbers small
+        add_uint(((uint64_t)val << 1) ^ (uint64_t)(val >> 63));
+    }
+
+    void add_string(const std::string& val)
+    {
+        add_uint(val.size());
+        buf += val;
+    }
+
+    void add_bytes(const std::vector<uint8_t>& val)
+    {
+        add_uint(val.size());
+        buf.append((const char*)val.data(), val.size());
+    }
+
+    /// Encode a value with its attributes
+    void add_var(const Var& var)
+    {
+        add_string(var.enqc());
+        add_bytes(Values::encode_attrs(var));
+    }
+};
+
+/// Decoder for a memory mapped archive
+struct Decoder
+{
+    const std::string& pathname;
+    const uint8_t* cur;
+    const uint8_t* end;
+
+    Decoder(const std::string& pathname, const uint8_t* begin, const uint8_t* end)
+        : pathname(pathname), cur(begin), end(end) {}
+
+    [[noreturn]] void truncated()
+    {
+        error_consistency::throwf("%s: archive file is truncated or corrupted", pathname.c_str());
+    }
+
+    uint64_t read_uint()
+    {
+        uint64_t res = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            if (cur == end) truncated();
+            uint8_t c = *cur++;
+            res |= (uint64_t)(c & 0x7f) << shift;
+            if (!(c & 0x80)) return res;
+        }
+        truncated();
+    }
+
+    int64_t read_int()
+    {
+        uint64_t val = read_uint();
+        return (int64_t)(val >> 1) ^ -(int64_t)(val & 1);
+    }
+
+    /// Return a pointer to the next size bytes, and skip them
+    const uint8_t* read_raw(size_t size)
+    {
+        if ((size_t)(end - cur) < size) truncated();
+        const uint8_t* res = cur;
+        cur += size;
+        return res;
+    }
+
+    std::string read_string()
+    {
+        size_t size = read_uint();
+        return std::string((const char*)read_raw(size), size);
+    }
+
+    /// Decode a value with its attributes
+    std::unique_ptr<Var> read_var(Varcode code)
+    {
+        size_t size = read_uint();
+        std::string value((const char*)read_raw(size), size);
+        auto var = newvar(code, value);
+        size = read_uint();
+        if (size)
+        {
+            const uint8_t* attrs = read_raw(size);
+            core::value::Decoder::decode_attrs(std::vector<uint8_t>(attrs, attrs + size), *var);
+        }
+        return var;
+    }
+
+    /// Skip a value with its attributes
+    void skip_var()
+    {
+        read_raw(read_uint());
+        read_raw(read_uint());
+    }
+};
+
+/// Positions in the data table of the values of a time series
+struct Series
+{
+    std::vector<size_t> rows;
+    int64_t dtmin;
+    int64_t dtmax;
+};
+
+}
+
+void write_archive(v7::Transaction& tr, const core::Query& query, const std::string& pathname)
+{
+    Store store;
+
+    for (const auto& e: tr.repinfo().entries())
+    {
+        RepinfoRow row;
+        row.id = e.id;
+        row.memo = e.memo;
+        row.description = e.desc;
+        row.prio = e.prio;
+        row.descriptor = e.descriptor;
+        row.tablea = e.tablea;
+        store.repinfo.push_back(row);
+    }
+    std::sort(store.repinfo.begin(), store.repinfo.end(), [](const RepinfoRow& a, const RepinfoRow& b) { return a.id < b.id; });
+
+    core::Query all;
+    auto stations = tr.query_stations(all);
+    while (stations->next())
+    {
+        DBStation station = stations->get_station();
+        store.station.insert(station.id, tr.repinfo().get_id(station.report.c_str()), station.coords.lat, station.coords.lon, station.ident);
+    }
+
+    all.query = "attrs";
+    auto station_data = dynamic_pointer_cast<db::CursorStationData>(tr.query_station_data(all));
+    while (station_data->next())
+        store.station_data.insert(station_data->attr_reference_id(), station_data->get_station().id, std::unique_ptr<Var>(new Var(station_data->get_var())));
+
+    // Read measured values in id order, so they are appended to the table
+    core::Query q(query);
+    q.query = "attrs";
+    std::vector<std::tuple<int, int, int, Datetime, std::unique_ptr<Var>>> values;
+    auto data = dynamic_pointer_cast<db::CursorData>(tr.query_data(q));
+    while (data->next())
+    {
+        Level level = data->get_level();
+        Trange trange = data->get_trange();
+        int id_levtr = store.levtr.find_id(level, trange);
+        if (id_levtr == MISSING_INT)
+            id_levtr = store.levtr_insert(level, trange);
+        values.emplace_back(data->attr_reference_id(), data->get_station().id, id_levtr, data->get_datetime(), std::unique_ptr<Var>(new Var(data->get_var())));
+    }
+    std::sort(values.begin(), values.end(), [](const decltype(values)::value_type& a, const decltype(values)::value_type& b) {
+        return std::get<0>(a) < std::get<0>(b);
+    });
+    for (auto& v: values)
+        store.data.insert(std::get<0>(v), std::get<1>(v), std::get<2>(v), std::get<3>(v), std::move(std::get<4>(v)));
+    values.clear();
+
+    write_archive(store, pathname);
+}
+
+void write_archive(const Store& store, const std::string& pathname)
+{
+    Encoder enc;
+    enc.buf.append(archive_magic, sizeof(archive_magic));
+
+    enc.add_uint(store.repinfo.size());
+    for (const auto& row: store.repinfo)
+    {
+        enc.add_uint(row.id);
+        enc.add_string(row.memo);
+        enc.add_string(row.description);
+        enc.add_int(row.prio);
+        enc.add_string(row.descriptor);
+        enc.add_uint(row.tablea);
+    }
+
+    const StationTable& station = store.station;
+    enc.add_uint(station.size());
+    for (size_t pos = 0; pos < station.size(); ++pos)
+    {
+        enc.add_uint(station.id[pos]);
+        enc.add_uint(station.rep[pos]);
+        enc.add_int(station.lat[pos]);
+        enc.add_int(station.lon[pos]);
+        if (station.ident[pos].is_missing())
+            enc.add_uint(0);
+        else {
+            enc.add_uint(1);
+            enc.add_string((const char*)station.ident[pos]);
+        }
+    }
+
+    const LevTrTable& levtr = store.levtr;
+    enc.add_uint(levtr.size());
+    for (size_t pos = 0; pos < levtr.size(); ++pos)
+    {
+        enc.add_uint(levtr.id[pos]);
+        enc.add_int(levtr.level[pos].ltype1);
+        enc.add_int(levtr.level[pos].l1);
+        enc.add_int(levtr.level[pos].ltype2);
+        enc.add_int(levtr.level[pos].l2);
+        enc.add_int(levtr.trange[pos].pind);
+        enc.add_int(levtr.trange[pos].p1);
+        enc.add_int(levtr.trange[pos].p2);
+    }
+
+    const StationDataTable& station_data = store.station_data;
+    enc.add_uint(station_data.size());
+    for (size_t pos = 0; pos < station_data.size(); ++pos)
+    {
+        enc.add_uint(station_data.id[pos]);
+        enc.add_uint(station_data.id_station[pos]);
+        enc.add_uint(station_data.code[pos]);
+        enc.add_var(*station_data.value[pos]);
+    }
+
+    // Group measured values by time series, sorted by datetime
+    const DataTable& data = store.data;
+    std::map<std::tuple<int, int, Varcode>, Series> series;
+    for (auto i = data.by_key.begin(); i != data.by_key.end(); ++i)
+    {
+        size_t pos = data.find(i->second);
+        int64_t dt = encode_datetime(data.datetime[pos]);
+        Series& s = series[std::make_tuple(data.id_station[pos], data.id_levtr[pos], data.code[pos])];
+        if (s.rows.empty())
+            s.dtmin = dt;
+        s.dtmax = dt;
+        s.rows.push_back(pos);
+    }
+
+    // Encode the blocks separately, to know their offsets for the directory
+    Encoder blocks;
+    Encoder dir;
+    dir.add_uint(series.size());
+    for (const auto& i: series)
+    {
+        size_t offset = blocks.buf.size();
+        const Series& s = i.second;
+
+        int last_id = 0;
+        for (auto pos: s.rows)
+        {
+            blocks.add_int(data.id[pos] - last_id);
+            last_id = data.id[pos];
+        }
+        int64_t last_dt = s.dtmin;
+        for (auto pos: s.rows)
+        {
+            int64_t dt = encode_datetime(data.datetime[pos]);
+            blocks.add_uint(dt - last_dt);
+            last_dt = dt;
+        }
+        for (auto pos: s.rows)
+            blocks.add_var(data.var(pos));
+
+        dir.add_uint(std::get<0>(i.first));
+        dir.add_uint(std::get<1>(i.first));
+        dir.add_uint(std::get<2>(i.first));
+        dir.add_uint(s.rows.size());
+        dir.add_int(s.dtmin);
+        dir.add_int(s.dtmax);
+        dir.add_uint(offset);
+        dir.add_uint(blocks.buf.size() - offset);
+    }
+    enc.buf += dir.buf;
+    enc.add_uint(blocks.buf.size());
+    enc.buf += blocks.buf;
+
+    // Write to a temporary file and rename it, to never leave a partial
+    // archive in place
+    std::string tmpname = pathname + ".tmp";
+    FILE* out = fopen(tmpname.c_str(), "wb");
+    if (!out)
+        error_system::throwf("cannot create archive %s", tmpname.c_str());
+    bool written = fwrite(enc.buf.data(), enc.buf.size(), 1, out) == 1;
+    if (fclose(out) != 0)
+        written = false;
+    if (!written)
+    {
+        unlink(tmpname.c_str());
+        error_system::throwf("cannot write archive %s", tmpname.c_str());
+    }
+    if (rename(tmpname.c_str(), pathname.c_str()) == -1)
+    {
+        unlink(tmpname.c_str());
+        error_system::throwf("cannot rename %s to %s", tmpname.c_str(), pathname.c_str());
+    }
+}
+
+Archive::Archive(const std::string& pathname, Store& store)
+    : pathname(pathname), file(pathname, "archive")
+{
+    if (file.size() < sizeof(archive_magic) || memcmp(file.begin(), archive_magic, sizeof(archive_magic)) != 0)
+        error_consistency::throwf("%s is not a DB-All.e archive, or was created with an unsupported version", pathname.c_str());
+
+    Decoder dec(pathname, file.begin() + sizeof(archive_magic), file.end());
+
+    size_t count = dec.read_uint();
+    for (size_t i = 0; i < count; ++i)
+    {
+        RepinfoRow row;
+        row.id = dec.read_uint();
+        row.memo = dec.read_string();
+        row.description = dec.read_string();
+        row.prio = dec.read_int();
+        row.descriptor = dec.read_string();
+        row.tablea = dec.read_uint();
+        store.repinfo.push_back(row);
+    }
+
+    count = dec.read_uint();
+    for (size_t i = 0; i < count; ++i)
+    {
+        int id = dec.read_uint();
+        int rep = dec.read_uint();
+        int lat = dec.read_int();
+        int lon = dec.read_int();
+        Ident ident;
+        if (dec.read_uint())
+            ident = dec.read_string();
+        store.station.insert(id, rep, lat, lon, ident);
+    }
+
+    count = dec.read_uint();
+    for (size_t i = 0; i < count; ++i)
+    {
+        int id = dec.read_uint();
+        Level level;
+        level.ltype1 = dec.read_int();
+        level.l1 = dec.read_int();
+        level.ltype2 = dec.read_int();
+        level.l2 = dec.read_int();
+        Trange trange;
+        trange.pind = dec.read_int();
+        trange.p1 = dec.read_int();
+        trange.p2 = dec.read_int();
+        store.levtr.insert(id, level, trange);
+    }
+
+    count = dec.read_uint();
+    for (size_t i = 0; i < count; ++i)
+    {
+        int id = dec.read_uint();
+        int id_station = dec.read_uint();
+        Varcode code = dec.read_uint();
+        store.station_data.insert(id, id_station, dec.read_var(code));
+    }
+
+    // Read the series directory
+    count = dec.read_uint();
+    entries.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        Entry e;
+        e.id_station = dec.read_uint();
+        e.id_levtr = dec.read_uint();
+        e.code = dec.read_uint();
+        e.count = dec.read_uint();
+        e.dtmin = dec.read_int();
+        e.dtmax = dec.read_int();
+        e.offset = dec.read_uint();
+        e.size = dec.read_uint();
+        e.loaded = false;
+        entries.push_back(e);
+    }
+    blocks_size = dec.read_uint();
+    blocks = dec.read_raw(blocks_size);
+    for (const auto& e: entries)
+        if (e.offset > blocks_size || e.size > blocks_size - e.offset)
+            dec.truncated();
+}
+
+void Archive::load(Store& store, const core::Query& query)
+{
+    int64_t dtmin = query.dtrange.min.is_missing() ? INT64_MIN : encode_datetime(query.dtrange.min);
+    int64_t dtmax = query.dtrange.max.is_missing() ? INT64_MAX : encode_datetime(query.dtrange.max);
+
+    // Positions of the values, sorted by id
+    std::vector<std::tuple<int, int, int, int64_t, Varcode, const uint8_t*>> rows;
+    std::vector<int> ids;
+    std::vector<int64_t> datetimes;
+    for (auto& e: entries)
+    {
+        if (e.loaded) continue;
+        if (e.dtmax < dtmin || e.dtmin > dtmax) continue;
+        if (!query.varcodes.empty() && query.varcodes.find(e.code) == query.varcodes.end()) continue;
+        if (query.ana_id != MISSING_INT && e.id_station != query.ana_id) continue;
+
+        Decoder block(pathname, blocks + e.offset, blocks + e.offset + e.size);
+        ids.clear();
+        int id = 0;
+        for (size_t i = 0; i < e.count; ++i)
+        {
+            id += block.read_int();
+            ids.push_back(id);
+        }
+        datetimes.clear();
+        int64_t dt = e.dtmin;
+        for (size_t i = 0; i < e.count; ++i)
+        {
+            dt += block.read_uint();
+            datetimes.push_back(dt);
+        }
+        for (size_t i = 0; i < e.count; ++i)
+        {
+            rows.emplace_back(ids[i], e.id_station, e.id_levtr, datetimes[i], e.code, block.cur);
+            block.skip_var();
+        }
+        e.loaded = true;
+    }
+    if (rows.empty()) return;
+
+    std::sort(rows.begin(), rows.end(), [](const decltype(rows)::value_type& a, const decltype(rows)::value_type& b) {
+        return std::get<0>(a) < std::get<0>(b);
+    });
+    DataTable loaded;
+    loaded.id.reserve(rows.size());
+    loaded.id_station.reserve(rows.size());
+    loaded.id_levtr.reserve(rows.size());
+    loaded.datetime.reserve(rows.size());
+    loaded.code.reserve(rows.size());
+    loaded.value.reserve(rows.size());
+    loaded.encoded.reserve(rows.size());
+    for (const auto& r: rows)
+    {
+        loaded.id.push_back(std::get<0>(r));
+        loaded.id_station.push_back(std::get<1>(r));
+        loaded.id_levtr.push_back(std::get<2>(r));
+        loaded.datetime.push_back(decode_datetime(std::get<3>(r)));
+        loaded.code.push_back(std::get<4>(r));
+        loaded.value.emplace_back();
+        loaded.encoded.push_back(std::get<5>(r));
+    }
+    store.data.merge(loaded);
+}
+
+std::unique_ptr<Var> Archive::read_var(Varcode code, const uint8_t* pos) const
+{
+    Decoder dec(pathname, pos, blocks + blocks_size);
+    return dec.read_var(code);
+}
+
+void read_archive(const std::string& pathname, Store& store)
+{
+    store.archive = std::make_shared<Archive>(pathname, store);
+    store.data.archive = store.archive.get();
+}
+
+}
+}
+}
+}
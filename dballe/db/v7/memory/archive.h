@@ -0,0 +1,104 @@
+#ifndef DBALLE_DB_V7_MEMORY_ARCHIVE_H
+#define DBALLE_DB_V7_MEMORY_ARCHIVE_H
+
+/** @file
+ * Read-only archive files for historical data.
+ *
+ * An archive stores the contents of a V7 database in a compact file meant to
+ * be memory mapped. Measured values are stored as one block per time series,
+ * that is, per (station, level/time range, varcode). Each block contains
+ * delta-encoded ids and datetimes, followed by the values and their
+ * attributes. A directory at the start of the blocks lists, for each series,
+ * its position in the file and the minimum and maximum datetime of its
+ * values.
+ *
+ * Archives are opened with URLs like `arc:/path/to/file`, and are queried
+ * with the in-memory backend. Only the directory is read when opening: the
+ * series that can match a query are loaded when the query is run, and their
+ * values are decoded from the mapped file when they are accessed.
+ */
+
+#include <dballe/core/fwd.h>
+#include <dballe/core/mmap.h>
+#include <dballe/db/v7/fwd.h>
+#include <wreport/var.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+struct Store;
+
+/**
+ * Write an archive with all the stations and station values of a database,
+ * and the measured values matching the given query.
+ */
+void write_archive(v7::Transaction& tr, const core::Query& query, const std::string& pathname);
+
+/**
+ * Write the contents of an in-memory database to an archive
+ */
+void write_archive(const Store& store, const std::string& pathname);
+
+/**
+ * Memory mapped archive file
+ */
+class Archive
+{
+protected:
+    /// Directory entry of a time series
+    struct Entry
+    {
+        int id_station;
+        int id_levtr;
+        wreport::Varcode code;
+        size_t count;
+        int64_t dtmin;
+        int64_t dtmax;
+        size_t offset;
+        size_t size;
+        /// True if the series has been loaded in the data table
+        bool loaded;
+    };
+
+    std::string pathname;
+    core::MappedFile file;
+    std::vector<Entry> entries;
+    const uint8_t* blocks = nullptr;
+    size_t blocks_size = 0;
+
+public:
+    /**
+     * Open an archive, and load all its contents into an empty Store except
+     * the measured values
+     */
+    Archive(const std::string& pathname, Store& store);
+    Archive(const Archive&) = delete;
+    Archive& operator=(const Archive&) = delete;
+
+    /**
+     * Load in the data table of store the series not loaded yet whose
+     * datetime range, varcode and station may match query.
+     *
+     * The values are left encoded, for DataTable::var() to decode.
+     */
+    void load(Store& store, const core::Query& query);
+
+    /// Decode the value at the given position in the mapped file
+    std::unique_ptr<wreport::Var> read_var(wreport::Varcode code, const uint8_t* pos) const;
+};
+
+/**
+ * Open an archive and make its contents available in an empty Store
+ */
+void read_archive(const std::string& pathname, Store& store);
+
+}
+}
+}
+}
+#endif
@@ -0,0 +1,142 @@
+#include "dballe/core/tests.h"
+#include "dballe/var.h"
+#include "connection.h"
+
+using namespace dballe;
+using namespace dballe::db::v7::memory;
+using namespace dballe::tests;
+using namespace wreport;
+using namespace std;
+
+namespace {
+
+/// Datetime of the i-th value added by fill_data
+Datetime test_datetime(unsigned i)
+{
+    return Datetime(2020, 1, 1, i / 3600, (i / 60) % 60, i % 60);
+}
+
+/// Fill the data table with count values, one per second
+void fill_data(Store& store, unsigned count)
+{
+    store.create_tables();
+    int id_station = store.station_insert(1, 4500000, 1100000, Ident());
+    int id_levtr = store.levtr_insert(Level(1), Trange::instant());
+    for (unsigned i = 0; i < count; ++i)
+        store.data_insert(id_station, id_levtr, test_datetime(i), newvar(WR_VAR(0, 12, 101), (double)(i % 100)));
+}
+
+/// Check that the data table has the values with the given ids, and that its indices match it
+void check_data(const Store& store, const std::vector<int>& ids)
+{
+    const DataTable& data = store.data;
+    wassert(actual(data.size()) == ids.size());
+    wassert(actual(data.by_key.size()) == ids.size());
+    size_t by_datetime = 0;
+    for (const auto& i: data.by_datetime)
+        by_datetime += i.second.size();
+    wassert(actual(by_datetime) == ids.size());
+    for (size_t pos = 0; pos < ids.size(); ++pos)
+    {
+        int id = ids[pos];
+        wassert(actual(data.id[pos]) == id);
+        wassert(actual(data.value[pos]->enqd()) == (id - 1) % 100);
+        wassert(actual(data.datetime[pos]) == test_datetime(id - 1));
+        wassert(actual(data.find(id)) == pos);
+        wassert_true(data.by_datetime.at(data.datetime[pos]).count(id));
+        wassert_true(data.by_code.at(WR_VAR(0, 12, 101)).count(id));
+    }
+}
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override;
+} tests("db_v7_memory_connection");
+
+void Tests::register_tests() {
+
+add_method("data_remove", [] {
+    Store store;
+    fill_data(store, 10);
+    wassert(check_data(store, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+
+    store.in_transaction = true;
+    store.data_remove(std::vector<size_t>{0, 3, 4, 9});
+    wassert(check_data(store, {2, 3, 6, 7, 8, 9}));
+
+    // Removing nothing is fine
+    store.data_remove(std::vector<size_t>());
+    wassert(check_data(store, {2, 3, 6, 7, 8, 9}));
+
+    store.data_remove(std::vector<size_t>{1, 2});
+    wassert(check_data(store, {2, 7, 8, 9}));
+
+    // Rolling back puts back every row in its place
+    store.in_transaction = false;
+    store.rollback();
+    wassert(check_data(store, {1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+});
+
+add_method("data_remove_large", [] {
+    // Remove most of the rows of a large table
+    Store store;
+    fill_data(store, 50000);
+
+    std::vector<size_t> positions;
+    std::vector<int> kept;
+    for (size_t pos = 0; pos < 50000; ++pos)
+        if (pos % 3)
+            positions.push_back(pos);
+        else
+            kept.push_back(pos + 1);
+    store.data_remove(positions);
+    wassert(check_data(store, kept));
+});
+
+add_method("station_levtr_remove", [] {
+    Store store;
+    store.create_tables();
+    for (int i = 0; i < 5; ++i)
+    {
+        store.station_insert(1, i * 100, i * 100, Ident());
+        store.levtr_insert(Level(1, i), Trange::instant());
+        store.station_data_insert(i + 1, newvar(WR_VAR(0, 1, 19), "test"));
+    }
+
+    store.in_transaction = true;
+    store.station_remove(std::vector<size_t>{1, 4});
+    store.levtr_remove(std::vector<size_t>{0, 2});
+    store.station_data_remove(std::vector<size_t>{1, 4});
+    wassert(actual(store.station.size()) == 3u);
+    wassert(actual(store.station.id[1]) == 3);
+    wassert(actual(store.station.find_id(1, 100, 100, Ident())) == MISSING_INT);
+    wassert(actual(store.station.find_id(1, 200, 200, Ident())) == 3);
+    wassert(actual(store.levtr.size()) == 3u);
+    wassert(actual(store.levtr.id[0]) == 2);
+    wassert(actual(store.levtr.find_id(Level(1, 0), Trange::instant())) == MISSING_INT);
+    wassert(actual(store.levtr.find_id(Level(1, 3), Trange::instant())) == 4);
+    wassert(actual(store.station_data.size()) == 3u);
+    wassert(actual(store.station_data.by_key.size()) == 3u);
+    wassert(actual(store.station_data.id_station[2]) == 4);
+
+    store.in_transaction = false;
+    store.rollback();
+    wassert(actual(store.station.size()) == 5u);
+    wassert(actual(store.station.find_id(1, 100, 100, Ident())) == 2);
+    wassert(actual(store.levtr.size()) == 5u);
+    wassert(actual(store.levtr.find_id(Level(1, 0), Trange::instant())) == 1);
+    wassert(actual(store.station_data.size()) == 5u);
+    wassert(actual(store.station_data.by_key.size()) == 5u);
+    for (int i = 0; i < 5; ++i)
+    {
+        wassert(actual(store.station.id[i]) == i + 1);
+        wassert(actual(store.levtr.id[i]) == i + 1);
+        wassert(actual(store.station_data.id_station[i]) == i + 1);
+    }
+});
+
+}
+
+}
@@ -0,0 +1,807 @@
+#include "connection.h"
+#include "archive.h"
+#include <algorithm>
+#include <climits>
+#include <cstdarg>
+#include <cstdio>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+
+void error_memory::throwf(const char* fmt, ...)
+{
+    char buf[512];
+
+    // Format the arguments
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, 512, fmt, ap);
+    va_end(ap);
+
+    throw error_memory(buf);
+}
+
+namespace {
+
+/// Find the position of id in a sorted id column, or ids.size() if not found
+size_t find_id_pos(const std::vector<int>& ids, int id)
+{
+    auto i = std::lower_bound(ids.begin(), ids.end(), id);
+    if (i == ids.end() || *i != id)
+        return ids.size();
+    return i - ids.begin();
+}
+
+/// Position where id should be inserted to keep ids sorted
+size_t insert_pos(const std::vector<int>& ids, int id)
+{
+    return std::lower_bound(ids.begin(), ids.end(), id) - ids.begin();
+}
+
+/// Next id to use for a new row, reusing the ids freed at the end of the table
+int next_id(const std::vector<int>& ids)
+{
+    return ids.empty() ? 1 : ids.back() + 1;
+}
+
+/**
+ * Move the elements at the given sorted positions from col to the end of
+ * removed, shifting each element that is kept only once
+ */
+template<typename T>
+void compact(std::vector<T>& col, const std::vector<size_t>& positions, std::vector<T>& removed)
+{
+    if (positions.empty()) return;
+    auto next = positions.begin();
+    size_t dst = *next;
+    for (size_t src = dst; src < col.size(); ++src)
+    {
+        if (next != positions.end() && *next == src)
+        {
+            removed.emplace_back(std::move(col[src]));
+            ++next;
+        } else
+            col[dst++] = std::move(col[src]);
+    }
+    col.erase(col.begin() + dst, col.end());
+}
+
+/// Undo compact(), moving the elements of removed back to their positions
+template<typename T>
+void expand(std::vector<T>& col, const std::vector<size_t>& positions, std::vector<T>& removed)
+{
+    size_t src = col.size();
+    col.resize(src + removed.size());
+    size_t dst = col.size();
+    size_t next = removed.size();
+    for (auto p = positions.rbegin(); p != positions.rend(); ++p)
+    {
+        while (dst > *p + 1)
+            col[--dst] = std::move(col[--src]);
+        col[--dst] = std::move(removed[--next]);
+    }
+    removed.clear();
+}
+
+}
+
+
+/*
+ * StationTable
+ */
+
+size_t StationTable::find(int id) const
+{
+    return find_id_pos(this->id, id);
+}
+
+int StationTable::find_id(int rep, int lat, int lon, const Ident& ident) const
+{
+    auto i = by_key.find(std::make_tuple(rep, lat, lon, ident));
+    if (i == by_key.end()) return MISSING_INT;
+    return i->second;
+}
+
+void StationTable::insert(int id, int rep, int lat, int lon, const Ident& ident)
+{
+    auto key = std::make_tuple(rep, lat, lon, ident);
+    if (by_key.find(key) != by_key.end())
+        error_memory::throwf("cannot insert station %d: a station with the same report, coordinates and identifier already exists", id);
+    size_t pos = insert_pos(this->id, id);
+    this->id.insert(this->id.begin() + pos, id);
+    this->rep.insert(this->rep.begin() + pos, rep);
+    this->lat.insert(this->lat.begin() + pos, lat);
+    this->lon.insert(this->lon.begin() + pos, lon);
+    this->ident.insert(this->ident.begin() + pos, ident);
+    by_key.insert(make_pair(key, id));
+}
+
+void StationTable::erase(size_t pos)
+{
+    by_key.erase(std::make_tuple(rep[pos], lat[pos], lon[pos], ident[pos]));
+    id.erase(id.begin() + pos);
+    rep.erase(rep.begin() + pos);
+    lat.erase(lat.begin() + pos);
+    lon.erase(lon.begin() + pos);
+    ident.erase(ident.begin() + pos);
+}
+
+void StationTable::erase(const std::vector<size_t>& positions, StationTable& removed)
+{
+    for (auto pos: positions)
+        by_key.erase(std::make_tuple(rep[pos], lat[pos], lon[pos], ident[pos]));
+    compact(id, positions, removed.id);
+    compact(rep, positions, removed.rep);
+    compact(lat, positions, removed.lat);
+    compact(lon, positions, removed.lon);
+    compact(ident, positions, removed.ident);
+}
+
+void StationTable::restore(const std::vector<size_t>& positions, StationTable& removed)
+{
+    expand(id, positions, removed.id);
+    expand(rep, positions, removed.rep);
+    expand(lat, positions, removed.lat);
+    expand(lon, positions, removed.lon);
+    expand(ident, positions, removed.ident);
+    for (auto pos: positions)
+        by_key.insert(make_pair(std::make_tuple(rep[pos], lat[pos], lon[pos], ident[pos]), id[pos]));
+}
+
+void StationTable::clear()
+{
+    id.clear();
+    rep.clear();
+    lat.clear();
+    lon.clear();
+    ident.clear();
+    by_key.clear();
+}
+
+
+/*
+ * LevTrTable
+ */
+
+LevTrKey LevTrTable::make_key(const Level& level, const Trange& trange)
+{
+    return std::make_tuple(level.ltype1, level.l1, level.ltype2, level.l2, trange.pind, trange.p1, trange.p2);
+}
+
+size_t LevTrTable::find(int id) const
+{
+    return find_id_pos(this->id, id);
+}
+
+int LevTrTable::find_id(const Level& level, const Trange& trange) const
+{
+    auto i = by_key.find(make_key(level, trange));
+    if (i == by_key.end()) return MISSING_INT;
+    return i->second;
+}
+
+void LevTrTable::insert(int id, const Level& level, const Trange& trange)
+{
+    size_t pos = insert_pos(this->id, id);
+    this->id.insert(this->id.begin() + pos, id);
+    this->level.insert(this->level.begin() + pos, level);
+    this->trange.insert(this->trange.begin() + pos, trange);
+    by_key.insert(make_pair(make_key(level, trange), id));
+}
+
+void LevTrTable::erase(size_t pos)
+{
+    by_key.erase(make_key(level[pos], trange[pos]));
+    id.erase(id.begin() + pos);
+    level.erase(level.begin() + pos);
+    trange.erase(trange.begin() + pos);
+}
+
+void LevTrTable::erase(const std::vector<size_t>& positions, LevTrTable& removed)
+{
+    for (auto pos: positions)
+        by_key.erase(make_key(level[pos], trange[pos]));
+    compact(id, positions, removed.id);
+    compact(level, positions, removed.level);
+    compact(trange, positions, removed.trange);
+}
+
+void LevTrTable::restore(const std::vector<size_t>& positions, LevTrTable& removed)
+{
+    expand(id, positions, removed.id);
+    expand(level, positions, removed.level);
+    expand(trange, positions, removed.trange);
+    for (auto pos: positions)
+        by_key.insert(make_pair(make_key(level[pos], trange[pos]), id[pos]));
+}
+
+void LevTrTable::clear()
+{
+    id.clear();
+    level.clear();
+    trange.clear();
+    by_key.clear();
+}
+
+
+/*
+ * StationDataTable
+ */
+
+size_t StationDataTable::find(int id) const
+{
+    return find_id_pos(this->id, id);
+}
+
+void StationDataTable::insert(int id, int id_station, std::unique_ptr<wreport::Var> var)
+{
+    auto key = make_pair(id_station, var->code());
+    if (by_key.find(key) != by_key.end())
+        error_memory::throwf("cannot insert station value %01d%02d%03d for station %d: the value already exists",
+                WR_VAR_FXY(var->code()), id_station);
+    size_t pos = insert_pos(this->id, id);
+    this->id.insert(this->id.begin() + pos, id);
+    this->id_station.insert(this->id_station.begin() + pos, id_station);
+    this->code.insert(this->code.begin() + pos, var->code());
+    this->value.insert(this->value.begin() + pos, std::move(var));
+    by_key.insert(make_pair(key, id));
+}
+
+void StationDataTable::erase(size_t pos)
+{
+    by_key.erase(make_pair(id_station[pos], code[pos]));
+    id.erase(id.begin() + pos);
+    id_station.erase(id_station.begin() + pos);
+    code.erase(code.begin() + pos);
+    value.erase(value.begin() + pos);
+}
+
+void StationDataTable::erase(const std::vector<size_t>& positions, StationDataTable& removed)
+{
+    for (auto pos: positions)
+        by_key.erase(make_pair(id_station[pos], code[pos]));
+    compact(id, positions, removed.id);
+    compact(id_station, positions, removed.id_station);
+    compact(code, positions, removed.code);
+    compact(value, positions, removed.value);
+}
+
+void StationDataTable::restore(const std::vector<size_t>& positions, StationDataTable& removed)
+{
+    expand(id, positions, removed.id);
+    expand(id_station, positions, removed.id_station);
+    expand(code, positions, removed.code);
+    expand(value, positions, removed.value);
+    for (auto pos: positions)
+        by_key.insert(make_pair(make_pair(id_station[pos], code[pos]), id[pos]));
+}
+
+void StationDataTable::clear()
+{
+    id.clear();
+    id_station.clear();
+    code.clear();
+    value.clear();
+    by_key.clear();
+}
+
+
+/*
+ * DataTable
+ */
+
+size_t DataTable::find(int id) const
+{
+    return find_id_pos(this->id, id);
+}
+
+void DataTable::insert(int id, int id_station, int id_levtr, const Datetime& datetime, std::unique_ptr<wreport::Var> var)
+{
+    DataKey key(id_station, datetime, id_levtr, var->code());
+    if (by_key.find(key) != by_key.end())
+        error_memory::throwf("cannot insert value %01d%02d%03d for station %d, levtr %d: the value already exists",
+                WR_VAR_FXY(var->code()), id_station, id_levtr);
+    size_t pos = insert_pos(this->id, id);
+    this->id.insert(this->id.begin() + pos, id);
+    this->id_station.insert(this->id_station.begin() + pos, id_station);
+    this->id_levtr.insert(this->id_levtr.begin() + pos, id_levtr);
+    this->datetime.insert(this->datetime.begin() + pos, datetime);
+    this->code.insert(this->code.begin() + pos, var->code());
+    this->value.insert(this->value.begin() + pos, std::move(var));
+    this->encoded.insert(this->encoded.begin() + pos, nullptr);
+    by_key.insert(make_pair(key, id));
+    by_code[code[pos]].insert(id);
+    by_datetime[datetime].insert(id);
+}
+
+void DataTable::erase(size_t pos)
+{
+    by_key.erase(DataKey(id_station[pos], datetime[pos], id_levtr[pos], code[pos]));
+
+    auto c = by_code.find(code[pos]);
+    c->second.erase(id[pos]);
+    if (c->second.empty()) by_code.erase(c);
+
+    auto d = by_datetime.find(datetime[pos]);
+    d->second.erase(id[pos]);
+    if (d->second.empty()) by_datetime.erase(d);
+
+    id.erase(id.begin() + pos);
+    id_station.erase(id_station.begin() + pos);
+    id_levtr.erase(id_levtr.begin() + pos);
+    datetime.erase(datetime.begin() + pos);
+    code.erase(code.begin() + pos);
+    value.erase(value.begin() + pos);
+    encoded.erase(encoded.begin() + pos);
+}
+
+void DataTable::erase(const std::vector<size_t>& positions, DataTable& removed)
+{
+    for (auto pos: positions)
+    {
+        by_key.erase(DataKey(id_station[pos], datetime[pos], id_levtr[pos], code[pos]));
+
+        auto c = by_code.find(code[pos]);
+        c->second.erase(id[pos]);
+        if (c->second.empty()) by_code.erase(c);
+
+        auto d = by_datetime.find(datetime[pos]);
+        d->second.erase(id[pos]);
+        if (d->second.empty()) by_datetime.erase(d);
+    }
+    compact(id, positions, removed.id);
+    compact(id_station, positions, removed.id_station);
+    compact(id_levtr, positions, removed.id_levtr);
+    compact(datetime, positions, removed.datetime);
+    compact(code, positions, removed.code);
+    compact(value, positions, removed.value);
+    compact(encoded, positions, removed.encoded);
+}
+
+void DataTable::restore(const std::vector<size_t>& positions, DataTable& removed)
+{
+    expand(id, positions, removed.id);
+    expand(id_station, positions, removed.id_station);
+    expand(id_levtr, positions, removed.id_levtr);
+    expand(datetime, positions, removed.datetime);
+    expand(code, positions, removed.code);
+    expand(value, positions, removed.value);
+    expand(encoded, positions, removed.encoded);
+    for (auto pos: positions)
+    {
+        by_key.insert(make_pair(DataKey(id_station[pos], datetime[pos], id_levtr[pos], code[pos]), id[pos]));
+        by_code[code[pos]].insert(id[pos]);
+        by_datetime[datetime[pos]].insert(id[pos]);
+    }
+}
+
+void DataTable::merge(DataTable& other)
+{
+    std::vector<size_t> positions;
+    positions.reserve(other.size());
+    size_t pos = 0;
+    for (size_t i = 0; i < other.size(); ++i)
+    {
+        while (pos < size() && id[pos] < other.id[i])
+            ++pos;
+        positions.push_back(pos + i);
+    }
+    restore(positions, other);
+}
+
+const wreport::Var& DataTable::var(size_t pos) const
+{
+    if (!value[pos])
+    {
+        value[pos] = archive->read_var(code[pos], encoded[pos]);
+    }
+    return *value[pos];
+}
+
+void DataTable::clear()
+{
+    id.clear();
+    id_station.clear();
+    id_levtr.clear();
+    datetime.clear();
+    code.clear();
+    value.clear();
+    encoded.clear();
+    by_key.clear();
+    by_code.clear();
+    by_datetime.clear();
+}
+
+
+/*
+ * Store
+ */
+
+void Store::on_rollback(std::function<void()> f)
+{
+    if (in_transaction)
+        undo.emplace_back(std::move(f));
+}
+
+void Store::rollback()
+{
+    for (auto i = undo.rbegin(); i != undo.rend(); ++i)
+        (*i)();
+    undo.clear();
+}
+
+void Store::check_tables(const char* name) const
+{
+    if (!has_tables)
+        error_memory::throwf("cannot access table %s: the in-memory database has no tables", name);
+}
+
+void Store::check_writable() const
+{
+    if (readonly)
+        throw error_memory("cannot modify an archive database: archives are read-only");
+}
+
+void Store::load_archive(const core::Query& query)
+{
+    if (archive)
+        archive->load(*this, query);
+}
+
+void Store::create_tables()
+{
+    check_writable();
+    has_tables = true;
+}
+
+void Store::drop_tables()
+{
+    check_writable();
+    has_tables = false;
+    repinfo.clear();
+    station.clear();
+    levtr.clear();
+    station_data.clear();
+    data.clear();
+}
+
+namespace {
+
+/// Tables set aside by remove_all, to be restored on rollback
+struct SavedTables
+{
+    StationTable station;
+    LevTrTable levtr;
+    StationDataTable station_data;
+    DataTable data;
+};
+
+}
+
+void Store::remove_all()
+{
+    check_writable();
+    if (in_transaction)
+    {
+        auto saved = make_shared<SavedTables>();
+        saved->station = std::move(station);
+        saved->levtr = std::move(levtr);
+        saved->station_data = std::move(station_data);
+        saved->data = std::move(data);
+        on_rollback([this, saved] {
+            station = std::move(saved->station);
+            levtr = std::move(saved->levtr);
+            station_data = std::move(saved->station_data);
+            data = std::move(saved->data);
+        });
+    }
+    station.clear();
+    levtr.clear();
+    station_data.clear();
+    data.clear();
+}
+
+size_t Store::repinfo_find(int id) const
+{
+    for (size_t i = 0; i < repinfo.size(); ++i)
+        if (repinfo[i].id == id)
+            return i;
+    return repinfo.size();
+}
+
+void Store::repinfo_insert(const RepinfoRow& row)
+{
+    check_writable();
+    for (const auto& r: repinfo)
+    {
+        if (r.id == row.id)
+            error_memory::throwf("cannot insert repinfo entry %d: the id already exists", row.id);
+        if (r.memo == row.memo)
+            error_memory::throwf("cannot insert repinfo entry %d: report %s already exists", row.id, row.memo.c_str());
+        if (r.prio == row.prio)
+            error_memory::throwf("cannot insert repinfo entry %d: priority %d is already used", row.id, row.prio);
+    }
+    auto pos = std::lower_bound(repinfo.begin(), repinfo.end(), row.id, [](const RepinfoRow& r, int id) { return r.id < id; });
+    repinfo.insert(pos, row);
+    int id = row.id;
+    on_rollback([this, id] { repinfo.erase(repinfo.begin() + repinfo_find(id)); });
+}
+
+void Store::repinfo_update(const RepinfoRow& row)
+{
+    check_writable();
+    size_t pos = repinfo_find(row.id);
+    if (pos == repinfo.size()) return;
+    RepinfoRow old = repinfo[pos];
+    repinfo[pos] = row;
+    on_rollback([this, old] { repinfo[repinfo_find(old.id)] = old; });
+}
+
+void Store::repinfo_remove(int id)
+{
+    check_writable();
+    size_t pos = repinfo_find(id);
+    if (pos == repinfo.size()) return;
+    RepinfoRow old = repinfo[pos];
+    repinfo.erase(repinfo.begin() + pos);
+    on_rollback([this, old] {
+        auto pos = std::lower_bound(repinfo.begin(), repinfo.end(), old.id, [](const RepinfoRow& r, int id) { return r.id < id; });
+        repinfo.insert(pos, old);
+    });
+}
+
+int Store::station_insert(int rep, int lat, int lon, const Ident& ident)
+{
+    check_writable();
+    int id = next_id(station.id);
+    station.insert(id, rep, lat, lon, ident);
+    on_rollback([this, id] { station.erase(station.find(id)); });
+    return id;
+}
+
+void Store::station_remove(const std::vector<size_t>& positions)
+{
+    check_writable();
+    auto removed = make_shared<StationTable>();
+    station.erase(positions, *removed);
+    on_rollback([this, positions, removed] { station.restore(positions, *removed); });
+}
+
+int Store::levtr_insert(const Level& level, const Trange& trange)
+{
+    check_writable();
+    int id = next_id(levtr.id);
+    levtr.insert(id, level, trange);
+    on_rollback([this, id] { levtr.erase(levtr.find(id)); });
+    return id;
+}
+
+void Store::levtr_remove(const std::vector<size_t>& positions)
+{
+    check_writable();
+    auto removed = make_shared<LevTrTable>();
+    levtr.erase(positions, *removed);
+    on_rollback([this, positions, removed] { levtr.restore(positions, *removed); });
+}
+
+int Store::station_data_insert(int id_station, std::unique_ptr<wreport::Var> var)
+{
+    check_writable();
+    int id = next_id(station_data.id);
+    station_data.insert(id, id_station, std::move(var));
+    on_rollback([this, id] { station_data.erase(station_data.find(id)); });
+    return id;
+}
+
+void Store::station_data_update(size_t pos, std::unique_ptr<wreport::Var> var)
+{
+    check_writable();
+    int id = station_data.id[pos];
+    std::shared_ptr<wreport::Var> old(station_data.value[pos].release());
+    station_data.value[pos] = std::move(var);
+    on_rollback([this, id, old] { station_data.value[station_data.find(id)].reset(new Var(*old)); });
+}
+
+void Store::station_data_remove(size_t pos)
+{
+    check_writable();
+    int id = station_data.id[pos];
+    int id_station = station_data.id_station[pos];
+    std::shared_ptr<wreport::Var> old(station_data.value[pos].release());
+    station_data.erase(pos);
+    on_rollback([this, id, id_station, old] {
+        station_data.insert(id, id_station, unique_ptr<Var>(new Var(*old)));
+    });
+}
+
+void Store::station_data_remove(const std::vector<size_t>& positions)
+{
+    check_writable();
+    auto removed = make_shared<StationDataTable>();
+    station_data.erase(positions, *removed);
+    on_rollback([this, positions, removed] { station_data.restore(positions, *removed); });
+}
+
+int Store::data_insert(int id_station, int id_levtr, const Datetime& datetime, std::unique_ptr<wreport::Var> var)
+{
+    check_writable();
+    int id = next_id(data.id);
+    data.insert(id, id_station, id_levtr, datetime, std::move(var));
+    on_rollback([this, id] { data.erase(data.find(id)); });
+    return id;
+}
+
+void Store::data_update(size_t pos, std::unique_ptr<wreport::Var> var)
+{
+    check_writable();
+    int id = data.id[pos];
+    std::shared_ptr<wreport::Var> old(data.value[pos].release());
+    data.value[pos] = std::move(var);
+    on_rollback([this, id, old] { data.value[data.find(id)].reset(new Var(*old)); });
+}
+
+void Store::data_remove(size_t pos)
+{
+    check_writable();
+    int id = data.id[pos];
+    int id_station = data.id_station[pos];
+    int id_levtr = data.id_levtr[pos];
+    Datetime datetime = data.datetime[pos];
+    std::shared_ptr<wreport::Var> old(data.value[pos].release());
+    data.erase(pos);
+    on_rollback([this, id, id_station, id_levtr, datetime, old] {
+        data.insert(id, id_station, id_levtr, datetime, unique_ptr<Var>(new Var(*old)));
+    });
+}
+
+void Store::data_remove(const std::vector<size_t>& positions)
+{
+    check_writable();
+    auto removed = make_shared<DataTable>();
+    data.erase(positions, *removed);
+    on_rollback([this, positions, removed] { data.restore(positions, *removed); });
+}
+
+
+/*
+ * MemoryConnection
+ */
+
+MemoryConnection::MemoryConnection()
+{
+    server_type = dballe::sql::ServerType::MEMORY;
+    url = "mem:";
+}
+
+MemoryConnection::~MemoryConnection()
+{
+}
+
+std::shared_ptr<MemoryConnection> MemoryConnection::create()
+{
+    auto res = std::shared_ptr<MemoryConnection>(new MemoryConnection);
+    res->register_atfork();
+    return res;
+}
+
+std::shared_ptr<MemoryConnection> MemoryConnection::open_archive(const std::string& pathname)
+{
+    auto res = create();
+    res->url = "arc:" + pathname;
+    read_archive(pathname, res->store);
+    res->store.has_tables = true;
+    res->store.readonly = true;
+    res->store.settings["version"] = "V7";
+    return res;
+}
+
+void MemoryConnection::fork_child()
+{
+    // The child gets a copy of the database contents, but changes there
+    // would silently not be seen by the parent
+    forked = true;
+}
+
+void MemoryConnection::check_connection()
+{
+    if (forked)
+        throw error_memory("database connections cannot be used after forking");
+}
+
+namespace {
+
+struct MemoryTransaction : public dballe::sql::Transaction
+{
+    Store& store;
+    bool fired = false;
+
+    MemoryTransaction(Store& store) : store(store)
+    {
+        store.in_transaction = true;
+    }
+    ~MemoryTransaction() { if (!fired) rollback_nothrow(); }
+
+    void commit() override
+    {
+        store.undo.clear();
+        store.in_transaction = false;
+        fired = true;
+    }
+    void rollback() override
+    {
+        store.in_transaction = false;
+        store.rollback();
+        fired = true;
+    }
+    void rollback_nothrow() noexcept override
+    {
+        store.in_transaction = false;
+        try {
+            store.rollback();
+        } catch (std::exception& e) {
+            fprintf(stderr, "cannot roll back in-memory transaction: %s\n", e.what());
+        }
+        fired = true;
+    }
+    void lock_table(const char* name) override
+    {
+        // Nothing to do: there is only one transaction at a time
+    }
+};
+
+}
+
+std::unique_ptr<dballe::sql::Transaction> MemoryConnection::transaction(bool readonly)
+{
+    check_connection();
+    if (store.in_transaction)
+        throw error_memory("cannot start a transaction within a transaction");
+    return unique_ptr<dballe::sql::Transaction>(new MemoryTransaction(store));
+}
+
+bool MemoryConnection::has_table(const std::string& name)
+{
+    if (!store.has_tables) return false;
+    return name == "repinfo" || name == "station" || name == "levtr"
+        || name == "station_data" || name == "data";
+}
+
+std::string MemoryConnection::get_setting(const std::string& key)
+{
+    auto i = store.settings.find(key);
+    if (i == store.settings.end()) return std::string();
+    return i->second;
+}
+
+void MemoryConnection::set_setting(const std::string& key, const std::string& value)
+{
+    store.check_writable();
+    store.settings[key] = value;
+}
+
+void MemoryConnection::drop_settings()
+{
+    store.check_writable();
+    store.settings.clear();
+}
+
+void MemoryConnection::execute(const std::string& query)
+{
+    error_unimplemented::throwf("cannot run SQL on an in-memory database: %s", query.c_str());
+}
+
+void MemoryConnection::explain(const std::string& query, FILE* out)
+{
+    fprintf(out, "%s\n", query.c_str());
+    fprintf(out, "in-memory database: the query is evaluated directly on the in-memory tables\n");
+}
+
+}
+}
+}
+}
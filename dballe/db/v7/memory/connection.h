@@ -0,0 +1,321 @@
+#ifndef DBALLE_DB_V7_MEMORY_CONNECTION_H
+#define DBALLE_DB_V7_MEMORY_CONNECTION_H
+
+/** @file
+ * In-memory storage for V7 databases
+ *
+ * The tables of a V7 database are kept in columnar arrays sorted by id, with
+ * std::map based indices for the lookups done by the v7 code. All changes
+ * done inside a transaction are recorded in an undo log, that is replayed in
+ * reverse on rollback.
+ */
+
+#include <dballe/core/error.h>
+#include <dballe/core/fwd.h>
+#include <dballe/sql/sql.h>
+#include <dballe/types.h>
+#include <wreport/var.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+class Archive;
+
+/**
+ * Report an error accessing an in-memory database
+ */
+struct error_memory : public dballe::error_db
+{
+    std::string msg;
+
+    error_memory(const std::string& msg) : msg(msg) {}
+    ~error_memory() noexcept {}
+
+    const char* what() const noexcept override { return msg.c_str(); }
+
+    static void throwf(const char* fmt, ...) WREPORT_THROWF_ATTRS(1, 2);
+};
+
+/// Row of the repinfo table
+struct RepinfoRow
+{
+    int id;
+    std::string memo;
+    std::string description;
+    int prio;
+    std::string descriptor;
+    int tablea;
+};
+
+/// Station table, stored by column and sorted by id
+struct StationTable
+{
+    std::vector<int> id;
+    std::vector<int> rep;
+    std::vector<int> lat;
+    std::vector<int> lon;
+    std::vector<Ident> ident;
+
+    /// Unique index on (rep, lat, lon, ident)
+    std::map<std::tuple<int, int, int, Ident>, int> by_key;
+
+    size_t size() const { return id.size(); }
+
+    /// Return the position of the station with the given id, or size() if not found
+    size_t find(int id) const;
+
+    /// Return the id of the station with the given values, or MISSING_INT
+    int find_id(int rep, int lat, int lon, const Ident& ident) const;
+
+    /// Add a row, keeping the table sorted by id
+    void insert(int id, int rep, int lat, int lon, const Ident& ident);
+
+    /// Remove the row at the given position
+    void erase(size_t pos);
+
+    /**
+     * Remove the rows at the given positions, sorted and without duplicates,
+     * moving them to \a removed
+     */
+    void erase(const std::vector<size_t>& positions, StationTable& removed);
+
+    /// Put back the rows taken out by erase(positions, removed)
+    void restore(const std::vector<size_t>& positions, StationTable& removed);
+
+    void clear();
+};
+
+/// Level and time range, as an ordered tuple of their integer fields
+typedef std::tuple<int, int, int, int, int, int, int> LevTrKey;
+
+/// levtr table, stored by column and sorted by id
+struct LevTrTable
+{
+    std::vector<int> id;
+    std::vector<Level> level;
+    std::vector<Trange> trange;
+
+    /// Unique index on the level and time range values
+    std::map<LevTrKey, int> by_key;
+
+    static LevTrKey make_key(const Level& level, const Trange& trange);
+
+    size_t size() const { return id.size(); }
+    size_t find(int id) const;
+    int find_id(const Level& level, const Trange& trange) const;
+    void insert(int id, const Level& level, const Trange& trange);
+    void erase(size_t pos);
+    void erase(const std::vector<size_t>& positions, LevTrTable& removed);
+    void restore(const std::vector<size_t>& positions, LevTrTable& removed);
+    void clear();
+};
+
+/**
+ * station_data table, stored by column and sorted by id.
+ *
+ * Values are stored as wreport::Var together with their attributes, so that
+ * reading them does not require parsing.
+ */
+struct StationDataTable
+{
+    std::vector<int> id;
+    std::vector<int> id_station;
+    std::vector<wreport::Varcode> code;
+    std::vector<std::unique_ptr<wreport::Var>> value;
+
+    /// Unique index on (id_station, code)
+    std::map<std::pair<int, wreport::Varcode>, int> by_key;
+
+    size_t size() const { return id.size(); }
+    size_t find(int id) const;
+    void insert(int id, int id_station, std::unique_ptr<wreport::Var> var);
+    void erase(size_t pos);
+    void erase(const std::vector<size_t>& positions, StationDataTable& removed);
+    void restore(const std::vector<size_t>& positions, StationDataTable& removed);
+    const wreport::Var& var(size_t pos) const { return *value[pos]; }
+    void clear();
+};
+
+/// Unique key of a row in the data table
+typedef std::tuple<int, Datetime, int, wreport::Varcode> DataKey;
+
+/**
+ * data table, stored by column and sorted by id.
+ *
+ * Values are stored as wreport::Var together with their attributes, so that
+ * reading them does not require parsing. Values loaded from an archive are
+ * decoded the first time they are accessed with var().
+ */
+struct DataTable
+{
+    std::vector<int> id;
+    std::vector<int> id_station;
+    std::vector<int> id_levtr;
+    std::vector<Datetime> datetime;
+    std::vector<wreport::Varcode> code;
+    /// Decoded values, or nullptr if they have not been decoded yet
+    mutable std::vector<std::unique_ptr<wreport::Var>> value;
+    /// Encoded values in the archive file, or nullptr
+    std::vector<const uint8_t*> encoded;
+    /// Archive with the encoded values
+    const Archive* archive = nullptr;
+
+    /// Unique index on (id_station, datetime, id_levtr, code)
+    std::map<DataKey, int> by_key;
+    /// Index on code
+    std::map<wreport::Varcode, std::set<int>> by_code;
+    /// Index on datetime
+    std::map<Datetime, std::set<int>> by_datetime;
+
+    size_t size() const { return id.size(); }
+    size_t find(int id) const;
+    void insert(int id, int id_station, int id_levtr, const Datetime& datetime, std::unique_ptr<wreport::Var> var);
+    void erase(size_t pos);
+    void erase(const std::vector<size_t>& positions, DataTable& removed);
+    void restore(const std::vector<size_t>& positions, DataTable& removed);
+
+    /// Move in the rows of other, sorted by id, with ids not in this table
+    void merge(DataTable& other);
+
+    /// Return the value at the given position, decoding it if needed
+    const wreport::Var& var(size_t pos) const;
+    void clear();
+};
+
+/**
+ * Contents of an in-memory database.
+ *
+ * All the modification methods record their inverse in the undo log if a
+ * transaction is active.
+ */
+struct Store
+{
+    /// True if the tables have been created
+    bool has_tables = false;
+    /// True if the contents cannot be modified, as for archives
+    bool readonly = false;
+    std::vector<RepinfoRow> repinfo;
+    StationTable station;
+    LevTrTable levtr;
+    StationDataTable station_data;
+    DataTable data;
+    std::map<std::string, std::string> settings;
+    /// Archive with the measured values not yet loaded in data
+    std::shared_ptr<Archive> archive;
+
+    /// True if a transaction is active
+    bool in_transaction = false;
+    /// Changes to undo when the current transaction is rolled back
+    std::vector<std::function<void()>> undo;
+
+    /// Record a function that reverts a change
+    void on_rollback(std::function<void()> f);
+
+    /// Run the undo log in reverse, and clear it
+    void rollback();
+
+    /// Throw error_memory if the tables have not been created
+    void check_tables(const char* name) const;
+
+    /// Throw error_memory if the contents cannot be modified
+    void check_writable() const;
+
+    /**
+     * Load in the data table the values from the archive that may match the
+     * query
+     */
+    void load_archive(const core::Query& query);
+
+    void create_tables();
+    void drop_tables();
+
+    /// Empty all tables except repinfo
+    void remove_all();
+
+    /// Return the position of the repinfo row with the given id, or repinfo.size()
+    size_t repinfo_find(int id) const;
+    void repinfo_insert(const RepinfoRow& row);
+    void repinfo_update(const RepinfoRow& row);
+    void repinfo_remove(int id);
+
+    /*
+     * The *_remove methods taking a list of positions want them sorted and
+     * without duplicates, and remove all the rows in one pass over the
+     * table.
+     */
+
+    int station_insert(int rep, int lat, int lon, const Ident& ident);
+    void station_remove(const std::vector<size_t>& positions);
+
+    int levtr_insert(const Level& level, const Trange& trange);
+    void levtr_remove(const std::vector<size_t>& positions);
+
+    int station_data_insert(int id_station, std::unique_ptr<wreport::Var> var);
+    void station_data_update(size_t pos, std::unique_ptr<wreport::Var> var);
+    void station_data_remove(size_t pos);
+    void station_data_remove(const std::vector<size_t>& positions);
+
+    int data_insert(int id_station, int id_levtr, const Datetime& datetime, std::unique_ptr<wreport::Var> var);
+    void data_update(size_t pos, std::unique_ptr<wreport::Var> var);
+    void data_remove(size_t pos);
+    void data_remove(const std::vector<size_t>& positions);
+};
+
+/**
+ * Connection to an in-memory database.
+ *
+ * It implements the parts of sql::Connection used outside of the backend
+ * drivers; execute() is not supported.
+ */
+class MemoryConnection : public dballe::sql::Connection
+{
+protected:
+    /// Marker to catch attempts to reuse connections in forked processes
+    bool forked = false;
+
+    MemoryConnection();
+
+    void fork_child() override;
+
+public:
+    /// Database contents
+    Store store;
+
+    MemoryConnection(const MemoryConnection&) = delete;
+    MemoryConnection(const MemoryConnection&&) = delete;
+    ~MemoryConnection();
+    MemoryConnection& operator=(const MemoryConnection&) = delete;
+
+    static std::shared_ptr<MemoryConnection> create();
+
+    /**
+     * Create a read-only connection with the contents of an archive file
+     * created by write_archive()
+     */
+    static std::shared_ptr<MemoryConnection> open_archive(const std::string& pathname);
+
+    void check_connection();
+
+    std::unique_ptr<dballe::sql::Transaction> transaction(bool readonly=false) override;
+    bool has_table(const std::string& name) override;
+    std::string get_setting(const std::string& key) override;
+    void set_setting(const std::string& key, const std::string& value) override;
+    void drop_settings() override;
+    void execute(const std::string& query) override;
+    void explain(const std::string& query, FILE* out) override;
+};
+
+}
+}
+}
+}
+#endif
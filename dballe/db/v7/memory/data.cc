@@ -0,0 +1,414 @@
+#include "data.h"
+#include "connection.h"
+#include "query.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/batch.h"
+#include "dballe/db/v7/qbuilder.h"
+#include "dballe/db/v7/repinfo.h"
+#include "dballe/core/query.h"
+#include "dballe/core/varmatch.h"
+#include "dballe/values.h"
+#include "dballe/var.h"
+#include <algorithm>
+#include <map>
+#include <climits>
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+
+namespace {
+
+/**
+ * Copy a variable for storing it in the database.
+ *
+ * The copy uses the default variable information for its code, as it would
+ * happen when reading it back from a SQL database.
+ */
+unique_ptr<Var> copy_var(const Var& src, bool with_attrs)
+{
+    unique_ptr<Var> res(new Var(varinfo(src.code())));
+    res->setval(src);
+    if (with_attrs)
+        for (const Var* a = src.next_attr(); a != nullptr; a = a->next_attr())
+        {
+            Var attr(varinfo(a->code()));
+            attr.setval(*a);
+            res->seta(move(attr));
+        }
+    return res;
+}
+
+/// Table specific operations used by MemoryDataCommon
+template<typename Parent> struct Access;
+
+template<> struct Access<StationData>
+{
+    typedef StationDataTable Table;
+    static const Table& table(const Store& store) { return store.station_data; }
+    static void update(Store& store, size_t pos, unique_ptr<Var> var) { store.station_data_update(pos, move(var)); }
+    static void remove(Store& store, size_t pos) { store.station_data_remove(pos); }
+    static void remove(Store& store, const std::vector<size_t>& positions) { store.station_data_remove(positions); }
+    static std::vector<size_t> select(v7::Transaction& tr, const Store& store, const core::Query& query)
+    {
+        return select_station_data(tr, store, query);
+    }
+};
+
+template<> struct Access<Data>
+{
+    typedef DataTable Table;
+    static const Table& table(const Store& store) { return store.data; }
+    static void update(Store& store, size_t pos, unique_ptr<Var> var) { store.data_update(pos, move(var)); }
+    static void remove(Store& store, size_t pos) { store.data_remove(pos); }
+    static void remove(Store& store, const std::vector<size_t>& positions) { store.data_remove(positions); }
+    static std::vector<size_t> select(v7::Transaction& tr, const Store& store, const core::Query& query)
+    {
+        return select_data(tr, store, query);
+    }
+};
+
+/**
+ * Sort positions in the data tables in the same order as the ORDER BY clause
+ * of DataQueryBuilder
+ */
+void sort_results(const Store& store, unsigned modifiers, bool station_vars, std::vector<size_t>& rows)
+{
+    if (modifiers & DBA_DB_MODIFIER_UNSORTED) return;
+
+    // Precompute the sort keys
+    struct Row
+    {
+        size_t pos;
+        size_t st;
+        LevTrKey ltr;
+    };
+    std::vector<Row> keys;
+    keys.reserve(rows.size());
+    const StationTable& station = store.station;
+    const LevTrTable& levtr = store.levtr;
+    for (auto pos: rows)
+    {
+        Row row;
+        row.pos = pos;
+        if (station_vars)
+            row.st = station.find(store.station_data.id_station[pos]);
+        else {
+            row.st = station.find(store.data.id_station[pos]);
+            size_t ltr = levtr.find(store.data.id_levtr[pos]);
+            row.ltr = LevTrTable::make_key(levtr.level[ltr], levtr.trange[ltr]);
+        }
+        keys.push_back(row);
+    }
+
+    bool best = modifiers & DBA_DB_MODIFIER_BEST;
+    std::sort(keys.begin(), keys.end(), [&](const Row& a, const Row& b) {
+        if (best)
+        {
+            if (station.lat[a.st] != station.lat[b.st]) return station.lat[a.st] < station.lat[b.st];
+            if (station.lon[a.st] != station.lon[b.st]) return station.lon[a.st] < station.lon[b.st];
+            // Ident::compare sorts missing idents first, like NULLs in SQL
+            if (int res = station.ident[a.st].compare(station.ident[b.st])) return res < 0;
+        } else {
+            if (station.id[a.st] != station.id[b.st]) return station.id[a.st] < station.id[b.st];
+        }
+        if (!station_vars)
+        {
+            const Datetime& dta = store.data.datetime[a.pos];
+            const Datetime& dtb = store.data.datetime[b.pos];
+            if (dta != dtb) return dta < dtb;
+            if (a.ltr != b.ltr) return a.ltr < b.ltr;
+        }
+        if (modifiers & (DBA_DB_MODIFIER_BEST | DBA_DB_MODIFIER_LAST))
+            if (station.rep[a.st] != station.rep[b.st]) return station.rep[a.st] < station.rep[b.st];
+        if (station_vars)
+            return store.station_data.code[a.pos] < store.station_data.code[b.pos];
+        else
+            return store.data.code[a.pos] < store.data.code[b.pos];
+    });
+
+    for (size_t i = 0; i < keys.size(); ++i)
+        rows[i] = keys[i].pos;
+}
+
+/// Apply the query result limit
+void apply_limit(const core::Query& query, std::vector<size_t>& rows)
+{
+    if (query.limit != MISSING_INT && (size_t)query.limit < rows.size())
+        rows.resize(query.limit);
+}
+
+/// Fill station with the information of the given station id, if it changed
+void load_station(v7::Transaction& tr, const Store& store, int id_station, dballe::DBStation& station)
+{
+    if (id_station == station.id) return;
+    size_t pos = store.station.find(id_station);
+    station.id = id_station;
+    station.report = tr.repinfo().get_rep_memo(store.station.rep[pos]);
+    station.coords.lat = store.station.lat[pos];
+    station.coords.lon = store.station.lon[pos];
+    station.ident = store.station.ident[pos];
+}
+
+}
+
+template class MemoryDataCommon<StationData>;
+template class MemoryDataCommon<Data>;
+
+template<typename Parent>
+MemoryDataCommon<Parent>::MemoryDataCommon(v7::Transaction& tr, MemoryConnection& conn)
+    : Parent(tr), conn(conn)
+{
+}
+
+template<typename Parent>
+MemoryDataCommon<Parent>::~MemoryDataCommon()
+{
+}
+
+template<typename Parent>
+void MemoryDataCommon<Parent>::read_attrs(Tracer<>& trc, int id_data, std::function<void(std::unique_ptr<wreport::Var>)> dest)
+{
+    const auto& table = Access<Parent>::table(conn.store);
+    size_t pos = table.find(id_data);
+    if (pos == table.size()) return;
+    for (const Var* a = table.var(pos).next_attr(); a != nullptr; a = a->next_attr())
+        dest(unique_ptr<Var>(new Var(*a)));
+}
+
+template<typename Parent>
+void MemoryDataCommon<Parent>::write_attrs(Tracer<>& trc, int id_data, const Values& values)
+{
+    const auto& table = Access<Parent>::table(conn.store);
+    size_t pos = table.find(id_data);
+    if (pos == table.size()) return;
+    unique_ptr<Var> var = copy_var(table.var(pos), false);
+    for (const auto& v: values)
+        var->seta(*copy_var(*v, false));
+    Access<Parent>::update(conn.store, pos, move(var));
+}
+
+template<typename Parent>
+void MemoryDataCommon<Parent>::remove_all_attrs(Tracer<>& trc, int id_data)
+{
+    const auto& table = Access<Parent>::table(conn.store);
+    size_t pos = table.find(id_data);
+    if (pos == table.size()) return;
+    Access<Parent>::update(conn.store, pos, copy_var(table.var(pos), false));
+}
+
+template<typename Parent>
+void MemoryDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb)
+{
+    const auto& table = Access<Parent>::table(conn.store);
+    std::vector<size_t> rows = Access<Parent>::select(this->tr, conn.store, qb.query);
+    apply_limit(qb.query, rows);
+
+    if (!qb.query.attr_filter.empty())
+    {
+        std::unique_ptr<Varmatch> attr_filter = Varmatch::parse(qb.query.attr_filter);
+        auto end = std::remove_if(rows.begin(), rows.end(), [&](size_t pos) {
+            for (const Var* a = table.var(pos).next_attr(); a != nullptr; a = a->next_attr())
+                if ((*attr_filter)(*a))
+                    return false;
+            return true;
+        });
+        rows.erase(end, rows.end());
+    }
+
+    std::sort(rows.begin(), rows.end());
+    Access<Parent>::remove(conn.store, rows);
+}
+
+template<typename Parent>
+void MemoryDataCommon<Parent>::remove_by_id(Tracer<>& trc, int id)
+{
+    const auto& table = Access<Parent>::table(conn.store);
+    size_t pos = table.find(id);
+    if (pos == table.size()) return;
+    Access<Parent>::remove(conn.store, pos);
+}
+
+template<typename Parent>
+void MemoryDataCommon<Parent>::update(Tracer<>& trc, std::vector<typename Parent::BatchValue>& vars, bool with_attrs)
+{
+    const auto& table = Access<Parent>::table(conn.store);
+    for (auto& v: vars)
+    {
+        size_t pos = table.find(v.id);
+        if (pos == table.size()) continue;
+        Access<Parent>::update(conn.store, pos, copy_var(*v.var, with_attrs));
+    }
+}
+
+
+void MemoryStationData::query(Tracer<>& trc, int id_station, std::function<void(int id, wreport::Varcode code)> dest)
+{
+    const StationDataTable& table = conn.store.station_data;
+    for (auto i = table.by_key.lower_bound(make_pair(id_station, (Varcode)0));
+            i != table.by_key.end() && i->first.first == id_station; ++i)
+        dest(i->second, i->first.second);
+}
+
+void MemoryStationData::insert(Tracer<>& trc, int id_station, std::vector<batch::StationDatum>& vars, bool with_attrs)
+{
+    std::sort(vars.begin(), vars.end());
+    for (auto v = vars.begin(); v != vars.end(); ++v)
+    {
+        // Skip duplicates
+        auto next = v + 1;
+        if (next != vars.end() && *v == *next)
+            continue;
+        v->id = conn.store.station_data_insert(id_station, copy_var(*v->var, with_attrs));
+    }
+}
+
+void MemoryStationData::run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)> dest)
+{
+    const Store& store = conn.store;
+    const StationDataTable& table = store.station_data;
+    std::vector<size_t> rows = select_station_data(tr, store, qb.query);
+    sort_results(store, qb.modifiers, true, rows);
+    apply_limit(qb.query, rows);
+
+    dballe::DBStation station;
+    for (auto pos: rows)
+    {
+        unique_ptr<Var> var(new Var(table.var(pos), qb.select_attrs));
+
+        // Postprocessing filter of attr_filter
+        if (qb.attr_filter && !qb.match_attrs(*var))
+            continue;
+
+        load_station(tr, store, table.id_station[pos], station);
+        dest(station, table.id[pos], move(var));
+    }
+}
+
+void MemoryStationData::dump(FILE* out)
+{
+    StationDataDumper dumper(out);
+
+    dumper.print_head();
+    const StationDataTable& table = conn.store.station_data;
+    for (size_t pos = 0; pos < table.size(); ++pos)
+    {
+        const Var& var = table.var(pos);
+        dumper.print_row(table.id[pos], table.id_station[pos], table.code[pos], var.enqc(), Values::encode_attrs(var));
+    }
+    dumper.print_tail();
+}
+
+
+void MemoryData::query(Tracer<>& trc, int id_station, const Datetime& datetime, std::function<void(int id, int id_levtr, wreport::Varcode code)> dest)
+{
+    const DataTable& table = conn.store.data;
+    for (auto i = table.by_key.lower_bound(DataKey(id_station, datetime, INT_MIN, 0));
+            i != table.by_key.end() && std::get<0>(i->first) == id_station && std::get<1>(i->first) == datetime; ++i)
+        dest(i->second, std::get<2>(i->first), std::get<3>(i->first));
+}
+
+void MemoryData::insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs)
+{
+    std::sort(vars.begin(), vars.end());
+    for (auto v = vars.begin(); v != vars.end(); ++v)
+    {
+        // Skip duplicates
+        auto next = v + 1;
+        if (next != vars.end() && *v == *next)
+            continue;
+        v->id = conn.store.data_insert(id_station, v->id_levtr, datetime, copy_var(*v->var, with_attrs));
+    }
+}
+
+void MemoryData::run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)> dest)
+{
+    conn.store.load_archive(qb.query);
+    const Store& store = conn.store;
+    const DataTable& table = store.data;
+    std::vector<size_t> rows = select_data(tr, store, qb.query);
+    sort_results(store, qb.modifiers, false, rows);
+    apply_limit(qb.query, rows);
+
+    dballe::DBStation station;
+    for (auto pos: rows)
+    {
+        unique_ptr<Var> var(new Var(table.var(pos), qb.select_attrs));
+
+        // Postprocessing filter of attr_filter
+        if (qb.attr_filter && !qb.match_attrs(*var))
+            continue;
+
+        load_station(tr, store, table.id_station[pos], station);
+        dest(station, table.id_levtr[pos], table.datetime[pos], table.id[pos], move(var));
+    }
+}
+
+void MemoryData::run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)> dest)
+{
+    struct Entry
+    {
+        size_t count = 0;
+        Datetime dtmin;
+        Datetime dtmax;
+    };
+
+    conn.store.load_archive(qb.query);
+    const Store& store = conn.store;
+    const DataTable& table = store.data;
+    std::map<std::tuple<int, int, wreport::Varcode>, Entry> summary;
+    for (auto pos: select_data(tr, store, qb.query))
+    {
+        Entry& e = summary[std::make_tuple(table.id_station[pos], table.id_levtr[pos], table.code[pos])];
+        const Datetime& dt = table.datetime[pos];
+        if (e.count == 0)
+        {
+            e.dtmin = dt;
+            e.dtmax = dt;
+        } else {
+            if (dt < e.dtmin) e.dtmin = dt;
+            if (dt > e.dtmax) e.dtmax = dt;
+        }
+        ++e.count;
+    }
+
+    int limit = qb.query.limit;
+    dballe::DBStation station;
+    for (const auto& i: summary)
+    {
+        if (limit != MISSING_INT && limit-- <= 0) break;
+        load_station(tr, store, std::get<0>(i.first), station);
+        size_t count = 0;
+        DatetimeRange datetime;
+        if (qb.select_summary_details)
+        {
+            count = i.second.count;
+            datetime = DatetimeRange(i.second.dtmin, i.second.dtmax);
+        }
+        dest(station, std::get<1>(i.first), std::get<2>(i.first), datetime, count);
+    }
+}
+
+void MemoryData::dump(FILE* out)
+{
+    DataDumper dumper(out);
+
+    dumper.print_head();
+    conn.store.load_archive(core::Query());
+    const DataTable& table = conn.store.data;
+    for (size_t pos = 0; pos < table.size(); ++pos)
+    {
+        const Var& var = table.var(pos);
+        dumper.print_row(table.id[pos], table.id_station[pos], table.id_levtr[pos], table.datetime[pos], table.code[pos], var.enqc(), Values::encode_attrs(var));
+    }
+    dumper.print_tail();
+}
+
+}
+}
+}
+}
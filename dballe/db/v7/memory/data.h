@@ -0,0 +1,72 @@
+#ifndef DBALLE_DB_V7_MEMORY_DATA_H
+#define DBALLE_DB_V7_MEMORY_DATA_H
+
+#include <dballe/db/v7/data.h>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+class MemoryConnection;
+
+// Partial implementation of the common parts of StationData and Data
+template<typename Parent>
+class MemoryDataCommon : public Parent
+{
+protected:
+    /// DB connection
+    MemoryConnection& conn;
+
+public:
+    MemoryDataCommon(v7::Transaction& tr, MemoryConnection& conn);
+    MemoryDataCommon(const MemoryDataCommon&) = delete;
+    MemoryDataCommon(const MemoryDataCommon&&) = delete;
+    MemoryDataCommon& operator=(const MemoryDataCommon&) = delete;
+    ~MemoryDataCommon();
+
+    void update(Tracer<>& trc, std::vector<typename Parent::BatchValue>& vars, bool with_attrs) override;
+    void read_attrs(Tracer<>& trc, int id_data, std::function<void(std::unique_ptr<wreport::Var>)> dest) override;
+    void write_attrs(Tracer<>& trc, int id_data, const Values& values) override;
+    void remove_all_attrs(Tracer<>& trc, int id_data) override;
+    void remove(Tracer<>& trc, const v7::IdQueryBuilder& qb) override;
+    void remove_by_id(Tracer<>& trc, int id) override;
+    void clear_cache() override {}
+};
+
+extern template class MemoryDataCommon<StationData>;
+extern template class MemoryDataCommon<Data>;
+
+/**
+ * Access the station_data table of an in-memory database
+ */
+class MemoryStationData : public MemoryDataCommon<StationData>
+{
+public:
+    using MemoryDataCommon::MemoryDataCommon;
+
+    void query(Tracer<>& trc, int id_station, std::function<void(int id, wreport::Varcode code)> dest) override;
+    void insert(Tracer<>& trc, int id_station, std::vector<batch::StationDatum>& vars, bool with_attrs) override;
+    void run_station_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    void dump(FILE* out) override;
+};
+
+/**
+ * Access the data table of an in-memory database
+ */
+class MemoryData : public MemoryDataCommon<Data>
+{
+public:
+    using MemoryDataCommon::MemoryDataCommon;
+
+    void query(Tracer<>& trc, int id_station, const Datetime& datetime, std::function<void(int id, int id_levtr, wreport::Varcode code)> dest) override;
+    void insert(Tracer<>& trc, int id_station, const Datetime& datetime, std::vector<batch::MeasuredDatum>& vars, bool with_attrs) override;
+    void run_data_query(Tracer<>& trc, const v7::DataQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, const Datetime& datetime, int id_data, std::unique_ptr<wreport::Var> var)>) override;
+    void run_summary_query(Tracer<>& trc, const v7::SummaryQueryBuilder& qb, std::function<void(const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t size)>) override;
+    void dump(FILE* out) override;
+};
+
+}
+}
+}
+}
+#endif
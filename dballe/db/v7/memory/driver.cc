@@ -0,0 +1,199 @@
+#include "driver.h"
+#include "connection.h"
+#include "repinfo.h"
+#include "station.h"
+#include "levtr.h"
+#include "data.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/core/query.h"
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+
+Driver::Driver(MemoryConnection& conn)
+    : v7::Driver(conn), conn(conn)
+{
+}
+
+Driver::~Driver()
+{
+}
+
+std::unique_ptr<v7::Repinfo> Driver::create_repinfo(v7::Transaction& tr)
+{
+    return unique_ptr<v7::Repinfo>(new MemoryRepinfo(conn));
+}
+
+std::unique_ptr<v7::Station> Driver::create_station(v7::Transaction& tr)
+{
+    return unique_ptr<v7::Station>(new MemoryStation(tr, conn));
+}
+
+std::unique_ptr<v7::LevTr> Driver::create_levtr(v7::Transaction& tr)
+{
+    return unique_ptr<v7::LevTr>(new MemoryLevTr(tr, conn));
+}
+
+std::unique_ptr<v7::StationData> Driver::create_station_data(v7::Transaction& tr)
+{
+    return unique_ptr<v7::StationData>(new MemoryStationData(tr, conn));
+}
+
+std::unique_ptr<v7::Data> Driver::create_data(v7::Transaction& tr)
+{
+    return unique_ptr<v7::Data>(new MemoryData(tr, conn));
+}
+
+void Driver::create_tables_v7()
+{
+    conn.store.create_tables();
+    conn.set_setting("version", "V7");
+}
+
+void Driver::delete_tables_v7()
+{
+    conn.store.drop_tables();
+    conn.drop_settings();
+}
+
+void Driver::remove_all_v7()
+{
+    conn.store.check_tables("data");
+    conn.store.remove_all();
+}
+
+void Driver::vacuum_v7()
+{
+    Store& store = conn.store;
+    store.check_tables("data");
+
+    // Delete levels and time ranges with no data
+    set<int> used;
+    used.insert(store.data.id_levtr.begin(), store.data.id_levtr.end());
+    vector<size_t> unused;
+    for (size_t pos = 0; pos < store.levtr.size(); ++pos)
+        if (used.find(store.levtr.id[pos]) == used.end())
+            unused.push_back(pos);
+    store.levtr_remove(unused);
+
+    // Delete stations with no data, and their station values
+    used.clear();
+    used.insert(store.data.id_station.begin(), store.data.id_station.end());
+    unused.clear();
+    for (size_t pos = 0; pos < store.station_data.size(); ++pos)
+        if (used.find(store.station_data.id_station[pos]) == used.end())
+            unused.push_back(pos);
+    store.station_data_remove(unused);
+    unused.clear();
+    for (size_t pos = 0; pos < store.station.size(); ++pos)
+        if (used.find(store.station.id[pos]) == used.end())
+            unused.push_back(pos);
+    store.station_remove(unused);
+}
+
+bool Driver::data_id_range_v7(int& id_min, int& id_max)
+{
+    conn.store.load_archive(core::Query());
+    const DataTable& data = conn.store.data;
+    if (data.size() == 0) return false;
+    id_min = data.id.front();
+    id_max = data.id.back();
+    return true;
+}
+
+bool Driver::data_next_batch_v7(const Datetime& until, int last_id, unsigned batch_size, int& batch_last)
+{
+    core::Query query;
+    query.dtrange.max = until;
+    conn.store.load_archive(query);
+    const DataTable& data = conn.store.data;
+    size_t pos = upper_bound(data.id.begin(), data.id.end(), last_id) - data.id.begin();
+    unsigned count = 0;
+    for ( ; pos < data.size() && count < batch_size; ++pos)
+        if (data.datetime[pos] < until)
+        {
+            batch_last = data.id[pos];
+            ++count;
+        }
+    return count > 0;
+}
+
+unsigned Driver::purge_data_v7(const Datetime& until, int id_first, int id_last)
+{
+    Store& store = conn.store;
+    const DataTable& data = store.data;
+
+    // Ids are sorted, so the range is contiguous
+    size_t begin = lower_bound(data.id.begin(), data.id.end(), id_first) - data.id.begin();
+    size_t end = upper_bound(data.id.begin(), data.id.end(), id_last) - data.id.begin();
+
+    vector<size_t> positions;
+    for (size_t pos = begin; pos < end; ++pos)
+        if (data.datetime[pos] < until)
+            positions.push_back(pos);
+    store.data_remove(positions);
+    return positions.size();
+}
+
+
+bool Driver::upgrade_attrs_v7(const char* table, unsigned batch_size, int& last_id, unsigned& rewritten)
+{
+    // Attributes are kept decoded in memory, so there is nothing to reencode
+    return false;
+}
+
+void Driver::create_summary_v7()
+{
+    // Summary queries are computed by scanning the in-memory indices
+    throw error_unimplemented("in-memory databases do not support a summary table");
+}
+
+void Driver::drop_summary_v7()
+{
+}
+
+void Driver::summary_add_v7(const std::vector<SummaryTableRow>& rows)
+{
+    throw error_unimplemented("in-memory databases do not support a summary table");
+}
+
+void Driver::summary_keys_v7(const std::string& where, std::vector<SummaryTableRow>& keys)
+{
+    throw error_unimplemented("in-memory databases do not support a summary table");
+}
+
+void Driver::data_keys_v7(int id_first, int id_last, const Datetime& until, std::vector<SummaryTableRow>& keys)
+{
+    const DataTable& data = conn.store.data;
+
+    // Ids are sorted, so the range is contiguous
+    size_t begin = lower_bound(data.id.begin(), data.id.end(), id_first) - data.id.begin();
+    size_t end = upper_bound(data.id.begin(), data.id.end(), id_last) - data.id.begin();
+
+    std::set<std::tuple<int, int, wreport::Varcode>> found;
+    for (size_t pos = begin; pos < end; ++pos)
+    {
+        if (!until.is_missing() && !(data.datetime[pos] < until))
+            continue;
+        if (found.emplace(data.id_station[pos], data.id_levtr[pos], data.code[pos]).second)
+            keys.emplace_back(data.id_station[pos], data.id_levtr[pos], data.code[pos]);
+    }
+}
+
+void Driver::summary_refresh_v7(const std::vector<SummaryTableRow>& keys)
+{
+    throw error_unimplemented("in-memory databases do not support a summary table");
+}
+
+}
+}
+}
+}
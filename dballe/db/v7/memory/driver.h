@@ -0,0 +1,48 @@
+#ifndef DBALLE_DB_V7_MEMORY_DRIVER_H
+#define DBALLE_DB_V7_MEMORY_DRIVER_H
+
+#include <dballe/db/v7/driver.h>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+class MemoryConnection;
+
+/**
+ * v7 driver storing the database tables in memory, as sorted columns, instead
+ * of going through SQL
+ */
+struct Driver : public v7::Driver
+{
+    MemoryConnection& conn;
+
+    Driver(MemoryConnection& conn);
+    virtual ~Driver();
+
+    std::unique_ptr<v7::Repinfo> create_repinfo(v7::Transaction& tr) override;
+    std::unique_ptr<v7::Station> create_station(v7::Transaction& tr) override;
+    std::unique_ptr<v7::LevTr> create_levtr(v7::Transaction& tr) override;
+    std::unique_ptr<v7::StationData> create_station_data(v7::Transaction& tr) override;
+    std::unique_ptr<v7::Data> create_data(v7::Transaction& tr) override;
+    void create_tables_v7() override;
+    void delete_tables_v7() override;
+    void remove_all_v7() override;
+    void vacuum_v7() override;
+    bool data_id_range_v7(int& id_min, int& id_max) override;
+    bool data_next_batch_v7(const Datetime& until, int last_id, unsigned batch_size, int& batch_last) override;
+    unsigned purge_data_v7(const Datetime& until, int id_first, int id_last) override;
+    bool upgrade_attrs_v7(const char* table, unsigned batch_size, int& last_id, unsigned& rewritten) override;
+    void create_summary_v7() override;
+    void drop_summary_v7() override;
+    void summary_add_v7(const std::vector<SummaryTableRow>& rows) override;
+    void summary_keys_v7(const std::string& where, std::vector<SummaryTableRow>& keys) override;
+    void data_keys_v7(int id_first, int id_last, const Datetime& until, std::vector<SummaryTableRow>& keys) override;
+    void summary_refresh_v7(const std::vector<SummaryTableRow>& keys) override;
+};
+
+}
+}
+}
+}
+#endif
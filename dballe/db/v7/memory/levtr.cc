@@ -0,0 +1,70 @@
+#include "levtr.h"
+#include "connection.h"
+#include "dballe/db/v7/transaction.h"
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+
+MemoryLevTr::MemoryLevTr(v7::Transaction& tr, MemoryConnection& conn)
+    : v7::LevTr(tr), conn(conn)
+{
+}
+
+MemoryLevTr::~MemoryLevTr()
+{
+}
+
+void MemoryLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+{
+    const LevTrTable& table = conn.store.levtr;
+    for (auto id: ids)
+    {
+        if (cache.find_entry(id)) continue;
+        size_t pos = table.find(id);
+        if (pos == table.size()) continue;
+        cache.insert(unique_ptr<LevTrEntry>(new LevTrEntry(id, table.level[pos], table.trange[pos])));
+    }
+}
+
+const LevTrEntry* MemoryLevTr::lookup_id(Tracer<>& trc, int id)
+{
+    // First look it up in the transaction cache
+    const LevTrEntry* res = cache.find_entry(id);
+    if (res) return res;
+
+    const LevTrTable& table = conn.store.levtr;
+    size_t pos = table.find(id);
+    if (pos == table.size())
+        error_notfound::throwf("levtr with id %d not found in the database", id);
+
+    return cache.insert(unique_ptr<LevTrEntry>(new LevTrEntry(id, table.level[pos], table.trange[pos])));
+}
+
+int MemoryLevTr::obtain_id(Tracer<>& trc, const LevTrEntry& desc)
+{
+    int id = cache.find_id(desc);
+    if (id != MISSING_INT) return id;
+
+    id = conn.store.levtr.find_id(desc.level, desc.trange);
+    if (id == MISSING_INT)
+        id = conn.store.levtr_insert(desc.level, desc.trange);
+    cache.insert(desc, id);
+    return id;
+}
+
+void MemoryLevTr::_dump(std::function<void(int, const Level&, const Trange&)> out)
+{
+    const LevTrTable& table = conn.store.levtr;
+    for (size_t pos = 0; pos < table.size(); ++pos)
+        out(table.id[pos], table.level[pos], table.trange[pos]);
+}
+
+}
+}
+}
+}
@@ -0,0 +1,42 @@
+#ifndef DBALLE_DB_V7_MEMORY_LEVTR_H
+#define DBALLE_DB_V7_MEMORY_LEVTR_H
+
+#include <dballe/db/v7/levtr.h>
+#include <cstdio>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+class MemoryConnection;
+
+/**
+ * Access the levtr table of an in-memory database
+ */
+struct MemoryLevTr : public v7::LevTr
+{
+protected:
+    /**
+     * DB connection.
+     */
+    MemoryConnection& conn;
+
+    void _dump(std::function<void(int, const Level&, const Trange&)> out) override;
+
+public:
+    MemoryLevTr(v7::Transaction& tr, MemoryConnection& conn);
+    MemoryLevTr(const LevTr&) = delete;
+    MemoryLevTr(const LevTr&&) = delete;
+    MemoryLevTr& operator=(const MemoryLevTr&) = delete;
+    ~MemoryLevTr();
+
+    void prefetch_ids(Tracer<>& trc, const std::set<int>& id) override;
+    const LevTrEntry* lookup_id(Tracer<>& trc, int id) override;
+    int obtain_id(Tracer<>& trc, const LevTrEntry& desc) override;
+};
+
+}
+}
+}
+}
+#endif
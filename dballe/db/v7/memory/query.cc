@@ -0,0 +1,346 @@
+#include "query.h"
+#include "connection.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/repinfo.h"
+#include "dballe/core/query.h"
+#include "dballe/core/varmatch.h"
+#include <algorithm>
+#include <climits>
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+
+namespace {
+
+/// Lowest possible datetime, used as the start of index ranges
+const Datetime datetime_min(0, 1, 1, 0, 0, 0);
+
+}
+
+
+/*
+ * StationFilter
+ */
+
+StationFilter::StationFilter(v7::Transaction& tr, const Store& store, const core::Query& query, bool with_prio)
+    : store(store), query(query)
+{
+    if (query.ana_id != MISSING_INT
+            || !query.latrange.is_missing()
+            || !query.lonrange.is_missing()
+            || query.mobile != MISSING_INT
+            || !query.ident.is_missing()
+            || query.block != MISSING_INT
+            || query.station != MISSING_INT)
+        match_all = false;
+
+    if (!query.ana_filter.empty())
+    {
+        ana_filter = Varmatch::parse(query.ana_filter);
+        match_all = false;
+    }
+
+    if (with_prio && (query.priomin != MISSING_INT || query.priomax != MISSING_INT))
+    {
+        std::vector<int> ids = tr.repinfo().ids_by_prio(query);
+        if (ids.empty())
+            match_none = true;
+        has_reps = true;
+        reps.insert(ids.begin(), ids.end());
+        match_all = false;
+    }
+
+    if (!query.report.empty())
+    {
+        int rep = tr.repinfo().get_id(query.report.c_str());
+        if (rep == -1)
+            match_none = true;
+        else if (has_reps) {
+            if (reps.find(rep) == reps.end())
+                match_none = true;
+            reps.clear();
+            reps.insert(rep);
+        } else {
+            has_reps = true;
+            reps.insert(rep);
+        }
+        match_all = false;
+    }
+}
+
+StationFilter::~StationFilter()
+{
+}
+
+const wreport::Var* StationFilter::station_var(int id_station, wreport::Varcode code) const
+{
+    auto i = store.station_data.by_key.find(make_pair(id_station, code));
+    if (i == store.station_data.by_key.end()) return nullptr;
+    return store.station_data.value[store.station_data.find(i->second)].get();
+}
+
+bool StationFilter::match(size_t pos) const
+{
+    if (match_none) return false;
+    if (match_all) return true;
+
+    const StationTable& st = store.station;
+
+    if (query.ana_id != MISSING_INT && st.id[pos] != query.ana_id)
+        return false;
+
+    if (!query.latrange.is_missing())
+    {
+        int lat = st.lat[pos];
+        if (query.latrange.imin == query.latrange.imax)
+        {
+            if (lat != query.latrange.imin) return false;
+        } else {
+            if (query.latrange.imin != LatRange::IMIN && lat < query.latrange.imin) return false;
+            if (query.latrange.imax != LatRange::IMAX && lat > query.latrange.imax) return false;
+        }
+    }
+
+    if (!query.lonrange.is_missing())
+    {
+        int lon = st.lon[pos];
+        if (query.lonrange.imin == query.lonrange.imax)
+        {
+            if (lon != query.lonrange.imin) return false;
+        } else if (query.lonrange.imin < query.lonrange.imax) {
+            if (lon < query.lonrange.imin || lon > query.lonrange.imax) return false;
+        } else {
+            // The range wraps around the antimeridian
+            if (!((lon >= query.lonrange.imin && lon <= 18000000) || (lon >= -18000000 && lon <= query.lonrange.imax)))
+                return false;
+        }
+    }
+
+    if (query.mobile != MISSING_INT)
+    {
+        if (query.mobile == 0)
+        {
+            if (!st.ident[pos].is_missing()) return false;
+        } else {
+            if (st.ident[pos].is_missing()) return false;
+        }
+    }
+
+    if (!query.ident.is_missing())
+    {
+        if (st.ident[pos].is_missing() || st.ident[pos].compare(query.ident) != 0)
+            return false;
+    }
+
+    if (has_reps && reps.find(st.rep[pos]) == reps.end())
+        return false;
+
+    if (query.block != MISSING_INT)
+    {
+        const Var* var = station_var(st.id[pos], WR_VAR(0, 1, 1));
+        if (!var || !var->isset() || var->enqi() != query.block) return false;
+    }
+
+    if (query.station != MISSING_INT)
+    {
+        const Var* var = station_var(st.id[pos], WR_VAR(0, 1, 2));
+        if (!var || !var->isset() || var->enqi() != query.station) return false;
+    }
+
+    if (ana_filter)
+    {
+        const Var* var = station_var(st.id[pos], ana_filter->code);
+        if (!var || !(*ana_filter)(*var)) return false;
+    }
+
+    return true;
+}
+
+std::set<int> StationFilter::select() const
+{
+    std::set<int> res;
+    if (match_none) return res;
+
+    if (query.ana_id != MISSING_INT)
+    {
+        // Only one candidate
+        size_t pos = store.station.find(query.ana_id);
+        if (pos != store.station.size() && match(pos))
+            res.insert(query.ana_id);
+        return res;
+    }
+
+    for (size_t pos = 0; pos < store.station.size(); ++pos)
+        if (match(pos))
+            res.insert(res.end(), store.station.id[pos]);
+    return res;
+}
+
+
+/*
+ * ValueFilter
+ */
+
+ValueFilter::ValueFilter(const core::Query& query, bool with_context)
+    : query(query), with_context(with_context)
+{
+    if (!query.data_filter.empty())
+        data_filter = Varmatch::parse(query.data_filter);
+}
+
+ValueFilter::~ValueFilter()
+{
+}
+
+bool ValueFilter::match_code(wreport::Varcode code) const
+{
+    if (!query.varcodes.empty() && query.varcodes.find(code) == query.varcodes.end())
+        return false;
+    if (data_filter && data_filter->code != code)
+        return false;
+    return true;
+}
+
+bool ValueFilter::match_datetime(const Datetime& dt) const
+{
+    if (!with_context || query.dtrange.is_missing()) return true;
+    const Datetime& dtmin = query.dtrange.min;
+    const Datetime& dtmax = query.dtrange.max;
+    if (dtmin == dtmax)
+        return dt == dtmin;
+    if (!dtmin.is_missing() && dt < dtmin) return false;
+    if (!dtmax.is_missing() && dt > dtmax) return false;
+    return true;
+}
+
+bool ValueFilter::match_levtr(const Level& level, const Trange& trange) const
+{
+    if (!with_context) return true;
+    if (query.level.ltype1 != MISSING_INT && level.ltype1 != query.level.ltype1) return false;
+    if (query.level.l1 != MISSING_INT && level.l1 != query.level.l1) return false;
+    if (query.level.ltype2 != MISSING_INT && level.ltype2 != query.level.ltype2) return false;
+    if (query.level.l2 != MISSING_INT && level.l2 != query.level.l2) return false;
+    if (query.trange.pind != MISSING_INT && trange.pind != query.trange.pind) return false;
+    if (query.trange.p1 != MISSING_INT && trange.p1 != query.trange.p1) return false;
+    if (query.trange.p2 != MISSING_INT && trange.p2 != query.trange.p2) return false;
+    return true;
+}
+
+bool ValueFilter::match_value(const wreport::Var& var) const
+{
+    if (!data_filter) return true;
+    return (*data_filter)(var);
+}
+
+
+/*
+ * Selection
+ */
+
+std::vector<size_t> select_station_data(v7::Transaction& tr, const Store& store, const core::Query& query)
+{
+    std::vector<size_t> res;
+    StationFilter sf(tr, store, query, true);
+    if (sf.match_none) return res;
+    ValueFilter vf(query, false);
+    const StationDataTable& table = store.station_data;
+
+    std::vector<int> ids;
+    if (!sf.match_all)
+    {
+        // Use the (id_station, code) index to only look at the values of the
+        // matching stations
+        for (int id_station: sf.select())
+        {
+            for (auto i = table.by_key.lower_bound(make_pair(id_station, (Varcode)0));
+                    i != table.by_key.end() && i->first.first == id_station; ++i)
+                if (vf.match_code(i->first.second))
+                    ids.push_back(i->second);
+        }
+        std::sort(ids.begin(), ids.end());
+        for (auto id: ids)
+        {
+            size_t pos = table.find(id);
+            if (vf.match_value(table.var(pos)))
+                res.push_back(pos);
+        }
+    } else {
+        for (size_t pos = 0; pos < table.size(); ++pos)
+            if (vf.match_code(table.code[pos]) && vf.match_value(table.var(pos)))
+                res.push_back(pos);
+    }
+    return res;
+}
+
+std::vector<size_t> select_data(v7::Transaction& tr, const Store& store, const core::Query& query)
+{
+    std::vector<size_t> res;
+    StationFilter sf(tr, store, query, true);
+    if (sf.match_none) return res;
+    ValueFilter vf(query, true);
+    const DataTable& table = store.data;
+    const LevTrTable& levtr = store.levtr;
+
+    Datetime dtmin = query.dtrange.min;
+    Datetime dtmax = query.dtrange.max;
+    if (dtmin.is_missing()) dtmin = datetime_min;
+
+    // Pick the index that narrows down the candidates the most
+    std::vector<int> ids;
+    bool all_ids = false;
+    if (!sf.match_all)
+    {
+        for (int id_station: sf.select())
+        {
+            for (auto i = table.by_key.lower_bound(DataKey(id_station, dtmin, INT_MIN, 0));
+                    i != table.by_key.end() && std::get<0>(i->first) == id_station; ++i)
+            {
+                if (!dtmax.is_missing() && dtmax < std::get<1>(i->first)) break;
+                ids.push_back(i->second);
+            }
+        }
+    } else if (!query.varcodes.empty() || vf.data_filter) {
+        std::set<Varcode> codes;
+        if (query.varcodes.empty())
+            codes.insert(vf.data_filter->code);
+        else
+            codes = query.varcodes;
+        for (auto code: codes)
+        {
+            auto i = table.by_code.find(code);
+            if (i == table.by_code.end()) continue;
+            ids.insert(ids.end(), i->second.begin(), i->second.end());
+        }
+    } else if (!query.dtrange.is_missing()) {
+        auto end = dtmax.is_missing() ? table.by_datetime.end() : table.by_datetime.upper_bound(dtmax);
+        for (auto i = table.by_datetime.lower_bound(dtmin); i != end; ++i)
+            ids.insert(ids.end(), i->second.begin(), i->second.end());
+    } else
+        all_ids = true;
+
+    if (!all_ids)
+        std::sort(ids.begin(), ids.end());
+
+    size_t count = all_ids ? table.size() : ids.size();
+    for (size_t i = 0; i < count; ++i)
+    {
+        size_t pos = all_ids ? i : table.find(ids[i]);
+        if (!vf.match_code(table.code[pos])) continue;
+        if (!vf.match_datetime(table.datetime[pos])) continue;
+        size_t ltr = levtr.find(table.id_levtr[pos]);
+        if (ltr == levtr.size() || !vf.match_levtr(levtr.level[ltr], levtr.trange[ltr])) continue;
+        if (!vf.match_value(table.var(pos))) continue;
+        res.push_back(pos);
+    }
+    return res;
+}
+
+}
+}
+}
+}
@@ -0,0 +1,99 @@
+#ifndef DBALLE_DB_V7_MEMORY_QUERY_H
+#define DBALLE_DB_V7_MEMORY_QUERY_H
+
+/** @file
+ * Evaluation of v7 queries on in-memory tables.
+ *
+ * This implements the same selection as the SQL generated by
+ * v7::QueryBuilder, working directly on the query and its modifiers.
+ */
+
+#include <dballe/fwd.h>
+#include <dballe/core/fwd.h>
+#include <dballe/db/v7/fwd.h>
+#include <wreport/var.h>
+#include <memory>
+#include <set>
+#include <vector>
+
+namespace dballe {
+struct Varmatch;
+
+namespace db {
+namespace v7 {
+namespace memory {
+struct Store;
+
+/**
+ * Match stations against the station constraints of a query
+ */
+struct StationFilter
+{
+    const Store& store;
+    const core::Query& query;
+    /// True if no station can match
+    bool match_none = false;
+    /// True if all stations match
+    bool match_all = true;
+    /// True if the station report must be one of reps
+    bool has_reps = false;
+    /// Allowed report ids, if has_reps is true
+    std::set<int> reps;
+    /// Parsed ana_filter
+    std::unique_ptr<Varmatch> ana_filter;
+
+    /**
+     * @param with_prio
+     *   Also filter on priomin and priomax, as it is done on data queries
+     */
+    StationFilter(v7::Transaction& tr, const Store& store, const core::Query& query, bool with_prio);
+    ~StationFilter();
+
+    /// Check if the station at the given position in the station table matches
+    bool match(size_t pos) const;
+
+    /// Return the ids of the matching stations
+    std::set<int> select() const;
+
+protected:
+    /// Return the station value with the given code, or nullptr
+    const wreport::Var* station_var(int id_station, wreport::Varcode code) const;
+};
+
+/**
+ * Match values against the value constraints of a query
+ */
+struct ValueFilter
+{
+    const core::Query& query;
+    /// True if constraints on datetime, level and time range are checked
+    bool with_context;
+    /// Parsed data_filter
+    std::unique_ptr<Varmatch> data_filter;
+
+    ValueFilter(const core::Query& query, bool with_context);
+    ~ValueFilter();
+
+    bool match_code(wreport::Varcode code) const;
+    bool match_datetime(const Datetime& dt) const;
+    bool match_levtr(const Level& level, const Trange& trange) const;
+    bool match_value(const wreport::Var& var) const;
+};
+
+/**
+ * Return the positions in the station_data table of the rows matching the
+ * query, in id order
+ */
+std::vector<size_t> select_station_data(v7::Transaction& tr, const Store& store, const core::Query& query);
+
+/**
+ * Return the positions in the data table of the rows matching the query, in
+ * id order
+ */
+std::vector<size_t> select_data(v7::Transaction& tr, const Store& store, const core::Query& query);
+
+}
+}
+}
+}
+#endif
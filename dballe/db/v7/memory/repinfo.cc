@@ -0,0 +1,114 @@
+#include "repinfo.h"
+#include "connection.h"
+#include <algorithm>
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+
+MemoryRepinfo::MemoryRepinfo(MemoryConnection& conn)
+    : Repinfo(conn), conn(conn)
+{
+}
+
+MemoryRepinfo::~MemoryRepinfo()
+{
+}
+
+void MemoryRepinfo::read_cache()
+{
+    conn.store.check_tables("repinfo");
+
+    cache.clear();
+    memo_idx.clear();
+
+    for (const auto& row: conn.store.repinfo)
+        cache_append(row.id, row.memo.c_str(), row.description.c_str(), row.prio, row.descriptor.c_str(), row.tablea);
+
+    // Rebuild the memo index as well
+    rebuild_memo_idx();
+}
+
+void MemoryRepinfo::insert_auto_entry(const char* memo)
+{
+    int id = 0;
+    int prio = 0;
+    for (const auto& row: conn.store.repinfo)
+    {
+        id = max(id, row.id);
+        prio = max(prio, row.prio);
+    }
+
+    RepinfoRow row;
+    row.id = id + 1;
+    row.memo = memo;
+    row.description = memo;
+    row.prio = prio + 1;
+    row.descriptor = "-";
+    row.tablea = 255;
+    conn.store.repinfo_insert(row);
+}
+
+int MemoryRepinfo::id_use_count(unsigned id, const char* name)
+{
+    const auto& rep = conn.store.station.rep;
+    return count(rep.begin(), rep.end(), (int)id);
+}
+
+void MemoryRepinfo::delete_entry(unsigned id)
+{
+    conn.store.repinfo_remove(id);
+}
+
+void MemoryRepinfo::update_entry(const v7::repinfo::Cache& entry)
+{
+    RepinfoRow row;
+    row.id = entry.id;
+    row.memo = entry.new_memo;
+    row.description = entry.new_desc;
+    row.prio = entry.new_prio;
+    row.descriptor = entry.new_descriptor;
+    row.tablea = entry.new_tablea;
+    conn.store.repinfo_update(row);
+}
+
+void MemoryRepinfo::insert_entry(const v7::repinfo::Cache& entry)
+{
+    RepinfoRow row;
+    row.id = entry.id;
+    row.memo = entry.new_memo;
+    row.description = entry.new_desc;
+    row.prio = entry.new_prio;
+    row.descriptor = entry.new_descriptor;
+    row.tablea = entry.new_tablea;
+    conn.store.repinfo_insert(row);
+}
+
+void MemoryRepinfo::dump(FILE* out)
+{
+    fprintf(out, "dump of table repinfo:\n");
+    fprintf(out, "   id   memo   description  prio   desc  tablea\n");
+
+    int count = 0;
+    for (const auto& row: conn.store.repinfo)
+    {
+        fprintf(out, " %4d   %s  %s  %d  %s %d\n",
+                row.id,
+                row.memo.c_str(),
+                row.description.c_str(),
+                row.prio,
+                row.descriptor.c_str(),
+                row.tablea);
+        ++count;
+    }
+    fprintf(out, "%d element%s in table repinfo\n", count, count != 1 ? "s" : "");
+}
+
+}
+}
+}
+}
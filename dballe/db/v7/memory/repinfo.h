@@ -0,0 +1,45 @@
+#ifndef DBALLE_DB_V7_MEMORY_REPINFO_H
+#define DBALLE_DB_V7_MEMORY_REPINFO_H
+
+#include <dballe/db/v7/repinfo.h>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+class MemoryConnection;
+
+/**
+ * Fast cached access to the repinfo table
+ */
+struct MemoryRepinfo : public v7::Repinfo
+{
+    /**
+     * DB connection. The pointer is assumed always valid during the
+     * lifetime of the object
+     */
+    MemoryConnection& conn;
+
+    MemoryRepinfo(MemoryConnection& conn);
+    MemoryRepinfo(const MemoryRepinfo&) = delete;
+    MemoryRepinfo(const MemoryRepinfo&&) = delete;
+    virtual ~MemoryRepinfo();
+    MemoryRepinfo& operator=(const MemoryRepinfo&) = delete;
+
+    void dump(FILE* out) override;
+
+protected:
+    /// Return how many time this ID is used in the database
+    int id_use_count(unsigned id, const char* name) override;
+    void delete_entry(unsigned id) override;
+    void update_entry(const v7::repinfo::Cache& entry) override;
+    void insert_entry(const v7::repinfo::Cache& entry) override;
+    void read_cache() override;
+    void insert_auto_entry(const char* memo) override;
+};
+
+}
+}
+}
+}
+#endif
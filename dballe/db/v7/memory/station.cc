@@ -0,0 +1,128 @@
+#include "station.h"
+#include "connection.h"
+#include "query.h"
+#include "dballe/db/v7/transaction.h"
+#include "dballe/db/v7/repinfo.h"
+#include "dballe/db/v7/qbuilder.h"
+#include "dballe/core/query.h"
+#include "dballe/values.h"
+#include <wreport/var.h>
+#include <sstream>
+
+using namespace wreport;
+using namespace std;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+namespace memory {
+
+MemoryStation::MemoryStation(v7::Transaction& tr, MemoryConnection& conn)
+    : v7::Station(tr), conn(conn)
+{
+}
+
+MemoryStation::~MemoryStation()
+{
+}
+
+DBStation MemoryStation::lookup(Tracer<>& trc, int id_station)
+{
+    const StationTable& table = conn.store.station;
+    size_t pos = table.find(id_station);
+    if (pos == table.size())
+    {
+        stringstream msg;
+        msg << "Station with id " << id_station << " not found";
+        throw std::runtime_error(msg.str());
+    }
+
+    DBStation station;
+    station.id = id_station;
+    station.report = tr.repinfo().get_rep_memo(table.rep[pos]);
+    station.coords.lat = table.lat[pos];
+    station.coords.lon = table.lon[pos];
+    station.ident = table.ident[pos];
+    return station;
+}
+
+int MemoryStation::maybe_get_id(Tracer<>& trc, const dballe::DBStation& st)
+{
+    int rep = tr.repinfo().obtain_id(st.report.c_str());
+    return conn.store.station.find_id(rep, st.coords.lat, st.coords.lon, st.ident);
+}
+
+int MemoryStation::insert_new(Tracer<>& trc, const dballe::DBStation& desc)
+{
+    return conn.store.station_insert(tr.repinfo().get_id(desc.report.c_str()), desc.coords.lat, desc.coords.lon, desc.ident);
+}
+
+void MemoryStation::get_station_vars(Tracer<>& trc, int id_station, std::function<void(std::unique_ptr<wreport::Var>)> dest)
+{
+    // The (id_station, code) index gives the values sorted by code
+    const StationDataTable& table = conn.store.station_data;
+    for (auto i = table.by_key.lower_bound(make_pair(id_station, (Varcode)0));
+            i != table.by_key.end() && i->first.first == id_station; ++i)
+        dest(unique_ptr<Var>(new Var(*table.value[table.find(i->second)])));
+}
+
+void MemoryStation::add_station_vars(Tracer<>& trc, int id_station, DBValues& values)
+{
+    const StationDataTable& table = conn.store.station_data;
+    for (auto i = table.by_key.lower_bound(make_pair(id_station, (Varcode)0));
+            i != table.by_key.end() && i->first.first == id_station; ++i)
+        values.set(unique_ptr<Var>(new Var(*table.value[table.find(i->second)], false)));
+}
+
+void MemoryStation::run_station_query(Tracer<>& trc, const v7::StationQueryBuilder& qb, std::function<void(const dballe::DBStation&)> dest)
+{
+    const Store& store = conn.store;
+    StationFilter filter(tr, store, qb.query, false);
+    if (filter.match_none) return;
+
+    // Querying varcodes on a station query means querying stations that
+    // measure those variables
+    std::set<int> with_vars;
+    if (!qb.query.varcodes.empty())
+    {
+        core::Query vars;
+        vars.varcodes = qb.query.varcodes;
+        conn.store.load_archive(vars);
+        for (auto code: qb.query.varcodes)
+        {
+            auto i = store.data.by_code.find(code);
+            if (i == store.data.by_code.end()) continue;
+            for (auto id: i->second)
+                with_vars.insert(store.data.id_station[store.data.find(id)]);
+        }
+    }
+
+    int limit = qb.query.limit;
+    dballe::DBStation station;
+    for (size_t pos = 0; pos < store.station.size(); ++pos)
+    {
+        if (limit != MISSING_INT && limit <= 0) break;
+        if (!filter.match(pos)) continue;
+        if (!qb.query.varcodes.empty() && with_vars.find(store.station.id[pos]) == with_vars.end()) continue;
+
+        station.id = store.station.id[pos];
+        station.report = tr.repinfo().get_rep_memo(store.station.rep[pos]);
+        station.coords.lat = store.station.lat[pos];
+        station.coords.lon = store.station.lon[pos];
+        station.ident = store.station.ident[pos];
+        dest(station);
+        if (limit != MISSING_INT) --limit;
+    }
+}
+
+void MemoryStation::_dump(std::function<void(int, int, const Coords& coords, const char* ident)> out)
+{
+    const StationTable& table = conn.store.station;
+    for (size_t pos = 0; pos < table.size(); ++pos)
+        out(table.id[pos], table.rep[pos], Coords(table.lat[pos], table.lon[pos]), table.ident[pos].get());
+}
+
+}
+}
+}
+}
@@ -69,29 +69,39 @@ void MySQLDataCommon<Parent>::remove_all_attrs(Tracer<>& trc, int id_data)
     conn.exec_no_data(query);
 }
 
-namespace {
-
-bool match_attrs(const Varmatch& match, const std::vector<uint8_t>& attrs)
-{
-    bool found = false;
-    Values::decode(attrs, [&](std::unique_ptr<wreport::Var> var) {
-        if (match(*var))
-            found = true;
-    });
-    return found;
-}
-
-}
-
 template<typename Parent>
 void MySQLDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb)
 {
     if (qb.bind_in_ident)
         throw error_unimplemented("binding in MySQL driver is not implemented");
 
-    std::unique_ptr<Varmatch> attr_filter;
     if (!qb.query.attr_filter.empty())
-        attr_filter = Varmatch::parse(qb.query.attr_filter);
+    {
+        // We need to apply attr_filter to all results of the query, so we
+        // collect the IDs of the matching rows and delete them in bulk
+        std::unique_ptr<Varmatch> attr_filter = Varmatch::parse(qb.query.attr_filter);
+        AttrFilterMatcher matcher(*attr_filter);
+        {
+            Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
+            auto res = conn.exec_store(qb.sql_query);
+            while (auto row = res.fetch())
+            {
+                if (trc_sel) trc_sel->add_row();
+                matcher.add(row.as_int(0), row.as_blob(1));
+            }
+            matcher.flush();
+        }
+
+        matcher.foreach_chunk(10000, [&](const std::string& id_list, unsigned count) {
+            Querybuf dq(64 + id_list.size());
+            dq.appendf("DELETE FROM %s WHERE id IN (", Parent::table_name);
+            dq.append(id_list);
+            dq.append(")");
+            Tracer<> trc_del(trc ? trc->trace_delete(dq, count) : nullptr);
+            conn.exec_no_data(dq);
+        });
+        return;
+    }
 
     Querybuf dq(512);
     dq.appendf("DELETE FROM %s WHERE id IN (", Parent::table_name);
@@ -102,7 +112,6 @@ void MySQLDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb
     while (auto row = res.fetch())
     {
         if (trc_sel) trc_sel->add_row();
-        if (attr_filter.get() && !match_attrs(*attr_filter, row.as_blob(1))) return;
 
         // Note: if the query gets too long, we can split this in more DELETE
         // runs
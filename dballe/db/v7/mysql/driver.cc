@@ -8,6 +8,8 @@
 #include "dballe/db/v7/qbuilder.h"
 #include "dballe/sql/mysql.h"
 #include "dballe/var.h"
+#include "dballe/types.h"
+#include "dballe/core/values.h"
 #include <algorithm>
 #include <cstring>
 
@@ -128,6 +130,7 @@ void Driver::create_tables_v7()
 }
 void Driver::delete_tables_v7()
 {
+    conn.drop_table_if_exists("summary");
     conn.drop_table_if_exists("data");
     conn.drop_table_if_exists("station_data");
     conn.drop_table_if_exists("levtr");
@@ -147,6 +150,133 @@ void Driver::vacuum_v7()
     conn.exec_no_data("DELETE s FROM station s LEFT JOIN data d ON d.id_station = s.id WHERE d.id IS NULL");
 }
 
+bool Driver::data_id_range_v7(int& id_min, int& id_max)
+{
+    auto res = conn.exec_store("SELECT MIN(id), MAX(id) FROM data");
+    Row row = res.expect_one_result();
+    if (row.isnull(0)) return false;
+    id_min = row.as_int(0);
+    id_max = row.as_int(1);
+    return true;
+}
+
+bool Driver::data_next_batch_v7(const Datetime& until, int last_id, unsigned batch_size, int& batch_last)
+{
+    Querybuf qb;
+    qb.appendf("SELECT MAX(id) FROM (SELECT id FROM data WHERE id > %d AND datetime < ", last_id);
+    conn.add_datetime(qb, until);
+    qb.appendf(" ORDER BY id LIMIT %u) AS batch", batch_size);
+    auto res = conn.exec_store(qb);
+    Row row = res.expect_one_result();
+    if (row.isnull(0)) return false;
+    batch_last = row.as_int(0);
+    return true;
+}
+
+unsigned Driver::purge_data_v7(const Datetime& until, int id_first, int id_last)
+{
+    Querybuf qb;
+    qb.appendf("DELETE FROM data WHERE id BETWEEN %d AND %d AND datetime < ", id_first, id_last);
+    conn.add_datetime(qb, until);
+    conn.exec_no_data(qb);
+    return conn.changes();
+}
+
+void Driver::create_summary_v7()
+{
+    conn.exec_no_data(R"(
+        CREATE TABLE summary (
+           id_station  INTEGER NOT NULL,
+           id_levtr    INTEGER NOT NULL,
+           code        SMALLINT NOT NULL,
+           count       INTEGER NOT NULL,
+           dtmin       DATETIME NOT NULL,
+           dtmax       DATETIME NOT NULL,
+           PRIMARY KEY (id_station, id_levtr, code)
+        )
+    )" DBA_MYSQL_DEFAULT_TABLE_OPTIONS);
+    fill_summary_v7();
+}
+
+void Driver::summary_add_v7(const std::vector<SummaryTableRow>& rows)
+{
+    if (rows.empty()) return;
+    Querybuf qb;
+    qb.append("INSERT INTO summary (id_station, id_levtr, code, count, dtmin, dtmax) VALUES ");
+    qb.start_list(",");
+    for (const auto& row: rows)
+    {
+        qb.append_listf("(%d, %d, %d, %u, ", row.id_station, row.id_levtr, (int)row.code, (unsigned)row.count);
+        conn.add_datetime(qb, row.datetime.min);
+        qb.append(", ");
+        conn.add_datetime(qb, row.datetime.max);
+        qb.append(")");
+    }
+    qb.append(R"(
+        ON DUPLICATE KEY UPDATE count=count+VALUES(count),
+                                dtmin=LEAST(dtmin, VALUES(dtmin)),
+                                dtmax=GREATEST(dtmax, VALUES(dtmax))
+    )");
+    conn.exec_no_data(qb);
+}
+
+void Driver::summary_keys_v7(const std::string& where, std::vector<SummaryTableRow>& keys)
+{
+    auto res = conn.exec_store("SELECT DISTINCT id_station, id_levtr, code FROM data WHERE " + where);
+    while (Row row = res.fetch())
+        keys.emplace_back(row.as_int(0), row.as_int(1), row.as_int(2));
+}
+
+void Driver::summary_refresh_v7(const std::vector<SummaryTableRow>& keys)
+{
+    // The MySQL connector has no bound parameters: the keys are integers
+    // formatted by Querybuf, as in the other queries of this driver
+    for (const auto& key: keys)
+    {
+        Querybuf qb;
+        qb.appendf("DELETE FROM summary WHERE id_station=%d AND id_levtr=%d AND code=%d",
+                key.id_station, key.id_levtr, (int)key.code);
+        conn.exec_no_data(qb);
+        qb.clear();
+        qb.appendf(R"(
+            INSERT INTO summary (id_station, id_levtr, code, count, dtmin, dtmax)
+                 SELECT id_station, id_levtr, code, COUNT(1), MIN(datetime), MAX(datetime)
+                   FROM data
+                  WHERE id_station=%d AND id_levtr=%d AND code=%d
+               GROUP BY id_station, id_levtr, code
+        )", key.id_station, key.id_levtr, (int)key.code);
+        conn.exec_no_data(qb);
+    }
+}
+
+
+bool Driver::upgrade_attrs_v7(const char* table, unsigned batch_size, int& last_id, unsigned& rewritten)
+{
+    Querybuf qb;
+    qb.appendf("SELECT id, attrs FROM %s WHERE id > %d AND attrs IS NOT NULL ORDER BY id LIMIT %u", table, last_id, batch_size);
+    auto res = conn.exec_store(qb);
+    bool found = false;
+    std::vector<std::pair<int, std::vector<uint8_t>>> changed;
+    while (Row row = res.fetch())
+    {
+        found = true;
+        last_id = row.as_int(0);
+        std::vector<uint8_t> attrs = row.as_blob(1);
+        if (core::value::Decoder::upgrade(attrs))
+            changed.emplace_back(last_id, std::move(attrs));
+    }
+
+    for (const auto& row: changed)
+    {
+        string escaped = conn.escape(row.second);
+        Querybuf uqb;
+        uqb.appendf("UPDATE %s SET attrs=X'%s' WHERE id=%d", table, escaped.c_str(), row.first);
+        conn.exec_no_data(uqb);
+    }
+    rewritten += changed.size();
+    return found;
+}
+
 }
 }
 }
@@ -50,8 +50,9 @@ MySQLLevTr::~MySQLLevTr()
 {
 }
 
-void MySQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+void MySQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& wanted)
 {
+    std::set<int> ids = uncached_ids(wanted);
     if (ids.empty()) return;
 
     sql::Querybuf qb;
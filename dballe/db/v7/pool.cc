@@ -0,0 +1,169 @@
+#include "pool.h"
+#include "driver.h"
+#include "dballe/db.h"
+#include "dballe/sql/sql.h"
+#include "dballe/sql/sqlite.h"
+#include "dballe/db/v7/memory/connection.h"
+#include <wreport/error.h>
+#include <algorithm>
+#include <iterator>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+
+namespace {
+
+/// Open a read-only connection to the same database as \a conn
+std::shared_ptr<sql::Connection> open_reader_connection(sql::Connection& conn)
+{
+    if (dynamic_cast<memory::MemoryConnection*>(&conn))
+        throw error_unimplemented("connection pools are not supported on in-memory databases");
+
+    if (dynamic_cast<sql::SQLiteConnection*>(&conn))
+    {
+        std::string pathname = conn.get_url().substr(9);
+        if (pathname.empty() || pathname.compare(0, 8, ":memory:") == 0)
+            throw error_unimplemented("connection pools need an SQLite database stored in a file");
+        auto res = sql::SQLiteConnection::create();
+        res->open_file(pathname, SQLITE_OPEN_READONLY);
+        return res;
+    }
+
+    return sql::Connection::create(*DBConnectOptions::create(conn.get_url()));
+}
+
+/// Open a read-only connection with the same settings as \a conn
+std::shared_ptr<sql::Connection> open_reader(sql::Connection& conn)
+{
+    auto res = open_reader_connection(conn);
+    res->reconnect_after_fork = conn.reconnect_after_fork;
+    return res;
+}
+
+bool levtr_id_less(const LevTrEntry& a, const LevTrEntry& b) { return a.id < b.id; }
+
+}
+
+
+PooledConnection::PooledConnection(std::shared_ptr<dballe::sql::Connection> conn)
+    : conn(conn), driver(v7::Driver::create(*conn))
+{
+}
+
+PooledConnection::~PooledConnection()
+{
+}
+
+
+ConnectionPool::ConnectionPool(dballe::sql::Connection& conn, unsigned size)
+{
+    if (size == 0)
+        throw error_consistency("a connection pool needs at least one connection");
+
+    // Let readers work on a snapshot of the database without locking out the
+    // writer
+    if (sql::SQLiteConnection* c = dynamic_cast<sql::SQLiteConnection*>(&conn))
+        c->exec("PRAGMA journal_mode = WAL");
+
+    for (unsigned i = 0; i < size; ++i)
+    {
+        connections.emplace_back(new PooledConnection(open_reader(conn)));
+        idle.push_back(connections.back().get());
+    }
+}
+
+ConnectionPool::~ConnectionPool()
+{
+}
+
+void ConnectionPool::release(PooledConnection* conn)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        idle.push_back(conn);
+    }
+    available.notify_one();
+}
+
+std::shared_ptr<PooledConnection> ConnectionPool::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    available.wait(lock, [&] { return !idle.empty(); });
+    PooledConnection* res = idle.back();
+    idle.pop_back();
+    auto self = shared_from_this();
+    return std::shared_ptr<PooledConnection>(res, [self](PooledConnection* conn) { self->release(conn); });
+}
+
+std::shared_ptr<PooledConnection> ConnectionPool::try_acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (idle.empty())
+        return nullptr;
+    PooledConnection* res = idle.back();
+    idle.pop_back();
+    auto self = shared_from_this();
+    return std::shared_ptr<PooledConnection>(res, [self](PooledConnection* conn) { self->release(conn); });
+}
+
+
+SharedCache::Snapshot SharedCache::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    Snapshot res;
+    res.generation = m_generation;
+    res.repinfo = m_repinfo;
+    res.levtr = m_levtr;
+    return res;
+}
+
+void SharedCache::publish_repinfo(unsigned generation, const std::vector<repinfo::Cache>& entries)
+{
+    auto copy = make_shared<const std::vector<repinfo::Cache>>(entries);
+    std::lock_guard<std::mutex> lock(mutex);
+    if (generation != m_generation) return;
+    m_repinfo = copy;
+}
+
+void SharedCache::publish_levtr(unsigned generation, const std::vector<LevTrEntry>& entries)
+{
+    std::shared_ptr<const std::vector<LevTrEntry>> current;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (generation != m_generation) return;
+        current = m_levtr;
+    }
+
+    // Merge outside the lock; both sequences are sorted by id
+    auto merged = make_shared<std::vector<LevTrEntry>>();
+    if (current)
+    {
+        std::set_union(current->begin(), current->end(), entries.begin(), entries.end(),
+                back_inserter(*merged), levtr_id_less);
+        if (merged->size() == current->size())
+            return;
+    } else
+        *merged = entries;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    // If another transaction published in the meantime, keep its version:
+    // what is missing will be published again later
+    if (generation != m_generation || m_levtr != current) return;
+    m_levtr = merged;
+}
+
+void SharedCache::invalidate()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ++m_generation;
+    m_repinfo.reset();
+    m_levtr.reset();
+}
+
+}
+}
+}
@@ -0,0 +1,127 @@
+#ifndef DBALLE_DB_V7_POOL_H
+#define DBALLE_DB_V7_POOL_H
+
+/** @file
+ * Pool of read-only connections, used to run read-only transactions
+ * concurrently from multiple threads, and caches of database contents shared
+ * between transactions.
+ */
+
+#include <dballe/sql/fwd.h>
+#include <dballe/db/v7/fwd.h>
+#include <dballe/db/v7/cache.h>
+#include <dballe/db/v7/repinfo.h>
+#include <condition_variable>
+#include <mutex>
+#include <memory>
+#include <vector>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+
+/**
+ * Read-only connection owned by a ConnectionPool, with its own driver
+ */
+struct PooledConnection
+{
+    std::shared_ptr<dballe::sql::Connection> conn;
+    std::unique_ptr<v7::Driver> driver;
+
+    PooledConnection(std::shared_ptr<dballe::sql::Connection> conn);
+    PooledConnection(const PooledConnection&) = delete;
+    PooledConnection& operator=(const PooledConnection&) = delete;
+    ~PooledConnection();
+};
+
+/**
+ * Fixed set of read-only connections to the same database.
+ *
+ * Each connection is used by at most one transaction at a time: acquire()
+ * waits until a connection is free, try_acquire() gives up if none is, and
+ * the connection goes back to the pool when the last reference to it is
+ * released.
+ *
+ * SQLite databases are switched to WAL journaling, so that readers work on
+ * their own snapshot without blocking, or being blocked by, the writer.
+ */
+class ConnectionPool : public std::enable_shared_from_this<ConnectionPool>
+{
+protected:
+    std::mutex mutex;
+    std::condition_variable available;
+    std::vector<std::unique_ptr<PooledConnection>> connections;
+    std::vector<PooledConnection*> idle;
+
+    void release(PooledConnection* conn);
+
+public:
+    /**
+     * Open \a size read-only connections to the database of \a conn
+     */
+    ConnectionPool(dballe::sql::Connection& conn, unsigned size);
+    ConnectionPool(const ConnectionPool&) = delete;
+    ConnectionPool& operator=(const ConnectionPool&) = delete;
+    ~ConnectionPool();
+
+    /// Number of connections in the pool
+    unsigned size() const { return connections.size(); }
+
+    /// Get a free connection, waiting for one if they are all in use
+    std::shared_ptr<PooledConnection> acquire();
+
+    /// Get a free connection, or nullptr if they are all in use
+    std::shared_ptr<PooledConnection> try_acquire();
+};
+
+/**
+ * Copies of the repinfo and levtr tables, shared between transactions.
+ *
+ * Transactions read a snapshot when they start, and can publish what they
+ * loaded when they end. Every change to the database contents that can
+ * invalidate the caches increments a generation counter and drops the
+ * snapshots, and publishing is refused if the generation changed since the
+ * transaction started, as it may have seen stale contents.
+ *
+ * The mutex is only held to swap pointers: snapshots are immutable and can be
+ * read without locking.
+ */
+class SharedCache
+{
+protected:
+    mutable std::mutex mutex;
+    unsigned m_generation = 0;
+    std::shared_ptr<const std::vector<repinfo::Cache>> m_repinfo;
+    std::shared_ptr<const std::vector<LevTrEntry>> m_levtr;
+
+public:
+    struct Snapshot
+    {
+        unsigned generation = 0;
+        std::shared_ptr<const std::vector<repinfo::Cache>> repinfo;
+        std::shared_ptr<const std::vector<LevTrEntry>> levtr;
+    };
+
+    /// Get the current contents of the caches
+    Snapshot snapshot() const;
+
+    /**
+     * Store the repinfo table, if the generation is still \a generation
+     */
+    void publish_repinfo(unsigned generation, const std::vector<repinfo::Cache>& entries);
+
+    /**
+     * Merge levtr entries with the shared ones, if the generation is still
+     * \a generation
+     */
+    void publish_levtr(unsigned generation, const std::vector<LevTrEntry>& entries);
+
+    /// Drop all cached contents
+    void invalidate();
+};
+
+}
+}
+}
+
+#endif
@@ -42,9 +42,10 @@ void PostgreSQLDataCommon<Parent>::read_attrs(Tracer<>& trc, int id_data, std::f
         select_attrs_query_name += "v7_select_attrs";
         char query[64];
         snprintf(query, 64, "SELECT attrs FROM %s WHERE id=$1::int4", Parent::table_name);
-        conn.prepare(select_attrs_query_name, query);
+        select_attrs_query = query;
+        conn.prepare(select_attrs_query_name, select_attrs_query);
     }
-    Tracer<> trc_sel(trc ? trc->trace_select("SELECT attrs FROM … WHERE id=$1::int4") : nullptr);
+    Tracer<> trc_sel(trc ? trc->trace_select(select_attrs_query) : nullptr);
     Values::decode(
             conn.exec_prepared_one_row(select_attrs_query_name, id_data).get_bytea(0, 0),
             dest);
@@ -60,9 +61,10 @@ void PostgreSQLDataCommon<Parent>::write_attrs(Tracer<>& trc, int id_data, const
         write_attrs_query_name += "v7_write_attrs";
         char query[64];
         snprintf(query, 64, "UPDATE %s SET attrs=$1::bytea WHERE id=$2::int4", Parent::table_name);
-        conn.prepare(write_attrs_query_name, query);
+        write_attrs_query = query;
+        conn.prepare(write_attrs_query_name, write_attrs_query);
     }
-    Tracer<> trc_upd(trc ? trc->trace_update("UPDATE … SET attrs=$1::bytea WHERE id=$2::int4", 1) : nullptr);
+    Tracer<> trc_upd(trc ? trc->trace_update(write_attrs_query, 1) : nullptr);
     vector<uint8_t> encoded = values.encode();
     conn.exec_prepared_no_data(write_attrs_query_name, encoded, id_data);
 }
@@ -76,57 +78,50 @@ void PostgreSQLDataCommon<Parent>::remove_all_attrs(Tracer<>& trc, int id_data)
         remove_attrs_query_name += "v7_remove_attrs";
         char query[64];
         snprintf(query, 64, "UPDATE %s SET attrs=NULL WHERE id=$1::int4", Parent::table_name);
-        conn.prepare(remove_attrs_query_name, query);
+        remove_attrs_query = query;
+        conn.prepare(remove_attrs_query_name, remove_attrs_query);
     }
-    Tracer<> trc_upd(trc ? trc->trace_update("UPDATE … SET attrs=NULL WHERE id=$1::int4", 1) : nullptr);
+    Tracer<> trc_upd(trc ? trc->trace_update(remove_attrs_query, 1) : nullptr);
     conn.exec_prepared_no_data(remove_attrs_query_name, id_data);
 }
 
-namespace {
-
-bool match_attrs(const Varmatch& match, const std::vector<uint8_t>& attrs)
-{
-    bool found = false;
-    Values::decode(attrs, [&](std::unique_ptr<wreport::Var> var) {
-        if (match(*var))
-            found = true;
-    });
-    return found;
-}
-
-}
-
 template<typename Parent>
 void PostgreSQLDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb)
 {
     if (!qb.query.attr_filter.empty())
     {
         // We need to apply attr_filter to all results of the query, so we
-        // iterate the results and delete the matching ones one by one.
+        // collect the IDs of the matching rows and delete them in bulk
         std::unique_ptr<Varmatch> attr_filter = Varmatch::parse(qb.query.attr_filter);
+        AttrFilterMatcher matcher(*attr_filter);
+        {
+            Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
+            Result to_remove;
+            if (qb.bind_in_ident)
+                to_remove = conn.exec(qb.sql_query, qb.bind_in_ident);
+            else
+                to_remove = conn.exec(qb.sql_query);
+            if (trc_sel) trc_sel->add_row(to_remove.rowcount());
+            for (unsigned row = 0; row < to_remove.rowcount(); ++row)
+                matcher.add(to_remove.get_int4(row, 0), to_remove.get_bytea(row, 1));
+            matcher.flush();
+        }
+
         if (remove_data_query_name.empty())
         {
             remove_data_query_name = Parent::table_name;
             remove_data_query_name += "v7_remove_data";
             char query[64];
-            snprintf(query, 64, "DELETE FROM %s WHERE id=$1::int4", Parent::table_name);
-            conn.prepare(remove_data_query_name, query);
+            snprintf(query, 64, "DELETE FROM %s WHERE id = ANY($1::int4[])", Parent::table_name);
+            remove_data_query = query;
+            conn.prepare(remove_data_query_name, remove_data_query);
         }
 
-        Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
-        Result to_remove;
-        if (qb.bind_in_ident)
-            to_remove = conn.exec(qb.sql_query, qb.bind_in_ident);
-        else
-            to_remove = conn.exec(qb.sql_query);
-        if (trc_sel) trc_sel->add_row(to_remove.rowcount());
-        trc_sel.done();
-        for (unsigned row = 0; row < to_remove.rowcount(); ++row)
-        {
-            if (!match_attrs(*attr_filter, to_remove.get_bytea(row, 1))) return;
-            Tracer<> trc_del(trc ? trc->trace_delete(remove_data_query_name, 1) : nullptr);
-            conn.exec_prepared(remove_data_query_name, (int)to_remove.get_int4(row, 0));
-        }
+        matcher.foreach_chunk(10000, [&](const std::string& id_list, unsigned count) {
+            Tracer<> trc_del(trc ? trc->trace_delete(remove_data_query, count) : nullptr);
+            std::string array = "{" + id_list + "}";
+            conn.exec_prepared_no_data(remove_data_query_name, array);
+        });
     } else {
         Querybuf dq(512);
         dq.append("DELETE FROM ");
@@ -21,6 +21,11 @@ protected:
     std::string write_attrs_query_name;
     std::string remove_attrs_query_name;
     std::string remove_data_query_name;
+    /// SQL of the prepared queries, for tracing
+    std::string select_attrs_query;
+    std::string write_attrs_query;
+    std::string remove_attrs_query;
+    std::string remove_data_query;
 
 public:
     PostgreSQLDataCommon(v7::Transaction& tr, dballe::sql::PostgreSQLConnection& conn);
@@ -8,6 +8,8 @@
 #include "dballe/db/v7/qbuilder.h"
 #include "dballe/sql/postgresql.h"
 #include "dballe/var.h"
+#include "dballe/types.h"
+#include "dballe/core/values.h"
 #include <algorithm>
 #include <cstring>
 
@@ -126,6 +128,7 @@ void Driver::create_tables_v7()
 }
 void Driver::delete_tables_v7()
 {
+    conn.drop_table_if_exists("summary");
     conn.drop_table_if_exists("data");
     conn.drop_table_if_exists("station_data");
     conn.drop_table_if_exists("levtr");
@@ -158,6 +161,115 @@ void Driver::vacuum_v7()
     )");
 }
 
+bool Driver::data_id_range_v7(int& id_min, int& id_max)
+{
+    auto res = conn.exec_one_row("SELECT MIN(id), MAX(id) FROM data");
+    if (res.is_null(0, 0)) return false;
+    id_min = res.get_int4(0, 0);
+    id_max = res.get_int4(0, 1);
+    return true;
+}
+
+bool Driver::data_next_batch_v7(const Datetime& until, int last_id, unsigned batch_size, int& batch_last)
+{
+    auto res = conn.exec_one_row(R"(
+        SELECT MAX(id) FROM (
+            SELECT id FROM data WHERE id > $1::int4 AND datetime < $2::timestamp ORDER BY id LIMIT $3::int4) AS batch
+    )", last_id, until, (int)batch_size);
+    if (res.is_null(0, 0)) return false;
+    batch_last = res.get_int4(0, 0);
+    return true;
+}
+
+unsigned Driver::purge_data_v7(const Datetime& until, int id_first, int id_last)
+{
+    // Use a CTE to get the count of deleted rows, since libpq only gives it
+    // to us as a string
+    auto res = conn.exec_one_row(R"(
+        WITH deleted AS (
+            DELETE FROM data
+             WHERE id BETWEEN $1::int4 AND $2::int4 AND datetime < $3::timestamp
+            RETURNING 1)
+        SELECT COUNT(*) FROM deleted
+    )", id_first, id_last, until);
+    return res.get_int8(0, 0);
+}
+
+void Driver::create_summary_v7()
+{
+    conn.exec_no_data(R"(
+        CREATE TABLE summary (
+           id_station  INTEGER NOT NULL,
+           id_levtr    INTEGER NOT NULL,
+           code        INTEGER NOT NULL,
+           count       BIGINT NOT NULL,
+           dtmin       TIMESTAMP NOT NULL,
+           dtmax       TIMESTAMP NOT NULL,
+           PRIMARY KEY (id_station, id_levtr, code)
+        );
+    )");
+    fill_summary_v7();
+}
+
+void Driver::summary_add_v7(const std::vector<SummaryTableRow>& rows)
+{
+    // ON CONFLICT keeps this correct when concurrent transactions add the
+    // first values of the same time series
+    for (const auto& row: rows)
+        conn.exec_no_data(R"(
+            INSERT INTO summary (id_station, id_levtr, code, count, dtmin, dtmax)
+                 VALUES ($1::int4, $2::int4, $3::int4, $4::int4, $5::timestamp, $6::timestamp)
+            ON CONFLICT (id_station, id_levtr, code) DO UPDATE
+                    SET count=summary.count+EXCLUDED.count,
+                        dtmin=LEAST(summary.dtmin, EXCLUDED.dtmin),
+                        dtmax=GREATEST(summary.dtmax, EXCLUDED.dtmax)
+        )", row.id_station, row.id_levtr, (int)row.code, (int)row.count, row.datetime.min, row.datetime.max);
+}
+
+void Driver::summary_keys_v7(const std::string& where, std::vector<SummaryTableRow>& keys)
+{
+    auto res = conn.exec("SELECT DISTINCT id_station, id_levtr, code FROM data WHERE " + where);
+    for (unsigned row = 0; row < res.rowcount(); ++row)
+        keys.emplace_back(res.get_int4(row, 0), res.get_int4(row, 1), res.get_int4(row, 2));
+}
+
+void Driver::summary_refresh_v7(const std::vector<SummaryTableRow>& keys)
+{
+    for (const auto& key: keys)
+    {
+        conn.exec_no_data("DELETE FROM summary WHERE id_station=$1::int4 AND id_levtr=$2::int4 AND code=$3::int4",
+                key.id_station, key.id_levtr, (int)key.code);
+        conn.exec_no_data(R"(
+            INSERT INTO summary (id_station, id_levtr, code, count, dtmin, dtmax)
+                 SELECT id_station, id_levtr, code, COUNT(1), MIN(datetime), MAX(datetime)
+                   FROM data
+                  WHERE id_station=$1::int4 AND id_levtr=$2::int4 AND code=$3::int4
+               GROUP BY id_station, id_levtr, code
+        )", key.id_station, key.id_levtr, (int)key.code);
+    }
+}
+
+
+bool Driver::upgrade_attrs_v7(const char* table, unsigned batch_size, int& last_id, unsigned& rewritten)
+{
+    char query[128];
+    snprintf(query, 128, "SELECT id, attrs FROM %s WHERE id > $1::int4 AND attrs IS NOT NULL ORDER BY id LIMIT $2::int4", table);
+    auto res = conn.exec(query, last_id, (int)batch_size);
+    unsigned rows = res.rowcount();
+    if (!rows) return false;
+
+    snprintf(query, 128, "UPDATE %s SET attrs=$1::bytea WHERE id=$2::int4", table);
+    for (unsigned row = 0; row < rows; ++row)
+    {
+        last_id = res.get_int4(row, 0);
+        std::vector<uint8_t> attrs = res.get_bytea(row, 1);
+        if (!core::value::Decoder::upgrade(attrs)) continue;
+        conn.exec_no_data(query, attrs, last_id);
+        ++rewritten;
+    }
+    return true;
+}
+
 }
 }
 }
@@ -24,6 +24,14 @@ struct Driver : public v7::Driver
     void create_tables_v7() override;
     void delete_tables_v7() override;
     void vacuum_v7() override;
+    bool data_id_range_v7(int& id_min, int& id_max) override;
+    bool data_next_batch_v7(const Datetime& until, int last_id, unsigned batch_size, int& batch_last) override;
+    unsigned purge_data_v7(const Datetime& until, int id_first, int id_last) override;
+    bool upgrade_attrs_v7(const char* table, unsigned batch_size, int& last_id, unsigned& rewritten) override;
+    void create_summary_v7() override;
+    void summary_add_v7(const std::vector<SummaryTableRow>& rows) override;
+    void summary_keys_v7(const std::string& where, std::vector<SummaryTableRow>& keys) override;
+    void summary_refresh_v7(const std::vector<SummaryTableRow>& keys) override;
 };
 
 }
@@ -58,8 +58,9 @@ PostgreSQLLevTr::~PostgreSQLLevTr()
 {
 }
 
-void PostgreSQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+void PostgreSQLLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& wanted)
 {
+    std::set<int> ids = uncached_ids(wanted);
     if (ids.empty()) return;
 
     sql::Querybuf qb;
@@ -224,7 +224,7 @@ struct Constraints
 };
 
 QueryBuilder::QueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers, bool query_station_vars)
-    : conn(*tr->db->conn), tr(tr), query(query), sql_query(2048), sql_from(1024), sql_where(1024),
+    : conn(tr->connection()), tr(tr), query(query), sql_query(2048), sql_from(1024), sql_where(1024),
       modifiers(modifiers), query_station_vars(query_station_vars)
 {
 }
@@ -375,6 +375,11 @@ bool DataQueryBuilder::build_where()
 
     // Add pseudoana-specific where parts
     has_where = add_pa_where("s") || has_where;
+    if (id_station_min != MISSING_INT)
+    {
+        sql_where.append_listf("s.id BETWEEN %d AND %d", id_station_min, id_station_max);
+        has_where = true;
+    }
     if (!query_station_vars)
     {
         has_where = add_dt_where("d") || has_where;
@@ -473,7 +478,23 @@ void SummaryQueryBuilder::build_select()
     if (!query.attr_filter.empty())
         throw error_consistency("attr_filter is not supported on summary queries");
 
-    if (modifiers & DBA_DB_MODIFIER_SUMMARY_DETAILS)
+    // The summary table can answer queries that do not need to look at the
+    // datetime or the value of each row
+    use_summary_table = !query_station_vars && tr->summary_table
+        && query.dtrange.is_missing() && query.data_filter.empty();
+
+    if (use_summary_table)
+    {
+        if (modifiers & DBA_DB_MODIFIER_SUMMARY_DETAILS)
+        {
+            sql_query.append(R"(
+                SELECT s.id, s.rep, s.lat, s.lon, s.ident, d.id_levtr, d.code,
+                       d.count, d.dtmin, d.dtmax
+            )");
+            select_summary_details = true;
+        } else
+            sql_query.append("SELECT s.id, s.rep, s.lat, s.lon, s.ident, d.id_levtr, d.code");
+    } else if (modifiers & DBA_DB_MODIFIER_SUMMARY_DETAILS)
     {
         if (query_station_vars)
             sql_query.append("SELECT s.id, s.rep, s.lat, s.lon, s.ident, d.code, COUNT(1)");
@@ -503,15 +524,19 @@ void SummaryQueryBuilder::build_select()
         sql_from.append(" JOIN station_data d ON s.id = d.id_station");
     else
     {
-        sql_from.append(" JOIN data d ON s.id = d.id_station");
+        if (use_summary_table)
+            sql_from.append(" JOIN summary d ON s.id = d.id_station");
+        else
+            sql_from.append(" JOIN data d ON s.id = d.id_station");
         sql_from.append(" JOIN levtr ltr ON ltr.id=d.id_levtr");
     }
 }
 
 void SummaryQueryBuilder::build_order_by()
 {
-    // No ordering required, but we may add a GROUP BY
-    if (modifiers & DBA_DB_MODIFIER_SUMMARY_DETAILS)
+    // No ordering required, but we may add a GROUP BY. The summary table
+    // already has one row per group.
+    if ((modifiers & DBA_DB_MODIFIER_SUMMARY_DETAILS) && !use_summary_table)
     {
         if (query_station_vars)
             sql_query.append(" GROUP BY s.id, d.code");
@@ -99,6 +99,14 @@ struct DataQueryBuilder : public QueryBuilder
     /// True if the select includes the attrs field
     bool select_attrs = false;
 
+    /**
+     * If set, only select data of stations with IDs between id_station_min
+     * and id_station_max, both included. This is used to split a query in
+     * parts over disjoint sets of stations.
+     */
+    int id_station_min = MISSING_INT;
+    int id_station_max = MISSING_INT;
+
     DataQueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers, bool query_station_vars);
     ~DataQueryBuilder();
 
@@ -123,6 +131,9 @@ struct IdQueryBuilder : public DataQueryBuilder
 
 struct SummaryQueryBuilder : public DataQueryBuilder
 {
+    /// True if the query reads the summary table instead of the data table
+    bool use_summary_table = false;
+
     SummaryQueryBuilder(std::shared_ptr<v7::Transaction> tr, const core::Query& query, unsigned int modifiers, bool query_station_vars)
         : DataQueryBuilder(tr, query, modifiers, query_station_vars) {}
 
@@ -0,0 +1,146 @@
+#include "querycache.h"
+#include "dballe/core/query.h"
+#include "dballe/core/json.h"
+#include <sstream>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace db {
+namespace v7 {
+
+namespace {
+
+size_t var_memory_usage(const Var& var)
+{
+    size_t res = sizeof(Var);
+    switch (var.info()->type)
+    {
+        case Vartype::String: res += var.info()->len + 1; break;
+        case Vartype::Binary: res += var.info()->bit_len / 8 + 1; break;
+        default: break;
+    }
+    for (const Var* a = var.next_attr(); a; a = a->next_attr())
+        res += var_memory_usage(*a);
+    return res;
+}
+
+}
+
+size_t CachedData::memory_usage() const
+{
+    size_t res = sizeof(CachedData);
+    for (const auto& s: stations)
+        res += sizeof(dballe::DBStation) + s.report.size();
+    res += size() * (sizeof(unsigned) + sizeof(int) * 2 + sizeof(Datetime));
+    for (const auto& v: values)
+        res += var_memory_usage(v);
+    res += levtr.size() * sizeof(LevTrEntry);
+    return res;
+}
+
+
+QueryCache::QueryCache(size_t max_memory)
+    : max_memory(max_memory)
+{
+}
+
+std::string QueryCache::make_key(const core::Query& query, unsigned modifiers)
+{
+    core::Query normalized(query);
+    normalized.query.clear();
+    normalized.validate();
+
+    std::string res = std::to_string(modifiers);
+    res += ' ';
+    res += std::to_string(normalized.want_missing);
+    res += ' ';
+    core::JSONWriter writer(res);
+    writer.start_mapping();
+    normalized.serialize(writer);
+    writer.end_mapping();
+    return res;
+}
+
+void QueryCache::erase(std::list<Entry>::iterator i)
+{
+    m_memory -= i->memory;
+    index.erase(i->key);
+    lru.erase(i);
+}
+
+std::shared_ptr<const CachedData> QueryCache::get(const std::string& key, unsigned generation)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto i = index.find(key);
+    if (i == index.end() || i->second->generation != generation)
+    {
+        // Results read before the last change will never be valid again
+        if (i != index.end() && i->second->generation < generation)
+            erase(i->second);
+        ++m_misses;
+        return std::shared_ptr<const CachedData>();
+    }
+    lru.splice(lru.begin(), lru, i->second);
+    ++m_hits;
+    return i->second->data;
+}
+
+void QueryCache::put(const std::string& key, unsigned generation, std::shared_ptr<const CachedData> data)
+{
+    size_t memory = data->memory_usage() + key.size();
+    if (memory > max_memory) return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto i = index.find(key);
+    if (i != index.end())
+    {
+        // Keep results of newer generations
+        if (i->second->generation > generation) return;
+        erase(i->second);
+    }
+
+    while (!lru.empty() && m_memory + memory > max_memory)
+        erase(std::prev(lru.end()));
+
+    lru.push_front(Entry{key, generation, data, memory});
+    index.emplace(key, lru.begin());
+    m_memory += memory;
+}
+
+void QueryCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    index.clear();
+    m_memory = 0;
+}
+
+size_t QueryCache::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return lru.size();
+}
+
+size_t QueryCache::memory() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return m_memory;
+}
+
+unsigned QueryCache::hits() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return m_hits;
+}
+
+unsigned QueryCache::misses() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return m_misses;
+}
+
+}
+}
+}
@@ -0,0 +1,127 @@
+#ifndef DBALLE_DB_V7_QUERYCACHE_H
+#define DBALLE_DB_V7_QUERYCACHE_H
+
+/** @file
+ * Process-wide cache of the results of data queries.
+ */
+
+#include <dballe/types.h>
+#include <dballe/core/fwd.h>
+#include <dballe/db/v7/cache.h>
+#include <wreport/var.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dballe {
+namespace db {
+namespace v7 {
+
+/**
+ * Results of a data query, stored by column.
+ *
+ * Stations are stored once, and rows refer to them by their position in
+ * stations.
+ */
+struct CachedData
+{
+    std::vector<dballe::DBStation> stations;
+    std::vector<unsigned> station;
+    std::vector<int> id_levtr;
+    std::vector<Datetime> datetime;
+    std::vector<int> id_data;
+    std::vector<wreport::Var> values;
+    /// Levels and time ranges used by the rows
+    std::vector<LevTrEntry> levtr;
+
+    /// Number of rows
+    size_t size() const { return id_data.size(); }
+
+    /// Estimate the memory used by the results
+    size_t memory_usage() const;
+};
+
+/**
+ * Cache of data query results, keyed by normalized query and modifiers.
+ *
+ * Each entry is tagged with the data generation of the database at the time
+ * the results were read (see v7::DB::data_generation), and is only returned to
+ * transactions that started at the same generation.
+ *
+ * The total memory used by the entries is kept within a budget, evicting the
+ * least recently used entries first.
+ */
+class QueryCache
+{
+protected:
+    struct Entry
+    {
+        std::string key;
+        unsigned generation;
+        std::shared_ptr<const CachedData> data;
+        size_t memory;
+    };
+
+    mutable std::mutex mutex;
+    /// Entries, most recently used first
+    std::list<Entry> lru;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    size_t m_memory = 0;
+    unsigned m_hits = 0;
+    unsigned m_misses = 0;
+
+    /// Remove the entry pointed by \a i
+    void erase(std::list<Entry>::iterator i);
+
+public:
+    /// Maximum memory used by cached results, in bytes
+    const size_t max_memory;
+
+    explicit QueryCache(size_t max_memory);
+    QueryCache(const QueryCache&) = delete;
+    QueryCache& operator=(const QueryCache&) = delete;
+
+    /**
+     * Build the cache key for a data query.
+     *
+     * The query is validated, so that equivalent ways of expressing the same
+     * query give the same key, and its query modifiers string is replaced with
+     * the parsed modifiers.
+     */
+    static std::string make_key(const core::Query& query, unsigned modifiers);
+
+    /**
+     * Look up the results for \a key read at the given data generation.
+     *
+     * Returns nullptr if they are not in the cache.
+     */
+    std::shared_ptr<const CachedData> get(const std::string& key, unsigned generation);
+
+    /**
+     * Store the results for \a key read at the given data generation.
+     *
+     * Results bigger than the whole budget are not stored.
+     */
+    void put(const std::string& key, unsigned generation, std::shared_ptr<const CachedData> data);
+
+    /// Remove all entries
+    void clear();
+
+    /// Number of entries in the cache
+    size_t size() const;
+    /// Estimated memory used by the entries in the cache
+    size_t memory() const;
+    /// Number of lookups that found results in the cache
+    unsigned hits() const;
+    /// Number of lookups that did not find results in the cache
+    unsigned misses() const;
+};
+
+}
+}
+}
+
+#endif
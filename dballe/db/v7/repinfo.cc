@@ -17,6 +17,12 @@ Repinfo::Repinfo(dballe::sql::Connection& conn)
 {
 }
 
+void Repinfo::load_cache(const std::vector<repinfo::Cache>& entries)
+{
+    cache = entries;
+    rebuild_memo_idx();
+}
+
 const char* Repinfo::get_rep_memo(int id)
 {
     if (const repinfo::Cache* c = get_by_id(id))
@@ -125,6 +125,12 @@ struct Repinfo
      */
     int obtain_id(const char* memo);
 
+    /// Access the cached contents of the repinfo table
+    const std::vector<repinfo::Cache>& entries() const { return cache; }
+
+    /// Replace the cached contents of the repinfo table
+    void load_cache(const std::vector<repinfo::Cache>& entries);
+
     /// Dump the entire contents of the database to an output stream
     virtual void dump(FILE* out) = 0;
 
@@ -93,44 +93,44 @@ void SQLiteDataCommon<Parent>::remove_all_attrs(Tracer<>& trc, int id_data)
     remove_attrs_stm->execute();
 }
 
-namespace {
-
-bool match_attrs(const Varmatch& match, const std::vector<uint8_t>& attrs)
-{
-    bool found = false;
-    Values::decode(attrs, [&](std::unique_ptr<wreport::Var> var) {
-        if (match(*var))
-            found = true;
-    });
-    return found;
-}
-
-}
-
 template<typename Parent>
 void SQLiteDataCommon<Parent>::remove(Tracer<>& trc, const v7::IdQueryBuilder& qb)
 {
-    char query[64];
-    snprintf(query, 64, "DELETE FROM %s WHERE id=?", Parent::table_name);
-    auto stmd = conn.sqlitestatement(query);
-    auto stm = conn.sqlitestatement(qb.sql_query);
-    if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
-
-    std::unique_ptr<Varmatch> attr_filter;
     if (!qb.query.attr_filter.empty())
-        attr_filter = Varmatch::parse(qb.query.attr_filter);
-
-    // Iterate all the data_id results, deleting the related data and attributes
-    Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
-    stm->execute([&]() {
-        if (trc_sel) trc_sel->add_row();
-        if (attr_filter.get() && !match_attrs(*attr_filter, stm->column_blob(1))) return;
+    {
+        // We need to apply attr_filter to all results of the query, so we
+        // collect the IDs of the matching rows and delete them in bulk
+        std::unique_ptr<Varmatch> attr_filter = Varmatch::parse(qb.query.attr_filter);
+        AttrFilterMatcher matcher(*attr_filter);
+        {
+            auto stm = conn.sqlitestatement(qb.sql_query);
+            if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
+            Tracer<> trc_sel(trc ? trc->trace_select(qb.sql_query) : nullptr);
+            stm->execute([&]() {
+                if (trc_sel) trc_sel->add_row();
+                matcher.add(stm->column_int(0), stm->column_blob(1));
+            });
+            matcher.flush();
+        }
 
-        // Compile the DELETE query for the data
-        Tracer<> trc_del(trc ? trc->trace_delete(query, 1) : nullptr);
-        stmd->bind_val(1, stm->column_int(0));
-        stmd->execute();
-    });
+        matcher.foreach_chunk(10000, [&](const std::string& id_list, unsigned count) {
+            Querybuf dq(64 + id_list.size());
+            dq.appendf("DELETE FROM %s WHERE id IN (", Parent::table_name);
+            dq.append(id_list);
+            dq.append(")");
+            Tracer<> trc_del(trc ? trc->trace_delete(dq, count) : nullptr);
+            conn.execute(dq);
+        });
+    } else {
+        Querybuf dq(512);
+        dq.appendf("DELETE FROM %s WHERE id IN (", Parent::table_name);
+        dq.append(qb.sql_query);
+        dq.append(")");
+        Tracer<> trc_del(trc ? trc->trace_delete(dq) : nullptr);
+        auto stm = conn.sqlitestatement(dq);
+        if (qb.bind_in_ident) stm->bind_val(1, qb.bind_in_ident);
+        stm->execute();
+    }
 }
 
 template<typename Parent>
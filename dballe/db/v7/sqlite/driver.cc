@@ -8,6 +8,8 @@
 #include "dballe/db/v7/transaction.h"
 #include "dballe/sql/sqlite.h"
 #include "dballe/var.h"
+#include "dballe/types.h"
+#include "dballe/core/values.h"
 #include <algorithm>
 #include <cstring>
 
@@ -59,6 +61,9 @@ std::unique_ptr<v7::Data> Driver::create_data(v7::Transaction& tr)
 
 void Driver::create_tables_v7()
 {
+    // Allow purge to give back free pages without a full VACUUM. This only
+    // has effect if no tables have been created yet.
+    conn.exec("PRAGMA auto_vacuum = INCREMENTAL");
     conn.exec(R"(
         CREATE TABLE repinfo (
            id           INTEGER PRIMARY KEY,
@@ -124,6 +129,7 @@ void Driver::create_tables_v7()
 }
 void Driver::delete_tables_v7()
 {
+    conn.drop_table_if_exists("summary");
     conn.drop_table_if_exists("data");
     conn.drop_table_if_exists("station_data");
     conn.drop_table_if_exists("levtr");
@@ -156,6 +162,140 @@ void Driver::vacuum_v7()
     )");
 }
 
+bool Driver::data_id_range_v7(int& id_min, int& id_max)
+{
+    bool found = false;
+    auto stm = conn.sqlitestatement("SELECT MIN(id), MAX(id) FROM data");
+    stm->execute_one([&]() {
+        if (stm->column_isnull(0)) return;
+        id_min = stm->column_int(0);
+        id_max = stm->column_int(1);
+        found = true;
+    });
+    return found;
+}
+
+bool Driver::data_next_batch_v7(const Datetime& until, int last_id, unsigned batch_size, int& batch_last)
+{
+    bool found = false;
+    auto stm = conn.sqlitestatement(R"(
+        SELECT MAX(id) FROM (
+            SELECT id FROM data WHERE id > ? AND datetime < ? ORDER BY id LIMIT ?)
+    )");
+    stm->bind(last_id, until, batch_size);
+    stm->execute_one([&]() {
+        if (stm->column_isnull(0)) return;
+        batch_last = stm->column_int(0);
+        found = true;
+    });
+    return found;
+}
+
+unsigned Driver::purge_data_v7(const Datetime& until, int id_first, int id_last)
+{
+    auto stm = conn.sqlitestatement("DELETE FROM data WHERE id BETWEEN ? AND ? AND datetime < ?");
+    stm->bind(id_first, id_last, until);
+    stm->execute();
+    return conn.changes();
+}
+
+void Driver::compact_v7()
+{
+    // This only has an effect on databases created with auto_vacuum=INCREMENTAL
+    conn.exec("PRAGMA incremental_vacuum");
+}
+
+void Driver::create_summary_v7()
+{
+    conn.exec(R"(
+        CREATE TABLE summary (
+           id_station  INTEGER NOT NULL,
+           id_levtr    INTEGER NOT NULL,
+           code        INTEGER NOT NULL,
+           count       INTEGER NOT NULL,
+           dtmin       TEXT NOT NULL,
+           dtmax       TEXT NOT NULL,
+           PRIMARY KEY (id_station, id_levtr, code)
+        );
+    )");
+    fill_summary_v7();
+}
+
+void Driver::summary_add_v7(const std::vector<SummaryTableRow>& rows)
+{
+    auto ustm = conn.sqlitestatement(R"(
+        UPDATE summary SET count=count+?, dtmin=MIN(dtmin, ?), dtmax=MAX(dtmax, ?)
+         WHERE id_station=? AND id_levtr=? AND code=?
+    )");
+    auto istm = conn.sqlitestatement(R"(
+        INSERT INTO summary (id_station, id_levtr, code, count, dtmin, dtmax)
+             VALUES (?, ?, ?, ?, ?, ?)
+    )");
+    for (const auto& row: rows)
+    {
+        ustm->bind((unsigned)row.count, row.datetime.min, row.datetime.max, row.id_station, row.id_levtr, row.code);
+        ustm->execute();
+        if (conn.changes() > 0) continue;
+        istm->bind(row.id_station, row.id_levtr, row.code, (unsigned)row.count, row.datetime.min, row.datetime.max);
+        istm->execute();
+    }
+}
+
+void Driver::summary_keys_v7(const std::string& where, std::vector<SummaryTableRow>& keys)
+{
+    auto stm = conn.sqlitestatement("SELECT DISTINCT id_station, id_levtr, code FROM data WHERE " + where);
+    stm->execute([&]() {
+        keys.emplace_back(stm->column_int(0), stm->column_int(1), stm->column_int(2));
+    });
+}
+
+void Driver::summary_refresh_v7(const std::vector<SummaryTableRow>& keys)
+{
+    auto dstm = conn.sqlitestatement("DELETE FROM summary WHERE id_station=? AND id_levtr=? AND code=?");
+    auto istm = conn.sqlitestatement(R"(
+        INSERT INTO summary (id_station, id_levtr, code, count, dtmin, dtmax)
+             SELECT id_station, id_levtr, code, COUNT(1), MIN(datetime), MAX(datetime)
+               FROM data
+              WHERE id_station=? AND id_levtr=? AND code=?
+           GROUP BY id_station, id_levtr, code
+    )");
+    for (const auto& key: keys)
+    {
+        dstm->bind(key.id_station, key.id_levtr, key.code);
+        dstm->execute();
+        istm->bind(key.id_station, key.id_levtr, key.code);
+        istm->execute();
+    }
+}
+
+
+bool Driver::upgrade_attrs_v7(const char* table, unsigned batch_size, int& last_id, unsigned& rewritten)
+{
+    char query[128];
+    snprintf(query, 128, "SELECT id, attrs FROM %s WHERE id > ? AND attrs IS NOT NULL ORDER BY id LIMIT ?", table);
+    auto stm = conn.sqlitestatement(query);
+    stm->bind(last_id, batch_size);
+    bool found = false;
+    std::vector<std::pair<int, std::vector<uint8_t>>> changed;
+    stm->execute([&]() {
+        found = true;
+        last_id = stm->column_int(0);
+        std::vector<uint8_t> attrs = stm->column_blob(1);
+        if (core::value::Decoder::upgrade(attrs))
+            changed.emplace_back(last_id, std::move(attrs));
+    });
+
+    snprintf(query, 128, "UPDATE %s SET attrs=? WHERE id=?", table);
+    auto ustm = conn.sqlitestatement(query);
+    for (const auto& row: changed)
+    {
+        ustm->bind(row.second, row.first);
+        ustm->execute();
+    }
+    rewritten += changed.size();
+    return found;
+}
+
 }
 }
 }
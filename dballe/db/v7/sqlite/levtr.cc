@@ -69,8 +69,9 @@ SQLiteLevTr::~SQLiteLevTr()
     delete istm;
 }
 
-void SQLiteLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& ids)
+void SQLiteLevTr::prefetch_ids(Tracer<>& trc, const std::set<int>& wanted)
 {
+    std::set<int> ids = uncached_ids(wanted);
     if (ids.empty()) return;
 
     sql::Querybuf qb;
@@ -1,5 +1,6 @@
 #include "trace.h"
 #include "dballe/core/query.h"
+#include "dballe/types.h"
 #include <wreport/error.h>
 #include <unistd.h>
 
@@ -13,10 +14,10 @@ namespace {
 
 std::string query_to_string(const Query& query)
 {
-    std::stringstream json_buf;
-    core::JSONWriter writer(json_buf);
+    std::string res;
+    core::JSONWriter writer(res);
     core::Query::downcast(query).serialize(writer);
-    return json_buf.str();
+    return res;
 }
 
 std::vector<std::string> read_argv()
@@ -182,6 +183,11 @@ Tracer<> Transaction::trace_remove_data_by_id(int id)
     return Tracer<>(add_child(new trace::Step("remove_data_by_id", std::to_string(id))));
 }
 
+Tracer<> Transaction::trace_purge_before(const Datetime& dt)
+{
+    return Tracer<>(add_child(new trace::Step("purge_before", dt.to_string())));
+}
+
 }
 
 
@@ -222,6 +228,12 @@ Tracer<> QuietCollectTrace::trace_vacuum()
     return Tracer<>(steps.back());
 }
 
+Tracer<> QuietCollectTrace::trace_purge(const Datetime& dt)
+{
+    steps.push_back(new trace::Step("purge", dt.to_string()));
+    return Tracer<>(steps.back());
+}
+
 
 CollectTrace::CollectTrace(const std::string& logdir)
     : logdir(logdir), start(time(nullptr))
@@ -231,24 +243,6 @@ CollectTrace::CollectTrace(const std::string& logdir)
 void CollectTrace::save()
 {
     pid_t pid = getpid();
-    std::stringstream json_buf;
-    core::JSONWriter writer(json_buf);
-    writer.start_mapping();
-
-    writer.add("cmdline");
-    writer.add_list(read_argv());
-    writer.add("pid", (int)pid);
-    writer.add("start", format_time(start));
-    writer.add("end", format_time(time(nullptr)));
-
-    writer.add("ops");
-    writer.start_list();
-    for (const auto& s: steps)
-        s->to_json(writer);
-    writer.end_list();
-
-    writer.end_mapping();
-
     std::string fname = logdir;
     fname += "/";
     fname += format_time_fname(start);
@@ -257,7 +251,30 @@ void CollectTrace::save()
     fname += ".json";
 
     FILE* out = fopen(fname.c_str(), "wt");
-    fwrite(json_buf.str().data(), json_buf.str().size(), 1, out);
+    if (!out) throw error_system("cannot open " + fname);
+
+    try {
+        core::JSONWriter writer(out);
+        writer.start_mapping();
+
+        writer.add("cmdline");
+        writer.add_list(read_argv());
+        writer.add("pid", (int)pid);
+        writer.add("start", format_time(start));
+        writer.add("end", format_time(time(nullptr)));
+
+        writer.add("ops");
+        writer.start_list();
+        for (const auto& s: steps)
+            s->to_json(writer);
+        writer.end_list();
+
+        writer.end_mapping();
+        writer.flush();
+    } catch (...) {
+        fclose(out);
+        throw;
+    }
     putc('\n', out);
     fclose(out);
 }
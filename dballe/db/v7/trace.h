@@ -187,6 +187,7 @@ public:
     Tracer<> trace_remove_data(const Query& query);
     Tracer<> trace_remove_station_data_by_id(int id);
     Tracer<> trace_remove_data_by_id(int id);
+    Tracer<> trace_purge_before(const Datetime& dt);
 };
 
 }
@@ -200,6 +201,7 @@ struct Trace
     virtual Tracer<trace::Transaction> trace_transaction() = 0;
     virtual Tracer<> trace_remove_all() = 0;
     virtual Tracer<> trace_vacuum() = 0;
+    virtual Tracer<> trace_purge(const Datetime& dt) = 0;
     virtual void save() = 0;
 
     static bool in_test_suite();
@@ -213,6 +215,7 @@ struct NullTrace : public Trace
     Tracer<trace::Transaction> trace_transaction() override { return Tracer<trace::Transaction>(nullptr); }
     Tracer<> trace_remove_all() override { return Tracer<>(nullptr); }
     Tracer<> trace_vacuum() override { return Tracer<>(nullptr); }
+    Tracer<> trace_purge(const Datetime& dt) override { return Tracer<>(nullptr); }
     void save() override {}
 };
 
@@ -234,6 +237,7 @@ public:
     Tracer<trace::Transaction> trace_transaction() override;
     Tracer<> trace_remove_all() override;
     Tracer<> trace_vacuum() override;
+    Tracer<> trace_purge(const Datetime& dt) override;
 
     void save() override {}
 };
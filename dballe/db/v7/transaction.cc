@@ -7,11 +7,17 @@
 #include "repinfo.h"
 #include "batch.h"
 #include "trace.h"
+#include "qbuilder.h"
+#include "pool.h"
 #include "dballe/core/query.h"
 #include "dballe/core/data.h"
 #include "dballe/sql/sql.h"
 #include <cassert>
+#include <cstdio>
 #include <memory>
+#include <map>
+#include <set>
+#include <tuple>
 
 using namespace wreport;
 using namespace std;
@@ -20,14 +26,31 @@ namespace dballe {
 namespace db {
 namespace v7 {
 
-Transaction::Transaction(std::shared_ptr<v7::DB> db, std::unique_ptr<dballe::sql::Transaction> sql_transaction)
-    : db(db), sql_transaction(std::move(sql_transaction)), batch(*this), trc(db->trace->trace_transaction())
+Transaction::Transaction(std::shared_ptr<v7::DB> db, std::unique_ptr<dballe::sql::Transaction> sql_transaction, bool readonly, std::shared_ptr<v7::PooledConnection> pooled)
+    : db(db), pooled(pooled), sql_transaction(std::move(sql_transaction)), readonly(readonly), data_generation(db->data_generation), batch(*this), trc(db->trace->trace_transaction())
 {
-    m_repinfo = db->driver().create_repinfo(*this).release();
-    m_station = db->driver().create_station(*this).release();
-    m_levtr = db->driver().create_levtr(*this).release();
-    m_station_data = db->driver().create_station_data(*this).release();
-    m_data = db->driver().create_data(*this).release();
+    m_repinfo = driver().create_repinfo(*this).release();
+    m_station = driver().create_station(*this).release();
+    m_levtr = driver().create_levtr(*this).release();
+    m_station_data = driver().create_station_data(*this).release();
+    m_data = driver().create_data(*this).release();
+
+    // Other connections can create or drop the summary table at any time
+    summary_table = connection().has_table("summary");
+
+    if (db->shared_cache)
+    {
+        auto cached = db->shared_cache->snapshot();
+        cache_generation = cached.generation;
+        if (cached.levtr)
+            m_levtr->load_cache(*cached.levtr);
+        if (cached.repinfo)
+        {
+            m_repinfo->load_cache(*cached.repinfo);
+            return;
+        }
+    }
+    m_repinfo->read_cache();
 }
 
 Transaction::~Transaction()
@@ -40,6 +63,18 @@ Transaction::~Transaction()
     delete m_repinfo;
 }
 
+dballe::sql::Connection& Transaction::connection()
+{
+    if (pooled) return *pooled->conn;
+    return *db->conn;
+}
+
+v7::Driver& Transaction::driver()
+{
+    if (pooled) return *pooled->driver;
+    return db->driver();
+}
+
 v7::Repinfo& Transaction::repinfo()
 {
     return *m_repinfo;
@@ -65,10 +100,137 @@ v7::Data& Transaction::data()
     return *m_data;
 }
 
+void Transaction::record_changes()
+{
+    m_record_changes = true;
+}
+
+void Transaction::record_added(const std::vector<SummaryTableRow>& rows)
+{
+    added_rows.insert(added_rows.end(), rows.begin(), rows.end());
+}
+
+void Transaction::record_removed(const std::vector<SummaryTableRow>& keys)
+{
+    removed_keys.insert(removed_keys.end(), keys.begin(), keys.end());
+}
+
+void Transaction::resolve_changes()
+{
+    Tracer<> trc;
+
+    // Merge the values added to each time series
+    std::map<std::tuple<int, int, wreport::Varcode>, SummaryTableRow> added;
+    for (const auto& row: added_rows)
+    {
+        auto res = added.emplace(std::make_tuple(row.id_station, row.id_levtr, row.code), row);
+        if (res.second) continue;
+        res.first->second.count += row.count;
+        res.first->second.datetime.merge(row.datetime);
+    }
+
+    // Group the time series with removed values by station
+    std::map<int, std::set<std::pair<int, wreport::Varcode>>> removed;
+    for (const auto& key: removed_keys)
+        removed[key.id_station].emplace(key.id_levtr, key.code);
+
+    auto get_station = [&](int id) -> const DBStation& {
+        auto i = changed_stations.find(id);
+        if (i == changed_stations.end())
+            i = changed_stations.emplace(id, station().lookup(trc, id)).first;
+        return i->second;
+    };
+    auto get_vardesc = [&](int id_levtr, wreport::Varcode code) {
+        auto i = changed_levtrs.find(id_levtr);
+        if (i == changed_levtrs.end())
+        {
+            const LevTrEntry* lt = levtr().lookup_id(trc, id_levtr);
+            if (!lt)
+                error_notfound::throwf("levtr %d not found while computing changes", id_levtr);
+            i = changed_levtrs.emplace(id_levtr, std::make_pair(lt->level, lt->trange)).first;
+        }
+        return summary::VarDesc(i->second.first, i->second.second, code);
+    };
+
+    m_changes.clear();
+    m_changes.cleared = removed_all;
+
+    // Read back the current state of time series with removed values, with
+    // one summary query per station
+    for (const auto& si: removed)
+    {
+        core::Query query;
+        query.ana_id = si.first;
+        for (const auto& key: si.second)
+            query.varcodes.insert(key.second);
+        SummaryQueryBuilder qb(dynamic_pointer_cast<v7::Transaction>(shared_from_this()), query, DBA_DB_MODIFIER_SUMMARY_DETAILS | DBA_DB_MODIFIER_UNSORTED, false);
+        qb.build();
+
+        std::map<std::pair<int, wreport::Varcode>, std::pair<DatetimeRange, size_t>> current;
+        data().run_summary_query(trc, qb, [&](const dballe::DBStation& station, int id_levtr, wreport::Varcode code, const DatetimeRange& datetime, size_t count) {
+            current.emplace(std::make_pair(id_levtr, code), std::make_pair(datetime, count));
+        });
+
+        for (const auto& key: si.second)
+        {
+            auto cur = current.find(key);
+            if (cur == current.end())
+                m_changes.replaced.emplace_back(get_station(si.first), get_vardesc(key.first, key.second), DatetimeRange(), 0);
+            else
+                m_changes.replaced.emplace_back(get_station(si.first), get_vardesc(key.first, key.second), cur->second.first, cur->second.second);
+            added.erase(std::make_tuple(si.first, key.first, key.second));
+        }
+    }
+
+    for (const auto& i: added)
+        m_changes.added.emplace_back(get_station(i.second.id_station), get_vardesc(i.second.id_levtr, i.second.code), i.second.datetime, i.second.count);
+
+    added_rows.clear();
+    removed_keys.clear();
+    changed_stations.clear();
+    changed_levtrs.clear();
+    removed_all = false;
+}
+
+void Transaction::lookup_changed(const std::vector<SummaryTableRow>& keys)
+{
+    Tracer<> trc;
+    for (const auto& key: keys)
+    {
+        if (changed_stations.find(key.id_station) == changed_stations.end())
+            changed_stations.emplace(key.id_station, station().lookup(trc, key.id_station));
+        if (changed_levtrs.find(key.id_levtr) == changed_levtrs.end())
+        {
+            const LevTrEntry* lt = levtr().lookup_id(trc, key.id_levtr);
+            if (!lt)
+                error_notfound::throwf("levtr %d not found while recording changes", key.id_levtr);
+            changed_levtrs.emplace(key.id_levtr, std::make_pair(lt->level, lt->trange));
+        }
+    }
+}
+
+void Transaction::update_shared_cache()
+{
+    if (!readonly)
+    {
+        // Anything that was written may have changed repinfo and levtr
+        db->shared_cache->invalidate();
+        return;
+    }
+    db->shared_cache->publish_repinfo(cache_generation, repinfo().entries());
+    db->shared_cache->publish_levtr(cache_generation, levtr().cached_entries());
+}
+
 void Transaction::commit()
 {
     if (fired) return;
+    if (m_record_changes)
+        resolve_changes();
     sql_transaction->commit();
+    if (m_data_written)
+        ++db->data_generation;
+    if (db->shared_cache)
+        update_shared_cache();
     clear_cached_state();
     fired = true;
     trc.done();
@@ -77,7 +239,12 @@ void Transaction::commit()
 void Transaction::rollback()
 {
     if (fired) return;
+    added_rows.clear();
+    removed_keys.clear();
+    removed_all = false;
     sql_transaction->rollback();
+    if (readonly && db->shared_cache)
+        update_shared_cache();
     clear_cached_state();
     fired = true;
     trc.done();
@@ -86,6 +253,9 @@ void Transaction::rollback()
 void Transaction::rollback_nothrow() noexcept
 {
     if (fired) return;
+    added_rows.clear();
+    removed_keys.clear();
+    removed_all = false;
     sql_transaction->rollback_nothrow();
     clear_cached_state();
     fired = true;
@@ -96,7 +266,8 @@ void Transaction::clear_cached_state()
 {
     // TODO: ideally drop it here, to load only on demand
     //       otherwise we're doing an extra query at the end of each transaction
-    repinfo().read_cache();
+    if (!readonly)
+        repinfo().read_cache();
     levtr().clear_cache();
     station_data().clear_cache();
     data().clear_cache();
@@ -118,8 +289,15 @@ Transaction& Transaction::downcast(dballe::db::Transaction& transaction)
 void Transaction::remove_all()
 {
     auto trc = db->trace->trace_remove_all();
-    db->driver().remove_all_v7(); // TODO: pass trace step
+    mark_data_written();
+    driver().remove_all_v7(); // TODO: pass trace step
     clear_cached_state();
+    if (m_record_changes)
+    {
+        added_rows.clear();
+        removed_keys.clear();
+        removed_all = true;
+    }
 }
 
 void Transaction::insert_station_data(dballe::Data& vals, const dballe::DBInsertOptions& opts)
@@ -187,6 +365,7 @@ void Transaction::insert_data(dballe::Data& vals, const dballe::DBInsertOptions&
 void Transaction::remove_station_data(const Query& query)
 {
     Tracer<> trc(this->trc ? this->trc->trace_remove_station_data(query) : nullptr);
+    mark_data_written();
     cursor::run_delete_query(trc, dynamic_pointer_cast<v7::Transaction>(shared_from_this()), core::Query::downcast(query), true, db->explain_queries);
     batch.clear();
 }
@@ -194,6 +373,7 @@ void Transaction::remove_station_data(const Query& query)
 void Transaction::remove_data(const Query& query)
 {
     Tracer<> trc(this->trc ? this->trc->trace_remove_data(query) : nullptr);
+    mark_data_written();
     cursor::run_delete_query(trc, dynamic_pointer_cast<v7::Transaction>(shared_from_this()), core::Query::downcast(query), false, db->explain_queries);
     batch.clear();
 }
@@ -201,6 +381,7 @@ void Transaction::remove_data(const Query& query)
 void Transaction::remove_station_data_by_id(int id)
 {
     Tracer<> trc(this->trc ? this->trc->trace_remove_station_data_by_id(id) : nullptr);
+    mark_data_written();
     station_data().remove_by_id(trc, id);
     batch.clear();
 }
@@ -208,7 +389,18 @@ void Transaction::remove_station_data_by_id(int id)
 void Transaction::remove_data_by_id(int id)
 {
     Tracer<> trc(this->trc ? this->trc->trace_remove_data_by_id(id) : nullptr);
-    data().remove_by_id(trc, id);
+    mark_data_written();
+    if (summary_table || m_record_changes)
+    {
+        std::vector<SummaryTableRow> keys;
+        driver().data_keys_v7(id, id, Datetime(), keys);
+        data().remove_by_id(trc, id);
+        if (summary_table)
+            driver().summary_refresh_v7(keys);
+        if (m_record_changes)
+            record_removed(keys);
+    } else
+        data().remove_by_id(trc, id);
     batch.clear();
 }
 
@@ -268,6 +460,7 @@ void Transaction::attr_query_data(int data_id, std::function<void(std::unique_pt
 void Transaction::attr_insert_station(int data_id, const Values& attrs)
 {
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_insert_station") : nullptr);
+    mark_data_written();
     auto& d = station_data();
     d.merge_attrs(trc, data_id, attrs);
 }
@@ -275,6 +468,7 @@ void Transaction::attr_insert_station(int data_id, const Values& attrs)
 void Transaction::attr_insert_data(int data_id, const Values& attrs)
 {
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_insert_data") : nullptr);
+    mark_data_written();
     auto& d = data();
     d.merge_attrs(trc, data_id, attrs);
 }
@@ -282,40 +476,51 @@ void Transaction::attr_insert_data(int data_id, const Values& attrs)
 void Transaction::attr_remove_station(int data_id, const db::AttrList& attrs)
 {
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_remove_station") : nullptr);
-    if (attrs.empty())
-    {
-        // Delete all attributes
-        char buf[64];
-        snprintf(buf, 64, "UPDATE station_data SET attrs=NULL WHERE id=%d", data_id);
-        Tracer<> trc_upd(trc ? trc->trace_update(buf, 1) : nullptr);
-        db->conn->execute(buf);
-    } else {
-        auto& d = station_data();
-        d.remove_attrs(trc, data_id, attrs);
-    }
+    mark_data_written();
+    // An empty attrs deletes all attributes
+    auto& d = station_data();
+    d.remove_attrs(trc, data_id, attrs);
 }
 
 void Transaction::attr_remove_data(int data_id, const db::AttrList& attrs)
 {
     Tracer<> trc(this->trc ? this->trc->trace_func("attr_remove_data") : nullptr);
-    if (attrs.empty())
-    {
-        // Delete all attributes
-        char buf[64];
-        snprintf(buf, 64, "UPDATE data SET attrs=NULL WHERE id=%d", data_id);
-        Tracer<> trc_upd(trc ? trc->trace_update(buf, 1) : nullptr);
-        db->conn->execute(buf);
-    } else {
-        auto& d = data();
-        d.remove_attrs(trc, data_id, attrs);
-    }
+    mark_data_written();
+    // An empty attrs deletes all attributes
+    auto& d = data();
+    d.remove_attrs(trc, data_id, attrs);
 }
 
 void Transaction::update_repinfo(const char* repinfo_file, int* added, int* deleted, int* updated)
 { // TODO: tracing
+    mark_data_written();
     repinfo().update(repinfo_file, added, deleted, updated);
 }
 
+unsigned Transaction::purge_before(const Datetime& dt)
+{
+    Tracer<> trc(this->trc ? this->trc->trace_purge_before(dt) : nullptr);
+    mark_data_written();
+    auto& driver = this->driver();
+    unsigned count = 0;
+    int id_min, id_max;
+    if (driver.data_id_range_v7(id_min, id_max))
+    {
+        std::vector<SummaryTableRow> keys;
+        if (m_record_changes)
+        {
+            driver.data_keys_v7(id_min, id_max, dt, keys);
+            lookup_changed(keys);
+        }
+        count = db->purge_data(dt, id_min, id_max);
+        if (m_record_changes)
+            record_removed(keys);
+    }
+    driver.vacuum_v7();
+    clear_cached_state();
+    return count;
+}
+
 void Transaction::dump(FILE* out)
 {
     repinfo().dump(out);
@@ -5,7 +5,9 @@
 #include <dballe/db/v7/fwd.h>
 #include <dballe/db/v7/data.h>
 #include <dballe/db/v7/batch.h>
+#include <dballe/db/summary.h>
 #include <dballe/sql/fwd.h>
+#include <map>
 #include <memory>
 
 namespace dballe {
@@ -29,6 +31,37 @@ protected:
     /// Track active cursors to invalidate them on commit/rollback
     std::vector<std::weak_ptr<dballe::Cursor>> tracked_cursors;
 
+    /// True if the changes done by this transaction are being recorded
+    bool m_record_changes = false;
+    /// Time series with values added by this transaction
+    std::vector<SummaryTableRow> added_rows;
+    /// Time series with values removed by this transaction
+    std::vector<SummaryTableRow> removed_keys;
+    /// True if all data was removed by this transaction
+    bool removed_all = false;
+    /// Stations of recorded changes, looked up by id
+    std::map<int, DBStation> changed_stations;
+    /// Levels and time ranges of recorded changes, looked up by levtr id
+    std::map<int, std::pair<Level, Trange>> changed_levtrs;
+    /// Changes done by this transaction, computed on commit
+    summary::Changes m_changes;
+    /// Generation of the shared caches when the transaction started
+    unsigned cache_generation = 0;
+    /// True if the transaction wrote to the database
+    bool m_data_written = false;
+
+    /// Compute m_changes from added_rows, removed_keys and removed_all
+    void resolve_changes();
+
+    /**
+     * Look up the stations and levels/time ranges of keys, before a vacuum
+     * can delete them from the database
+     */
+    void lookup_changed(const std::vector<SummaryTableRow>& keys);
+
+    /// Keep the shared caches in sync with what this transaction did and read
+    void update_shared_cache();
+
     void add_msg_to_batch(Tracer<>& trc, const Message& message, const dballe::DBImportOptions& opts);
     void track_cursor(std::weak_ptr<dballe::Cursor> cursor);
 
@@ -36,22 +69,46 @@ public:
     typedef v7::DB DB;
 
     std::shared_ptr<v7::DB> db;
+    /// Pooled connection used instead of the main database connection, if any
+    std::shared_ptr<v7::PooledConnection> pooled;
     /// SQL-side transaction
     std::shared_ptr<dballe::sql::Transaction> sql_transaction;
+    /// True if the transaction does not modify the database
+    bool readonly;
     /// True if commit or rollback have already been called on this transaction
     bool fired = false;
+    /// Value of db->data_generation when the transaction started
+    unsigned data_generation;
+    /// True if the database has a summary table to keep up to date
+    bool summary_table = false;
     /// Batch importer
     v7::Batch batch;
     /// Tracing system
     v7::Tracer<v7::trace::Transaction> trc;
 
-    Transaction(std::shared_ptr<v7::DB> db, std::unique_ptr<dballe::sql::Transaction> sql_transaction);
+    Transaction(std::shared_ptr<v7::DB> db, std::unique_ptr<dballe::sql::Transaction> sql_transaction, bool readonly=false, std::shared_ptr<v7::PooledConnection> pooled=nullptr);
     Transaction(const Transaction&) = delete;
     Transaction(Transaction&&) = delete;
     Transaction& operator=(const Transaction&) = delete;
     Transaction& operator=(Transaction&&) = delete;
     ~Transaction();
 
+    /**
+     * Note that the transaction wrote to the database.
+     *
+     * Results of data queries are not taken from the query cache after a
+     * transaction wrote, and committing increments db->data_generation.
+     */
+    void mark_data_written() { m_data_written = true; }
+
+    /// Check if the transaction wrote to the database
+    bool data_written() const { return m_data_written; }
+
+    /// Access the database connection used by this transaction
+    dballe::sql::Connection& connection();
+    /// Access the backend driver for the connection used by this transaction
+    v7::Driver& driver();
+
     /// Access the repinfo table
     v7::Repinfo& repinfo();
     /// Access the station table
@@ -63,6 +120,32 @@ public:
     /// Access the data table
     v7::Data& data();
 
+    /**
+     * Record the time series changed by this transaction, so that after
+     * commit they can be read with changes() and applied to summaries and
+     * explorers.
+     *
+     * Only changes done after this call are recorded.
+     */
+    void record_changes();
+
+    /// Check if changes are being recorded
+    bool recording_changes() const { return m_record_changes; }
+
+    /// Record values added to time series
+    void record_added(const std::vector<SummaryTableRow>& rows);
+
+    /// Record time series that had values removed
+    void record_removed(const std::vector<SummaryTableRow>& keys);
+
+    /**
+     * Return the time series changed by this transaction.
+     *
+     * This is filled by commit() if record_changes() has been called, and is
+     * empty otherwise.
+     */
+    const summary::Changes& changes() const { return m_changes; }
+
     void commit() override;
     void rollback() override;
     void rollback_nothrow() noexcept override;
@@ -91,6 +174,7 @@ public:
     void import_message(const Message& message, const dballe::DBImportOptions& opts) override;
     void import_messages(const std::vector<std::shared_ptr<Message>>& msgs, const dballe::DBImportOptions& opts) override;
     void update_repinfo(const char* repinfo_file, int* added, int* deleted, int* updated) override;
+    unsigned purge_before(const Datetime& dt) override;
 
     static Transaction& downcast(dballe::db::Transaction& transaction);
 
@@ -1,5 +1,10 @@
 #include "core/tests.h"
+#include "msg/tests.h"
+#include "msg/parallel_encoder.h"
 #include "exporter.h"
+#include "importer.h"
+#include "var.h"
+#include <wreport/bulletin.h>
 
 using namespace wreport;
 using namespace dballe;
@@ -8,6 +13,32 @@ using namespace std;
 
 namespace {
 
+/// Encode msgs with a ParallelEncoder
+std::vector<std::string> encode_parallel(const impl::Messages& msgs, const ExporterOptions& opts, unsigned threads=3)
+{
+    std::vector<std::string> res;
+    impl::ParallelEncoder encoder(Encoding::BUFR, opts, [&](const std::string& data) { res.push_back(data); }, threads);
+    for (const auto& msg: msgs)
+        encoder.add(msg);
+    encoder.flush();
+    return res;
+}
+
+/// Decode all the messages in the given encoded bulletins
+impl::Messages decode_all(const std::vector<std::string>& encoded)
+{
+    impl::Messages res;
+    auto importer = Importer::create(Encoding::BUFR);
+    for (const auto& data: encoded)
+    {
+        BinaryMessage msg(Encoding::BUFR);
+        msg.data = data;
+        for (const auto& m: importer->from_binary(msg))
+            res.push_back(m);
+    }
+    return res;
+}
+
 class Tests : public TestCase
 {
     using TestCase::TestCase;
@@ -21,6 +52,79 @@ void Tests::register_tests()
 add_method("empty", []() {
 });
 
+add_method("parallel", []() {
+    impl::Messages synops;
+    for (unsigned i = 0; i < 10; ++i)
+        synops.push_back(read_msgs("bufr/obs0-1.22.bufr", Encoding::BUFR)[0]);
+    auto exporter = Exporter::create(Encoding::BUFR);
+
+    // One message per bulletin, in order
+    impl::ExporterOptions opts;
+    std::vector<std::string> encoded = encode_parallel(synops, opts);
+    wassert(actual(encoded.size()) == synops.size());
+    for (unsigned i = 0; i < synops.size(); ++i)
+        wassert(actual(encoded[i] == exporter->to_binary({synops[i]})).istrue());
+    impl::Messages expected = decode_all(encoded);
+
+    // Batches of subsets
+    opts.max_subsets = 4;
+    encoded = encode_parallel(synops, opts);
+    wassert(actual(encoded.size()) == 3u);
+    impl::Messages decoded = decode_all(encoded);
+    wassert(actual(decoded.size()) == expected.size());
+    for (unsigned i = 0; i < decoded.size(); ++i)
+        wassert(actual(decoded[i]->diff(*expected[i])) == 0u);
+
+    // Compressed batches of subsets
+    opts.compress = true;
+    encoded = encode_parallel(synops, opts, 1);
+    wassert(actual(encoded.size()) == 3u);
+    auto bulletin = BufrBulletin::decode(encoded[0]);
+    wassert(actual(bulletin->subsets.size()) == 4u);
+    wassert_true(bulletin->compression);
+    decoded = decode_all(encoded);
+    wassert(actual(decoded.size()) == expected.size());
+    for (unsigned i = 0; i < decoded.size(); ++i)
+        wassert(actual(decoded[i]->diff(*expected[i])) == 0u);
+
+    // Messages whose generic template layout differs are not put in the same
+    // bulletin
+    impl::Messages generic;
+    for (unsigned i = 0; i < 4; ++i)
+        generic.push_back(read_msgs("bufr/gen-generic.bufr", Encoding::BUFR)[0]);
+    generic[2]->set(Level(103, 2000), Trange::instant(), newvar(WR_VAR(0, 12, 101), 290.0));
+    opts.template_name = "generic";
+    opts.compress = false;
+    encoded = encode_parallel(generic, opts);
+    wassert(actual(encoded.size()) == 3u);
+    decoded = decode_all(encoded);
+    wassert(actual(decoded.size()) == 4u);
+    auto single = Exporter::create(Encoding::BUFR, opts);
+    for (unsigned i = 0; i < 4; ++i)
+        wassert(actual(decoded[i]->diff(*decode_all({single->to_binary({generic[i]})})[0])) == 0u);
+
+    // Messages of the same type that are encoded with different templates
+    // are not put in the same bulletin: the synop template depends on the
+    // presence of the station name
+    impl::Messages mixed;
+    for (unsigned i = 0; i < 4; ++i)
+        mixed.push_back(read_msgs("bufr/obs0-1.22.bufr", Encoding::BUFR)[0]);
+    Values& station_data = impl::Message::downcast(mixed[1])->station_data;
+    if (station_data.maybe_var(WR_VAR(0, 1, 19)))
+        station_data.unset(WR_VAR(0, 1, 19));
+    else
+        station_data.set(WR_VAR(0, 1, 19), "Test station");
+    impl::ExporterOptions mixed_opts;
+    mixed_opts.max_subsets = 4;
+    encoded = encode_parallel(mixed, mixed_opts);
+    wassert(actual(encoded.size()) == 3u);
+    decoded = decode_all(encoded);
+    wassert(actual(decoded.size()) == 4u);
+    single = Exporter::create(Encoding::BUFR, mixed_opts);
+    for (unsigned i = 0; i < 4; ++i)
+        wassert(actual(decoded[i]->diff(*decode_all({single->to_binary({mixed[i]})})[0])) == 0u);
+});
+
 }
 
 }
@@ -22,12 +22,12 @@ std::unique_ptr<ExporterOptions> ExporterOptions::create()
 
 bool ExporterOptions::operator==(const ExporterOptions& o) const
 {
-    return std::tie(template_name, centre, subcentre, application) == std::tie(o.template_name, o.centre, o.subcentre, o.application);
+    return std::tie(template_name, centre, subcentre, application, max_subsets, compress) == std::tie(o.template_name, o.centre, o.subcentre, o.application, o.max_subsets, o.compress);
 }
 
 bool ExporterOptions::operator!=(const ExporterOptions& o) const
 {
-    return std::tie(template_name, centre, subcentre, application) != std::tie(o.template_name, o.centre, o.subcentre, o.application);
+    return std::tie(template_name, centre, subcentre, application, max_subsets, compress) != std::tie(o.template_name, o.centre, o.subcentre, o.application, o.max_subsets, o.compress);
 }
 
 void ExporterOptions::print(FILE* out)
@@ -65,6 +65,19 @@ std::string ExporterOptions::to_string() const
         res += buf;
     }
 
+    if (max_subsets != 1)
+    {
+        if (!res.empty()) res += ", ";
+        snprintf(buf, 100, "max subsets %u", max_subsets);
+        res += buf;
+    }
+
+    if (compress)
+    {
+        if (!res.empty()) res += ", ";
+        res += "compressed";
+    }
+
     return res;
 }
 
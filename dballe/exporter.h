@@ -32,7 +32,14 @@ public:
     int subcentre = MISSING_INT;
     /// Originating application ID
     int application = MISSING_INT;
-
+    /**
+     * Maximum number of consecutive messages to encode as subsets of the same
+     * bulletin, when exporting a sequence of messages with
+     * impl::ParallelEncoder. 1 encodes each message in its own bulletin.
+     */
+    unsigned max_subsets = 1;
+    /// Use BUFR compression for bulletins whose subsets all have the same variables
+    bool compress = false;
 
     bool operator==(const ExporterOptions&) const;
     bool operator!=(const ExporterOptions&) const;
@@ -1,5 +1,7 @@
 #include "core/tests.h"
 #include "types.h"
+#include "core/file.h"
+#include <cstdio>
 
 using namespace std;
 using namespace wreport::tests;
@@ -7,6 +9,33 @@ using namespace dballe;
 
 namespace {
 
+/// Check that reading pathname via mmap gives the same messages as via stdio
+void compare_mapped(Encoding type, const std::string& pathname)
+{
+    FILE* fd = fopen(pathname.c_str(), "r");
+    wassert(actual(fd != nullptr).istrue());
+    auto stdio = File::create(type, fd, true, pathname);
+    auto mapped = File::create(type, pathname, "r");
+    wassert(actual(dynamic_cast<core::MappedMessageFile*>(mapped.get()) != nullptr).istrue());
+
+    vector<BinaryMessage> expected;
+    stdio->foreach([&](const BinaryMessage& msg) { expected.push_back(msg); return true; });
+    wassert(actual(expected.size()) > 0u);
+
+    unsigned count = 0;
+    mapped->foreach([&](const BinaryMessage& msg) {
+        wassert(actual(count) < expected.size());
+        wassert(actual(msg.data) == expected[count].data);
+        wassert(actual(msg.offset) == expected[count].offset);
+        wassert(actual(msg.index) == expected[count].index);
+        wassert(actual(msg.pathname) == pathname);
+        ++count;
+        return true;
+    });
+    wassert(actual(count) == expected.size());
+    wassert(actual(mapped->read()).isfalse());
+}
+
 class Tests : public TestCase
 {
     using TestCase::TestCase;
@@ -88,6 +117,23 @@ add_method("json", []() {
     wassert_throws(wreport::error_consistency, file->read());
 });
 
+add_method("mapped", []() {
+    wassert(compare_mapped(Encoding::BUFR, tests::datafile("bufr/bufr1")));
+    wassert(compare_mapped(Encoding::BUFR, tests::datafile("bufr/gen-generic.bufr")));
+    wassert(compare_mapped(Encoding::BUFR, tests::datafile("bufr/temp-huge.bufr")));
+    wassert(compare_mapped(Encoding::CREX, tests::datafile("crex/test-synop0.crex")));
+    wassert(compare_mapped(Encoding::CREX, tests::datafile("crex/test-mare1.crex")));
+    wassert(compare_mapped(Encoding::JSON, tests::datafile("json/issue134.json")));
+
+    // Encoding autodetection
+    auto file = File::create(tests::datafile("crex/test-synop0.crex"), "r");
+    wassert(actual(file->encoding()) == Encoding::CREX);
+    wassert(actual(dynamic_cast<core::MappedCrexFile*>(file.get()) != nullptr).istrue());
+
+    // Mapped files are read-only
+    wassert_throws(wreport::error_unimplemented, file->write("CREX++"));
+});
+
 add_method("parse_encoding", []() {
     // Parse encoding test
     wassert(actual(File::parse_encoding("BUFR")) == Encoding::BUFR);
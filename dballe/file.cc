@@ -6,6 +6,7 @@
 #include <cstring>
 #include <cstdio>
 #include <algorithm>
+#include <sys/stat.h>
 
 using namespace std;
 using namespace wreport;
@@ -44,8 +45,50 @@ Encoding File::parse_encoding(const std::string& s)
     error_notfound::throwf("unsupported encoding '%s'", s.c_str());
 }
 
+namespace {
+
+/**
+ * Check if pathname can be read using a memory mapping: this is the case for
+ * nonempty regular files opened read-only
+ */
+bool can_map(const std::string& pathname, const char* mode)
+{
+    if (strcmp(mode, "r") != 0 && strcmp(mode, "rb") != 0)
+        return false;
+    struct stat st;
+    // Leave error reporting to fopen
+    if (stat(pathname.c_str(), &st) == -1)
+        return false;
+    return S_ISREG(st.st_mode) && st.st_size > 0;
+}
+
+unique_ptr<File> create_mapped(Encoding type, const std::string& pathname, std::unique_ptr<core::MappedFile> mapping)
+{
+    switch (type)
+    {
+        case Encoding::BUFR: return unique_ptr<File>(new core::MappedBufrFile(pathname, move(mapping)));
+        case Encoding::CREX: return unique_ptr<File>(new core::MappedCrexFile(pathname, move(mapping)));
+        case Encoding::JSON: return unique_ptr<File>(new core::MappedJsonFile(pathname, move(mapping)));
+        default: error_consistency::throwf("cannot handle unknown file type %d", (int)type);
+    }
+}
+
+}
+
 unique_ptr<File> File::create(const std::string& pathname, const char* mode)
 {
+    if (can_map(pathname, mode))
+    {
+        unique_ptr<core::MappedFile> mapping(new core::MappedFile(pathname));
+        // Auto-detect from the first character in the file
+        switch (mapping->begin()[0])
+        {
+            case 'B': return create_mapped(Encoding::BUFR, pathname, move(mapping));
+            case 'C': return create_mapped(Encoding::CREX, pathname, move(mapping));
+            default: throw error_notfound("could not detect the encoding of " + pathname);
+        }
+    }
+
     FILE* fp = fopen(pathname.c_str(), mode);
     if (fp == NULL)
         error_system::throwf("opening %s with mode '%s'", pathname.c_str(), mode);
@@ -54,6 +97,9 @@ unique_ptr<File> File::create(const std::string& pathname, const char* mode)
 
 unique_ptr<File> File::create(Encoding type, const std::string& pathname, const char* mode)
 {
+    if (can_map(pathname, mode))
+        return create_mapped(type, pathname, unique_ptr<core::MappedFile>(new core::MappedFile(pathname)));
+
     FILE* fp = fopen(pathname.c_str(), mode);
     if (fp == NULL)
         error_system::throwf("opening %s with mode '%s'", pathname.c_str(), mode);
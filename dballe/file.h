@@ -51,6 +51,14 @@ public:
      */
     virtual bool foreach(std::function<bool(const BinaryMessage&)> dest) = 0;
 
+    /**
+     * Move the read position to the start of the message at \a offset.
+     *
+     * The next message read will be given \a index as its index in the file.
+     * This only works on files that can be seeked.
+     */
+    virtual void seek(off_t offset, int index) = 0;
+
     /// Append the binary message to the file
     virtual void write(const std::string& msg) = 0;
 
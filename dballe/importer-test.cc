@@ -1,6 +1,10 @@
 #include "core/tests.h"
 #include "msg/msg.h"
 #include "importer.h"
+#include "file.h"
+#include "msg/parallel_decoder.h"
+#include <wreport/utils/sys.h>
+#include <map>
 
 using namespace wreport;
 using namespace dballe;
@@ -9,6 +13,58 @@ using namespace std;
 
 namespace {
 
+typedef std::map<int, std::vector<std::shared_ptr<Message>>> Decoded;
+
+/// Decode all messages in a file, one at a time
+Decoded decode_sequential(File& file)
+{
+    Decoded res;
+    auto importer = Importer::create(file.encoding());
+    while (BinaryMessage msg = file.read())
+        res[msg.index] = importer->from_binary(msg);
+    return res;
+}
+
+/// Decode all messages in a test file, one at a time
+Decoded decode_sequential(const char* fname, Encoding encoding)
+{
+    auto file = open_test_data(fname, encoding);
+    return decode_sequential(*file);
+}
+
+/// Decode all messages in a file using multiple threads
+Decoded decode_parallel(File& file, bool ordered, std::vector<int>* order=nullptr, unsigned threads=3)
+{
+    Decoded res;
+    auto importer = Importer::create(file.encoding());
+    importer->foreach_decoded_parallel(file, [&](const BinaryMessage& msg, std::vector<std::shared_ptr<Message>>& decoded) {
+        res[msg.index] = decoded;
+        if (order) order->push_back(msg.index);
+        return true;
+    }, threads, ordered);
+    return res;
+}
+
+/// Decode all messages in a test file using multiple threads
+Decoded decode_parallel(const char* fname, Encoding encoding, bool ordered, std::vector<int>* order=nullptr)
+{
+    auto file = open_test_data(fname, encoding);
+    return decode_parallel(*file, ordered, order);
+}
+
+void assert_same_decoded(const Decoded& res, const Decoded& expected)
+{
+    wassert(actual(res.size()) == expected.size());
+    for (const auto& e: expected)
+    {
+        auto a = res.find(e.first);
+        wassert_true(a != res.end());
+        wassert(actual(a->second.size()) == e.second.size());
+        for (unsigned i = 0; i < e.second.size(); ++i)
+            wassert(actual(a->second[i]->diff(*e.second[i])) == 0u);
+    }
+}
+
 class Tests : public TestCase
 {
     using TestCase::TestCase;
@@ -31,6 +87,114 @@ add_method("options", []() {
     wassert_true(accurate.domain_errors == ImporterOptions::DomainErrors::THROW);
 });
 
+add_method("reuse", []() {
+    const char* fnames[] = { "bufr/synop3new.bufr", "bufr/gen-generic.bufr", "bufr/temp-huge.bufr" };
+    for (const auto& fname: fnames)
+    {
+        WREPORT_TEST_INFO(info);
+        info() << fname;
+        Decoded expected = decode_sequential(fname, Encoding::BUFR);
+
+        auto file = open_test_data(fname, Encoding::BUFR);
+        auto importer = Importer::create(Encoding::BUFR);
+        std::vector<std::shared_ptr<Message>> reuse;
+        std::vector<std::shared_ptr<Message>> msgs;
+        while (BinaryMessage msg = file->read())
+        {
+            const auto& exp = expected[msg.index];
+
+            // Messages not kept by dest are reused
+            unsigned count = 0;
+            importer->foreach_decoded_reusing(msg, reuse, [&](std::shared_ptr<Message> m) {
+                wassert(actual(m->diff(*exp[count])) == 0u);
+                ++count;
+                return true;
+            });
+            wassert(actual(count) == exp.size());
+            wassert(actual(reuse.size()) == 1u);
+
+            // Messages kept by dest are not reused
+            Decoded kept;
+            importer->foreach_decoded_reusing(msg, reuse, [&](std::shared_ptr<Message> m) {
+                kept[0].push_back(m);
+                return true;
+            });
+            wassert(assert_same_decoded(kept, Decoded{{0, exp}}));
+            for (unsigned i = 1; i < kept[0].size(); ++i)
+                wassert_true(kept[0][i] != kept[0][i - 1]);
+
+            // Decoding into a vector reuses its previous contents
+            importer->from_binary(msg, msgs);
+            const Message* first = msgs[0].get();
+            importer->from_binary(msg, msgs);
+            wassert_true(msgs[0].get() == first);
+            wassert(assert_same_decoded(Decoded{{0, msgs}}, Decoded{{0, exp}}));
+
+            // Messages referenced elsewhere are left alone
+            std::shared_ptr<Message> held = msgs[0];
+            importer->from_binary(msg, msgs);
+            wassert_true(msgs[0] != held);
+            wassert(actual(held->diff(*exp[0])) == 0u);
+        }
+    }
+});
+
+add_method("parallel", []() {
+    const char* bufr_files[] = { "bufr/synop3new.bufr", "bufr/gen-generic.bufr", "bufr/temp-huge.bufr" };
+    for (const auto& fname: bufr_files)
+    {
+        WREPORT_TEST_INFO(info);
+        info() << fname;
+        Decoded expected = decode_sequential(fname, Encoding::BUFR);
+        wassert(actual(expected.size()) > 0u);
+
+        std::vector<int> order;
+        wassert(assert_same_decoded(decode_parallel(fname, Encoding::BUFR, true, &order), expected));
+        for (unsigned i = 0; i < order.size(); ++i)
+            wassert(actual(order[i]) == (int)i);
+
+        wassert(assert_same_decoded(decode_parallel(fname, Encoding::BUFR, false), expected));
+    }
+
+    Decoded expected = decode_sequential("crex/test-synop0.crex", Encoding::CREX);
+    wassert(assert_same_decoded(decode_parallel("crex/test-synop0.crex", Encoding::CREX, true), expected));
+
+    // The file encoding must match the importer
+    auto file = open_test_data("crex/test-synop0.crex", Encoding::CREX);
+    auto importer = Importer::create(Encoding::BUFR);
+    auto e = wassert_throws(wreport::error_consistency, importer->foreach_decoded_parallel(*file, [](const BinaryMessage&, std::vector<std::shared_ptr<Message>>&) { return true; }));
+    wassert(actual(e.what()).contains("CREX"));
+});
+
+add_method("parallel_c_operators", []() {
+    // Messages with C operators changing data width, scale or reference value
+    // add altered entries to the B tables while they are decoded: mix them
+    // with messages that use the same tables without altering them
+    const char* fnames[] = {
+        "bufr/synop-gtscosmo.bufr", "bufr/temp-tsig-2.bufr", "bufr/temp-2-255.bufr",
+        "bufr/synop-longname.bufr", "bufr/synop3new.bufr", "bufr/gts-acars-us1.bufr",
+    };
+    std::string data;
+    for (unsigned i = 0; i < 8; ++i)
+        for (const auto& fname: fnames)
+            data += sys::read_file(tests::datafile(fname));
+    sys::write_file("test-parallel-c-operators.bufr", data);
+
+    auto file = File::create(Encoding::BUFR, "test-parallel-c-operators.bufr", "rb");
+    Decoded expected = decode_sequential(*file);
+    wassert(actual(expected.size()) > 400u);
+
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        file = File::create(Encoding::BUFR, "test-parallel-c-operators.bufr", "rb");
+        wassert(assert_same_decoded(decode_parallel(*file, false, nullptr, 8), expected));
+    }
+
+    wassert_true(impl::ParallelDecoder::alters_tables(open_test_data("bufr/temp-2-255.bufr", Encoding::BUFR)->read()));
+    wassert_true(impl::ParallelDecoder::alters_tables(open_test_data("bufr/synop-longname.bufr", Encoding::BUFR)->read()));
+    wassert_false(impl::ParallelDecoder::alters_tables(open_test_data("bufr/gen-generic.bufr", Encoding::BUFR)->read()));
+});
+
 }
 
 }
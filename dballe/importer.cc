@@ -2,8 +2,10 @@
 #include "file.h"
 #include "dballe/msg/wr_codec.h"
 #include "dballe/msg/json_codec.h"
+#include "dballe/msg/parallel_decoder.h"
 #include <wreport/error.h>
 #include <wreport/bulletin.h>
+#include <algorithm>
 
 #include "config.h"
 
@@ -69,11 +71,48 @@ std::vector<std::shared_ptr<Message>> Importer::from_binary(const BinaryMessage&
     return res;
 }
 
+void Importer::from_binary(const BinaryMessage& msg, std::vector<std::shared_ptr<Message>>& msgs) const
+{
+    std::vector<std::shared_ptr<Message>> reuse;
+    reuse.swap(msgs);
+    // Message::create takes messages from the back
+    std::reverse(reuse.begin(), reuse.end());
+    foreach_decoded_reusing(msg, reuse, [&](std::shared_ptr<Message> m) { msgs.emplace_back(m); return true; });
+}
+
+bool Importer::foreach_decoded_reusing(const BinaryMessage& msg, std::vector<std::shared_ptr<Message>>& reuse, std::function<bool(std::shared_ptr<Message>)> dest) const
+{
+    return foreach_decoded(msg, dest);
+}
+
+bool Importer::foreach_decoded_parallel(File& file, std::function<bool(const BinaryMessage&, std::vector<std::shared_ptr<Message>>&)> dest, unsigned threads, bool ordered) const
+{
+    if (file.encoding() != encoding())
+        error_consistency::throwf("cannot decode a %s file with a %s importer",
+                File::encoding_name(file.encoding()), File::encoding_name(encoding()));
+
+    impl::ParallelDecoder decoder(file, opts, threads, ordered);
+    BinaryMessage msg(file.encoding());
+    std::vector<std::shared_ptr<Message>> decoded;
+    while (decoder.next(msg, decoded))
+        if (!dest(msg, decoded))
+            return false;
+    return true;
+}
+
 std::vector<std::shared_ptr<Message>> Importer::from_bulletin(const wreport::Bulletin& msg) const
 {
     throw wreport::error_unimplemented("this exporter cannot read bulletins");
 }
 
+void BulletinImporter::from_bulletin(const wreport::Bulletin& msg, std::vector<std::shared_ptr<Message>>& msgs) const
+{
+    std::vector<std::shared_ptr<Message>> reuse;
+    reuse.swap(msgs);
+    std::reverse(reuse.begin(), reuse.end());
+    foreach_decoded_bulletin(msg, reuse, [&](std::shared_ptr<Message> m) { msgs.emplace_back(m); return true; });
+}
+
 std::unique_ptr<Importer> Importer::create(Encoding type, const ImporterOptions& opts)
 {
     switch (type)
@@ -88,6 +88,11 @@ public:
      */
     virtual Encoding encoding() const = 0;
 
+    /**
+     * Return the options used by this importer
+     */
+    const ImporterOptions& options() const { return opts; }
+
     /**
      * Decode a message from its raw encoded representation
      *
@@ -98,6 +103,22 @@ public:
      */
     std::vector<std::shared_ptr<Message>> from_binary(const BinaryMessage& msg) const;
 
+    /**
+     * Decode a message from its raw encoded representation into \a msgs,
+     * reusing the messages that \a msgs contains from a previous call.
+     *
+     * The previous contents of \a msgs that are not referenced anywhere else
+     * are emptied and filled again, keeping the memory they have already
+     * allocated. Use this to decode in a loop, when the decoded messages are
+     * not needed after decoding the next one.
+     *
+     * @param msg
+     *   Encoded message
+     * @retval msgs
+     *   The resulting messages
+     */
+    void from_binary(const BinaryMessage& msg, std::vector<std::shared_ptr<Message>>& msgs) const;
+
     /**
      * Import a decoded BUFR/CREX message
      */
@@ -117,6 +138,48 @@ public:
      */
     virtual bool foreach_decoded(const BinaryMessage& msg, std::function<bool(std::shared_ptr<Message>)> dest) const = 0;
 
+    /**
+     * Decode a message like foreach_decoded(), reusing the messages in
+     * \a reuse instead of creating new ones where possible.
+     *
+     * A message in \a reuse is emptied and filled with new data only if it is
+     * not referenced anywhere else. Messages that are not referenced anywhere
+     * else after \a dest returns are added to \a reuse, so that if \a dest
+     * does not keep the messages it receives, one message is enough to decode
+     * all the subsets of a bulletin.
+     *
+     * Importers that cannot reuse messages create new ones, as in
+     * foreach_decoded().
+     */
+    virtual bool foreach_decoded_reusing(const BinaryMessage& msg, std::vector<std::shared_ptr<Message>>& reuse, std::function<bool(std::shared_ptr<Message>)> dest) const;
+
+    /**
+     * Read all messages from \a file and decode them using multiple threads,
+     * calling \a dest with each message and its decoded contents.
+     *
+     * Messages are read and \a dest is called in the calling thread, while
+     * decoding happens in worker threads, each using its own importer with the
+     * same options as this one.
+     *
+     * If a message cannot be decoded, the decoding error is thrown after
+     * \a dest has been called for all the messages before it.
+     *
+     * Return false from \a dest to stop decoding.
+     *
+     * @param file
+     *   The file to read. Its encoding must be the same as this importer.
+     * @param dest
+     *   The function that consumes the decoded messages.
+     * @param threads
+     *   Number of decoding threads; 0 means one per available core, or the
+     *   value of the DBA_THREADS environment variable if set.
+     * @param ordered
+     *   If true, \a dest is called in the order messages have in the file;
+     *   otherwise, it is called in the order messages finish decoding.
+     * @returns true if it got to the end of the file, false if dest returned false.
+     */
+    bool foreach_decoded_parallel(File& file, std::function<bool(const BinaryMessage&, std::vector<std::shared_ptr<Message>>&)> dest, unsigned threads=0, bool ordered=true) const;
+
     /**
      * Instantiate an importer
      *
@@ -148,6 +211,22 @@ public:
      * Import a decoded BUFR/CREX message
      */
     std::vector<std::shared_ptr<Message>> from_bulletin(const wreport::Bulletin& msg) const override = 0;
+
+    /**
+     * Import a decoded BUFR/CREX message into \a msgs, reusing the messages
+     * that \a msgs contains from a previous call, like
+     * Importer::from_binary(const BinaryMessage&, std::vector<std::shared_ptr<Message>>&)
+     */
+    void from_bulletin(const wreport::Bulletin& msg, std::vector<std::shared_ptr<Message>>& msgs) const;
+
+    /**
+     * Import a decoded BUFR/CREX message calling \a dest on each resulting
+     * Message, and reusing the messages in \a reuse like
+     * foreach_decoded_reusing().
+     *
+     * Return false from \a dest to stop decoding.
+     */
+    virtual bool foreach_decoded_bulletin(const wreport::Bulletin& msg, std::vector<std::shared_ptr<Message>>& reuse, std::function<bool(std::shared_ptr<Message>)> dest) const = 0;
 };
 
 }
@@ -144,5 +144,22 @@ void BulletinCSVWriter::output_bulletin(const wreport::Bulletin& bulletin)
     writer.write_bulletin(bulletin);
 }
 
+bool same_layout(const Subset& a, const Subset& b)
+{
+    if (a.size() != b.size()) return false;
+    for (unsigned pos = 0; pos < a.size(); ++pos)
+        if (a[pos].code() != b[pos].code())
+            return false;
+    return true;
+}
+
+bool same_layout(const wreport::Bulletin& bulletin)
+{
+    for (unsigned i = 1; i < bulletin.subsets.size(); ++i)
+        if (!same_layout(bulletin.subsets[0], bulletin.subsets[i]))
+            return false;
+    return true;
+}
+
 }
 }
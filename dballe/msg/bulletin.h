@@ -5,6 +5,7 @@
 
 namespace wreport {
 struct Bulletin;
+struct Subset;
 }
 
 namespace dballe {
@@ -31,6 +32,12 @@ public:
     void output_bulletin(const wreport::Bulletin& bulletin);
 };
 
+/// Check if two subsets have the same sequence of variables
+bool same_layout(const wreport::Subset& a, const wreport::Subset& b);
+
+/// Check if all the subsets of \a bulletin have the same sequence of variables
+bool same_layout(const wreport::Bulletin& bulletin);
+
 }
 }
 
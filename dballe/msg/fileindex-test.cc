@@ -0,0 +1,146 @@
+#include "tests.h"
+#include "fileindex.h"
+#include "dballe/file.h"
+#include "dballe/importer.h"
+#include "dballe/core/query.h"
+#include <wreport/utils/sys.h>
+#include <ctime>
+
+using namespace std;
+using namespace wreport;
+using namespace dballe;
+using namespace dballe::tests;
+
+namespace {
+
+/// Copy of a test data file, with its sidecar index removed on destruction
+struct TestFile
+{
+    std::string pathname;
+
+    TestFile(const std::string& name)
+        : pathname("test-fileindex-" + name)
+    {
+        sys::write_file(pathname, sys::read_file(tests::datafile("bufr/" + name)));
+        sys::unlink_ifexists(impl::FileIndex::sidecar_pathname(pathname));
+    }
+    ~TestFile()
+    {
+        sys::unlink_ifexists(pathname);
+        sys::unlink_ifexists(impl::FileIndex::sidecar_pathname(pathname));
+    }
+};
+
+/// Return the indices of the messages of pathname that match query
+std::vector<int> matching(const std::string& pathname, const core::Query& query)
+{
+    std::vector<int> res;
+    auto file = File::create(Encoding::BUFR, pathname, "r");
+    impl::FileIndex::foreach_match(*file, query, [&](const BinaryMessage& msg) {
+        res.push_back(msg.index);
+        return true;
+    });
+    return res;
+}
+
+class Tests : public TestCase
+{
+    using TestCase::TestCase;
+
+    void register_tests() override;
+} test("msg_fileindex");
+
+void Tests::register_tests()
+{
+
+add_method("sidecar", []() {
+    TestFile tf("synop3new.bufr");
+    wassert_true(impl::FileIndex::load_sidecar(tf.pathname).get() == nullptr);
+
+    auto index = impl::FileIndex::create_sidecar(tf.pathname, Encoding::BUFR, ImporterOptions::defaults);
+    wassert(actual(index->entries.size()) > 1u);
+
+    auto loaded = impl::FileIndex::load_sidecar(tf.pathname);
+    wassert_true(loaded.get() != nullptr);
+    wassert(actual(loaded->entries.size()) == index->entries.size());
+    for (unsigned i = 0; i < index->entries.size(); ++i)
+    {
+        const auto& a = index->entries[i];
+        const auto& b = loaded->entries[i];
+        wassert(actual(b.offset) == a.offset);
+        wassert(actual(b.size) == a.size);
+        wassert(actual(b.index) == (int)i);
+        wassert(actual(b.decoded) == a.decoded);
+        wassert(actual(b.category) == a.category);
+        wassert(actual(b.subcategory) == a.subcategory);
+        wassert(actual(b.datetime) == a.datetime);
+        wassert(actual(b.lat_min) == a.lat_min);
+        wassert(actual(b.lon_max) == a.lon_max);
+        wassert(actual(b.block) == a.block);
+        wassert(actual(b.station) == a.station);
+        wassert(actual(b.ident) == a.ident);
+        wassert(actual(b.report) == a.report);
+    }
+
+    // A modified file makes the index out of date
+    sys::touch(tf.pathname, time(nullptr) + 10);
+    wassert_true(impl::FileIndex::load_sidecar(tf.pathname).get() == nullptr);
+});
+
+add_method("match", []() {
+    TestFile tf("synop3new.bufr");
+
+    // Read the station of the first message
+    impl::FileIndex probe;
+    {
+        auto file = File::create(Encoding::BUFR, tf.pathname, "r");
+        auto importer = Importer::create(Encoding::BUFR);
+        probe.add(file->read(), *importer);
+    }
+    const impl::FileIndexEntry& first = probe.entries[0];
+    wassert(actual(first.decoded).istrue());
+    wassert(actual(first.block) != MISSING_INT);
+
+    core::Query all;
+    core::Query by_station;
+    by_station.block = first.block;
+    by_station.station = first.station;
+    core::Query nothing;
+    nothing.dtrange = DatetimeRange(Datetime(1800, 1, 1), Datetime(1800, 12, 31, 23, 59, 59));
+
+    // Without an index, all messages are decoded and matched
+    std::vector<int> expected_all = matching(tf.pathname, all);
+    std::vector<int> expected_station = matching(tf.pathname, by_station);
+    wassert(actual(expected_all.size()) > 1u);
+    wassert(actual(expected_station.size()) > 0u);
+    wassert(actual(expected_station[0]) == 0);
+    wassert(actual(matching(tf.pathname, nothing).size()) == 0u);
+
+    // Using the index gives the same results
+    impl::FileIndex::create_sidecar(tf.pathname, Encoding::BUFR, ImporterOptions::defaults);
+    wassert_true(matching(tf.pathname, all) == expected_all);
+    wassert_true(matching(tf.pathname, by_station) == expected_station);
+    wassert(actual(matching(tf.pathname, nothing).size()) == 0u);
+});
+
+add_method("undecodable", []() {
+    // Messages that fail to decode are indexed as undecoded
+    impl::FileIndex index;
+    auto importer = Importer::create(Encoding::JSON);
+    BinaryMessage msg(Encoding::JSON);
+    msg.data = "{\"version\": ";
+    wassert(index.add(msg, *importer));
+    wassert(actual(index.entries.size()) == 1u);
+    wassert_false(index.entries[0].decoded);
+
+    importer = Importer::create(Encoding::BUFR);
+    BinaryMessage bufr(Encoding::BUFR);
+    bufr.data = "BUFR garbage 7777";
+    wassert(index.add(bufr, *importer));
+    wassert(actual(index.entries.size()) == 2u);
+    wassert_false(index.entries[1].decoded);
+});
+
+}
+
+}
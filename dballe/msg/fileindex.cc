@@ -0,0 +1,428 @@
+#include "fileindex.h"
+#include "msg.h"
+#include "dballe/file.h"
+#include "dballe/importer.h"
+#include "dballe/core/mmap.h"
+#include "dballe/core/shortcuts.h"
+#include <wreport/bulletin.h>
+#include <wreport/error.h>
+#include <wreport/utils/sys.h>
+#include <cstring>
+#include <limits>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace impl {
+
+namespace {
+
+/// Signature at the start of file index files, including the format version
+const char binary_magic[8] = { 'D', 'B', 'A', 'I', 'D', 'X', 0, 1 };
+
+/// Marker used to reject files written with a different byte order
+const uint32_t binary_byte_order = 0x01020304;
+
+/// Value used for missing strings and datetimes
+const uint32_t binary_missing_string = std::numeric_limits<uint32_t>::max();
+const int64_t binary_missing_datetime = std::numeric_limits<int64_t>::min();
+
+/**
+ * Header of a file index.
+ *
+ * It is followed by the table of entries, and by the string table with the
+ * NUL-terminated idents and reports.
+ *
+ * All records have a fixed size and are stored in native byte order, so that
+ * a mapped file can be used without decoding.
+ */
+struct BinaryHeader
+{
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t entry_count;
+    uint32_t strings_size;
+    uint32_t padding;
+    int64_t file_size;
+    int64_t file_mtime;
+};
+
+struct BinaryEntry
+{
+    int64_t offset;
+    uint32_t size;
+    int32_t index;
+    uint8_t encoding;
+    uint8_t type;
+    uint8_t decoded;
+    uint8_t padding;
+    int16_t category;
+    int16_t subcategory;
+    int64_t dtmin;
+    int64_t dtmax;
+    int32_t lat_min;
+    int32_t lat_max;
+    int32_t lon_min;
+    int32_t lon_max;
+    int32_t block;
+    int32_t station;
+    /// Offset of the ident in the string table, or binary_missing_string
+    uint32_t ident;
+    /// Offset of the report in the string table, or binary_missing_string
+    uint32_t report;
+};
+
+static_assert(sizeof(BinaryHeader) % 8 == 0, "file index header is not 8-byte aligned");
+static_assert(sizeof(BinaryEntry) % 8 == 0, "file index entry record is not 8-byte aligned");
+
+int64_t encode_datetime(const Datetime& dt)
+{
+    if (dt.is_missing())
+        return binary_missing_datetime;
+    return (int64_t)dt.to_julian() * 100000 + dt.hour * 3600 + dt.minute * 60 + dt.second;
+}
+
+Datetime decode_datetime(int64_t val)
+{
+    if (val == binary_missing_datetime)
+        return Datetime();
+    int sod = val % 100000;
+    return Datetime::from_julian(val / 100000, sod / 3600, (sod / 60) % 60, sod % 60);
+}
+
+/// Read an integer variable from the station data of msg, or MISSING_INT
+int station_int(const impl::Message& msg, wreport::Varcode code)
+{
+    const Var* var = msg.station_data.maybe_var(code);
+    if (!var || !var->isset()) return MISSING_INT;
+    return var->enqi();
+}
+
+/// Merge val into a value that is kept only if it is the same for all messages
+template<typename T>
+void merge_common(bool first, T& dest, const T& val, const T& missing)
+{
+    if (first)
+        dest = val;
+    else if (dest != val)
+        dest = missing;
+}
+
+}
+
+void FileIndexEntry::set_messages(const std::vector<std::shared_ptr<dballe::Message>>& msgs)
+{
+    bool first = true;
+    for (const auto& m: msgs)
+    {
+        const impl::Message& msg = impl::Message::downcast(*m);
+        if (first)
+            type = msg.type;
+
+        Datetime dt = msg.get_datetime();
+        if (!dt.is_missing())
+        {
+            if (datetime.min.is_missing() || dt < datetime.min)
+                datetime.min = dt;
+            if (datetime.max.is_missing() || dt > datetime.max)
+                datetime.max = dt;
+        }
+
+        Coords coords = msg.get_coords();
+        if (!coords.is_missing())
+        {
+            if (lat_min == MISSING_INT)
+            {
+                lat_min = lat_max = coords.lat;
+                lon_min = lon_max = coords.lon;
+            } else {
+                lat_min = min(lat_min, coords.lat);
+                lat_max = max(lat_max, coords.lat);
+                lon_min = min(lon_min, coords.lon);
+                lon_max = max(lon_max, coords.lon);
+            }
+        }
+
+        merge_common(first, block, station_int(msg, WR_VAR(0, 1, 1)), MISSING_INT);
+        merge_common(first, station, station_int(msg, WR_VAR(0, 1, 2)), MISSING_INT);
+        merge_common(first, ident, msg.get_ident(), Ident());
+        const Var* rep_memo = msg.station_data.maybe_var(sc::rep_memo.code);
+        merge_common(first, report, rep_memo && rep_memo->isset() ? std::string(rep_memo->enqc()) : std::string(), std::string());
+
+        first = false;
+    }
+}
+
+
+matcher::Result MatchedFileIndexEntry::match_var_id(int) const
+{
+    return matcher::MATCH_YES;
+}
+
+matcher::Result MatchedFileIndexEntry::match_station_id(int) const
+{
+    return matcher::MATCH_YES;
+}
+
+matcher::Result MatchedFileIndexEntry::match_station_wmo(int block, int station) const
+{
+    if (e.block != MISSING_INT && e.block != block) return matcher::MATCH_NO;
+    if (station != -1 && e.station != MISSING_INT && e.station != station) return matcher::MATCH_NO;
+    return matcher::MATCH_YES;
+}
+
+matcher::Result MatchedFileIndexEntry::match_datetime(const DatetimeRange& range) const
+{
+    if (e.datetime.min.is_missing()) return matcher::MATCH_YES;
+    return range.is_disjoint(e.datetime) ? matcher::MATCH_NO : matcher::MATCH_YES;
+}
+
+matcher::Result MatchedFileIndexEntry::match_coords(const LatRange& latrange, const LonRange& lonrange) const
+{
+    if (e.lat_min == MISSING_INT) return matcher::MATCH_YES;
+
+    if (e.lat_max < latrange.imin || e.lat_min > latrange.imax)
+        return matcher::MATCH_NO;
+
+    if (lonrange.is_missing())
+        return matcher::MATCH_YES;
+    if (lonrange.imin <= lonrange.imax)
+    {
+        if (e.lon_max < lonrange.imin || e.lon_min > lonrange.imax)
+            return matcher::MATCH_NO;
+    } else {
+        // The range wraps around the antimeridian
+        if (e.lon_max < lonrange.imin && e.lon_min > lonrange.imax)
+            return matcher::MATCH_NO;
+    }
+    return matcher::MATCH_YES;
+}
+
+matcher::Result MatchedFileIndexEntry::match_rep_memo(const char* memo) const
+{
+    if (e.report.empty()) return matcher::MATCH_YES;
+    return e.report == memo ? matcher::MATCH_YES : matcher::MATCH_NO;
+}
+
+
+void FileIndex::add(const BinaryMessage& msg, const Importer& importer)
+{
+    FileIndexEntry entry;
+    entry.offset = msg.offset;
+    entry.size = msg.data.size();
+    entry.index = msg.index;
+    entry.encoding = msg.encoding;
+
+    try {
+        std::unique_ptr<Bulletin> bulletin;
+        switch (msg.encoding)
+        {
+            case Encoding::BUFR:
+                bulletin = BufrBulletin::decode(msg.data, msg.pathname.c_str(), msg.offset);
+                break;
+            case Encoding::CREX:
+                bulletin = CrexBulletin::decode(msg.data, msg.pathname.c_str(), msg.offset);
+                break;
+            case Encoding::JSON:
+                break;
+        }
+
+        if (bulletin)
+        {
+            entry.category = bulletin->data_category;
+            entry.subcategory = bulletin->data_subcategory;
+            entry.set_messages(importer.from_bulletin(*bulletin));
+        } else
+            entry.set_messages(importer.from_binary(msg));
+        entry.decoded = true;
+    } catch (std::exception&) {
+        // Undecodable messages are indexed with what is known about them, and
+        // will be candidates for any match
+    }
+
+    entries.emplace_back(std::move(entry));
+}
+
+void FileIndex::write(const std::string& pathname) const
+{
+    std::string strings;
+    auto add_string = [&](const std::string& val) {
+        uint32_t res = strings.size();
+        strings += val;
+        strings += '\0';
+        return res;
+    };
+
+    std::vector<BinaryEntry> binary_entries;
+    binary_entries.reserve(entries.size());
+    for (const auto& e: entries)
+    {
+        BinaryEntry be;
+        memset(&be, 0, sizeof(be));
+        be.offset = e.offset;
+        be.size = e.size;
+        be.index = e.index;
+        be.encoding = static_cast<uint8_t>(e.encoding);
+        be.type = static_cast<uint8_t>(e.type);
+        be.decoded = e.decoded;
+        be.category = e.category;
+        be.subcategory = e.subcategory;
+        be.dtmin = encode_datetime(e.datetime.min);
+        be.dtmax = encode_datetime(e.datetime.max);
+        be.lat_min = e.lat_min;
+        be.lat_max = e.lat_max;
+        be.lon_min = e.lon_min;
+        be.lon_max = e.lon_max;
+        be.block = e.block;
+        be.station = e.station;
+        be.ident = e.ident.is_missing() ? binary_missing_string : add_string(e.ident.get());
+        be.report = e.report.empty() ? binary_missing_string : add_string(e.report);
+        binary_entries.push_back(be);
+    }
+
+    BinaryHeader header;
+    memcpy(header.magic, binary_magic, sizeof(binary_magic));
+    header.byte_order = binary_byte_order;
+    header.entry_count = binary_entries.size();
+    header.strings_size = strings.size();
+    header.padding = 0;
+    header.file_size = file_size;
+    header.file_mtime = file_mtime;
+
+    std::string buf;
+    buf.append((const char*)&header, sizeof(header));
+    buf.append((const char*)binary_entries.data(), binary_entries.size() * sizeof(BinaryEntry));
+    buf += strings;
+    sys::write_file_atomically(pathname, buf);
+}
+
+void FileIndex::read(const std::string& pathname)
+{
+    core::MappedFile file(pathname, "file index");
+    if (file.size() < sizeof(BinaryHeader) || memcmp(file.begin(), binary_magic, sizeof(binary_magic)) != 0)
+        error_consistency::throwf("%s is not a DB-All.e file index, or was created with an unsupported version", pathname.c_str());
+    const BinaryHeader& header = *reinterpret_cast<const BinaryHeader*>(file.begin());
+    if (header.byte_order != binary_byte_order)
+        error_consistency::throwf("%s was written on a machine with a different byte order", pathname.c_str());
+    if (file.size() != sizeof(BinaryHeader) + (size_t)header.entry_count * sizeof(BinaryEntry) + header.strings_size)
+        error_consistency::throwf("%s: file index is truncated or corrupted", pathname.c_str());
+
+    const BinaryEntry* binary_entries = reinterpret_cast<const BinaryEntry*>(file.begin() + sizeof(BinaryHeader));
+    const char* strings = reinterpret_cast<const char*>(binary_entries + header.entry_count);
+    if (header.strings_size && strings[header.strings_size - 1])
+        error_consistency::throwf("%s: file index is truncated or corrupted", pathname.c_str());
+
+    file_size = header.file_size;
+    file_mtime = header.file_mtime;
+    entries.clear();
+    entries.reserve(header.entry_count);
+    for (uint32_t i = 0; i < header.entry_count; ++i)
+    {
+        const BinaryEntry& be = binary_entries[i];
+        if ((be.ident != binary_missing_string && be.ident >= header.strings_size)
+                || (be.report != binary_missing_string && be.report >= header.strings_size))
+            error_consistency::throwf("%s: file index is truncated or corrupted", pathname.c_str());
+        FileIndexEntry e;
+        e.offset = be.offset;
+        e.size = be.size;
+        e.index = be.index;
+        e.encoding = static_cast<Encoding>(be.encoding);
+        e.type = static_cast<MessageType>(be.type);
+        e.decoded = be.decoded;
+        e.category = be.category;
+        e.subcategory = be.subcategory;
+        e.datetime.min = decode_datetime(be.dtmin);
+        e.datetime.max = decode_datetime(be.dtmax);
+        e.lat_min = be.lat_min;
+        e.lat_max = be.lat_max;
+        e.lon_min = be.lon_min;
+        e.lon_max = be.lon_max;
+        e.block = be.block;
+        e.station = be.station;
+        if (be.ident != binary_missing_string)
+            e.ident = strings + be.ident;
+        if (be.report != binary_missing_string)
+            e.report = strings + be.report;
+        entries.emplace_back(std::move(e));
+    }
+}
+
+bool FileIndex::foreach(dballe::File& file, std::function<bool(const FileIndexEntry&)> filter, std::function<bool(const BinaryMessage&)> dest) const
+{
+    for (const auto& e: entries)
+    {
+        if (!filter(e)) continue;
+        file.seek(e.offset, e.index);
+        BinaryMessage msg = file.read();
+        if (!msg || msg.offset != e.offset || msg.data.size() != e.size)
+            error_consistency::throwf("%s: message #%d is not at offset %jd as recorded in its index", file.pathname().c_str(), e.index, (intmax_t)e.offset);
+        if (!dest(msg))
+            return false;
+    }
+    return true;
+}
+
+std::string FileIndex::sidecar_pathname(const std::string& pathname)
+{
+    return pathname + ".dbaidx";
+}
+
+std::unique_ptr<FileIndex> FileIndex::create_sidecar(const std::string& pathname, Encoding encoding, const dballe::ImporterOptions& opts)
+{
+    std::unique_ptr<FileIndex> res(new FileIndex);
+    auto st = sys::stat(pathname);
+    if (!st)
+        error_system::throwf("cannot stat %s", pathname.c_str());
+    res->file_size = st->st_size;
+    res->file_mtime = st->st_mtime;
+
+    auto file = File::create(encoding, pathname, "r");
+    auto importer = Importer::create(encoding, opts);
+    file->foreach([&](const BinaryMessage& msg) {
+        res->add(msg, *importer);
+        return true;
+    });
+
+    res->write(sidecar_pathname(pathname));
+    return res;
+}
+
+bool FileIndex::foreach_match(dballe::File& file, const dballe::Query& query, std::function<bool(const BinaryMessage&)> dest)
+{
+    auto matcher = Matcher::create(query);
+    auto importer = Importer::create(file.encoding());
+    std::vector<std::shared_ptr<dballe::Message>> msgs;
+    auto match = [&](const BinaryMessage& msg) {
+        importer->from_binary(msg, msgs);
+        if (matcher->match(MatchedMessages(msgs)) != matcher::MATCH_YES)
+            return true;
+        return dest(msg);
+    };
+
+    auto index = load_sidecar(file.pathname());
+    if (index && (index->entries.empty() || index->entries[0].encoding == file.encoding()))
+        return index->foreach(file, [&](const FileIndexEntry& e) {
+            return matcher->match(MatchedFileIndexEntry(e)) != matcher::MATCH_NO;
+        }, match);
+
+    file.seek(0, 0);
+    return file.foreach(match);
+}
+
+std::unique_ptr<FileIndex> FileIndex::load_sidecar(const std::string& pathname)
+{
+    std::string index_pathname = sidecar_pathname(pathname);
+    auto st = sys::stat(pathname);
+    if (!st || !sys::exists(index_pathname))
+        return std::unique_ptr<FileIndex>();
+
+    std::unique_ptr<FileIndex> res(new FileIndex);
+    res->read(index_pathname);
+    if (res->file_size != st->st_size || res->file_mtime != st->st_mtime)
+        return std::unique_ptr<FileIndex>();
+    return res;
+}
+
+}
+}
@@ -0,0 +1,158 @@
+#ifndef DBALLE_MSG_FILEINDEX_H
+#define DBALLE_MSG_FILEINDEX_H
+
+/** @file
+ * Sidecar indices of files with encoded messages, used to find the messages
+ * that can match a filter without decoding all the file.
+ */
+
+#include <dballe/fwd.h>
+#include <dballe/types.h>
+#include <dballe/core/matcher.h>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace dballe {
+namespace impl {
+
+/**
+ * Summary of the contents of a message in an indexed file.
+ *
+ * Unknown values are left missing, and a missing value never excludes the
+ * message from a match.
+ */
+struct FileIndexEntry
+{
+    /// Position of the message in the file
+    off_t offset = 0;
+    /// Size of the encoded message
+    size_t size = 0;
+    /// Index of the message in the file
+    int index = 0;
+    /// Encoding of the message
+    Encoding encoding = Encoding::BUFR;
+    /// True if the message could be decoded when it was indexed
+    bool decoded = false;
+    /// Type of the first decoded message
+    MessageType type = MessageType::GENERIC;
+    /// BUFR or CREX data category, or -1 if unknown
+    int category = -1;
+    /// BUFR or CREX data subcategory, or -1 if unknown
+    int subcategory = -1;
+    /// Range of the datetimes of the decoded messages
+    DatetimeRange datetime;
+    /// Bounding box of the coordinates of the decoded messages
+    int lat_min = MISSING_INT;
+    int lat_max = MISSING_INT;
+    int lon_min = MISSING_INT;
+    int lon_max = MISSING_INT;
+    /// WMO block and station number, if the same for all decoded messages
+    int block = MISSING_INT;
+    int station = MISSING_INT;
+    /// Mobile station identifier, if the same for all decoded messages
+    Ident ident;
+    /// rep_memo, if the same for all decoded messages
+    std::string report;
+
+    /**
+     * Fill in the entry with the contents of the messages decoded from the
+     * indexed message
+     */
+    void set_messages(const std::vector<std::shared_ptr<dballe::Message>>& msgs);
+};
+
+/**
+ * Match adapter for FileIndexEntry.
+ *
+ * It gives MATCH_NO only if no message summarised by the entry can match, so
+ * that a matcher accepts all entries for messages that could match it.
+ */
+struct MatchedFileIndexEntry : public Matched
+{
+    const FileIndexEntry& e;
+
+    MatchedFileIndexEntry(const FileIndexEntry& e) : e(e) {}
+
+    matcher::Result match_var_id(int val) const override;
+    matcher::Result match_station_id(int val) const override;
+    matcher::Result match_station_wmo(int block, int station=-1) const override;
+    matcher::Result match_datetime(const DatetimeRange& range) const override;
+    matcher::Result match_coords(const LatRange& latrange, const LonRange& lonrange) const override;
+    matcher::Result match_rep_memo(const char* memo) const override;
+};
+
+/**
+ * Index of the messages in a file.
+ *
+ * The index is stored in a sidecar file next to the file it indexes (see
+ * sidecar_pathname()), and records the size and modification time of the
+ * indexed file, so that an index that is out of date is ignored.
+ */
+class FileIndex
+{
+public:
+    /// Size of the indexed file
+    off_t file_size = 0;
+    /// Modification time of the indexed file
+    time_t file_mtime = 0;
+    /// Entries of the index, in file order
+    std::vector<FileIndexEntry> entries;
+
+    /// Add an entry for a message, decoding it with \a importer
+    void add(const BinaryMessage& msg, const Importer& importer);
+
+    /// Write the index to \a pathname
+    void write(const std::string& pathname) const;
+
+    /// Read the index from \a pathname
+    void read(const std::string& pathname);
+
+    /**
+     * Read the messages of \a file whose entries are accepted by \a filter,
+     * seeking directly to them, and send them to \a dest.
+     *
+     * If @a dest returns false, reading will stop.
+     *
+     * @return
+     *   true if all candidate messages were read, false if reading was
+     *   stopped because @a dest returned false.
+     */
+    bool foreach(dballe::File& file, std::function<bool(const FileIndexEntry&)> filter, std::function<bool(const BinaryMessage&)> dest) const;
+
+    /// Pathname of the sidecar index of \a pathname
+    static std::string sidecar_pathname(const std::string& pathname);
+
+    /**
+     * Index all messages in the file \a pathname, and write the index to its
+     * sidecar file.
+     */
+    static std::unique_ptr<FileIndex> create_sidecar(const std::string& pathname, Encoding encoding, const dballe::ImporterOptions& opts);
+
+    /**
+     * Send to \a dest the messages of \a file that match \a query.
+     *
+     * All the file is searched, from the beginning. If the file has an up to
+     * date sidecar index, only the messages that can match are read and
+     * decoded.
+     *
+     * @return
+     *   true if all the file was searched, false if reading was stopped
+     *   because @a dest returned false.
+     */
+    static bool foreach_match(dballe::File& file, const dballe::Query& query, std::function<bool(const BinaryMessage&)> dest);
+
+    /**
+     * Load the sidecar index of \a pathname.
+     *
+     * Returns nullptr if there is no sidecar index, or if the file changed
+     * after it was indexed.
+     */
+    static std::unique_ptr<FileIndex> load_sidecar(const std::string& pathname);
+};
+
+}
+}
+
+#endif
@@ -62,9 +62,8 @@ struct JSONMsgReader : public core::JSONReader
 
     bool parse_msgs(const std::string& buf, std::function<bool(std::shared_ptr<impl::Message>)> cb)
     {
-        std::stringstream in(buf);
-        while (!in.eof())
-        {
+        core::json::Stream in(buf);
+        do {
             parse(in);
             if (not state.empty() && state.top() == MSG_END) {
                 state.pop();
@@ -72,7 +71,7 @@ struct JSONMsgReader : public core::JSONReader
                     return false;
             }
             msg.reset();
-        }
+        } while (!in.eof());
         if (not state.empty())
             throw JSONParseException("Incomplete JSON");
         return true;
@@ -450,7 +449,7 @@ JsonExporter::~JsonExporter() {}
 
 std::string JsonExporter::to_binary(const std::vector<std::shared_ptr<dballe::Message>>& msgs) const
 {
-    std::stringstream buf;
+    std::string buf;
     core::JSONWriter json(buf);
 
     for (const auto& mi: msgs) {
@@ -470,9 +469,14 @@ std::string JsonExporter::to_binary(const std::vector<std::shared_ptr<dballe::Me
         json.add("lat");
         json.add_int(msg->get_latitude_var()->enqi());
         json.add("date");
-        std::stringstream ss;
-        msg->get_datetime().to_stream_iso8601(ss, 'T', "Z");
-        json.add(ss.str().c_str());
+        Datetime dt = msg->get_datetime();
+        if (dt.is_missing())
+        {
+            std::stringstream ss;
+            dt.to_stream_iso8601(ss, 'T', "Z");
+            json.add(ss.str());
+        } else
+            json.add(dt.to_string('T', "Z"));
         json.add("data");
         json.start_list();
             json.start_mapping();
@@ -494,7 +498,7 @@ std::string JsonExporter::to_binary(const std::vector<std::shared_ptr<dballe::Me
         json.add_break();
     }
 
-    return buf.str();
+    return buf;
 }
 
 }
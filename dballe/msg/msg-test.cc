@@ -618,6 +618,45 @@ add_method("iterate_no_data", [] {
     wassert(actual(cur->next()).isfalse());
 });
 
+add_method("recycle", [] {
+    impl::Message msg;
+    msg.type = MessageType::SYNOP;
+    msg.set_block(16);
+    msg.set_st_name("Bologna");
+    msg.set_temp_2m(289.2, 80);
+    msg.set(Level(1), Trange::instant(), var(WR_VAR(0, 12, 101), 280.0));
+    wassert(actual(msg.pool.size()) == 0u);
+
+    // Copies do not share the pool
+    impl::Message copy(msg);
+
+    msg.recycle();
+    wassert(actual(msg.type) == MessageType::GENERIC);
+    wassert(actual(msg.station_data.size()) == 0u);
+    wassert(actual(msg.data.size()) == 0u);
+    wassert(actual(msg.pool.size()) == 4u);
+
+    // Filling the message again takes variables from the pool
+    msg.type = MessageType::SYNOP;
+    msg.set_block(16);
+    msg.set_st_name("Bologna");
+    msg.set(Level(1), Trange::instant(), var(WR_VAR(0, 12, 101), 280.0));
+    wassert(actual(msg.pool.size()) == 1u);
+    msg.set_temp_2m(289.2, 80);
+    wassert(actual(msg.pool.size()) == 0u);
+    notes::Collect c(cerr);
+    wassert(actual(msg.diff(copy)) == 0u);
+    wassert(actual(msg.get_temp_2m_var()->enqa(WR_VAR(0, 33, 7))->enqi()) == 80);
+
+    impl::Message copy1(msg);
+    msg.recycle();
+    copy1 = msg;
+    wassert(actual(copy1.pool.size()) == 0u);
+
+    msg.clear();
+    wassert(actual(msg.pool.size()) == 0u);
+});
+
 }
 
 }
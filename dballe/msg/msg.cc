@@ -22,6 +22,69 @@ namespace impl {
 
 namespace msg {
 
+std::unique_ptr<wreport::Var> VarPool::take(wreport::Varinfo info)
+{
+    if (m_free.empty())
+        return unique_ptr<Var>(new Var(info));
+    unique_ptr<Var> res(std::move(m_free.back()));
+    m_free.pop_back();
+    *res = Var(info);
+    return res;
+}
+
+std::unique_ptr<wreport::Var> VarPool::create(wreport::Varcode code)
+{
+    return take(varinfo(code));
+}
+
+std::unique_ptr<wreport::Var> VarPool::copy(const wreport::Var& var)
+{
+    unique_ptr<Var> res(take(var.info()));
+    *res = var;
+    return res;
+}
+
+std::unique_ptr<wreport::Var> VarPool::copy_without_unset_attrs(const wreport::Var& var, wreport::Varcode code)
+{
+    unique_ptr<Var> res(create(code));
+    res->setval(var); // Copy value performing conversions
+
+    for (const Var* a = var.next_attr(); a; a = a->next_attr())
+    {
+        // Skip undefined attributes
+        if (!a->isset()) continue;
+        auto acopy = create(map_code_to_dballe(a->code()));
+        acopy->setval(*a);
+        res->seta(move(acopy));
+    }
+
+    return res;
+}
+
+void VarPool::recycle(std::unique_ptr<wreport::Var>&& var)
+{
+    m_free.emplace_back(std::move(var));
+}
+
+void VarPool::recycle(Values& values)
+{
+    values.move_to([&](std::unique_ptr<wreport::Var> var) {
+        m_free.emplace_back(std::move(var));
+    });
+}
+
+void VarPool::recycle_storage(Values&& values)
+{
+    m_storage.emplace_back(std::move(values));
+}
+
+void VarPool::reuse_storage(Values& values)
+{
+    if (m_storage.empty()) return;
+    values = std::move(m_storage.back());
+    m_storage.pop_back();
+}
+
 Contexts::const_iterator Contexts::find(const Level& level, const Trange& trange) const
 {
     /* Binary search */
@@ -167,6 +230,23 @@ std::shared_ptr<Message> Message::create()
     return std::make_shared<Message>();
 }
 
+std::shared_ptr<Message> Message::create(std::vector<std::shared_ptr<dballe::Message>>& reuse)
+{
+    while (!reuse.empty())
+    {
+        std::shared_ptr<dballe::Message> candidate(std::move(reuse.back()));
+        reuse.pop_back();
+        if (candidate.use_count() != 1) continue;
+        if (auto res = std::dynamic_pointer_cast<Message>(candidate))
+        {
+            candidate.reset();
+            res->recycle();
+            return res;
+        }
+    }
+    return std::make_shared<Message>();
+}
+
 const Message& Message::downcast(const dballe::Message& o)
 {
     const Message* ptr = dynamic_cast<const Message*>(&o);
@@ -267,6 +347,19 @@ void Message::clear()
     type = MessageType::GENERIC;
     station_data.clear();
     data.clear();
+    pool.clear();
+}
+
+void Message::recycle()
+{
+    type = MessageType::GENERIC;
+    pool.recycle(station_data);
+    for (auto& ctx: data)
+    {
+        pool.recycle(ctx.values);
+        pool.recycle_storage(std::move(ctx.values));
+    }
+    data.clear();
 }
 
 const msg::Context* Message::find_context(const Level& lev, const Trange& tr) const
@@ -301,7 +394,10 @@ msg::Context& Message::obtain_context(const Level& lev, const Trange& tr)
     if (lev.is_missing() && tr.is_missing())
         throw std::runtime_error("find_contexts called for station level, but this is no longer supported");
 
+    size_t count = data.size();
     auto i = data.obtain(lev, tr);
+    if (data.size() != count)
+        pool.reuse_storage(i->values);
     return *i;
 }
 
@@ -804,14 +900,24 @@ void Message::set(const Shortcut& shortcut, const wreport::Var& var)
     if (shortcut.station_data)
     {
         if (shortcut.code == var.code())
-            station_data.set(var);
+            station_data.set(pool.copy(var));
         else
-            station_data.set(var_copy_without_unset_attrs(var, shortcut.code));
+            station_data.set(pool.copy_without_unset_attrs(var, shortcut.code));
     }
     else
         set(shortcut.level, shortcut.trange, shortcut.code, var);
 }
 
+void Message::set(const Level& lev, const Trange& tr, wreport::Varcode code, const wreport::Var& var)
+{
+    set_impl(lev, tr, pool.copy_without_unset_attrs(var, code));
+}
+
+void Message::set(const Level& lev, const Trange& tr, const wreport::Var& var)
+{
+    set_impl(lev, tr, pool.copy_without_unset_attrs(var, var.code()));
+}
+
 void Message::set_impl(const Level& lev, const Trange& tr, std::unique_ptr<Var> var)
 {
     if (lev.is_missing() && tr.is_missing())
@@ -825,9 +931,14 @@ void Message::set_impl(const Level& lev, const Trange& tr, std::unique_ptr<Var>
 
 void Message::seti(const Level& lev, const Trange& tr, Varcode code, int val, int conf)
 {
-    unique_ptr<Var> var(newvar(code, val));
+    unique_ptr<Var> var(pool.create(code));
+    var->seti(val);
     if (conf != -1)
-        var->seta(newvar(WR_VAR(0, 33, 7), conf));
+    {
+        unique_ptr<Var> attr(pool.create(WR_VAR(0, 33, 7)));
+        attr->seti(conf);
+        var->seta(std::move(attr));
+    }
     if (lev.is_missing() && tr.is_missing())
         station_data.set(std::move(var));
     else
@@ -836,9 +947,14 @@ void Message::seti(const Level& lev, const Trange& tr, Varcode code, int val, in
 
 void Message::setd(const Level& lev, const Trange& tr, Varcode code, double val, int conf)
 {
-    unique_ptr<Var> var(newvar(code, val));
+    unique_ptr<Var> var(pool.create(code));
+    var->setd(val);
     if (conf != -1)
-        var->seta(newvar(WR_VAR(0, 33, 7), conf));
+    {
+        unique_ptr<Var> attr(pool.create(WR_VAR(0, 33, 7)));
+        attr->seti(conf);
+        var->seta(std::move(attr));
+    }
     if (lev.is_missing() && tr.is_missing())
         station_data.set(std::move(var));
     else
@@ -847,9 +963,14 @@ void Message::setd(const Level& lev, const Trange& tr, Varcode code, double val,
 
 void Message::setc(const Level& lev, const Trange& tr, Varcode code, const char* val, int conf)
 {
-    unique_ptr<Var> var(newvar(code, val));
+    unique_ptr<Var> var(pool.create(code));
+    var->setc(val);
     if (conf != -1)
-        var->seta(newvar(WR_VAR(0, 33, 7), conf));
+    {
+        unique_ptr<Var> attr(pool.create(WR_VAR(0, 33, 7)));
+        attr->seti(conf);
+        var->seta(std::move(attr));
+    }
     if (lev.is_missing() && tr.is_missing())
         station_data.set(std::move(var));
     else
@@ -121,6 +121,64 @@ public:
     // iterator erase(const_iterator pos) { return m_contexts.erase(pos); }
 };
 
+
+/**
+ * Variables released by Message::recycle(), to be reused when setting values
+ * instead of allocating new ones.
+ *
+ * The pool also keeps the storage of the Values of recycled contexts, to be
+ * reused by the contexts created later.
+ *
+ * Copying a pool gives an empty pool.
+ */
+class VarPool
+{
+protected:
+    std::vector<std::unique_ptr<wreport::Var>> m_free;
+    std::vector<Values> m_storage;
+
+    /// Take a variable from the pool, or allocate a new one
+    std::unique_ptr<wreport::Var> take(wreport::Varinfo info);
+
+public:
+    VarPool() = default;
+    VarPool(const VarPool&) {}
+    VarPool(VarPool&&) = default;
+    VarPool& operator=(const VarPool&) { return *this; }
+    VarPool& operator=(VarPool&&) = default;
+
+    /// Number of variables available for reuse
+    size_t size() const { return m_free.size(); }
+    bool empty() const { return m_free.empty(); }
+    void clear() { m_free.clear(); m_storage.clear(); }
+
+    /// Return an unset variable with code \a code
+    std::unique_ptr<wreport::Var> create(wreport::Varcode code);
+
+    /// Return a copy of \a var, with all its attributes
+    std::unique_ptr<wreport::Var> copy(const wreport::Var& var);
+
+    /**
+     * Return a variable with code \a code, with the value of \a var and all
+     * its attributes except the unset ones.
+     *
+     * This works like var_copy_without_unset_attrs().
+     */
+    std::unique_ptr<wreport::Var> copy_without_unset_attrs(const wreport::Var& var, wreport::Varcode code);
+
+    /// Add a variable to the pool
+    void recycle(std::unique_ptr<wreport::Var>&& var);
+
+    /// Move all the variables of \a values to the pool, leaving it empty
+    void recycle(Values& values);
+
+    /// Keep the storage of the empty \a values, to be reused by reuse_storage()
+    void recycle_storage(Values&& values);
+
+    /// Give the empty \a values storage kept by recycle_storage(), if any
+    void reuse_storage(Values& values);
+};
+
 }
 
 
@@ -153,9 +211,20 @@ public:
     MessageType type = MessageType::GENERIC;
     Values station_data;
     msg::Contexts data;
+    /// Variables left by recycle(), reused when setting values
+    msg::VarPool pool;
 
     static std::shared_ptr<Message> create();
 
+    /**
+     * Return a message from \a reuse, recycled, if there is one that is not
+     * referenced anywhere else, or a new message otherwise.
+     *
+     * The message returned is removed from \a reuse, and so are the messages
+     * in \a reuse found to be still in use.
+     */
+    static std::shared_ptr<Message> create(std::vector<std::shared_ptr<dballe::Message>>& reuse);
+
     /**
      * Return a reference to \a o downcasted as an impl::Message.
      *
@@ -190,9 +259,25 @@ public:
     /// Reset the messages as if it was just created
     void clear();
 
+    /**
+     * Reset the message to be filled again, keeping its variables and the
+     * storage of its contexts in pool to be reused instead of allocating new
+     * ones.
+     *
+     * Recycling a message and decoding into it again saves most of the
+     * allocations of decoding into a new message.
+     */
+    void recycle();
+
     using dballe::Message::get;
     using dballe::Message::set;
 
+    /// Like dballe::Message::set, taking the new variable from pool
+    void set(const Level& lev, const Trange& tr, wreport::Varcode code, const wreport::Var& var);
+
+    /// Like dballe::Message::set, taking the new variable from pool
+    void set(const Level& lev, const Trange& tr, const wreport::Var& var);
+
     /**
      * Find a datum given its shortcut
      *
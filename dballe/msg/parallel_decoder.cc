@@ -0,0 +1,284 @@
+#include "parallel_decoder.h"
+#include "dballe/core/parallel.h"
+#include "dballe/var.h"
+#include <wreport/bulletin.h>
+#include <wreport/tables.h>
+#include <wreport/dtable.h>
+#include <wreport/opcodes.h>
+#include <cctype>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace impl {
+
+namespace {
+
+/// Check if the expansion of \a ops contains operators that alter B table entries
+bool has_altering_operators(const DTable& dtable, const Opcodes& ops)
+{
+    for (unsigned i = 0; i < ops.size(); ++i)
+        switch (WR_VAR_F(ops[i]))
+        {
+            case 2:
+                switch (WR_VAR_X(ops[i]))
+                {
+                    case 1: case 2: case 3: case 7: case 8:
+                        return true;
+                }
+                break;
+            case 3:
+                if (has_altering_operators(dtable, dtable.query(ops[i])))
+                    return true;
+                break;
+        }
+    return false;
+}
+
+}
+
+ParallelDecoder::ParallelDecoder(dballe::File& file, const dballe::ImporterOptions& opts, unsigned threads, bool ordered)
+    : file(file), ordered(ordered)
+{
+    if (threads == 0)
+        threads = core::default_concurrency();
+    max_in_flight = threads * 4;
+
+    // Load the dballe B table before any worker needs it
+    dballe::varinfo(WR_VAR(0, 1, 1));
+
+    for (unsigned i = 0; i < threads; ++i)
+        importers.emplace_back(Importer::create(file.encoding(), opts));
+
+    try {
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            const dballe::Importer& importer = *importers[i];
+            workers.emplace_back([this, &importer] { worker_main(importer); });
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+ParallelDecoder::~ParallelDecoder()
+{
+    stop();
+}
+
+void ParallelDecoder::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending.clear();
+    }
+    work_available.notify_all();
+    for (auto& w: workers)
+        w.join();
+    workers.clear();
+}
+
+void ParallelDecoder::acquire_tables(bool exclusive)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (exclusive)
+    {
+        tables_released.wait(lock, [&] { return !table_writer && table_readers == 0; });
+        table_writer = true;
+    } else {
+        tables_released.wait(lock, [&] { return !table_writer; });
+        ++table_readers;
+    }
+}
+
+void ParallelDecoder::release_tables(bool exclusive)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (exclusive)
+            table_writer = false;
+        else
+            --table_readers;
+    }
+    tables_released.notify_all();
+}
+
+void ParallelDecoder::decode(const dballe::Importer& importer, Item& item)
+{
+    std::string key = table_key(item.msg);
+
+    // Decode messages whose tables are already loaded concurrently with each
+    // other, and the others one at a time with no other decoding going on
+    bool exclusive;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        exclusive = loaded_tables.find(key) == loaded_tables.end();
+    }
+    acquire_tables(exclusive);
+
+    try {
+        // Messages with operators that alter B table entries also modify the
+        // tables while decoding
+        if (!exclusive && alters_tables(item.msg))
+        {
+            release_tables(false);
+            exclusive = true;
+            acquire_tables(true);
+        }
+        item.decoded = importer.from_binary(item.msg);
+    } catch (...) {
+        item.error = std::current_exception();
+    }
+
+    if (exclusive)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded_tables.insert(key);
+    }
+    release_tables(exclusive);
+}
+
+void ParallelDecoder::worker_main(const dballe::Importer& importer)
+{
+    while (true)
+    {
+        std::unique_ptr<Item> item;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(lock, [&] { return stopping || !pending.empty(); });
+            if (stopping) return;
+            item = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        decode(importer, *item);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t seq = item->seq;
+            done.emplace(seq, std::move(item));
+        }
+        results_available.notify_all();
+    }
+}
+
+void ParallelDecoder::fill()
+{
+    while (!eof && in_flight < max_in_flight)
+    {
+        std::unique_ptr<Item> item(new Item(next_read, BinaryMessage(file.encoding())));
+        try {
+            item->msg = file.read();
+        } catch (...) {
+            // Report read errors in sequence with the decoded messages, and
+            // stop reading
+            item->error = std::current_exception();
+            eof = true;
+            std::lock_guard<std::mutex> lock(mutex);
+            done.emplace(next_read++, std::move(item));
+            ++in_flight;
+            break;
+        }
+        if (!item->msg)
+        {
+            eof = true;
+            break;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.emplace_back(std::move(item));
+        }
+        ++next_read;
+        ++in_flight;
+        work_available.notify_one();
+    }
+}
+
+bool ParallelDecoder::next(BinaryMessage& msg, std::vector<std::shared_ptr<dballe::Message>>& decoded)
+{
+    fill();
+
+    std::unique_ptr<Item> item;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            if (!done.empty() && (!ordered || done.begin()->first == next_delivery))
+            {
+                item = std::move(done.begin()->second);
+                done.erase(done.begin());
+                break;
+            }
+            if (in_flight == 0)
+                return false;
+            results_available.wait(lock);
+        }
+    }
+
+    --in_flight;
+    if (ordered)
+        ++next_delivery;
+
+    msg = std::move(item->msg);
+    decoded = std::move(item->decoded);
+    if (item->error)
+        std::rethrow_exception(item->error);
+    return true;
+}
+
+bool ParallelDecoder::alters_tables(const BinaryMessage& msg)
+{
+    std::unique_ptr<Bulletin> header;
+    switch (msg.encoding)
+    {
+        case Encoding::BUFR: header = BufrBulletin::decode_header(msg.data); break;
+        case Encoding::CREX: header = CrexBulletin::decode_header(msg.data); break;
+        case Encoding::JSON: return false;
+    }
+    if (!header->tables.dtable)
+        return true;
+    return has_altering_operators(*header->tables.dtable, Opcodes(header->datadesc));
+}
+
+std::string ParallelDecoder::table_key(const BinaryMessage& msg)
+{
+    const std::string& data = msg.data;
+    switch (msg.encoding)
+    {
+        case Encoding::BUFR:
+            // Edition number in section 0, and section 1 from the master
+            // table number to the local table version
+            if (data.size() > 8)
+            {
+                unsigned edition = (unsigned char)data[7];
+                size_t len = edition < 4 ? 9 : 12;
+                if (data.size() >= 11 + len)
+                    return data.substr(7, 1) + data.substr(11, len);
+            }
+            break;
+        case Encoding::CREX:
+        {
+            // The table token at the start of section 1
+            size_t pos = data.find("CREX++");
+            if (pos == std::string::npos) break;
+            pos += 6;
+            while (pos < data.size() && isspace((unsigned char)data[pos]))
+                ++pos;
+            size_t end = pos;
+            while (end < data.size() && !isspace((unsigned char)data[end]))
+                ++end;
+            return data.substr(pos, end - pos);
+        }
+        case Encoding::JSON:
+            return std::string();
+    }
+    // Messages that cannot be parsed are only decoded exclusively
+    return data;
+}
+
+}
+}
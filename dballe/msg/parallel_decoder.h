@@ -0,0 +1,154 @@
+#ifndef DBALLE_MSG_PARALLEL_DECODER_H
+#define DBALLE_MSG_PARALLEL_DECODER_H
+
+/** @file
+ * Decoding of the messages of a file on multiple threads.
+ */
+
+#include <dballe/file.h>
+#include <dballe/importer.h>
+#include <condition_variable>
+#include <exception>
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dballe {
+namespace impl {
+
+/**
+ * Read messages from a File and decode them on a pool of worker threads.
+ *
+ * Messages are read by the thread that calls next(), which also receives the
+ * decoded results. Each worker thread decodes using its own Importer.
+ *
+ * wreport is not thread safe when it modifies the B and D tables: it loads
+ * and caches them the first time a bulletin needs them, and C operators that
+ * change data width, scale or reference value (201, 202, 203, 207, 208) add
+ * altered entries to the shared B tables. A message using tables that no
+ * previous message has used, or using those operators, is decoded while no
+ * other thread is decoding.
+ */
+class ParallelDecoder
+{
+protected:
+    /// Message read from the file, and the results of decoding it
+    struct Item
+    {
+        size_t seq;
+        BinaryMessage msg;
+        std::vector<std::shared_ptr<dballe::Message>> decoded;
+        std::exception_ptr error;
+
+        Item(size_t seq, BinaryMessage&& msg) : seq(seq), msg(std::move(msg)) {}
+    };
+
+    dballe::File& file;
+    bool ordered;
+    /// Maximum number of messages read and not yet returned by next()
+    size_t max_in_flight;
+
+    std::mutex mutex;
+    /// Notified when messages are queued for decoding, or on shutdown
+    std::condition_variable work_available;
+    /// Notified when messages have been decoded
+    std::condition_variable results_available;
+    /// Notified when a worker stops using the tables
+    std::condition_variable tables_released;
+    std::deque<std::unique_ptr<Item>> pending;
+    std::map<size_t, std::unique_ptr<Item>> done;
+    /// Keys of the tables that have already been loaded (see table_key())
+    std::set<std::string> loaded_tables;
+    /// Number of workers decoding with already loaded tables
+    unsigned table_readers = 0;
+    /// True when a worker is decoding a message that may load new tables
+    bool table_writer = false;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+    /// Importer used by each worker thread
+    std::vector<std::unique_ptr<dballe::Importer>> importers;
+
+    /// Sequence number of the next message read from the file
+    size_t next_read = 0;
+    /// Sequence number of the next message to return in ordered mode
+    size_t next_delivery = 0;
+    /// Number of messages read and not yet returned by next()
+    size_t in_flight = 0;
+    bool eof = false;
+
+    /**
+     * Wait until the tables can be used, alone if \a exclusive is true, or
+     * together with other threads that do not modify them
+     */
+    void acquire_tables(bool exclusive);
+    /// Release the tables after acquire_tables()
+    void release_tables(bool exclusive);
+    /// Decode \a item with \a importer, storing results or error in it
+    void decode(const dballe::Importer& importer, Item& item);
+    void worker_main(const dballe::Importer& importer);
+    /// Read messages from the file until there are max_in_flight in flight
+    void fill();
+    void stop();
+
+public:
+    /**
+     * @param file
+     *   The file to read. It must not be used by others until the decoder is
+     *   destroyed.
+     * @param opts
+     *   Options for the importers used by the worker threads
+     * @param threads
+     *   Number of worker threads; 0 means core::default_concurrency()
+     * @param ordered
+     *   If true, next() returns messages in the order they have in the file;
+     *   otherwise, it returns them as soon as they are decoded.
+     */
+    ParallelDecoder(dballe::File& file, const dballe::ImporterOptions& opts, unsigned threads=0, bool ordered=true);
+    ParallelDecoder(const ParallelDecoder&) = delete;
+    ParallelDecoder& operator=(const ParallelDecoder&) = delete;
+    ~ParallelDecoder();
+
+    /// Number of worker threads
+    unsigned threads() const { return workers.size(); }
+
+    /**
+     * Get the next decoded message.
+     *
+     * If a message could not be decoded, the decoding error is thrown, and
+     * the following call to next() continues with the other messages.
+     *
+     * @return false when all the file has been read and decoded
+     */
+    bool next(BinaryMessage& msg, std::vector<std::shared_ptr<dballe::Message>>& decoded);
+
+    /**
+     * Identify the tables needed to decode a message.
+     *
+     * Messages with the same key use the same tables. This uses the table
+     * information in section 1 of BUFR messages, and the table token at the
+     * start of section 1 of CREX messages. JSON messages do not use BUFR
+     * tables and always give an empty key.
+     */
+    static std::string table_key(const BinaryMessage& msg);
+
+    /**
+     * Check if decoding a message adds altered entries to the B tables,
+     * because its data descriptors, or the sequences they expand to, contain
+     * C operators that change data width, scale or reference value.
+     *
+     * This decodes the message header, and the tables it uses must have
+     * already been loaded.
+     */
+    static bool alters_tables(const BinaryMessage& msg);
+};
+
+}
+}
+
+#endif
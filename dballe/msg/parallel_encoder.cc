@@ -0,0 +1,215 @@
+#include "parallel_encoder.h"
+#include "msg.h"
+#include "bulletin.h"
+#include "wr_codec.h"
+#include "dballe/core/parallel.h"
+#include "dballe/var.h"
+#include <wreport/bulletin.h>
+
+using namespace std;
+using namespace wreport;
+
+namespace dballe {
+namespace impl {
+
+ParallelEncoder::ParallelEncoder(Encoding encoding, const dballe::ExporterOptions& opts, Dest dest, unsigned threads)
+    : encoding(encoding), max_subsets(opts.max_subsets), dest(dest)
+{
+    if (threads == 0)
+        threads = core::default_concurrency();
+    max_in_flight = threads * 4;
+    // JSON has no bulletins to group messages in
+    if (max_subsets == 0 || encoding == Encoding::JSON)
+        max_subsets = 1;
+
+    // Load the dballe B table before any worker needs it
+    dballe::varinfo(WR_VAR(0, 1, 1));
+
+    for (unsigned i = 0; i < threads; ++i)
+        exporters.emplace_back(Exporter::create(encoding, opts));
+
+    try {
+        for (unsigned i = 0; i < threads; ++i)
+        {
+            const dballe::Exporter& exporter = *exporters[i];
+            workers.emplace_back([this, &exporter] { worker_main(exporter); });
+        }
+    } catch (...) {
+        stop();
+        throw;
+    }
+}
+
+ParallelEncoder::~ParallelEncoder()
+{
+    stop();
+}
+
+void ParallelEncoder::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending.clear();
+    }
+    work_available.notify_all();
+    for (auto& w: workers)
+        w.join();
+    workers.clear();
+}
+
+void ParallelEncoder::encode(const dballe::Exporter& exporter, Batch& batch)
+{
+    // Encode batches whose tables are already loaded concurrently with each
+    // other, and the others one at a time with no other encoding going on
+    bool writer;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        tables_released.wait(lock, [&] {
+            return !table_writer && (table_readers == 0 || loaded_tables.find(batch.key) != loaded_tables.end());
+        });
+        writer = loaded_tables.find(batch.key) == loaded_tables.end();
+        if (writer)
+            table_writer = true;
+        else
+            ++table_readers;
+    }
+
+    try {
+        if (batch.msgs.size() == 1)
+            batch.encoded.emplace_back(exporter.to_binary(batch.msgs));
+        else
+        {
+            auto bulletin = exporter.to_bulletin(batch.msgs);
+            const auto& subsets = bulletin->subsets;
+            unsigned begin = 0;
+            for (unsigned i = 1; i < subsets.size() && begin == 0; ++i)
+                if (!dballe::msg::same_layout(subsets[0], subsets[i]))
+                    begin = i;
+            if (begin == 0)
+                batch.encoded.emplace_back(bulletin->encode());
+            else
+            {
+                // Encode each run of messages with the same layout in its
+                // own bulletin
+                begin = 0;
+                for (unsigned i = 1; i <= subsets.size(); ++i)
+                {
+                    if (i < subsets.size() && dballe::msg::same_layout(subsets[begin], subsets[i]))
+                        continue;
+                    std::vector<std::shared_ptr<dballe::Message>> run(batch.msgs.begin() + begin, batch.msgs.begin() + i);
+                    batch.encoded.emplace_back(exporter.to_binary(run));
+                    begin = i;
+                }
+            }
+        }
+    } catch (...) {
+        batch.error = std::current_exception();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (writer)
+        {
+            table_writer = false;
+            loaded_tables.insert(batch.key);
+        } else
+            --table_readers;
+    }
+    tables_released.notify_all();
+}
+
+void ParallelEncoder::worker_main(const dballe::Exporter& exporter)
+{
+    while (true)
+    {
+        std::unique_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            work_available.wait(lock, [&] { return stopping || !pending.empty(); });
+            if (stopping) return;
+            batch = std::move(pending.front());
+            pending.pop_front();
+        }
+
+        encode(exporter, *batch);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            size_t seq = batch->seq;
+            done.emplace(seq, std::move(batch));
+        }
+        results_available.notify_all();
+    }
+}
+
+void ParallelEncoder::submit()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.emplace_back(std::move(current));
+    }
+    ++in_flight;
+    work_available.notify_one();
+}
+
+void ParallelEncoder::deliver(size_t wait_until)
+{
+    while (in_flight > 0)
+    {
+        std::unique_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (done.empty() || done.begin()->first != next_delivery)
+            {
+                if (in_flight <= wait_until)
+                    return;
+                results_available.wait(lock);
+            }
+            batch = std::move(done.begin()->second);
+            done.erase(done.begin());
+        }
+
+        --in_flight;
+        ++next_delivery;
+
+        if (batch->error)
+            std::rethrow_exception(batch->error);
+        for (const auto& data: batch->encoded)
+            dest(data);
+    }
+}
+
+void ParallelEncoder::add(std::shared_ptr<dballe::Message> msg)
+{
+    // Messages encoded with the same template can share a bulletin
+    std::string key;
+    if (const msg::WRExporter* exporter = dynamic_cast<const msg::WRExporter*>(exporters[0].get()))
+        key = exporter->infer_template(Messages{msg})->name();
+    else
+        key = format_message_type(Message::downcast(*msg).type);
+
+    if (current && current->key != key)
+        submit();
+
+    if (!current)
+    {
+        current.reset(new Batch(next_submit++));
+        current->key = key;
+    }
+    current->msgs.emplace_back(msg);
+    if (current->msgs.size() >= max_subsets)
+        submit();
+
+    deliver(max_in_flight);
+}
+
+void ParallelEncoder::flush()
+{
+    if (current)
+        submit();
+    deliver(0);
+}
+
+}
+}
@@ -0,0 +1,144 @@
+#ifndef DBALLE_MSG_PARALLEL_ENCODER_H
+#define DBALLE_MSG_PARALLEL_ENCODER_H
+
+/** @file
+ * Encoding of sequences of messages on multiple threads.
+ */
+
+#include <dballe/exporter.h>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <map>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace dballe {
+namespace impl {
+
+/**
+ * Encode a sequence of messages on a pool of worker threads, passing the
+ * encoded data to a function in the same order as the messages.
+ *
+ * When ExporterOptions::max_subsets is more than 1, consecutive messages
+ * encoded with the same template are encoded as subsets of the same BUFR or
+ * CREX bulletin. A group of messages whose subsets would not all have the
+ * same variables is split into runs of consecutive messages that do, since
+ * the template exporters like generic take the data descriptors from the
+ * message contents.
+ *
+ * As in ParallelDecoder, a group of messages for a template that has not
+ * been used yet may load new wreport tables, and it is encoded while no other
+ * thread is encoding.
+ */
+class ParallelEncoder
+{
+public:
+    /// Function receiving encoded data
+    typedef std::function<void(const std::string&)> Dest;
+
+protected:
+    /// Messages to encode together, and the results of encoding them
+    struct Batch
+    {
+        size_t seq;
+        std::string key;
+        std::vector<std::shared_ptr<dballe::Message>> msgs;
+        std::vector<std::string> encoded;
+        std::exception_ptr error;
+
+        explicit Batch(size_t seq) : seq(seq) {}
+    };
+
+    Encoding encoding;
+    unsigned max_subsets;
+    Dest dest;
+    /// Maximum number of batches submitted and not yet passed to dest
+    size_t max_in_flight;
+
+    std::mutex mutex;
+    /// Notified when batches are queued for encoding, or on shutdown
+    std::condition_variable work_available;
+    /// Notified when batches have been encoded
+    std::condition_variable results_available;
+    /// Notified when a worker stops using the tables
+    std::condition_variable tables_released;
+    std::deque<std::unique_ptr<Batch>> pending;
+    std::map<size_t, std::unique_ptr<Batch>> done;
+    /// Keys of the batches that have already been encoded once
+    std::set<std::string> loaded_tables;
+    /// Number of workers encoding with already loaded tables
+    unsigned table_readers = 0;
+    /// True when a worker is encoding a batch that may load new tables
+    bool table_writer = false;
+    bool stopping = false;
+
+    std::vector<std::thread> workers;
+    /// Exporter used by each worker thread
+    std::vector<std::unique_ptr<dballe::Exporter>> exporters;
+
+    /// Batch being filled by add()
+    std::unique_ptr<Batch> current;
+    /// Sequence number of the next batch to submit
+    size_t next_submit = 0;
+    /// Sequence number of the next batch to pass to dest
+    size_t next_delivery = 0;
+    /// Number of batches submitted and not yet passed to dest
+    size_t in_flight = 0;
+
+    /// Encode \a batch with \a exporter, storing results or error in it
+    void encode(const dballe::Exporter& exporter, Batch& batch);
+    void worker_main(const dballe::Exporter& exporter);
+    /// Queue the current batch for encoding
+    void submit();
+    /**
+     * Pass encoded batches to dest, in order.
+     *
+     * @param wait_until
+     *   Wait for results until no more than this number of batches are in
+     *   flight
+     */
+    void deliver(size_t wait_until);
+    void stop();
+
+public:
+    /**
+     * @param encoding
+     *   Encoding of the output
+     * @param opts
+     *   Options for the exporters used by the worker threads
+     * @param dest
+     *   Function called, in the thread that calls add() and flush(), with
+     *   the encoded data of each bulletin
+     * @param threads
+     *   Number of worker threads; 0 means core::default_concurrency()
+     */
+    ParallelEncoder(Encoding encoding, const dballe::ExporterOptions& opts, Dest dest, unsigned threads=0);
+    ParallelEncoder(const ParallelEncoder&) = delete;
+    ParallelEncoder& operator=(const ParallelEncoder&) = delete;
+    ~ParallelEncoder();
+
+    /// Number of worker threads
+    unsigned threads() const { return workers.size(); }
+
+    /**
+     * Add a message to encode.
+     *
+     * This can call dest with the results of previous messages. If encoding
+     * failed, the error is thrown when its turn comes to be passed to dest.
+     */
+    void add(std::shared_ptr<dballe::Message> msg);
+
+    /// Encode all the messages added so far, and pass the results to dest
+    void flush();
+};
+
+}
+}
+
+#endif
@@ -1,4 +1,5 @@
 #include "wr_codec.h"
+#include "bulletin.h"
 #include "domain_errors.h"
 #include "dballe/file.h"
 #include "msg.h"
@@ -29,6 +30,12 @@ bool BufrImporter::foreach_decoded(const BinaryMessage& msg, std::function<bool(
     return foreach_decoded_bulletin(*bulletin, dest);
 }
 
+bool BufrImporter::foreach_decoded_reusing(const BinaryMessage& msg, std::vector<std::shared_ptr<dballe::Message>>& reuse, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const
+{
+    unique_ptr<BufrBulletin> bulletin(BufrBulletin::decode(msg.data));
+    return foreach_decoded_bulletin(*bulletin, reuse, dest);
+}
+
 CrexImporter::CrexImporter(const dballe::ImporterOptions& opts)
     : WRImporter(opts) {}
 CrexImporter::~CrexImporter() {}
@@ -39,6 +46,12 @@ bool CrexImporter::foreach_decoded(const BinaryMessage& msg, std::function<bool(
     return foreach_decoded_bulletin(*bulletin, dest);
 }
 
+bool CrexImporter::foreach_decoded_reusing(const BinaryMessage& msg, std::vector<std::shared_ptr<dballe::Message>>& reuse, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const
+{
+    unique_ptr<CrexBulletin> bulletin(CrexBulletin::decode(msg.data));
+    return foreach_decoded_bulletin(*bulletin, reuse, dest);
+}
+
 Messages WRImporter::from_bulletin(const wreport::Bulletin& msg) const
 {
     Messages res;
@@ -47,6 +60,16 @@ Messages WRImporter::from_bulletin(const wreport::Bulletin& msg) const
 }
 
 bool WRImporter::foreach_decoded_bulletin(const wreport::Bulletin& msg, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const
+{
+    return import_bulletin(msg, nullptr, dest);
+}
+
+bool WRImporter::foreach_decoded_bulletin(const wreport::Bulletin& msg, std::vector<std::shared_ptr<dballe::Message>>& reuse, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const
+{
+    return import_bulletin(msg, &reuse, dest);
+}
+
+bool WRImporter::import_bulletin(const wreport::Bulletin& msg, std::vector<std::shared_ptr<dballe::Message>>* reuse, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const
 {
     WreportVarOptionsForImport wreport_config(opts.domain_errors);
 
@@ -93,13 +116,43 @@ bool WRImporter::foreach_decoded_bulletin(const wreport::Bulletin& msg, std::fun
     }
 
     MessageType type = importer->scanType(msg);
+
+    // All the subsets of compressed bulletins have the same variables, and
+    // importers that support it can import them together
+    const BufrBulletin* bufr = dynamic_cast<const BufrBulletin*>(&msg);
+    if (bufr && bufr->compression && msg.subsets.size() > 1 && importer->supports_subset_import())
+    {
+        std::vector<std::shared_ptr<Message>> msgs;
+        std::vector<Message*> targets;
+        msgs.reserve(msg.subsets.size());
+        targets.reserve(msg.subsets.size());
+        for (unsigned i = 0; i < msg.subsets.size(); ++i)
+        {
+            msgs.emplace_back(reuse ? Message::create(*reuse) : Message::create());
+            msgs.back()->type = type;
+            targets.push_back(msgs.back().get());
+        }
+        importer->import_subsets(msg, targets);
+        for (auto& newmsg: msgs)
+        {
+            if (!dest(newmsg))
+                return false;
+            if (reuse && newmsg.use_count() == 1)
+                reuse->emplace_back(std::move(newmsg));
+        }
+        return true;
+    }
+
     for (unsigned i = 0; i < msg.subsets.size(); ++i)
     {
-        auto newmsg = std::make_shared<Message>();
+        auto newmsg = reuse ? Message::create(*reuse) : Message::create();
         newmsg->type = type;
         importer->import(msg.subsets[i], *newmsg);
         if (!dest(newmsg))
             return false;
+        // Reuse the message for the next subset if dest did not keep it
+        if (reuse && newmsg.use_count() == 1)
+            reuse->emplace_back(std::move(newmsg));
     }
     return true;
 }
@@ -169,6 +222,9 @@ unique_ptr<Bulletin> WRExporter::to_bulletin(const Messages& msgs) const
     // fprintf(stderr, "Encoding with template %s\n", encoder->name());
     auto res = make_bulletin();
     encoder->to_bulletin(*res);
+    if (opts.compress && res->subsets.size() > 1 && dballe::msg::same_layout(*res))
+        if (BufrBulletin* b = dynamic_cast<BufrBulletin*>(res.get()))
+            b->compression = true;
     return res;
 }
 
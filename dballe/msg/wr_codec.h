@@ -22,6 +22,10 @@ namespace msg {
 
 class WRImporter : public BulletinImporter
 {
+protected:
+    /// Import a bulletin, reusing messages from \a reuse if it is not nullptr
+    bool import_bulletin(const wreport::Bulletin& msg, std::vector<std::shared_ptr<dballe::Message>>* reuse, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const;
+
 public:
     WRImporter(const dballe::ImporterOptions& opts);
 
@@ -43,6 +47,10 @@ public:
      * @returns true if it got to the end of decoding, false if dest returned false.
      */
     bool foreach_decoded_bulletin(const wreport::Bulletin& msg, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const;
+
+    bool foreach_decoded_bulletin(const wreport::Bulletin& msg, std::vector<std::shared_ptr<dballe::Message>>& reuse, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const override;
+
+    using BulletinImporter::from_bulletin;
 };
 
 class BufrImporter : public WRImporter
@@ -54,6 +62,7 @@ public:
     Encoding encoding() const override { return Encoding::BUFR; }
 
     bool foreach_decoded(const BinaryMessage& msg, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const override;
+    bool foreach_decoded_reusing(const BinaryMessage& msg, std::vector<std::shared_ptr<dballe::Message>>& reuse, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const override;
 };
 
 class CrexImporter : public WRImporter
@@ -65,6 +74,7 @@ public:
     Encoding encoding() const override { return Encoding::CREX; }
 
     bool foreach_decoded(const BinaryMessage& msg, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const override;
+    bool foreach_decoded_reusing(const BinaryMessage& msg, std::vector<std::shared_ptr<dballe::Message>>& reuse, std::function<bool(std::shared_ptr<dballe::Message>)> dest) const override;
 };
 
 namespace wr {
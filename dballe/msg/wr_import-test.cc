@@ -2,6 +2,7 @@
 #include "wr_codec.h"
 #include "msg.h"
 #include "context.h"
+#include "wr_importers/base.h"
 #include <wreport/bulletin.h>
 #include <wreport/options.h>
 #include <cstring>
@@ -322,6 +323,106 @@ class Tests : public TestCase
             IS(ident, "FJCYR4RA");
         });
 
+        // Importing all the subsets of flight data at once gives the same
+        // results as importing them one at a time
+        add_method("flight_subsets", [] {
+            const char* fnames[] = { "gts-acars1.bufr", "gts-acars2.bufr", "gts-acars-uk1.bufr", "gts-acars-us1.bufr", "ecmwf-amdar1.bufr" };
+            for (const auto& fname: fnames)
+                for (bool simplified: { true, false })
+                {
+                    WREPORT_TEST_INFO(info);
+                    info() << fname << (simplified ? " simplified" : " accurate");
+                    BinaryMessage raw = read_rawmsg((std::string("bufr/") + fname).c_str(), Encoding::BUFR);
+                    auto bulletin = BufrBulletin::decode(raw.data);
+
+                    // Add a subset at a different level, and one with no level
+                    bulletin->subsets.push_back(bulletin->subsets[0]);
+                    bulletin->subsets.push_back(bulletin->subsets[0]);
+                    for (auto& var: bulletin->subsets[1])
+                        switch (var.code())
+                        {
+                            case WR_VAR(0, 7, 2):
+                            case WR_VAR(0, 7, 4):
+                            case WR_VAR(0, 7, 10):
+                                if (var.isset()) var.setd(var.enqd() / 2);
+                                break;
+                            case WR_VAR(0, 12, 101): var.unset(); break;
+                        }
+                    for (auto& var: bulletin->subsets[2])
+                        switch (var.code())
+                        {
+                            case WR_VAR(0, 7, 2):
+                            case WR_VAR(0, 7, 4):
+                            case WR_VAR(0, 7, 10): var.unset(); break;
+                        }
+
+                    impl::ImporterOptions opts;
+                    opts.simplified = simplified;
+                    auto importer = impl::msg::wr::Importer::createFlight(opts);
+                    impl::Messages expected;
+                    std::vector<impl::Message*> targets;
+                    for (const auto& subset: bulletin->subsets)
+                    {
+                        auto msg = make_shared<impl::Message>();
+                        importer->import(subset, *msg);
+                        expected.push_back(msg);
+                        targets.push_back(new impl::Message);
+                    }
+                    importer->import_subsets(*bulletin, targets);
+                    for (unsigned i = 0; i < targets.size(); ++i)
+                    {
+                        unique_ptr<impl::Message> res(targets[i]);
+                        wassert(actual(res->diff(*expected[i])) == 0u);
+                    }
+
+                    // The same happens importing compressed bulletins
+                    auto bimporter = Importer::create(Encoding::BUFR, opts);
+                    const auto& bulletin_importer = dynamic_cast<const BulletinImporter&>(*bimporter);
+                    bulletin->compression = false;
+                    impl::Messages uncompressed = bulletin_importer.from_bulletin(*bulletin);
+                    bulletin->compression = true;
+                    impl::Messages compressed = bulletin_importer.from_bulletin(*bulletin);
+                    wassert(actual(compressed.size()) == uncompressed.size());
+                    for (unsigned i = 0; i < compressed.size(); ++i)
+                        wassert(actual(compressed[i]->diff(*uncompressed[i])) == 0u);
+                }
+        });
+
+        // Compressed bulletins are imported one subset at a time, unless the
+        // importer can import all subsets together
+        add_method("compressed_subsets", [] {
+            const char* fnames[] = { "synop-rad1.bufr", "gts-acars1.bufr" };
+            for (const auto& fname: fnames)
+            {
+                WREPORT_TEST_INFO(info);
+                info() << fname;
+                BinaryMessage raw = read_rawmsg((std::string("bufr/") + fname).c_str(), Encoding::BUFR);
+                auto bulletin = BufrBulletin::decode(raw.data);
+                bulletin->subsets.push_back(bulletin->subsets[0]);
+                bulletin->subsets.push_back(bulletin->subsets[0]);
+                bulletin->compression = true;
+
+                auto importer = Importer::create(Encoding::BUFR);
+                const auto& bulletin_importer = dynamic_cast<const BulletinImporter&>(*importer);
+                std::vector<std::shared_ptr<dballe::Message>> reuse;
+
+                // Decoding stops as soon as dest returns false
+                unsigned count = 0;
+                wassert_false(bulletin_importer.foreach_decoded_bulletin(*bulletin, reuse, [&](std::shared_ptr<dballe::Message>) {
+                    ++count;
+                    return false;
+                }));
+                wassert(actual(count) == 1u);
+
+                count = 0;
+                wassert_true(bulletin_importer.foreach_decoded_bulletin(*bulletin, reuse, [&](std::shared_ptr<dballe::Message>) {
+                    ++count;
+                    return true;
+                }));
+                wassert(actual(count) == bulletin->subsets.size());
+            }
+        });
+
         // BUFR that has a variable that goes out of range when converted to local B
         // table
         add_method("outofrange", [] {
@@ -37,6 +37,12 @@ void Importer::import(const wreport::Subset& subset, Message& msg)
     run();
 }
 
+void Importer::import_subsets(const wreport::Bulletin& bulletin, const std::vector<impl::Message*>& msgs)
+{
+    for (unsigned i = 0; i < bulletin.subsets.size(); ++i)
+        import(bulletin.subsets[i], *msgs[i]);
+}
+
 void Importer::set(const wreport::Var& var, const Shortcut& shortcut)
 {
     msg->set(shortcut, var);
@@ -49,34 +55,41 @@ void Importer::set(const wreport::Var& var, wreport::Varcode code, const Level&
 
 std::unique_ptr<Importer> Importer::createSat(const dballe::ImporterOptions&) { throw error_unimplemented("WB sat Importers"); }
 
-void WMOImporter::import_var(const Var& var)
+const Shortcut* WMOImporter::station_shortcut(Varcode code)
 {
-    switch (var.code())
+    switch (code)
     {
         // General bulletin metadata
-        case WR_VAR(0,  1,  1): set(var, sc::block); break;
-        case WR_VAR(0,  1,  2): set(var, sc::station); break;
+        case WR_VAR(0,  1,  1): return &sc::block;
+        case WR_VAR(0,  1,  2): return &sc::station;
         case WR_VAR(0,  1,  5):
         case WR_VAR(0,  1,  6):
-        case WR_VAR(0,  1, 11): set(var, sc::ident); break;
-        case WR_VAR(0,  1, 12): set(var, sc::st_dir); break;
-        case WR_VAR(0,  1, 13): set(var, sc::st_speed); break;
-        case WR_VAR(0,  1, 63): set(var, sc::st_name_icao); break;
-        case WR_VAR(0,  2,  1): set(var, sc::st_type); break;
-        case WR_VAR(0,  1, 15): set(var, sc::st_name); break;
-        case WR_VAR(0,  4,  1): set(var, sc::year); break;
-        case WR_VAR(0,  4,  2): set(var, sc::month); break;
-        case WR_VAR(0,  4,  3): set(var, sc::day); break;
-        case WR_VAR(0,  4,  4): set(var, sc::hour); break;
-        case WR_VAR(0,  4,  5): set(var, sc::minute); break;
-        case WR_VAR(0,  4,  6): set(var, sc::second); break;
+        case WR_VAR(0,  1, 11): return &sc::ident;
+        case WR_VAR(0,  1, 12): return &sc::st_dir;
+        case WR_VAR(0,  1, 13): return &sc::st_speed;
+        case WR_VAR(0,  1, 63): return &sc::st_name_icao;
+        case WR_VAR(0,  2,  1): return &sc::st_type;
+        case WR_VAR(0,  1, 15): return &sc::st_name;
+        case WR_VAR(0,  4,  1): return &sc::year;
+        case WR_VAR(0,  4,  2): return &sc::month;
+        case WR_VAR(0,  4,  3): return &sc::day;
+        case WR_VAR(0,  4,  4): return &sc::hour;
+        case WR_VAR(0,  4,  5): return &sc::minute;
+        case WR_VAR(0,  4,  6): return &sc::second;
         case WR_VAR(0,  5,  1):
-        case WR_VAR(0,  5,  2): set(var, sc::latitude); break;
+        case WR_VAR(0,  5,  2): return &sc::latitude;
         case WR_VAR(0,  6,  1):
-        case WR_VAR(0,  6,  2): set(var, sc::longitude); break;
+        case WR_VAR(0,  6,  2): return &sc::longitude;
+        default: return nullptr;
     }
 }
 
+void WMOImporter::import_var(const Var& var)
+{
+    if (const Shortcut* shortcut = station_shortcut(var.code()))
+        set(var, *shortcut);
+}
+
 void LevelContext::init()
 {
     height_baro = MISSING_BARO;
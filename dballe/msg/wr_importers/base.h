@@ -38,6 +38,22 @@ public:
 
     void import(const wreport::Subset& subset, impl::Message& msg);
 
+    /**
+     * Import all the subsets of \a bulletin, the first into msgs[0], the
+     * second into msgs[1], and so on.
+     *
+     * The default implementation imports one subset at a time. Importers can
+     * override it to interpret the data descriptors only once when all the
+     * subsets share them, as in compressed BUFR.
+     */
+    virtual void import_subsets(const wreport::Bulletin& bulletin, const std::vector<impl::Message*>& msgs);
+
+    /**
+     * Check if import_subsets is worth using instead of importing one subset
+     * at a time
+     */
+    virtual bool supports_subset_import() const { return false; }
+
     static std::unique_ptr<Importer> createSynop(const dballe::ImporterOptions&);
     static std::unique_ptr<Importer> createShip(const dballe::ImporterOptions&);
     static std::unique_ptr<Importer> createMetar(const dballe::ImporterOptions&);
@@ -56,6 +72,9 @@ protected:
 
     void import_var(const wreport::Var& var);
 
+    /// Shortcut used by import_var for \a code, or nullptr if it ignores it
+    static const Shortcut* station_shortcut(wreport::Varcode code);
+
     void init() override
     {
         pos = 0;
@@ -1,6 +1,7 @@
 #include "base.h"
 #include "dballe/core/var.h"
 #include "dballe/msg/msg.h"
+#include "dballe/msg/bulletin.h"
 #include <wreport/bulletin.h>
 #include <wreport/subset.h>
 #include <wreport/conv.h>
@@ -17,6 +18,34 @@ namespace wr {
 class FlightImporter : public WMOImporter
 {
 protected:
+    /// What import_var does with a variable
+    enum class Action
+    {
+        IGNORE,
+        /// Store in the data at the flight level
+        ACQUIRE,
+        /// Set the flight level from B07002, then acquire as B07030
+        HEIGHT,
+        /// Set the flight level from B07004 if not yet set, then acquire as B10004
+        PRESSURE,
+        /// Set the flight level from B07010, then acquire as B07030
+        FLIGHT_LEVEL,
+        B01006,
+        B01008,
+        /// Store in the station data using a shortcut
+        STATION,
+    };
+
+    /// Interpretation of a position in the subsets of a bulletin
+    struct Step
+    {
+        unsigned pos;
+        Action action;
+        /// Code to use when acquiring the variable
+        Varcode code;
+        const Shortcut* shortcut;
+    };
+
     Level lev;
     std::vector<Var*> deferred;
     const Var* b01006;
@@ -24,6 +53,12 @@ protected:
 
     void import_var(const Var& var);
 
+    /// Compute what import_var does with variables with code \a code
+    static Step plan(unsigned pos, Varcode code);
+
+    /// Flight level set by \a var, according to \a action
+    Level flight_level(Action action, const Var& var) const;
+
 public:
     FlightImporter(const dballe::ImporterOptions& opts) : WMOImporter(opts) {}
     virtual ~FlightImporter()
@@ -105,6 +140,107 @@ public:
             msg->set_ident_var(*b01006);
     }
 
+    bool supports_subset_import() const override { return true; }
+
+    /**
+     * Compile the variables of the first subset into a list of steps, and
+     * apply each step to all subsets in turn.
+     *
+     * The results are the same as importing each subset with run().
+     */
+    void import_subsets(const Bulletin& bulletin, const std::vector<impl::Message*>& msgs) override
+    {
+        if (bulletin.subsets.size() < 2 || !dballe::msg::same_layout(bulletin))
+            return WMOImporter::import_subsets(bulletin, msgs);
+
+        const Subset& first = bulletin.subsets[0];
+        std::vector<Step> steps;
+        for (unsigned pos = 0; pos < first.size(); ++pos)
+        {
+            Varcode code = first[pos].code();
+            if (WR_VAR_F(code) != 0) continue;
+            Step step = plan(pos, code);
+            if (step.action != Action::IGNORE)
+                steps.push_back(step);
+        }
+
+        const unsigned count = bulletin.subsets.size();
+        std::vector<Level> levels(count);
+        std::vector<const Var*> b01006s(count, nullptr);
+        std::vector<const Var*> b01008s(count, nullptr);
+
+        // Find the flight level and the identifiers of each subset, and store
+        // the station data
+        for (const auto& step: steps)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                const Var& var = bulletin.subsets[i][step.pos];
+                if (!var.isset()) continue;
+                switch (step.action)
+                {
+                    case Action::PRESSURE:
+                        if (levels[i].ltype1 != MISSING_INT) break;
+                        // Fallthrough
+                    case Action::HEIGHT:
+                    case Action::FLIGHT_LEVEL:
+                    {
+                        Level newlev = flight_level(step.action, var);
+                        if (levels[i].ltype1 != MISSING_INT)
+                            error_consistency::throwf("found two flight levels: %s and %s",
+                                    levels[i].describe().c_str(), newlev.describe().c_str());
+                        levels[i] = newlev;
+                        break;
+                    }
+                    case Action::B01006: b01006s[i] = &var; break;
+                    case Action::B01008: b01008s[i] = &var; break;
+                    case Action::STATION: msgs[i]->set(*step.shortcut, var); break;
+                    default: break;
+                }
+            }
+        }
+
+        // Store the values. Variables found before the flight level are
+        // stored when it is found, so all variables end up being stored in
+        // the same order as in the subset, and dropped if there is no flight
+        // level. Everything else has already been stored in other contexts,
+        // so the context of the flight level can be looked up only once
+        std::vector<msg::Context*> contexts(count, nullptr);
+        auto store = [&](unsigned i, const Var& var, Varcode code) {
+            if (levels[i].ltype1 == MISSING_INT) return;
+            if (!contexts[i])
+                contexts[i] = &msgs[i]->obtain_context(levels[i], Trange::instant());
+            contexts[i]->values.set(msgs[i]->pool.copy_without_unset_attrs(var, code));
+        };
+        for (const auto& step: steps)
+        {
+            for (unsigned i = 0; i < count; ++i)
+            {
+                const Var& var = bulletin.subsets[i][step.pos];
+                if (!var.isset()) continue;
+                switch (step.action)
+                {
+                    case Action::ACQUIRE:
+                    case Action::HEIGHT:
+                    case Action::PRESSURE:
+                    case Action::FLIGHT_LEVEL: store(i, var, step.code); break;
+                    default: break;
+                }
+            }
+        }
+
+        for (unsigned i = 0; i < count; ++i)
+        {
+            if (b01008s[i])
+            {
+                msgs[i]->set_ident_var(*b01008s[i]);
+                if (b01006s[i])
+                    store(i, *b01006s[i], WR_VAR(0, 1, 6));
+            } else if (b01006s[i])
+                msgs[i]->set_ident_var(*b01006s[i]);
+        }
+    }
+
     MessageType scanTypeFromVars(const Subset& subset) const
     {
         for (unsigned i = 0; i < subset.size(); ++i)
@@ -141,6 +277,87 @@ std::unique_ptr<Importer> Importer::createFlight(const dballe::ImporterOptions&
     return unique_ptr<Importer>(new FlightImporter(opts));
 }
 
+FlightImporter::Step FlightImporter::plan(unsigned pos, Varcode code)
+{
+    Step res{pos, Action::ACQUIRE, code, nullptr};
+    switch (code)
+    {
+        case WR_VAR(0,  1,  6): res.action = Action::B01006; break;
+        case WR_VAR(0,  1,  8): res.action = Action::B01008; break;
+        case WR_VAR(0,  1, 23):
+        case WR_VAR(0,  2,  1):
+        case WR_VAR(0,  2,  2):
+        case WR_VAR(0,  2,  5):
+        case WR_VAR(0,  2, 61):
+        case WR_VAR(0,  2, 62):
+        case WR_VAR(0,  2, 63):
+        case WR_VAR(0,  2, 64):
+        case WR_VAR(0,  2, 70): break;
+        case WR_VAR(0,  7,  2): res.action = Action::HEIGHT; res.code = WR_VAR(0, 7, 30); break;
+        case WR_VAR(0,  7,  4): res.action = Action::PRESSURE; res.code = WR_VAR(0, 10, 4); break;
+        case WR_VAR(0,  7, 10): res.action = Action::FLIGHT_LEVEL; res.code = WR_VAR(0, 7, 30); break;
+        case WR_VAR(0,  8,  4):
+        case WR_VAR(0,  8,  9):
+        case WR_VAR(0,  8, 21):
+        case WR_VAR(0, 11,  1):
+        case WR_VAR(0, 11,  2):
+        case WR_VAR(0, 11, 31):
+        case WR_VAR(0, 11, 32):
+        case WR_VAR(0, 11, 33):
+        case WR_VAR(0, 11, 34):
+        case WR_VAR(0, 11, 35):
+        case WR_VAR(0, 11, 36):
+        case WR_VAR(0, 11, 37):
+        case WR_VAR(0, 11, 39):
+        case WR_VAR(0, 11, 77): break;
+        case WR_VAR(0, 12,  1): res.code = WR_VAR(0, 12, 101); break;
+        case WR_VAR(0, 12,101): break;
+        case WR_VAR(0, 12,  3): res.code = WR_VAR(0, 12, 103); break;
+        case WR_VAR(0, 12,103):
+        case WR_VAR(0, 13,  2):
+        case WR_VAR(0, 13,  3):
+        case WR_VAR(0, 20, 41):
+        case WR_VAR(0, 20, 42):
+        case WR_VAR(0, 20, 43):
+        case WR_VAR(0, 20, 44):
+        case WR_VAR(0, 20, 45):
+        case WR_VAR(0, 33, 25): break;
+        default:
+            if ((res.shortcut = station_shortcut(code)))
+                res.action = Action::STATION;
+            else
+                res.action = Action::IGNORE;
+            break;
+    }
+    return res;
+}
+
+Level FlightImporter::flight_level(Action action, const Var& var) const
+{
+    switch (action)
+    {
+        case Action::HEIGHT:
+            // Specific Altitude Above Mean Sea Level in mm
+            return Level(102, var.enqd() * 1000);
+        case Action::PRESSURE:
+            // Isobaric Surface in Pa
+            return Level(100, var.enqd());
+        case Action::FLIGHT_LEVEL:
+            if (opts.simplified)
+            {
+                // Convert to pressure using formula from
+                // http://www.wmo.int/pages/prog/www/IMOP/publications/CIMO-Guide/CIMO%20Guide%207th%20Edition,%202008/Part%20II/Chapter%203.pdf
+                double p_hPa = 1013.25 * pow(1.0 - 0.000001 * 6.8756 * var.enqd() * 3.28084, 5.2559);
+                return Level(100, round(p_hPa * 100));
+            }
+            else
+                // Specific Altitude Above Mean Sea Level in mm
+                return Level(102, var.enqd() * 1000);
+        default:
+            throw error_consistency("variable does not set a flight level");
+    }
+}
+
 void FlightImporter::import_var(const Var& var)
 {
     switch (var.code())
@@ -157,28 +374,16 @@ void FlightImporter::import_var(const Var& var)
         case WR_VAR(0,  2, 64): acquire(var); break;
         case WR_VAR(0,  2, 70): acquire(var); break;
         case WR_VAR(0,  7,  2):
-            // Specific Altitude Above Mean Sea Level in mm
-            set_level(Level(102, var.enqd() * 1000));
+            set_level(flight_level(Action::HEIGHT, var));
             acquire(var, WR_VAR(0,  7, 30));
             break;
         case WR_VAR(0,  7,  4):
-            // Isobaric Surface in Pa
             if (lev.ltype1 == MISSING_INT)
-                set_level(Level(100, var.enqd()));
+                set_level(flight_level(Action::PRESSURE, var));
             acquire(var, WR_VAR(0, 10,  4));
             break;
         case WR_VAR(0,  7,  10):
-            // Flight level
-            if (opts.simplified)
-            {
-                // Convert to pressure using formula from
-                // http://www.wmo.int/pages/prog/www/IMOP/publications/CIMO-Guide/CIMO%20Guide%207th%20Edition,%202008/Part%20II/Chapter%203.pdf
-                double p_hPa = 1013.25 * pow(1.0 - 0.000001 * 6.8756 * var.enqd() * 3.28084, 5.2559);
-                set_level(Level(100, round(p_hPa * 100)));
-            }
-            else
-                // Specific Altitude Above Mean Sea Level in mm
-                set_level(Level(102, var.enqd() * 1000));
+            set_level(flight_level(Action::FLIGHT_LEVEL, var));
             acquire(var, WR_VAR(0, 7, 30));
             break;
         case WR_VAR(0,  8,  4): acquire(var); break;
@@ -6,6 +6,7 @@
 #include <cstdio>
 #include <cstdlib>
 #include <iostream>
+#include <unistd.h>
 
 //#define TRACE_MYSQL
 #ifdef TRACE_MYSQL
@@ -248,15 +249,36 @@ void MySQLConnection::fork_parent()
 
 void MySQLConnection::fork_child()
 {
+    if (db)
+    {
+        // Close the socket first, so that freeing the handle cannot send a
+        // quit command to the server and end the session of the parent
+        my_socket fd = mysql_get_socket(db);
+        if (fd >= 0)
+            ::close(fd);
+        mysql_close(db);
+        db = nullptr;
+    }
     forked = true;
-    // TODO: close the underlying file descriptor (how?) instead of leaking it
-    db = nullptr;
 }
 
 void MySQLConnection::check_connection()
 {
-    if (forked)
+    if (!forked) return;
+    if (!reconnect_after_fork)
         throw error_mysql("mysql handle not safe", "database connections cannot be used after forking");
+
+    db = mysql_init(nullptr);
+    if (!db) throw error_mysql(nullptr, "failed to create a MYSQL object");
+    forked = false;
+    try {
+        open_url(url);
+    } catch (...) {
+        mysql_close(db);
+        db = nullptr;
+        forked = true;
+        throw;
+    }
 }
 
 void MySQLConnection::open(const mysql::ConnectInfo& info)
@@ -570,6 +592,12 @@ int MySQLConnection::get_last_insert_id()
     return mysql_insert_id(db);
 }
 
+int MySQLConnection::changes()
+{
+    check_connection();
+    return mysql_affected_rows(db);
+}
+
 bool MySQLConnection::has_table(const std::string& name)
 {
     using namespace dballe::sql::mysql;
@@ -207,6 +207,9 @@ public:
      * If not supported, an exception is thrown.
      */
     int get_last_insert_id();
+
+    /// Count the number of rows modified by the last query that was run
+    int changes();
 };
 
 }
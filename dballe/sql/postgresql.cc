@@ -222,8 +222,24 @@ void PostgreSQLConnection::fork_child()
 
 void PostgreSQLConnection::check_connection()
 {
-    if (forked)
+    if (!forked) return;
+    if (!reconnect_after_fork)
         throw error_postgresql("server connection closed", "database connections cannot be used after forking");
+
+    // Statements prepared by the parent do not exist in the new session
+    prepared_names.clear();
+    forked = false;
+    try {
+        open_url(url);
+    } catch (...) {
+        if (db)
+        {
+            PQfinish(db);
+            db = nullptr;
+        }
+        forked = true;
+        throw;
+    }
 }
 
 void PostgreSQLConnection::open_url(const std::string& connection_string)
@@ -425,6 +441,21 @@ void PostgreSQLConnection::run_single_row_mode(const std::string& query_desc, st
     }
 }
 
+std::string PostgreSQLConnection::export_snapshot()
+{
+    auto res = exec_one_row("SELECT pg_export_snapshot()");
+    return res.get_string(0, 0);
+}
+
+void PostgreSQLConnection::import_snapshot(const std::string& snapshot)
+{
+    // SET TRANSACTION does not take parameters
+    Querybuf q;
+    q.append("SET TRANSACTION SNAPSHOT ");
+    append_escaped(q, snapshot);
+    exec_no_data(q);
+}
+
 bool PostgreSQLConnection::has_table(const std::string& name)
 {
     using namespace postgresql;
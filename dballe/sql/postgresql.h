@@ -459,6 +459,8 @@ public:
     void drop_settings() override;
     void execute(const std::string& query) override;
     void explain(const std::string& query, FILE* out) override;
+    std::string export_snapshot() override;
+    void import_snapshot(const std::string& snapshot) override;
 
     /**
      * Delete a table in the database if it exists, otherwise do nothing.
@@ -32,6 +32,7 @@ const char* format_server_type(ServerType type)
         case ServerType::SQLITE: return "sqlite";
         case ServerType::ORACLE: return "oracle";
         case ServerType::POSTGRES: return "postgresql";
+        case ServerType::MEMORY: return "memory";
         default: return "unknown";
     }
 }
@@ -102,6 +103,16 @@ void Connection::fork_prepare() {}
 void Connection::fork_parent() {}
 void Connection::fork_child() {}
 
+std::string Connection::export_snapshot()
+{
+    return std::string();
+}
+
+void Connection::import_snapshot(const std::string& snapshot)
+{
+    throw wreport::error_unimplemented("this database does not support sharing snapshots between connections");
+}
+
 void Connection::add_datetime(Querybuf& qb, const Datetime& dt) const
 {
     qb.appendf("'%04hu-%02hhu-%02hhu %02hhu:%02hhu:%02hhu'",
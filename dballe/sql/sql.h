@@ -43,6 +43,7 @@ enum class ServerType
     SQLITE,
     ORACLE,
     POSTGRES,
+    MEMORY,
 };
 
 /// Return a string description for a ServerType value
@@ -78,6 +79,14 @@ public:
      */
     ServerType server_type;
 
+    /**
+     * If true, using the connection in a child process after fork() reopens
+     * it, instead of raising an error.
+     *
+     * The connection must not be in a transaction when the process forks.
+     */
+    bool reconnect_after_fork = false;
+
     virtual ~Connection();
 
     const std::string& get_url() const { return url; }
@@ -110,6 +119,25 @@ public:
     /// Drop the settings table
     virtual void drop_settings() = 0;
 
+    /**
+     * Return an identifier for the snapshot of the database seen by the
+     * current transaction, that transactions on other connections can adopt
+     * with import_snapshot().
+     *
+     * Returns the empty string if the database does not support sharing
+     * snapshots between connections.
+     */
+    virtual std::string export_snapshot();
+
+    /**
+     * Make the current transaction see the snapshot exported by a transaction
+     * on another connection.
+     *
+     * This must be called right after starting a read-only transaction,
+     * before running any query in it.
+     */
+    virtual void import_snapshot(const std::string& snapshot);
+
     /// Format a datetime and add it to the querybuf
     virtual void add_datetime(Querybuf& qb, const Datetime& dt) const;
 
@@ -147,15 +147,36 @@ void SQLiteConnection::fork_parent()
 
 void SQLiteConnection::fork_child()
 {
+    if (db)
+    {
+#ifdef SQLITE_DBCONFIG_NO_CKPT_ON_CLOSE
+        // Do not checkpoint or remove the WAL that the parent is using
+        sqlite3_db_config(db, SQLITE_DBCONFIG_NO_CKPT_ON_CLOSE, 1, nullptr);
+#endif
+        // The child does not inherit the locks of the parent, so closing only
+        // releases the memory and file descriptors of the handle. Statements
+        // still prepared on it complete the close when they are finalized
+        sqlite3_close_v2(db);
+        db = nullptr;
+    }
     forked = true;
-    // TODO: close the underlying file descriptor (how?) instead of leaking it
-    db = nullptr;
 }
 
 void SQLiteConnection::check_connection()
 {
-    if (forked)
+    if (!forked) return;
+    if (!reconnect_after_fork)
         throw error_sqlite("sqlite handle not safe", "database connections cannot be used after forking");
+    if (pathname.empty() || pathname.compare(0, 8, ":memory:") == 0)
+        throw error_sqlite("sqlite handle not safe", "in-memory databases cannot be reopened after forking");
+
+    forked = false;
+    try {
+        reopen();
+    } catch (...) {
+        forked = true;
+        throw;
+    }
 }
 
 void SQLiteConnection::on_sqlite3_profile(void* arg, const char* query, sqlite3_uint64 usecs)
@@ -28,7 +28,9 @@ add_method("codec", []() {
     vals.set(newvar(WR_VAR(0, 1, 19), "Test string value"));
 
     vector<uint8_t> encoded = vals.encode();
-    wassert(actual(encoded.size()) == (14 + strlen("Test string value") + 1));
+    // Header, then each varcode in two bytes followed by 123 in 2 bytes,
+    // 28023 in 3 bytes and the string with its length in 1 byte
+    wassert(actual(encoded.size()) == (2 + 6 + 2 + 3 + 1 + strlen("Test string value")));
 
     Values vals1;
     Values::decode(encoded, [&](std::unique_ptr<wreport::Var> var) { vals1.set(move(var)); });
@@ -11,6 +11,7 @@
 #include "dballe/importer.h"
 #include "dballe/exporter.h"
 #include "dballe/msg/msg.h"
+#include "dballe/msg/parallel_decoder.h"
 #include "dballe/db/defs.h"
 #include "dballe/db/v7/cursor.h"
 #include <algorithm>
@@ -623,8 +624,9 @@ static unsigned db_load_file_enc(DB& db, Encoding encoding, FILE* file, bool clo
     std::unique_ptr<File> f = File::create(encoding, file, close_on_exit, name);
     std::unique_ptr<Importer> imp = Importer::create(f->encoding());
     unsigned count = 0;
+    impl::Messages messages;
     f->foreach([&](const BinaryMessage& raw) {
-        impl::Messages messages = imp->from_binary(raw);
+        imp->from_binary(raw, messages);
         db.import_messages(messages, opts);
         ++count;
         return true;
@@ -638,8 +640,9 @@ static unsigned db_load_file(DB& db, FILE* file, bool close_on_exit, const std::
     std::unique_ptr<File> f = File::create(file, close_on_exit, name);
     std::unique_ptr<Importer> imp = Importer::create(f->encoding());
     unsigned count = 0;
+    impl::Messages messages;
     f->foreach([&](const BinaryMessage& raw) {
-        impl::Messages messages = imp->from_binary(raw);
+        imp->from_binary(raw, messages);
         db.import_messages(messages, opts);
         ++count;
         return true;
@@ -870,10 +873,18 @@ struct import_messages : MethKwargs<import_messages<Impl>, Impl>
             if (dpy_ImporterFile_Check(obj))
             {
                 dpy_ImporterFile* impf = (dpy_ImporterFile*)obj;
-                while (auto binmsg = impf->file->file->file().read())
+                impl::Messages messages;
+                if (impf->decoder)
                 {
-                    auto messages = impf->importer->importer->from_binary(binmsg);
-                    self->db->import_messages(messages, *opts);
+                    BinaryMessage binmsg(impf->file->file->file().encoding());
+                    while (impf->decoder->next(binmsg, messages))
+                        self->db->import_messages(messages, *opts);
+                } else {
+                    while (auto binmsg = impf->file->file->file().read())
+                    {
+                        impf->importer->importer->from_binary(binmsg, messages);
+                        self->db->import_messages(messages, *opts);
+                    }
                 }
                 Py_RETURN_NONE;
             }
@@ -1074,7 +1085,12 @@ struct transaction : MethKwargs<transaction, dpy_DB>
             return nullptr;
 
         try {
-            auto res = dynamic_pointer_cast<db::Transaction>(self->db->transaction(readonly));
+            std::shared_ptr<db::Transaction> res;
+            {
+                // Waiting for a pooled connection must not block other threads
+                ReleaseGIL gil;
+                res = dynamic_pointer_cast<db::Transaction>(self->db->transaction(readonly));
+            }
             return (PyObject*)transaction_create(move(res));
         } DBALLE_CATCH_RETURN_PYO
     }
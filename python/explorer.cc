@@ -1,6 +1,9 @@
 #define _DBALLE_LIBRARY_CODE
 #include "dballe/db/explorer.h"
 #include "dballe/core/json.h"
+#include "dballe/file.h"
+#include "dballe/msg/msg.h"
+#include "dballe/msg/parallel_decoder.h"
 #include "common.h"
 #include "cursor.h"
 #include "explorer.h"
@@ -10,6 +13,7 @@
 #include "db.h"
 #include "utils/type.h"
 #include <algorithm>
+#include <cstring>
 #include <sstream>
 #include "config.h"
 
@@ -363,14 +367,14 @@ preserved.)";
 
     static PyObject* run(Impl* self)
     {
-        std::ostringstream json;
+        std::string json;
         {
             ReleaseGIL rg;
             core::JSONWriter writer(json);
             self->explorer->to_json(writer);
         }
 
-        return string_to_python(json.str());
+        return string_to_python(json);
     }
 };
 
@@ -483,9 +487,11 @@ Use :meth:`rebuild` or :meth:`update` to populate the explorer.
 If a file name is passed to the constructor, the Explorer automatically loads
 contents from the file (if it exists), and saves them to the file on update.
 
-The persistence file is in JSON format if the file name ends with ``.json`` or
-if no Xapian support is compiled in. Otherwise, the Explorer will persist using
-an indexed Xapian database.
+The persistence file is in JSON format if the file name ends with ``.json``,
+and in a compact binary format that loads without parsing if the file name ends
+with ``.summary``, if the file already contains a binary summary, or if no
+Xapian support is compiled in. Otherwise, the Explorer will persist using an
+indexed Xapian database.
 
 ::
 
@@ -620,8 +626,7 @@ Add the contents of the given JSON string to the Explorer.
         try {
             {
                 ReleaseGIL rg;
-                std::istringstream json(json_str);
-                core::json::Stream in(json);
+                core::json::Stream in(json_str, json_str + strlen(json_str));
                 self->update.add_json(in);
             }
         } DBALLE_CATCH_RETURN_PYO
@@ -700,10 +705,18 @@ It takes the same messages argument of :func:`dballe.DB.import_messages`.
             if (dpy_ImporterFile_Check(obj))
             {
                 dpy_ImporterFile* impf = (dpy_ImporterFile*)obj;
-                while (auto binmsg = impf->file->file->file().read())
+                impl::Messages messages;
+                if (impf->decoder)
                 {
-                    auto messages = impf->importer->importer->from_binary(binmsg);
-                    self->update.add_messages(messages, station_data, data);
+                    BinaryMessage binmsg(impf->file->file->file().encoding());
+                    while (impf->decoder->next(binmsg, messages))
+                        self->update.add_messages(messages, station_data, data);
+                } else {
+                    while (auto binmsg = impf->file->file->file().read())
+                    {
+                        impf->importer->importer->from_binary(binmsg, messages);
+                        self->update.add_messages(messages, station_data, data);
+                    }
                 }
                 Py_RETURN_NONE;
             }
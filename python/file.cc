@@ -5,6 +5,8 @@
 #include "utils/type.h"
 #include "utils/methods.h"
 #include "utils/values.h"
+#include "types.h"
+#include "dballe/msg/fileindex.h"
 
 using namespace std;
 using namespace dballe;
@@ -236,6 +238,49 @@ struct __exit__ : MethVarargs<__exit__, dpy_File>
     }
 };
 
+struct select : MethKwargs<select, dpy_File>
+{
+    constexpr static const char* name = "select";
+    constexpr static const char* signature = "query: Dict[str, Any]";
+    constexpr static const char* returns = "List[dballe.BinaryMessage]";
+    constexpr static const char* summary = "Read the messages in the file that match a query";
+    constexpr static const char* doc = R"(
+The query is matched with the station and datetime of the decoded messages,
+like the filters of ``dbamsg``. All the file is searched, regardless of the
+messages that have already been read.
+
+If the file has been indexed with ``dbamsg index``, only the messages that can
+match the query are read and decoded.
+)";
+    static PyObject* run(Impl* self, PyObject* args, PyObject* kw)
+    {
+        static const char* kwlist[] = { "query", nullptr };
+        PyObject* pyquery = nullptr;
+        if (!PyArg_ParseTupleAndKeywords(args, kw, "|O", const_cast<char**>(kwlist), &pyquery))
+            return nullptr;
+
+        try {
+            auto query = query_from_python(pyquery);
+            std::vector<BinaryMessage> found;
+            {
+                ReleaseGIL gil;
+                impl::FileIndex::foreach_match(self->file->file(), *query, [&](const BinaryMessage& msg) {
+                    found.push_back(msg);
+                    return true;
+                });
+            }
+
+            pyo_unique_ptr res(throw_ifnull(PyList_New(0)));
+            for (auto& msg: found)
+            {
+                pyo_unique_ptr item((PyObject*)throw_ifnull(binarymessage_create(std::move(msg))));
+                if (PyList_Append(res, item) == -1)
+                    throw PythonException();
+            }
+            return res.release();
+        } DBALLE_CATCH_RETURN_PYO
+    }
+};
 
 struct FileDefinition : public Type<FileDefinition, dpy_File>
 {
@@ -264,7 +309,7 @@ Example usage::
 )";
 
     GetSetters<getter_name, encoding> getsetters;
-    Methods<__enter__, __exit__> methods;
+    Methods<__enter__, __exit__, select> methods;
 
     static void _dealloc(Impl* self)
     {
@@ -6,6 +6,7 @@
 #include "message.h"
 #include "dballe/file.h"
 #include "dballe/msg/msg.h"
+#include "dballe/msg/parallel_decoder.h"
 #include "utils/type.h"
 #include "wreport/options.h"
 
@@ -38,6 +39,8 @@ struct __exit__ : MethVarargs<__exit__, dpy_ImporterFile>
             return nullptr;
 
         try {
+            delete self->decoder;
+            self->decoder = nullptr;
             Py_XDECREF(self->importer);
             self->importer = nullptr;
             Py_XDECREF(self->file);
@@ -60,6 +63,9 @@ This is never instantiated explicitly, but is returned by
 
 It can be used in a context manager, and it is an iterable that yields tuples
 of :class:`dballe.Message` objects.
+
+When decoding with multiple threads, the GIL is released while waiting for the
+next decoded message.
 )";
 
     GetSetters<> getsetters;
@@ -76,6 +82,7 @@ of :class:`dballe.Message` objects.
 
     static void _dealloc(Impl* self)
     {
+        delete self->decoder;
         Py_XDECREF(self->importer);
         Py_XDECREF(self->file);
         Py_TYPE(self)->tp_free(self);
@@ -94,13 +101,29 @@ of :class:`dballe.Message` objects.
     {
         try {
             check_valid(self);
-            BinaryMessage binmsg = self->file->file->file().read();
-            if (!binmsg)
+            std::vector<std::shared_ptr<dballe::Message>> messages;
+            if (self->decoder)
             {
-                PyErr_SetNone(PyExc_StopIteration);
-                return nullptr;
+                BinaryMessage binmsg(self->file->file->file().encoding());
+                bool found;
+                {
+                    ReleaseGIL gil;
+                    found = self->decoder->next(binmsg, messages);
+                }
+                if (!found)
+                {
+                    PyErr_SetNone(PyExc_StopIteration);
+                    return nullptr;
+                }
+            } else {
+                BinaryMessage binmsg = self->file->file->file().read();
+                if (!binmsg)
+                {
+                    PyErr_SetNone(PyExc_StopIteration);
+                    return nullptr;
+                }
+                messages = self->importer->importer->from_binary(binmsg);
             }
-            auto messages = self->importer->importer->from_binary(binmsg);
             pyo_unique_ptr res(throw_ifnull(PyTuple_New(messages.size())));
             for (size_t i = 0; i < messages.size(); ++i)
                 PyTuple_SET_ITEM((PyTupleObject*)res.get(), i, (PyObject*)message_create(messages[i]));
@@ -138,20 +161,34 @@ struct from_binary : MethKwargs<from_binary, dpy_Importer>
 struct from_file : MethKwargs<from_file, dpy_Importer>
 {
     constexpr static const char* name = "from_file";
-    constexpr static const char* signature = "file: Union[dballe.File, str, File]";
+    constexpr static const char* signature = "file: Union[dballe.File, str, File], threads: int=1, ordered: bool=True";
     constexpr static const char* returns = "dballe.ImporterFile";
     constexpr static const char* doc = R"(
 Wrap a :class:`dballe.File` into a sequence of tuples of :class:`dballe.Message` objects.
 
 `file` can be a :class:`dballe.File`, a file name, or a file-like object. A :class:`dballe.File`
 is automatically constructed if needed, using the importer encoding.
+
+:arg threads: number of threads used to decode messages. 0 means one per
+              available core, or the value of the ``DBA_THREADS`` environment
+              variable if set.
+:arg ordered: when decoding with multiple threads, yield messages in the order
+              they have in the file. If False, yield them as soon as they are
+              decoded.
 )";
     static PyObject* run(Impl* self, PyObject* args, PyObject* kw)
     {
-        static const char* kwlist[] = { "file", nullptr };
+        static const char* kwlist[] = { "file", "threads", "ordered", nullptr };
         PyObject* obj = nullptr;
-        if (!PyArg_ParseTupleAndKeywords(args, kw, "O", const_cast<char**>(kwlist), &obj))
+        int threads = 1;
+        int ordered = 1;
+        if (!PyArg_ParseTupleAndKeywords(args, kw, "O|ip", const_cast<char**>(kwlist), &obj, &threads, &ordered))
             return nullptr;
+        if (threads < 0)
+        {
+            PyErr_SetString(PyExc_ValueError, "threads must not be negative");
+            return nullptr;
+        }
 
         try {
             py_unique_ptr<dpy_File> file;
@@ -165,9 +202,12 @@ is automatically constructed if needed, using the importer encoding.
             }
 
             py_unique_ptr<dpy_ImporterFile> res = throw_ifnull(PyObject_New(dpy_ImporterFile, dpy_ImporterFile_Type));
+            res->decoder = nullptr;
             res->file = file.release();
             Py_INCREF(self);
             res->importer = self;
+            if (threads != 1)
+                res->decoder = new impl::ParallelDecoder(res->file->file->file(), self->importer->options(), threads, ordered);
             return (PyObject*)res.release();
         } DBALLE_CATCH_RETURN_PYO
     }
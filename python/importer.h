@@ -5,6 +5,12 @@
 #include "file.h"
 #include <memory>
 
+namespace dballe {
+namespace impl {
+class ParallelDecoder;
+}
+}
+
 extern "C" {
 
 typedef struct {
@@ -23,6 +29,8 @@ typedef struct {
     PyObject_HEAD
     dpy_File* file;
     dpy_Importer* importer;
+    /// Decoder used when decoding with multiple threads, else nullptr
+    dballe::impl::ParallelDecoder* decoder;
 } dpy_ImporterFile;
 
 extern PyTypeObject* dpy_ImporterFile_Type;
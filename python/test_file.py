@@ -73,3 +73,13 @@ class TestFileRead(unittest.TestCase):
             self.assertEqual(sys.getrefcount(f), 4)  # file, __enter__ result, f, getrefcount
         self.assertEqual(sys.getrefcount(file), 3)  # file, f, _getrefcount
         self.assertEqual(sys.getrefcount(f), 3)  # file, f, _getrefcount
+
+    def test_select(self):
+        pathname = test_pathname("bufr/synop3new.bufr")
+        with dballe.File(pathname) as f:
+            everything = list(f)
+            # select() searches all the file, even after it has been read
+            selected = f.select({})
+            self.assertEqual([m.index for m in selected], [m.index for m in everything])
+            self.assertEqual([bytes(m) for m in selected], [bytes(m) for m in everything])
+            self.assertEqual(f.select({"year": 1800}), [])
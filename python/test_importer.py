@@ -90,6 +90,26 @@ class TestImporter(MessageTestMixin, unittest.TestCase):
         msg = decoded[0][0]
         self.assert_gts_acars_uk1_contents(msg)
 
+    def test_fromfile_threads(self):
+        pathname = test_pathname("bufr/synop3new.bufr")
+        importer = dballe.Importer("BUFR")
+
+        def summary(decoded):
+            return [tuple((m.report, m.coords, m.ident, m.datetime, m.type) for m in msgs) for msgs in decoded]
+
+        with importer.from_file(pathname) as f:
+            expected = summary(f)
+        self.assertGreater(len(expected), 1)
+
+        with importer.from_file(pathname, threads=3) as f:
+            self.assertEqual(summary(f), expected)
+
+        with importer.from_file(pathname, threads=0, ordered=False) as f:
+            self.assertCountEqual(summary(f), expected)
+
+        with self.assertRaises(ValueError):
+            importer.from_file(pathname, threads=-1)
+
     def test_refcounts(self):
         pathname = test_pathname("bufr/gts-acars-uk1.bufr")
         importer = dballe.Importer("BUFR")
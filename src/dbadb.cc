@@ -29,6 +29,9 @@ const char* op_varlist = "";
 const char* op_domain_errors = "";
 int op_wipe_first = 0;
 int op_dump = 0;
+int op_csv = 0;
+int op_subsets = 1;
+int op_compress = 0;
 int op_overwrite = 0;
 int op_fast = 0;
 int op_no_attrs = 0;
@@ -36,6 +39,8 @@ int op_full_pseudoana = 0;
 int op_verbose = 0;
 int op_precise_import = 0;
 int op_wipe_disappear = 0;
+int op_batch_size = 10000;
+int op_drop = 0;
 
 
 struct poptOption grepTable[] = {
@@ -224,6 +229,149 @@ struct CleanupCmd : public DatabaseCmd
     }
 };
 
+/// Remove old data from the database
+struct PurgeCmd : public DatabaseCmd
+{
+    PurgeCmd()
+    {
+        names.push_back("purge");
+        usage = "purge [options] datetime";
+        desc = "Remove all data older than the given date and time";
+        longdesc =
+            "Delete all measured values with a date and time earlier than the given one "
+            "(in ISO8601 format, like 2010-01-01T00:00:00), then delete stations and "
+            "levels/time ranges left without data. Data are deleted in batches, "
+            "committing after each batch.";
+    }
+
+    void add_to_optable(std::vector<poptOption>& opts) const override
+    {
+        DatabaseCmd::add_to_optable(opts);
+        opts.push_back({ "batch-size", 0, POPT_ARG_INT, &op_batch_size, 0,
+            "number of rows to delete in each transaction (default: 10000)", "num" });
+    }
+
+    int main(poptContext optCon) override
+    {
+        /* Throw away the command name */
+        poptGetArg(optCon);
+
+        const char* arg = poptGetArg(optCon);
+        if (arg == NULL)
+            dba_cmdline_error(optCon, "you need to specify the date and time before which data is removed");
+        Datetime dt = Datetime::from_iso8601(arg);
+        if (dt.is_missing())
+            dba_cmdline_error(optCon, "the date and time before which data is removed cannot be empty");
+        if (op_batch_size <= 0)
+            dba_cmdline_error(optCon, "--batch-size must be a positive number");
+
+        auto db = connect();
+        unsigned count = db->purge_before(dt, op_batch_size);
+        if (op_verbose)
+            fprintf(stderr, "%u values removed\n", count);
+        return 0;
+    }
+};
+
+/// Rewrite attributes in the current encoding
+struct UpgradeAttrsCmd : public DatabaseCmd
+{
+    UpgradeAttrsCmd()
+    {
+        names.push_back("upgrade-attrs");
+        usage = "upgrade-attrs [options]";
+        desc = "Rewrite attributes using the current compact encoding";
+        longdesc =
+            "Reencode all the attributes stored in the database that still use an older "
+            "binary encoding. Attributes are rewritten in batches, committing after each "
+            "batch. Databases with old attributes can still be read without running this "
+            "command.";
+    }
+
+    void add_to_optable(std::vector<poptOption>& opts) const override
+    {
+        DatabaseCmd::add_to_optable(opts);
+        opts.push_back({ "batch-size", 0, POPT_ARG_INT, &op_batch_size, 0,
+            "number of rows to rewrite in each transaction (default: 10000)", "num" });
+    }
+
+    int main(poptContext optCon) override
+    {
+        if (op_batch_size <= 0)
+            dba_cmdline_error(optCon, "--batch-size must be a positive number");
+
+        auto db = connect();
+        unsigned count = db->upgrade_attrs(op_batch_size);
+        if (op_verbose)
+            fprintf(stderr, "%u values reencoded\n", count);
+        return 0;
+    }
+};
+
+/// Create or drop the summary table
+struct SummaryTableCmd : public DatabaseCmd
+{
+    SummaryTableCmd()
+    {
+        names.push_back("summary-table");
+        usage = "summary-table [options]";
+        desc = "Create the summary table, or drop it with --drop";
+        longdesc =
+            "Create a table with the number of values and the datetime range of each "
+            "combination of station, level, time range and variable. The table is kept "
+            "up to date when data are imported or deleted, and is used to answer summary "
+            "queries that do not filter on datetime or values. Creating it scans all the "
+            "data, and should be done when nothing else is writing to the database.";
+    }
+
+    void add_to_optable(std::vector<poptOption>& opts) const override
+    {
+        DatabaseCmd::add_to_optable(opts);
+        opts.push_back({ "drop", 0, POPT_ARG_NONE, &op_drop, 0,
+            "drop the summary table instead of creating it", 0 });
+    }
+
+    int main(poptContext optCon) override
+    {
+        auto db = connect();
+        db->set_summary_table(!op_drop);
+        return 0;
+    }
+};
+
+/// Write a read-only archive
+struct ArchiveCmd : public DatabaseCmd
+{
+    ArchiveCmd()
+    {
+        names.push_back("archive");
+        usage = "archive [options] pathname [queryparm1=val1 [queryparm2=val2 [...]]]";
+        desc = "Write the contents of the database to a read-only archive";
+        longdesc =
+            "Write all stations and station values, and the measured values selected by the "
+            "query, to an archive file. The archive can then be queried as a read-only "
+            "database using the URL arc:pathname. "
+            "Query parameters are the same of the Fortran API.";
+    }
+
+    int main(poptContext optCon) override
+    {
+        /* Throw away the command name */
+        poptGetArg(optCon);
+
+        const char* pathname = poptGetArg(optCon);
+        if (pathname == NULL)
+            dba_cmdline_error(optCon, "you need to specify the pathname of the archive to write");
+
+        core::Query query;
+        dba_cmdline_get_query(optCon, query);
+
+        auto db = connect();
+        Dbadb dbadb(*db);
+        return dbadb.do_archive(query, pathname);
+    }
+};
+
 /// Update repinfo information in the database
 struct RepinfoCmd : public DatabaseCmd
 {
@@ -383,6 +531,12 @@ struct ExportCmd : public DatabaseCmd
             "template of the data in output (autoselect if not specified, 'list' gives a list)", "name" });
         opts.push_back({ "dump", 0, POPT_ARG_NONE, &op_dump, 0,
             "dump data to be encoded instead of encoding it", 0 });
+        opts.push_back({ "csv", 0, POPT_ARG_NONE, &op_csv, 0,
+            "write data as CSV, in the same format as dbamsg dump --csv --interpreted", 0 });
+        opts.push_back({ "subsets", 0, POPT_ARG_INT, &op_subsets, 0,
+            "encode up to this number of consecutive messages of the same type in the same bulletin (default: 1)", "num" });
+        opts.push_back({ "compress", 0, POPT_ARG_NONE, &op_compress, 0,
+            "use BUFR compression for bulletins with more than one subset", 0 });
     }
 
     int main(poptContext optCon) override
@@ -410,10 +564,18 @@ struct ExportCmd : public DatabaseCmd
         if (op_dump)
         {
             return dbadb.do_export_dump(query, stdout);
+        } else if (op_csv) {
+            return dbadb.do_export_csv(query, stdout);
         } else {
             Encoding type = File::parse_encoding(op_output_type);
             auto file = File::create(type, stdout, false, "w");
-            return dbadb.do_export(query, *file, op_output_template, forced_repmemo);
+            impl::ExporterOptions opts;
+            opts.template_name = op_output_template;
+            if (op_subsets < 1)
+                throw error_consistency("the number of subsets must be at least 1");
+            opts.max_subsets = op_subsets;
+            opts.compress = op_compress;
+            return dbadb.do_export(query, *file, opts, forced_repmemo);
         }
     }
 };
@@ -488,6 +650,10 @@ int main (int argc, const char* argv[])
     dbadb.add_subcommand(new StationsCmd);
     dbadb.add_subcommand(new WipeCmd);
     dbadb.add_subcommand(new CleanupCmd);
+    dbadb.add_subcommand(new PurgeCmd);
+    dbadb.add_subcommand(new ArchiveCmd);
+    dbadb.add_subcommand(new UpgradeAttrsCmd);
+    dbadb.add_subcommand(new SummaryTableCmd);
     dbadb.add_subcommand(new RepinfoCmd);
     dbadb.add_subcommand(new ImportCmd);
     dbadb.add_subcommand(new ExportCmd);
@@ -5,6 +5,7 @@
 #include "dballe/msg/msg.h"
 #include "dballe/msg/context.h"
 #include "dballe/msg/bulletin.h"
+#include "dballe/msg/fileindex.h"
 #include "dballe/file.h"
 #include "dballe/core/query.h"
 #include "dballe/core/matcher.h"
@@ -723,6 +724,56 @@ struct Cat : public cmdline::Subcommand
     }
 };
 
+struct IndexCmd : public cmdline::Subcommand
+{
+    IndexCmd()
+    {
+        names.push_back("index");
+        usage = "index [options] filename [filename [...]]";
+        desc = "Write an index of the messages in a file";
+        longdesc = "Write next to each file a .dbaidx file summarising its messages. "
+            "When filtering, the other commands use the index to read only the "
+            "messages that can match the filter. The index is ignored if the "
+            "file is modified after it has been created.";
+    }
+
+    void add_to_optable(std::vector<poptOption>& opts) const override
+    {
+        Subcommand::add_to_optable(opts);
+        opts.push_back({ "type", 't', POPT_ARG_STRING, &readeropts.input_type, 0,
+            "format of the input data ('bufr', 'crex', 'json')", "type" });
+        opts.push_back({ "precise", 0, 0, &op_precise_import, 0,
+            "import messages using precise contexts instead of standard ones", 0 });
+    }
+
+    int main(poptContext optCon) override
+    {
+        /* Throw away the command name */
+        poptGetArg(optCon);
+
+        auto import_opts = ImporterOptions::create();
+        if (op_precise_import) import_opts->simplified = false;
+
+        auto fnames = get_filenames(optCon);
+        if (fnames.empty())
+            dba_cmdline_error(optCon, "at least one input file needs to be specified");
+
+        for (const auto& name: fnames)
+        {
+            Encoding encoding;
+            if (strcmp(readeropts.input_type, "auto") == 0)
+                encoding = File::create(name, "r")->encoding();
+            else
+                encoding = string_to_encoding(readeropts.input_type);
+
+            auto index = impl::FileIndex::create_sidecar(name, encoding, *import_opts);
+            if (op_verbose)
+                fprintf(stderr, "%s: indexed %zu messages\n", name.c_str(), index->entries.size());
+        }
+        return 0;
+    }
+};
+
 #if 0
 struct StoreMessages : public cmdline::Action, public vector<BinaryMessage>
 {
@@ -1291,6 +1342,10 @@ Here are some example invocations of \\fBdbamsg\\fP:
 
   # Dump the content of a message, interpreted as physical quantities
   dbamsg dump --interpreted file.bufr
+
+  # Index a file, to quickly extract the messages of a station
+  dbamsg index file.bufr
+  dbamsg cat block=16 station=144 file.bufr > station.bufr
 .fi
 )";
 
@@ -1298,6 +1353,7 @@ Here are some example invocations of \\fBdbamsg\\fP:
     dbamsg.add_subcommand(new HeadCmd);
     dbamsg.add_subcommand(new Dump);
     dbamsg.add_subcommand(new Cat);
+    dbamsg.add_subcommand(new IndexCmd);
     dbamsg.add_subcommand(new Bisect);
     dbamsg.add_subcommand(new Convert);
     dbamsg.add_subcommand(new Compare);